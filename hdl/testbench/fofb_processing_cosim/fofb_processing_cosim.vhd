@@ -7,7 +7,10 @@
 -- Standard   : VHDL 2008
 -------------------------------------------------------------------------------
 -- Description: This testbench is intended to be run as a daemon listening to
---              a TCP port for commands. Valid commads are:
+--              a TCP port for commands, or with g_SHM, waiting for a client
+--              of the shared memory transport (sw/lib/fofb_cosim_client.h)
+--              which sends the same commands as binary vectors. Valid TCP
+--              commads are:
 --              - coefficients <list of numbers>
 --              - bpm_setpoints <list of numbers>
 --              - bpm_positions <list of numbers>
@@ -66,8 +69,11 @@ entity fofb_processing_cosim is
     -- Minimum setpoint value (saturation)
     g_SP_MIN                       : integer := -32768;
 
-    -- TCP port to listen to
-    g_TCP_PORT                     : natural := 14050
+    -- TCP port to listen to, or shared memory object key with g_SHM
+    g_TCP_PORT                     : natural := 14050;
+
+    -- Use the shared memory transport instead of TCP
+    g_SHM                          : boolean := false
   );
 end fofb_processing_cosim;
 
@@ -111,15 +117,21 @@ begin
     variable fofb_msg     : t_fofb_server_msg_type;
     variable connected    : boolean := false;
     variable end_simu     : boolean := false;
-    variable data         : std_logic_vector(31 downto 0);
-    variable data_sig     : signed(31 downto 0);
+    variable data_vec     : t_fofb_server_vec;
     variable data_int     : integer;
   begin
     -- Create a new instance of fofb_server
-    fofb_server := new_fofb_server(g_TCP_PORT,
-                                   c_FOFB_GAIN_FRAC_WIDTH,
-                                   31 - g_COEFF_INT_WIDTH,
-                                   g_BPM_POS_FRAC_WIDTH);
+    if g_SHM then
+      fofb_server := new_fofb_server_shm(g_TCP_PORT,
+                                         c_FOFB_GAIN_FRAC_WIDTH,
+                                         31 - g_COEFF_INT_WIDTH,
+                                         g_BPM_POS_FRAC_WIDTH);
+    else
+      fofb_server := new_fofb_server(g_TCP_PORT,
+                                     c_FOFB_GAIN_FRAC_WIDTH,
+                                     31 - g_COEFF_INT_WIDTH,
+                                     g_BPM_POS_FRAC_WIDTH);
+    end if;
     -- Reset all cores
     rst_n <= '0';
     f_wait_cycles(clk, 1);
@@ -130,7 +142,11 @@ begin
     while end_simu = false loop
       -- Waits for new connections, can only handle one at maximum at any given
       -- time
-      report "Waiting for a new connection on port " & to_string(g_TCP_PORT) & " ...";
+      if g_SHM then
+        report "Waiting for a new client on /dev/shm/fofb_cosim_" & to_string(g_TCP_PORT) & " ...";
+      else
+        report "Waiting for a new connection on port " & to_string(g_TCP_PORT) & " ...";
+      end if;
       fofb_server_wait_con(fofb_server);
       connected := true;
 
@@ -144,18 +160,18 @@ begin
           -- New coefficients received, update the coefficients array
           when COEFF_DATA    =>
             report "New coefficients data";
+            fofb_server_read_coeff_vec(fofb_server, data_vec);
             for i in 0 to 511 loop
-              fofb_server_read_coeff(fofb_server, i, data);
-              coeff_data_arr(i) <= data;
+              coeff_data_arr(i) <= std_logic_vector(to_signed(data_vec(i), 32));
             end loop;
 
           -- New BPM set-point (reference orbit) received, update the
           -- set-point array
           when SETPOINT_DATA =>
             report "New BPM set-point data";
+            fofb_server_read_sp_vec(fofb_server, data_vec);
             for i in 0 to 511 loop
-              fofb_server_read_sp(fofb_server, i, data);
-              sp_data_arr(i) <= data;
+              sp_data_arr(i) <= std_logic_vector(to_signed(data_vec(i), 32));
             end loop;
 
           -- New gain value received, update the gain
@@ -166,14 +182,13 @@ begin
 
           -- New BPM position data, compute a new current set-point
           when BPMPOS_DATA   =>
-            report "New BPM Position data";
+            fofb_server_read_bpm_pos_vec(fofb_server, data_vec);
             for i in 0 to 511 loop
-              fofb_server_read_bpm_pos(fofb_server, i, data_sig);
               -- Wait for the fofb_processing core to be ready to receive new data
               f_wait_clocked_signal(clk, busy, '0');
               -- Send BPM position
               bpm_pos_index <= to_unsigned(i, c_SP_COEFF_RAM_ADDR_WIDTH);
-              bpm_pos <= data_sig;
+              bpm_pos <= to_signed(data_vec(i), c_SP_POS_RAM_DATA_WIDTH);
               bpm_pos_valid <= '1';
               f_wait_cycles(clk, 1);
               bpm_pos_valid <= '0';
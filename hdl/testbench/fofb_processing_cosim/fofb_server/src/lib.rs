@@ -1,5 +1,19 @@
 //! # FOFB Server library
-//! Provides an interface for VHDL code to comunicate via TCP sockets.
+//! Provides an interface for VHDL code to comunicate via TCP sockets or, with
+//! `new_fofb_server_shm`, through a shared memory object.
+//!
+//! ## Shared memory transport
+//!
+//! The TCP transport sends each value as text, and the simulation reads them
+//! back one VHPIDIRECT call at a time. The shared memory transport instead
+//! moves whole vectors (coefficients, set-points, BPM positions) as binary
+//! fixed point words through two single-producer single-consumer rings of
+//! messages in `/dev/shm/fofb_cosim_<key>`, and a client may queue many BPM
+//! positions messages ahead of their set-points. The layout is `ShmLayout`,
+//! mirrored by `sw/lib/fofb_cosim_shm.h`; `sw/lib/fofb_cosim_client.h` is the
+//! controller side. `fofb_server_read_coeff_vec`, `fofb_server_read_sp_vec`
+//! and `fofb_server_read_bpm_pos_vec` copy a whole vector into the simulation
+//! with a single call, whatever the transport.
 //!
 //! ## Usage example
 //!
@@ -134,6 +148,27 @@ use core::slice;
 use std::net::{TcpListener, TcpStream, SocketAddr, Shutdown};
 use std::io::prelude::*;
 use std::io::BufReader;
+use std::fs::{File, OpenOptions};
+use std::os::raw::{c_int, c_long, c_void};
+use std::os::unix::io::AsRawFd;
+use std::sync::atomic::{AtomicU32, Ordering};
+use std::time::Duration;
+
+extern "C" {
+    fn mmap(addr: *mut c_void, len: usize, prot: c_int, flags: c_int, fd: c_int, offset: c_long) -> *mut c_void;
+    fn munmap(addr: *mut c_void, len: usize) -> c_int;
+}
+
+const PROT_READ: c_int = 1;
+const PROT_WRITE: c_int = 2;
+const MAP_SHARED: c_int = 1;
+
+const SHM_MAGIC: u32 = 0x46534843;
+const SHM_VERSION: u32 = 1;
+const SHM_RING_SLOTS: u32 = 32;
+const SHM_MSG_MAX_WORDS: usize = 512;
+/// Shared memory response type, the requests types are `FOFBMsgType` values
+const SHM_MSG_CORR_SP: u32 = 0x100;
 
 /// Indicate the message type
 #[repr(C)]
@@ -158,11 +193,94 @@ pub enum FOFBMsgType {
     Exit,
 }
 
+/// Shared memory message: `count` fixed point words
+#[repr(C)]
+struct ShmMsg {
+    msg_type: u32,
+    count: u32,
+    data: [i32; SHM_MSG_MAX_WORDS],
+}
+
+/// Ring index, alone in its cache line
+#[repr(C, align(64))]
+struct ShmIndex {
+    val: AtomicU32,
+}
+
+/// Single-producer single-consumer ring, each index is only written by its
+/// owner side
+#[repr(C)]
+struct ShmRing {
+    head: ShmIndex,
+    tail: ShmIndex,
+    slots: [ShmMsg; SHM_RING_SLOTS as usize],
+}
+
+#[repr(C, align(64))]
+struct ShmHeader {
+    magic: AtomicU32,
+    version: u32,
+    gain_frac_width: i32,
+    coeffs_frac_width: i32,
+    bpm_frac_width: i32,
+    /// Incremented by each new client
+    attach_gen: AtomicU32,
+    /// Copied from `attach_gen` once the server took the new client
+    ack_gen: AtomicU32,
+}
+
+/// Shared memory object layout, must match sw/lib/fofb_cosim_shm.h
+#[repr(C)]
+struct ShmLayout {
+    hdr: ShmHeader,
+    /// Client to simulation
+    req: ShmRing,
+    /// Simulation to client
+    resp: ShmRing,
+}
+
+const _: () = assert!(std::mem::size_of::<ShmLayout>() == 131904);
+
+/// Polls the client: spins, then yields, then sleeps, so that an idle client
+/// doesn't take a CPU away from the simulation
+struct Poller {
+    polls: u32,
+}
+
+impl Poller {
+    fn new() -> Poller {
+        Poller { polls: 0 }
+    }
+
+    fn wait(&mut self) {
+        self.polls = self.polls.saturating_add(1);
+        if self.polls < 64 {
+            std::hint::spin_loop();
+        } else if self.polls < 1024 {
+            std::thread::yield_now();
+        } else {
+            std::thread::sleep(Duration::from_micros(20));
+        }
+    }
+}
+
+enum Transport {
+    Tcp {
+        listener: TcpListener,
+        stream: Option<TcpStream>,
+        reader: Option<BufReader<TcpStream>>,
+    },
+    Shm {
+        path: String,
+        // Keeps the mapping's file open
+        _file: File,
+        map: *mut ShmLayout,
+    },
+}
+
 /// FOFB Server struct
 pub struct FOFBServer {
-    listener: TcpListener,
-    stream: Option<TcpStream>,
-    reader: Option<BufReader<TcpStream>>,
+    transport: Transport,
     gain_frac_width: i32,
     coeffs_frac_width: i32,
     bpm_frac_width: i32,
@@ -184,9 +302,59 @@ pub extern fn new_fofb_server(port: u32, gain_frac_width: i32, coeffs_frac_width
     let addr = SocketAddr::from(([127, 0, 0, 1], port as u16));
     Box::into_raw(Box::new(
         FOFBServer {
-            listener: TcpListener::bind(addr).unwrap(),
-            stream: None,
-            reader: None,
+            transport: Transport::Tcp {
+                listener: TcpListener::bind(addr).unwrap(),
+                stream: None,
+                reader: None,
+            },
+            gain_frac_width,
+            coeffs_frac_width,
+            bpm_frac_width,
+            gain: 0,
+            coeffs: [0; 512],
+            bpm_sp: [0; 512],
+            bpm_pos: [0; 512],
+        }))
+}
+
+/// Returns a pointer to a new `FOFBServer` instance using the shared memory
+/// transport (Linux only)
+///
+/// # Arguments
+/// * `key` - The shared memory object is /dev/shm/fofb_cosim_<key>
+/// * `gain_frac_width` - Fractionary part width in bits of the Gain
+/// * `coeffs_frac_width` - Fractionary part width in bits of the inverse response matrix coefficients'
+/// * `bpm_frac_width` - Fractionary part width in bits of the BPM set-point and position data
+#[no_mangle]
+pub extern fn new_fofb_server_shm(key: u32, gain_frac_width: i32, coeffs_frac_width: i32, bpm_frac_width: i32) -> *mut FOFBServer {
+    let path = format!("/dev/shm/fofb_cosim_{}", key);
+    let size = std::mem::size_of::<ShmLayout>();
+    // Truncating zeroes whatever a previous simulation left, clients wait
+    // for the magic number
+    let file = OpenOptions::new().read(true).write(true).create(true).truncate(true)
+        .open(&path).unwrap();
+    file.set_len(size as u64).unwrap();
+    let map = unsafe {
+        mmap(std::ptr::null_mut(), size, PROT_READ | PROT_WRITE, MAP_SHARED, file.as_raw_fd(), 0)
+    };
+    if map as isize == -1 {
+        panic!("can't map {}", path);
+    }
+    let map = map as *mut ShmLayout;
+    unsafe {
+        (*map).hdr.version = SHM_VERSION;
+        (*map).hdr.gain_frac_width = gain_frac_width;
+        (*map).hdr.coeffs_frac_width = coeffs_frac_width;
+        (*map).hdr.bpm_frac_width = bpm_frac_width;
+        (*map).hdr.magic.store(SHM_MAGIC, Ordering::Release);
+    }
+    Box::into_raw(Box::new(
+        FOFBServer {
+            transport: Transport::Shm {
+                path,
+                _file: file,
+                map,
+            },
             gain_frac_width,
             coeffs_frac_width,
             bpm_frac_width,
@@ -197,16 +365,41 @@ pub extern fn new_fofb_server(port: u32, gain_frac_width: i32, coeffs_frac_width
         }))
 }
 
-/// Wait for a new TCP connection
+/// Wait for a new TCP connection, or a new shared memory client
 ///
 /// # Arguments
 /// * `fsrv` - FOFBServer instance pointer
 #[no_mangle]
 pub extern fn fofb_server_wait_con(fsrv: &mut FOFBServer) {
-    let (socket, addr) = fsrv.listener.accept().unwrap();
-    println!("Connected! {:?}", addr);
-    fsrv.reader = Some(BufReader::new(socket.try_clone().unwrap()));
-    fsrv.stream = Some(socket);
+    match &mut fsrv.transport {
+        Transport::Tcp { listener, stream, reader } => {
+            let (socket, addr) = listener.accept().unwrap();
+            println!("Connected! {:?}", addr);
+            *reader = Some(BufReader::new(socket.try_clone().unwrap()));
+            *stream = Some(socket);
+        },
+        Transport::Shm { path, map, .. } => {
+            let map = *map;
+            let mut poller = Poller::new();
+            let gen = loop {
+                let gen = unsafe { (*map).hdr.attach_gen.load(Ordering::Acquire) };
+                if gen != unsafe { (*map).hdr.ack_gen.load(Ordering::Relaxed) } {
+                    break gen;
+                }
+                poller.wait();
+            };
+            // The new client doesn't touch the rings before the
+            // acknowledgement, drop whatever the previous one left
+            unsafe {
+                let req_head = (*map).req.head.val.load(Ordering::Acquire);
+                (*map).req.tail.val.store(req_head, Ordering::Release);
+                let resp_head = (*map).resp.head.val.load(Ordering::Relaxed);
+                (*map).resp.tail.val.store(resp_head, Ordering::Relaxed);
+                (*map).hdr.ack_gen.store(gen, Ordering::Release);
+            }
+            println!("Connected! {}", path);
+        },
+    }
 }
 
 /// Print internal state of the FOFBServer struct
@@ -314,7 +507,9 @@ fn fofb_server_parse_line(fsrv: &mut FOFBServer, line: &String) -> FOFBMsgType {
                 FOFBMsgType::Debug
             },
             &"disconnect" => {
-                fsrv.stream.as_mut().unwrap().shutdown(Shutdown::Both).unwrap();
+                if let Transport::Tcp { stream: Some(stream), .. } = &mut fsrv.transport {
+                    stream.shutdown(Shutdown::Both).unwrap();
+                }
                 FOFBMsgType::Disconnected
             },
             &"exit" => FOFBMsgType::Exit,
@@ -332,9 +527,9 @@ fn fofb_server_parse_line(fsrv: &mut FOFBServer, line: &String) -> FOFBMsgType {
 /// * `msg_type` - A FOFBMsgType enum pointer for returning the message type received
 #[no_mangle]
 pub extern fn fofb_server_wait_data(fsrv: &mut FOFBServer, msg_type: &mut FOFBMsgType) {
-    match &mut fsrv.reader {
-        None => *msg_type = FOFBMsgType::Disconnected,
-        Some(reader) => {
+    match &mut fsrv.transport {
+        Transport::Tcp { reader: None, .. } => *msg_type = FOFBMsgType::Disconnected,
+        Transport::Tcp { reader: Some(reader), .. } => {
             let mut line = String::new();
             let bytes = reader.read_line(&mut line).unwrap();
             if bytes > 0 {
@@ -343,7 +538,56 @@ pub extern fn fofb_server_wait_data(fsrv: &mut FOFBServer, msg_type: &mut FOFBMs
                 *msg_type = FOFBMsgType::Disconnected;
             }
         },
+        Transport::Shm { map, .. } => {
+            let map = *map;
+            *msg_type = fofb_server_shm_recv(fsrv, map);
+        },
+    }
+}
+
+/// Wait for the next shared memory message and copy its data
+///
+/// # Arguments
+/// * `fsrv` - FOFBServer instance pointer
+/// * `map` - Shared memory object of `fsrv`
+fn fofb_server_shm_recv(fsrv: &mut FOFBServer, map: *mut ShmLayout) -> FOFBMsgType {
+    let tail = unsafe { (*map).req.tail.val.load(Ordering::Relaxed) };
+    let mut poller = Poller::new();
+    while unsafe { (*map).req.head.val.load(Ordering::Acquire) } == tail {
+        poller.wait();
+    }
+
+    let msg = unsafe { &(*map).req.slots[(tail % SHM_RING_SLOTS) as usize] };
+    let count = std::cmp::min(msg.count as usize, SHM_MSG_MAX_WORDS);
+    let msg_type = match msg.msg_type {
+        0 => {
+            fsrv.coeffs[..count].copy_from_slice(&msg.data[..count]);
+            FOFBMsgType::Coeff
+        },
+        1 => {
+            fsrv.bpm_sp[..count].copy_from_slice(&msg.data[..count]);
+            FOFBMsgType::SetPoint
+        },
+        2 => {
+            fsrv.bpm_pos[..count].copy_from_slice(&msg.data[..count]);
+            FOFBMsgType::BPMPos
+        },
+        3 if count >= 1 => {
+            fsrv.gain = msg.data[0];
+            FOFBMsgType::Gain
+        },
+        4 => FOFBMsgType::ClearACC,
+        5 => FOFBMsgType::Debug,
+        6 => FOFBMsgType::Disconnected,
+        8 => FOFBMsgType::Exit,
+        _ => FOFBMsgType::ParseErr,
+    };
+    unsafe { (*map).req.tail.val.store(tail.wrapping_add(1), Ordering::Release) };
+
+    if let FOFBMsgType::Debug = msg_type {
+        fofb_server_print_state(fsrv);
     }
+    msg_type
 }
 
 /// Convert a 32 bits number to GHDL's internal representation of std_logic_vector
@@ -401,6 +645,45 @@ pub extern fn fofb_server_read_bpm_pos(fsrv: &mut FOFBServer, index: u32, bpm_po
     }
 }
 
+/// Copy a whole vector of fixed point words
+///
+/// # Arguments
+/// * `src` - Last received data
+/// * `vec` - Buffer as an array (0 to 511) of integer
+fn fofb_server_read_vec(src: &[i32; 512], vec: &mut [i32; 512]) {
+    vec.copy_from_slice(src);
+}
+
+/// Read all the coefficients with a single call
+///
+/// # Arguments
+/// * `fsrv` - FOFBServer instance pointer
+/// * `coeffs` - Coefficients buffer as t_fofb_server_vec, coefficient 0 first
+#[no_mangle]
+pub extern fn fofb_server_read_coeff_vec(fsrv: &mut FOFBServer, coeffs: &mut [i32; 512]) {
+    fofb_server_read_vec(&fsrv.coeffs, coeffs);
+}
+
+/// Read all the BPM set-points with a single call
+///
+/// # Arguments
+/// * `fsrv` - FOFBServer instance pointer
+/// * `bpm_sp` - BPM set-points buffer as t_fofb_server_vec, set-point 0 first
+#[no_mangle]
+pub extern fn fofb_server_read_sp_vec(fsrv: &mut FOFBServer, bpm_sp: &mut [i32; 512]) {
+    fofb_server_read_vec(&fsrv.bpm_sp, bpm_sp);
+}
+
+/// Read all the BPM positions with a single call
+///
+/// # Arguments
+/// * `fsrv` - FOFBServer instance pointer
+/// * `bpm_pos` - BPM positions buffer as t_fofb_server_vec, position 0 first
+#[no_mangle]
+pub extern fn fofb_server_read_bpm_pos_vec(fsrv: &mut FOFBServer, bpm_pos: &mut [i32; 512]) {
+    fofb_server_read_vec(&fsrv.bpm_pos, bpm_pos);
+}
+
 /// Read the gain as an integer
 ///
 /// # Arguments
@@ -418,13 +701,28 @@ pub extern fn fofb_server_read_gain(fsrv: &mut FOFBServer, gain: &mut i32) {
 /// * `corrector_sp` - Current set-point to be sent to the client
 #[no_mangle]
 pub extern fn fofb_server_write_sp(fsrv: &mut FOFBServer, corrector_sp: i32) {
-    match &mut fsrv.stream {
-        Some(stream) => {
+    match &mut fsrv.transport {
+        Transport::Tcp { stream: Some(stream), .. } => {
             let corrector_sp_str = corrector_sp.to_string();
             stream.write(corrector_sp_str.as_bytes()).unwrap();
             stream.write("\n".as_bytes()).unwrap();
         },
-        None => (),
+        Transport::Tcp { stream: None, .. } => (),
+        Transport::Shm { map, .. } => {
+            let map = *map;
+            let head = unsafe { (*map).resp.head.val.load(Ordering::Relaxed) };
+            let mut poller = Poller::new();
+            while head.wrapping_sub(unsafe { (*map).resp.tail.val.load(Ordering::Acquire) }) == SHM_RING_SLOTS {
+                poller.wait();
+            }
+            unsafe {
+                let msg = &mut (*map).resp.slots[(head % SHM_RING_SLOTS) as usize];
+                msg.msg_type = SHM_MSG_CORR_SP;
+                msg.count = 1;
+                msg.data[0] = corrector_sp;
+                (*map).resp.head.val.store(head.wrapping_add(1), Ordering::Release);
+            }
+        },
     }
 }
 
@@ -435,8 +733,10 @@ pub extern fn fofb_server_write_sp(fsrv: &mut FOFBServer, corrector_sp: i32) {
 #[no_mangle]
 pub extern fn fofb_server_delete(fsrv: *mut FOFBServer) {
     if !fsrv.is_null() {
-        unsafe {
-            Box::from_raw(fsrv);
+        let fsrv = unsafe { Box::from_raw(fsrv) };
+        if let Transport::Shm { path, map, .. } = &fsrv.transport {
+            unsafe { munmap(*map as *mut c_void, std::mem::size_of::<ShmLayout>()) };
+            let _ = std::fs::remove_file(path);
         }
     }
 }
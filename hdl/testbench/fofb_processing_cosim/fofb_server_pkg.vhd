@@ -29,6 +29,10 @@ package fofb_server_pkg is
   -- the memory pointed by the 'access' type.
   type t_fofb_server is access integer;
   type t_fofb_server_msg_type is (COEFF_DATA, SETPOINT_DATA, BPMPOS_DATA, GAIN_DATA, CLEAR_ACC, DEBUG, DISCONNECTED, PARSEERR, EXIT_SIMU);
+  -- A whole coefficients, set-points or BPM positions vector. Being a
+  -- constrained array of integers, GHDL passes it to the foreign code as a
+  -- pointer to 512 32 bits words.
+  type t_fofb_server_vec is array (0 to 511) of integer;
 
   -- Create a new fofb server instance.
   impure function new_fofb_server (tcp_port          : natural range 0 to 65535;
@@ -38,6 +42,16 @@ package fofb_server_pkg is
                                    return t_fofb_server;
   attribute foreign of new_fofb_server : function is "VHPIDIRECT new_fofb_server";
 
+  -- Create a new fofb server instance using the shared memory transport
+  -- (/dev/shm/fofb_cosim_<key>, see sw/lib/fofb_cosim_client.h) instead of
+  -- TCP. Every other procedure works the same with both transports.
+  impure function new_fofb_server_shm (key               : natural range 0 to 65535;
+                                       gain_frac_width   : natural range 0 to 31;
+                                       coeffs_frac_width : natural range 0 to 31;
+                                       bpm_frac_width    : natural range 0 to 31)
+                                       return t_fofb_server;
+  attribute foreign of new_fofb_server_shm : function is "VHPIDIRECT new_fofb_server_shm";
+
   -- Wait for a new client connection.
   procedure fofb_server_wait_con(variable obj : in  t_fofb_server);
   attribute foreign of fofb_server_wait_con: procedure is "VHPIDIRECT fofb_server_wait_con";
@@ -71,6 +85,24 @@ package fofb_server_pkg is
                                      variable bpm_pos : out signed(31 downto 0));
   attribute foreign of fofb_server_read_bpm_pos: procedure is "VHPIDIRECT fofb_server_read_bpm_pos";
 
+  -- Read all the matrix inverse response coefficients with a single call.
+  -- It is non-blocking, always return a copy of the last received data.
+  procedure fofb_server_read_coeff_vec(variable obj    : in  t_fofb_server;
+                                       variable coeffs : out t_fofb_server_vec);
+  attribute foreign of fofb_server_read_coeff_vec: procedure is "VHPIDIRECT fofb_server_read_coeff_vec";
+
+  -- Read all the BPM set-point values with a single call. It is
+  -- non-blocking, always return a copy of the last received data.
+  procedure fofb_server_read_sp_vec(variable obj : in  t_fofb_server;
+                                    variable sp  : out t_fofb_server_vec);
+  attribute foreign of fofb_server_read_sp_vec: procedure is "VHPIDIRECT fofb_server_read_sp_vec";
+
+  -- Read all the BPM position values with a single call. It is
+  -- non-blocking, always return a copy of the last received data.
+  procedure fofb_server_read_bpm_pos_vec(variable obj     : in  t_fofb_server;
+                                         variable bpm_pos : out t_fofb_server_vec);
+  attribute foreign of fofb_server_read_bpm_pos_vec: procedure is "VHPIDIRECT fofb_server_read_bpm_pos_vec";
+
   -- Read the gain value. It is non-blocking, always return a copy of the
   -- last received data.
   procedure fofb_server_read_gain(variable obj  : in  t_fofb_server;
@@ -91,6 +123,13 @@ package body fofb_server_pkg is
                                    return t_fofb_server is
   begin report "VHPIDIRECT new_fofb_server" severity failure; end;
 
+  impure function new_fofb_server_shm (key               : natural range 0 to 65535;
+                                       gain_frac_width   : natural range 0 to 31;
+                                       coeffs_frac_width : natural range 0 to 31;
+                                       bpm_frac_width    : natural range 0 to 31)
+                                       return t_fofb_server is
+  begin report "VHPIDIRECT new_fofb_server_shm" severity failure; end;
+
   procedure fofb_server_wait_con(variable obj : in  t_fofb_server
                                  ) is
   begin report "VHPIDIRECT fofb_server_wait_con" severity failure; end;
@@ -118,6 +157,21 @@ package body fofb_server_pkg is
                                      ) is
   begin report "VHPIDIRECT fofb_server_read_bpm_pos" severity failure; end;
 
+  procedure fofb_server_read_coeff_vec(variable obj    : in  t_fofb_server;
+                                       variable coeffs : out t_fofb_server_vec
+                                       ) is
+  begin report "VHPIDIRECT fofb_server_read_coeff_vec" severity failure; end;
+
+  procedure fofb_server_read_sp_vec(variable obj : in  t_fofb_server;
+                                    variable sp  : out t_fofb_server_vec
+                                    ) is
+  begin report "VHPIDIRECT fofb_server_read_sp_vec" severity failure; end;
+
+  procedure fofb_server_read_bpm_pos_vec(variable obj     : in  t_fofb_server;
+                                         variable bpm_pos : out t_fofb_server_vec
+                                         ) is
+  begin report "VHPIDIRECT fofb_server_read_bpm_pos_vec" severity failure; end;
+
   procedure fofb_server_read_gain(variable obj  : in  t_fofb_server;
                                   variable gain : out integer
                                   ) is
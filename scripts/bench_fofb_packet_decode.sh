@@ -0,0 +1,37 @@
+#!/usr/bin/env bash
+
+# Compares sw/build/fofb_packet_decode against reformat_fofb_packet_v2.py on
+# the same binary capture (8 words per packet): checks both produce the same
+# table and reports the time each one takes.
+#
+# usage: bench_fofb_packet_decode.sh <capture.bin>
+
+set -euo pipefail
+
+CAPTURE=$1
+SCRIPTS_DIR=$(dirname "$0")
+DECODER=${DECODER:-${SCRIPTS_DIR}/../sw/build/fofb_packet_decode}
+
+TMP=$(mktemp -d)
+trap "rm -rf ${TMP}" EXIT
+
+# reformat_fofb_packet_v2.py reads one packet per line, as signed decimals
+python3 -c '
+import struct, sys
+with open(sys.argv[1], "rb") as f:
+    for w in struct.iter_unpack("<8i", f.read()):
+        print("\t".join(map(str, w)))
+' "${CAPTURE}" > "${TMP}/capture.txt"
+
+echo "reformat_fofb_packet_v2.py:"
+time python3 "${SCRIPTS_DIR}/reformat_fofb_packet_v2.py" int32 \
+    < "${TMP}/capture.txt" > "${TMP}/py.txt"
+
+echo "fofb_packet_decode -f table:"
+time "${DECODER}" -f table "${CAPTURE}" > "${TMP}/native.txt"
+
+echo "fofb_packet_decode -f cols:"
+"${DECODER}" -s -o "${TMP}/cols" "${CAPTURE}"
+
+cmp "${TMP}/py.txt" "${TMP}/native.txt"
+echo "Tables match"
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+
+# Convert a sw/build/fofb_err_telemetry file to the CSV files written by
+# log_to_csv_files.py: <basename><board>_<halcs>.txt, ready for plot_csv.py.
+#
+# usage: err_telemetry_to_csv.py <file> [step]
+#
+# Records are only written on a change, a failure or the keepalive interval,
+# so each target is expanded to one line every 'step' polling intervals (1
+# by default; the polling rate for one line per second, like
+# get_fofb_errors.sh logs), with the accumulated counters carried over the
+# intervals without records. Acquisitions appended to the same file follow
+# each other.
+
+import sys
+import os
+import struct
+import pandas as pd
+
+try:
+    input = sys.argv[1]
+    input_basename = os.path.splitext(input)[0]
+except (IndexError):
+    print("Invalid or missing filename")
+    sys.exit(1)
+
+try:
+    step = int(sys.argv[2]) if len(sys.argv) > 2 else 1
+    if step < 1:
+        raise ValueError
+except (ValueError):
+    print("Invalid step")
+    sys.exit(1)
+
+# See sw/lib/fofb_err_telemetry.h
+HEADER = struct.Struct("<8sII")
+RECORD = struct.Struct("<QIBBBx12I")
+MAGIC = b"FOFBERRS"
+REC_START = 0x1
+REC_FAIL = 0x2
+
+columns = ["hard_err_cnt_1", "hard_err_cnt_2", "hard_err_cnt_3", "hard_err_cnt_4",
+           "soft_err_cnt_1", "soft_err_cnt_2", "soft_err_cnt_3", "soft_err_cnt_4",
+           "frame_err_cnt_1", "frame_err_cnt_2", "frame_err_cnt_3", "frame_err_cnt_4"]
+
+with open(input, "rb") as f:
+    data = f.read()
+
+if len(data) < HEADER.size:
+    print("Not an error telemetry file")
+    sys.exit(1)
+magic, version, record_size = HEADER.unpack_from(data)
+if magic != MAGIC or version != 1 or record_size != RECORD.size:
+    print("Not an error telemetry file")
+    sys.exit(1)
+
+# A record torn by a crash at the end is ignored, like
+# read_err_telemetry_file() does
+end = HEADER.size + (len(data) - HEADER.size) // RECORD.size * RECORD.size
+
+# (board, halcs) -> accumulated counters (None until the first good read), one
+# row per 'step' intervals, the row and seq the rows are counted from in the
+# current acquisition, and the last seq
+targets = {}
+for rec in RECORD.iter_unpack(data[HEADER.size:end]):
+    t_ns, seq, board, halcs, flags = rec[:5]
+    cnt = rec[5:]
+    counters, rows, anchor, last_seq = targets.get((board, halcs), (None, [], (0, 0), -1))
+    if seq < last_seq or counters is None:
+        # A later acquisition, or the first counters of the target
+        anchor = (len(rows), seq)
+    row = anchor[0] + (seq - anchor[1]) // step
+
+    # Counters unchanged over the intervals without records
+    while counters is not None and len(rows) < row:
+        rows.append(counters)
+
+    if flags & REC_FAIL:
+        pass
+    elif flags & REC_START:
+        counters = list(cnt)
+    elif counters is not None:
+        counters = [(a + d) & 0xffffffff for a, d in zip(counters, cnt)]
+    if counters is not None:
+        if row < len(rows):
+            rows[row] = counters
+        else:
+            rows.append(counters)
+    targets[(board, halcs)] = (counters, rows, anchor, seq)
+
+for (board, halcs), (counters, rows, anchor, last_seq) in targets.items():
+    if not rows:
+        continue
+    with open(input_basename + str(board) + "_" + str(halcs) + ".txt", "w") as f:
+        df = pd.DataFrame(rows, columns = columns)
+        df.to_csv(f, index=False)
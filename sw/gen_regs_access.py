@@ -0,0 +1,190 @@
+#!/usr/bin/env python3
+#
+# Generates the typed register access headers (see lib/fofb_reg_access.h)
+# from the cheby register maps.
+#
+# The register hierarchy comes from the .cheby file, while addresses, sizes
+# and field masks are taken from the macros of the cheby-generated C header,
+# so the result is always consistent with it.
+#
+# usage: gen_regs_access.py <map.cheby> <output.h>
+
+# Copyright (c) 2026 CNPEM
+# Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+import os
+import re
+import sys
+
+import yaml
+
+# Read-only registers whose value is fixed at synthesis time (generics),
+# cached by reg_block after the first read
+CONSTANT_REGS = {
+    'wb_fofb_processing_regs': [
+        'fixed_point_pos/coeff',
+        'fixed_point_pos/accs_gains',
+        'sp_decim_ratio_max',
+    ],
+    'wb_fofb_shaper_filt_regs': [
+        'num_biquads',
+        'coeffs_fp_repr',
+    ],
+    'wb_fofb_sys_id_regs': [
+        'bpm_pos_flatenizer/max_num_cte',
+        'prbs/sp_distort_mov_avg_max_num_taps_sel_cte',
+    ],
+    'fofb_cc_regs': [],
+}
+
+SIZE_UNITS = {'k': 1024, 'M': 1024 * 1024}
+
+
+def parse_size(size):
+    m = re.fullmatch(r'(\d+)([kM]?)', str(size))
+    return int(m.group(1)) * SIZE_UNITS.get(m.group(2), 1)
+
+
+def field_range(rng):
+    parts = str(rng).split('-')
+    hi = int(parts[0])
+    lo = int(parts[-1])
+    return hi, lo
+
+
+class generator:
+    def __init__(self, mmap):
+        self.map_name = mmap['name']
+        self.prefix = self.map_name.upper()
+        self.consts = CONSTANT_REGS.get(self.map_name, [])
+        self.out = []
+
+    def emit(self, level, line=''):
+        self.out.append(('  ' * level + line) if line else '')
+
+    def gen_fields(self, level, reg, macro):
+        fields = reg.get('children', [])
+        for c in fields:
+            f = c['field']
+            hi, lo = field_range(f['range'])
+            fmacro = macro + '_' + f['name'].upper()
+            if hi != lo:
+                fmacro += '_MASK'
+            self.emit(level, 'using %s = field<%s>;' % (f['name'], fmacro))
+        # A register without fields is a single value; memory registers are
+        # often named 'val' already, which the alias can't repeat
+        if not fields and reg['name'] != 'val':
+            self.emit(level, 'using val = field<width_mask(%d)>;' % reg.get('width', 32))
+
+    def gen_reg(self, level, reg, path, macro, addr_expr, mem):
+        name = reg['name']
+        acc = reg.get('access', 'rw')
+        width = reg.get('width', 32)
+        full_path = '/'.join(path + [name])
+        if mem:
+            base = 'mem_reg_def<%s + %s, %s, %s, access::%s, %d>' % (
+                mem['addr'], macro, mem['stride'], mem['depth'], acc, width)
+        elif full_path in self.consts:
+            base = 'reg_def<%s, access::ro_const, %d, %d>' % (
+                addr_expr, width, self.consts.index(full_path))
+        else:
+            base = 'reg_def<%s, access::%s, %d>' % (addr_expr, acc, width)
+        self.emit(level, 'struct %s : %s {' % (name, base))
+        self.gen_fields(level + 1, reg, macro)
+        self.emit(level, '};')
+
+    def gen_children(self, level, node, path, macro, rel_base, mem=None):
+        for c in node.get('children', []):
+            (kind, child), = c.items()
+            name = child['name']
+            cmacro = macro + '_' + name.upper()
+            # Inside repeats and memories the cheby macros are relative to
+            # the element
+            addr_expr = cmacro if rel_base is None else '%s + %s' % (rel_base, cmacro)
+
+            if kind == 'reg':
+                self.gen_reg(level, child, path, cmacro, addr_expr, mem)
+
+            elif kind == 'block':
+                self.emit(level, 'struct %s {' % name)
+                self.gen_children(level + 1, child, path + [name], cmacro, rel_base)
+                self.emit(level, '};')
+
+            elif kind == 'memory':
+                regs = child.get('children', [])
+                stride = cmacro + '_SIZE'
+                depth = parse_size(child['memsize']) // 4 // len(regs)
+                self.emit(level, 'struct %s {' % name)
+                self.emit(level + 1, 'static constexpr size_t depth = %d;' % depth)
+                self.gen_children(level + 1, child, path + [name], cmacro, None,
+                                  {'addr': addr_expr, 'stride': stride, 'depth': depth})
+                self.emit(level, '};')
+
+            elif kind == 'repeat':
+                count = child['count']
+                self.emit(level, '// %s[I], templated on the number of instantiated elements'
+                          % name)
+                self.emit(level, 'template <unsigned I, unsigned N = %d>' % count)
+                self.emit(level, 'struct %s {' % name)
+                self.emit(level + 1, 'static_assert(N <= %d, "%s supports up to %d elements");'
+                          % (count, name, count))
+                self.emit(level + 1, 'static_assert(I < N, "%s index out of range");' % name)
+                self.emit(level + 1, 'static constexpr size_t count = N;')
+                self.emit(level + 1, 'static constexpr size_t base = %s + I * %s_SIZE;'
+                          % (addr_expr, cmacro))
+                self.gen_children(level + 1, child, path + [name], cmacro, 'base')
+                self.emit(level, '};')
+
+            else:
+                raise ValueError('unsupported cheby node: ' + kind)
+
+    def generate(self, mmap, src_name):
+        guard = self.prefix + '_ACCESS_H_'
+        self.emit(0, '// Typed register access for %s' % self.map_name)
+        self.emit(0, '//')
+        self.emit(0, '// Generated by gen_regs_access.py from %s, do not edit.' % src_name)
+        self.emit(0)
+        self.emit(0, '// Copyright (c) 2026 CNPEM')
+        self.emit(0, '// Licensed under GNU Lesser General Public License (LGPL) v3.0')
+        self.emit(0)
+        self.emit(0, '#ifndef ' + guard)
+        self.emit(0, '#define ' + guard)
+        self.emit(0)
+        self.emit(0, '#include "fofb_reg_access.h"')
+        self.emit(0)
+        self.emit(0, 'namespace fofb {')
+        self.emit(0, 'namespace regs {')
+        self.emit(0)
+        self.emit(0, 'struct %s {' % self.map_name)
+        self.emit(1, 'static constexpr size_t size = %s_SIZE;' % self.prefix)
+        self.emit(1, 'static constexpr unsigned num_consts = %d;' % len(self.consts))
+        self.emit(0)
+        self.gen_children(1, mmap, [], self.prefix, None)
+        self.emit(0, '};')
+        self.emit(0)
+        self.emit(0, 'static_assert(%s::size == sizeof(::%s), "%s layout mismatch");'
+                  % (self.map_name, self.map_name, self.map_name))
+        self.emit(0)
+        self.emit(0, '} // namespace regs')
+        self.emit(0, '} // namespace fofb')
+        self.emit(0)
+        self.emit(0, '#endif // ' + guard)
+        return '\n'.join(self.out) + '\n'
+
+
+def main():
+    if len(sys.argv) != 3:
+        print('usage: %s <map.cheby> <output.h>' % sys.argv[0], file=sys.stderr)
+        sys.exit(1)
+
+    with open(sys.argv[1]) as f:
+        mmap = yaml.safe_load(f)['memory-map']
+
+    gen = generator(mmap)
+    src = gen.generate(mmap, os.path.basename(sys.argv[1]))
+    with open(sys.argv[2], 'w') as f:
+        f.write(src)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,488 @@
+// Compressed columnar archive of orbit, set-point and error counter history
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "fofb_archive.h"
+#include "fofb_host.h"
+
+namespace fofb {
+
+namespace {
+
+// Values per lane in a block
+constexpr unsigned c_LANE_VALUES = c_ARCHIVE_BLOCK / c_ARCHIVE_LANES;
+
+// Column chunk header: base value and number of blocks
+constexpr size_t c_COLUMN_HDR = 8;
+
+size_t round4(size_t n)
+{
+  return (n + 3) & ~size_t(3);
+}
+
+uint32_t zigzag(uint32_t d)
+{
+  return (d << 1) ^ uint32_t(int32_t(d) >> 31);
+}
+
+uint32_t unzigzag(uint32_t z)
+{
+  return (z >> 1) ^ (0 - (z & 1));
+}
+
+// Word 'i' of a block, which needn't be aligned in memory
+uint32_t word(const uint8_t *words, unsigned i)
+{
+  uint32_t v;
+  std::memcpy(&v, words + i * sizeof(uint32_t), sizeof(v));
+  return v;
+}
+
+// Value 'k' of lane 'l' of a block packed with 'w' bits
+uint32_t unpack(const uint8_t *words, unsigned w, unsigned k, unsigned l)
+{
+  const unsigned off = k * w;
+  const unsigned j = off / 32, s = off % 32;
+  uint32_t v = word(words, j * c_ARCHIVE_LANES + l) >> s;
+  if (s + w > 32)
+    v |= word(words, (j + 1) * c_ARCHIVE_LANES + l) << (32 - s);
+  return w < 32 ? v & ((uint32_t(1) << w) - 1) : v;
+}
+
+uint32_t decode_block_seq(const uint8_t *words, unsigned w, uint32_t prev, int32_t *out)
+{
+  for (unsigned k = 0; k < c_LANE_VALUES; k++) {
+    for (unsigned l = 0; l < c_ARCHIVE_LANES; l++) {
+      prev += w ? unzigzag(unpack(words, w, k, l)) : 0;
+      out[k * c_ARCHIVE_LANES + l] = int32_t(prev);
+    }
+  }
+  return prev;
+}
+
+#ifdef __AVX2__
+uint32_t decode_block_vec(const uint8_t *words, unsigned w, uint32_t prev, int32_t *out)
+{
+  __m256i carry = _mm256_set1_epi32(int32_t(prev));
+  if (w == 0) {
+    for (unsigned k = 0; k < c_LANE_VALUES; k++)
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k * c_ARCHIVE_LANES), carry);
+    return prev;
+  }
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i mask = _mm256_set1_epi32(w < 32 ? int32_t((uint32_t(1) << w) - 1) : -1);
+  const __m256i idx3 = _mm256_set1_epi32(3);
+  const __m256i idx7 = _mm256_set1_epi32(7);
+  for (unsigned k = 0; k < c_LANE_VALUES; k++) {
+    const unsigned off = k * w;
+    const unsigned j = off / 32, s = off % 32;
+    __m256i v = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i *>(words + j * sizeof(__m256i)));
+    v = _mm256_srl_epi32(v, _mm_cvtsi32_si128(int(s)));
+    if (s + w > 32) {
+      const __m256i hi = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i *>(words + (j + 1) * sizeof(__m256i)));
+      v = _mm256_or_si256(v, _mm256_sll_epi32(hi, _mm_cvtsi32_si128(int(32 - s))));
+    }
+    v = _mm256_and_si256(v, mask);
+    // Zigzag decode
+    __m256i d = _mm256_xor_si256(_mm256_srli_epi32(v, 1),
+                                 _mm256_sub_epi32(zero, _mm256_and_si256(v, one)));
+    // Prefix sum: within each 128 bits half, then the low half's total
+    // carried to the high half, then the previous values
+    d = _mm256_add_epi32(d, _mm256_slli_si256(d, 4));
+    d = _mm256_add_epi32(d, _mm256_slli_si256(d, 8));
+    d = _mm256_add_epi32(d, _mm256_blend_epi32(zero, _mm256_permutevar8x32_epi32(d, idx3),
+                                               0xf0));
+    d = _mm256_add_epi32(d, carry);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k * c_ARCHIVE_LANES), d);
+    carry = _mm256_permutevar8x32_epi32(d, idx7);
+  }
+  return uint32_t(_mm256_cvtsi256_si32(carry));
+}
+#endif
+
+} // namespace
+
+void archive_encode_column(const int32_t *vals, size_t n, std::vector<uint8_t> &out)
+{
+  const uint32_t nblocks = uint32_t((n + c_ARCHIVE_BLOCK - 1) / c_ARCHIVE_BLOCK);
+  const int32_t base = n ? vals[0] : 0;
+  const size_t start = out.size();
+  out.resize(start + c_COLUMN_HDR + round4(nblocks));
+  std::memcpy(&out[start], &base, sizeof(base));
+  std::memcpy(&out[start + 4], &nblocks, sizeof(nblocks));
+
+  uint32_t zz[c_ARCHIVE_BLOCK];
+  uint32_t words[c_ARCHIVE_BLOCK];
+  uint32_t prev = uint32_t(base);
+  for (uint32_t b = 0; b < nblocks; b++) {
+    uint32_t all = 0;
+    for (unsigned i = 0; i < c_ARCHIVE_BLOCK; i++) {
+      const size_t idx = size_t(b) * c_ARCHIVE_BLOCK + i;
+      // The last block is padded with repeats of the last value
+      const uint32_t v = idx < n ? uint32_t(vals[idx]) : prev;
+      zz[i] = zigzag(v - prev);
+      prev = v;
+      all |= zz[i];
+    }
+    const unsigned w = all ? 32 - __builtin_clz(all) : 0;
+    out[start + c_COLUMN_HDR + b] = uint8_t(w);
+
+    std::fill(words, words + w * c_ARCHIVE_LANES, 0);
+    for (unsigned k = 0; k < c_LANE_VALUES && w; k++) {
+      const unsigned off = k * w;
+      const unsigned j = off / 32, s = off % 32;
+      for (unsigned l = 0; l < c_ARCHIVE_LANES; l++) {
+        const uint32_t z = zz[k * c_ARCHIVE_LANES + l];
+        words[j * c_ARCHIVE_LANES + l] |= z << s;
+        if (s + w > 32)
+          words[(j + 1) * c_ARCHIVE_LANES + l] |= z >> (32 - s);
+      }
+    }
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(words);
+    out.insert(out.end(), p, p + w * c_ARCHIVE_LANES * sizeof(uint32_t));
+  }
+}
+
+void archive_decode_column(const uint8_t *data, size_t size, size_t n, int32_t *out,
+                           bool force_scalar)
+{
+  int32_t base;
+  uint32_t nblocks;
+  if (size < c_COLUMN_HDR)
+    throw std::runtime_error("corrupt archive column");
+  std::memcpy(&base, data, sizeof(base));
+  std::memcpy(&nblocks, data + 4, sizeof(nblocks));
+  if (nblocks != (n + c_ARCHIVE_BLOCK - 1) / c_ARCHIVE_BLOCK ||
+      size < c_COLUMN_HDR + round4(nblocks))
+    throw std::runtime_error("corrupt archive column");
+
+  const uint8_t *widths = data + c_COLUMN_HDR;
+  size_t pos = c_COLUMN_HDR + round4(nblocks);
+  uint32_t prev = uint32_t(base);
+  for (uint32_t b = 0; b < nblocks; b++) {
+    const unsigned w = widths[b];
+    const size_t len = size_t(w) * c_ARCHIVE_LANES * sizeof(uint32_t);
+    if (w > 32 || pos + len > size)
+      throw std::runtime_error("corrupt archive column");
+    const uint8_t *words = data + pos;
+    int32_t *o = out + size_t(b) * c_ARCHIVE_BLOCK;
+#ifdef __AVX2__
+    if (!force_scalar)
+      prev = decode_block_vec(words, w, prev, o);
+    else
+      prev = decode_block_seq(words, w, prev, o);
+#else
+    (void)force_scalar;
+    prev = decode_block_seq(words, w, prev, o);
+#endif
+    pos += len;
+  }
+}
+
+archive_writer::archive_writer(const std::string &fn, const std::vector<std::string> &columns,
+                               unsigned rows):
+  fname(fn),
+  tmp(fn + ".tmp"),
+  names(columns),
+  chunk_rows(rows),
+  cols(columns.size())
+{
+  if (columns.empty())
+    throw std::invalid_argument("archive without columns");
+  for (const std::string &name: columns)
+    if (name.empty() || name.size() >= c_ARCHIVE_NAME_LEN)
+      throw std::invalid_argument("invalid archive column name: " + name);
+  if (chunk_rows == 0)
+    throw std::invalid_argument("empty archive chunks");
+
+  tf.reserve(chunk_rows);
+  rel_tf.reserve(chunk_rows);
+  for (std::vector<int32_t> &c: cols)
+    c.reserve(chunk_rows);
+
+  f = std::fopen(tmp.c_str(), "wb");
+  if (!f)
+    throw std::runtime_error("can't open " + tmp);
+  // Written again by close()
+  const archive_file_header hdr = {};
+  write(&hdr, sizeof(hdr));
+}
+
+archive_writer::~archive_writer()
+{
+  if (f) {
+    std::fclose(f);
+    std::remove(tmp.c_str());
+  }
+}
+
+void archive_writer::write(const void *p, size_t n)
+{
+  if (n == 0)
+    return;
+  if (std::fwrite(p, 1, n, f) != n)
+    throw std::runtime_error(tmp + ": write error");
+  offset += n;
+}
+
+void archive_writer::append(uint64_t t, const int32_t *vals)
+{
+  if (!f)
+    throw std::logic_error("archive already closed");
+  const uint64_t last = tf.empty() ? (chunks.empty() ? 0 : chunks.back().tf_last) : tf.back();
+  if (t < last)
+    throw std::invalid_argument("archive rows must be in timeframe order");
+  // Timeframes are stored relative to the chunk's first one, on 32 bits
+  if (tf.size() == chunk_rows || (!tf.empty() && t - tf.front() >= (uint64_t(1) << 31)))
+    flush_chunk();
+  tf.push_back(t);
+  for (size_t c = 0; c < cols.size(); c++)
+    cols[c].push_back(vals[c]);
+  n_rows++;
+}
+
+void archive_writer::flush_chunk()
+{
+  if (tf.empty())
+    return;
+  archive_chunk_desc d = {};
+  d.tf_first = tf.front();
+  d.tf_last = tf.back();
+  d.rows = uint32_t(tf.size());
+  chunks.push_back(d);
+
+  rel_tf.resize(tf.size());
+  for (size_t i = 0; i < tf.size(); i++)
+    rel_tf[i] = int32_t(uint32_t(tf[i] - d.tf_first));
+  for (size_t c = 0; c <= cols.size(); c++) {
+    const std::vector<int32_t> &v = c ? cols[c - 1] : rel_tf;
+    enc.clear();
+    archive_encode_column(v.data(), v.size(), enc);
+    refs.push_back({offset, enc.size()});
+    write(enc.data(), enc.size());
+  }
+
+  tf.clear();
+  for (std::vector<int32_t> &c: cols)
+    c.clear();
+}
+
+void archive_writer::close()
+{
+  if (!f)
+    return;
+  try {
+    flush_chunk();
+    // The index is read in place from the mapping, align it for its 64 bits fields
+    const uint8_t pad[8] = {};
+    write(pad, (8 - offset % 8) % 8);
+    archive_file_header hdr = {};
+    std::memcpy(hdr.magic, c_ARCHIVE_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = c_ARCHIVE_FILE_VERSION;
+    hdr.columns = uint32_t(names.size());
+    hdr.chunk_rows = chunk_rows;
+    hdr.block_values = c_ARCHIVE_BLOCK;
+    hdr.rows = n_rows;
+    hdr.chunks = chunks.size();
+    hdr.index_offset = offset;
+    for (const std::string &name: names) {
+      char buf[c_ARCHIVE_NAME_LEN] = {};
+      std::memcpy(buf, name.data(), name.size());
+      write(buf, sizeof(buf));
+    }
+    write(chunks.data(), chunks.size() * sizeof(archive_chunk_desc));
+    write(refs.data(), refs.size() * sizeof(archive_column_ref));
+    if (std::fseek(f, 0, SEEK_SET) || std::fwrite(&hdr, sizeof(hdr), 1, f) != 1)
+      throw std::runtime_error(tmp + ": write error");
+  } catch (...) {
+    std::fclose(f);
+    f = nullptr;
+    std::remove(tmp.c_str());
+    throw;
+  }
+  const bool ok = std::fclose(f) == 0;
+  f = nullptr;
+  if (!ok) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error(tmp + ": write error");
+  }
+  if (std::rename(tmp.c_str(), fname.c_str())) {
+    const auto err = sys_error("can't rename " + tmp);
+    std::remove(tmp.c_str());
+    throw err;
+  }
+}
+
+archive_reader::archive_reader(const std::string &fname)
+{
+  const int fd = ::open(fname.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw sys_error("can't open " + fname);
+  struct stat sb;
+  if (::fstat(fd, &sb) < 0) {
+    const auto err = sys_error("can't stat " + fname);
+    ::close(fd);
+    throw err;
+  }
+  size = sb.st_size;
+  if (size < sizeof(hdr)) {
+    ::close(fd);
+    throw std::runtime_error(fname + ": not an archive");
+  }
+  map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (map == MAP_FAILED) {
+    map = nullptr;
+    throw sys_error("can't map " + fname);
+  }
+
+  std::memcpy(&hdr, map, sizeof(hdr));
+  const uint64_t refs_count = hdr.chunks * (uint64_t(hdr.columns) + 1);
+  const bool valid =
+    !std::memcmp(hdr.magic, c_ARCHIVE_FILE_MAGIC, sizeof(hdr.magic)) &&
+    hdr.version == c_ARCHIVE_FILE_VERSION && hdr.block_values == c_ARCHIVE_BLOCK &&
+    hdr.columns > 0 && hdr.chunk_rows > 0 && hdr.index_offset % 8 == 0 &&
+    hdr.index_offset <= size && hdr.chunks <= size && hdr.columns <= size &&
+    size - hdr.index_offset == hdr.columns * c_ARCHIVE_NAME_LEN +
+                               hdr.chunks * sizeof(archive_chunk_desc) +
+                               refs_count * sizeof(archive_column_ref);
+  if (!valid) {
+    ::munmap(map, size);
+    throw std::runtime_error(fname + ": not an archive");
+  }
+
+  const uint8_t *p = bytes() + hdr.index_offset;
+  for (uint32_t c = 0; c < hdr.columns; c++, p += c_ARCHIVE_NAME_LEN)
+    names.emplace_back(reinterpret_cast<const char *>(p),
+                       strnlen(reinterpret_cast<const char *>(p), c_ARCHIVE_NAME_LEN));
+  descs = reinterpret_cast<const archive_chunk_desc *>(p);
+  crefs = reinterpret_cast<const archive_column_ref *>(p + hdr.chunks * sizeof(*descs));
+
+  uint64_t rows = 0;
+  for (size_t i = 0; i < hdr.chunks; i++) {
+    const archive_chunk_desc &d = descs[i];
+    bool ok = d.rows > 0 && d.rows <= hdr.chunk_rows && d.tf_first <= d.tf_last &&
+              (i == 0 || descs[i - 1].tf_last <= d.tf_first);
+    for (unsigned c = 0; ok && c <= hdr.columns; c++) {
+      const archive_column_ref &r = ref(i, c);
+      ok = r.offset >= sizeof(hdr) && r.offset % 4 == 0 && r.offset <= hdr.index_offset &&
+           r.size <= hdr.index_offset - r.offset;
+    }
+    if (!ok) {
+      ::munmap(map, size);
+      throw std::runtime_error(fname + ": corrupt archive index");
+    }
+    rows += d.rows;
+  }
+  if (rows != hdr.rows) {
+    ::munmap(map, size);
+    throw std::runtime_error(fname + ": corrupt archive index");
+  }
+}
+
+archive_reader::~archive_reader()
+{
+  ::munmap(map, size);
+}
+
+int archive_reader::column(const std::string &name) const
+{
+  for (size_t c = 0; c < names.size(); c++)
+    if (names[c] == name)
+      return int(c);
+  return -1;
+}
+
+uint64_t archive_reader::tf_first() const
+{
+  return hdr.chunks ? descs[0].tf_first : UINT64_MAX;
+}
+
+uint64_t archive_reader::tf_last() const
+{
+  return hdr.chunks ? descs[hdr.chunks - 1].tf_last : 0;
+}
+
+void archive_reader::release(const archive_column_ref &r) const
+{
+  // Decoded pages are read again from the file if needed
+  const size_t page = size_t(::sysconf(_SC_PAGESIZE));
+  const size_t begin = r.offset / page * page;
+  const size_t end = std::min<size_t>((r.offset + r.size + page - 1) / page * page, size);
+  ::madvise(static_cast<uint8_t *>(map) + begin, end - begin, MADV_DONTNEED);
+}
+
+void archive_reader::scan(uint64_t tf_min, uint64_t tf_max, const std::vector<unsigned> &cols,
+                          const scan_fn &fn) const
+{
+  for (unsigned c: cols)
+    if (c >= hdr.columns)
+      throw std::out_of_range("no archive column " + std::to_string(c));
+  if (tf_min > tf_max)
+    return;
+
+  // First chunk ending in the range
+  size_t i = std::partition_point(descs, descs + hdr.chunks,
+                                  [&](const archive_chunk_desc &d) {
+                                    return d.tf_last < tf_min;
+                                  }) - descs;
+  const size_t buf_rows =
+    (hdr.chunk_rows + c_ARCHIVE_BLOCK - 1) / c_ARCHIVE_BLOCK * c_ARCHIVE_BLOCK;
+  std::vector<int32_t> rel(buf_rows);
+  std::vector<uint64_t> tf(hdr.chunk_rows);
+  std::vector<std::vector<int32_t>> vals(cols.size(), std::vector<int32_t>(buf_rows));
+  std::vector<const int32_t *> ptrs(cols.size());
+
+  for (; i < hdr.chunks && descs[i].tf_first <= tf_max; i++) {
+    const archive_chunk_desc &d = descs[i];
+    const archive_column_ref &tr = ref(i, 0);
+    archive_decode_column(bytes() + tr.offset, tr.size, d.rows, rel.data(), force_scalar);
+    for (uint32_t r = 0; r < d.rows; r++)
+      tf[r] = d.tf_first + uint32_t(rel[r]);
+    release(tr);
+    const size_t lo = std::lower_bound(tf.begin(), tf.begin() + d.rows, tf_min) - tf.begin();
+    const size_t hi = std::upper_bound(tf.begin(), tf.begin() + d.rows, tf_max) - tf.begin();
+    if (lo == hi)
+      continue;
+
+    for (size_t k = 0; k < cols.size(); k++) {
+      const archive_column_ref &r = ref(i, cols[k] + 1);
+      archive_decode_column(bytes() + r.offset, r.size, d.rows, vals[k].data(), force_scalar);
+      release(r);
+      ptrs[k] = vals[k].data() + lo;
+    }
+    fn(hi - lo, tf.data() + lo, ptrs.data());
+  }
+}
+
+archive_columns archive_reader::query(uint64_t tf_min, uint64_t tf_max,
+                                      const std::vector<unsigned> &cols) const
+{
+  archive_columns res;
+  res.vals.resize(cols.size());
+  scan(tf_min, tf_max, cols, [&](size_t n, const uint64_t *tf, const int32_t *const *vals) {
+    res.tf.insert(res.tf.end(), tf, tf + n);
+    for (size_t k = 0; k < cols.size(); k++)
+      res.vals[k].insert(res.vals[k].end(), vals[k], vals[k] + n);
+  });
+  return res;
+}
+
+} // namespace fofb
@@ -0,0 +1,209 @@
+// Compressed columnar archive of orbit, set-point and error counter history
+//
+// An archive is a table of int32 columns (BPM positions, set-points, error
+// counters...) with one row per timeframe, or per sample of slower sources,
+// keyed by a 64 bits timeframe number (tf_cntr_32 extended past its
+// wraparound by tf_unwrapper, about a day at 48 kHz). Rows are stored in
+// chunks of 'chunk_rows' rows and, within a chunk, column by column: a
+// reader only touches the columns it asks for, and the chunk index (first
+// and last timeframe of each chunk) takes it straight to the chunks of a
+// timeframe range.
+//
+// Each column chunk holds the differences between consecutive values,
+// zigzag encoded (so small negative differences are small too) and
+// bit-packed in blocks of c_ARCHIVE_BLOCK values, each with the width of its
+// largest value: a constant counter takes no space, a slowly moving orbit a
+// few bits per value. A block is laid out as 8 lanes of 32 bits words, value
+// i in lane i % 8, so the AVX2 decoder unpacks 8 consecutive values with the
+// same shifts, then zigzag decodes and prefix sums them in registers.
+//
+// Readers map the file (mmap) and decode a chunk at a time into buffers of
+// one chunk, dropping the pages they went through, so a range query over a
+// long history costs its output and a few MB of memory.
+//
+// File format (native endianness): an archive_file_header, the column
+// chunks, then, at 'index_offset' (a multiple of 8), the column names
+// (c_ARCHIVE_NAME_LEN bytes each), 'chunks' archive_chunk_desc entries and,
+// for each chunk, 'columns' + 1 archive_column_ref entries, the timeframe
+// column first. A column chunk is an int32 base value, the uint32 number of
+// blocks, their widths (one byte each, padded to 4 bytes) and the packed
+// blocks, of 8 * width words each. The timeframe column holds the
+// timeframes less the chunk's first one.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_ARCHIVE_H_
+#define FOFB_ARCHIVE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace fofb {
+
+constexpr unsigned c_ARCHIVE_BLOCK = 256;
+constexpr unsigned c_ARCHIVE_LANES = 8;
+constexpr unsigned c_ARCHIVE_NAME_LEN = 32;
+
+constexpr char c_ARCHIVE_FILE_MAGIC[8] = {'F', 'O', 'F', 'B', 'A', 'R', 'C', 'H'};
+constexpr uint32_t c_ARCHIVE_FILE_VERSION = 1;
+
+struct archive_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t columns;
+  uint32_t chunk_rows;
+  uint32_t block_values;
+  uint64_t rows;
+  uint64_t chunks;
+  uint64_t index_offset;
+};
+
+struct archive_chunk_desc {
+  uint64_t tf_first;
+  uint64_t tf_last;
+  uint32_t rows;
+  uint32_t reserved;
+};
+
+struct archive_column_ref {
+  uint64_t offset;
+  uint64_t size;
+};
+
+static_assert(sizeof(archive_file_header) == 48 && sizeof(archive_chunk_desc) == 24 &&
+              sizeof(archive_column_ref) == 16, "archive structures must not have padding");
+
+// Extends a wrapping 32 bits timeframe counter (tf_cntr_32) to 64 bits, for
+// successive values less than 2^31 timeframes apart
+class tf_unwrapper {
+ public:
+  uint64_t operator()(uint32_t tf)
+  {
+    if (started)
+      cur += uint64_t(int64_t(int32_t(tf - uint32_t(cur))));
+    else
+      cur = tf;
+    started = true;
+    return cur;
+  }
+
+ private:
+  uint64_t cur = 0;
+  bool started = false;
+};
+
+// Column chunk codec. archive_encode_column() appends the encoding of 'n'
+// values to 'out'; archive_decode_column() decodes 'size' bytes of it into
+// 'out', which must have room for 'n' values rounded up to a whole block,
+// and throws std::runtime_error if they don't hold 'n' values.
+void archive_encode_column(const int32_t *vals, size_t n, std::vector<uint8_t> &out);
+void archive_decode_column(const uint8_t *data, size_t size, size_t n, int32_t *out,
+                           bool force_scalar = false);
+
+class archive_writer {
+ public:
+  // The archive is written to 'fname'.tmp and renamed by close()
+  archive_writer(const std::string &fname, const std::vector<std::string> &columns,
+                 unsigned chunk_rows = 4096);
+  // Without close(), the partial archive is removed
+  ~archive_writer();
+
+  archive_writer(const archive_writer &) = delete;
+  archive_writer &operator=(const archive_writer &) = delete;
+
+  // Append a row, 'vals' holding one value per column. Timeframes must not
+  // decrease.
+  void append(uint64_t tf, const int32_t *vals);
+  void close();
+
+  uint64_t rows() const { return n_rows; }
+  // Bytes written so far
+  uint64_t size() const { return offset; }
+
+ private:
+  void write(const void *p, size_t n);
+  void flush_chunk();
+
+  std::string fname;
+  std::string tmp;
+  FILE *f = nullptr;
+  std::vector<std::string> names;
+  unsigned chunk_rows;
+  uint64_t offset = 0;
+  uint64_t n_rows = 0;
+
+  // Rows of the chunk being filled, column by column
+  std::vector<uint64_t> tf;
+  std::vector<std::vector<int32_t>> cols;
+  std::vector<int32_t> rel_tf;
+  std::vector<uint8_t> enc;
+
+  std::vector<archive_chunk_desc> chunks;
+  std::vector<archive_column_ref> refs;
+};
+
+// Columns of the rows of a query
+struct archive_columns {
+  std::vector<uint64_t> tf;
+  // One vector per requested column
+  std::vector<std::vector<int32_t>> vals;
+};
+
+class archive_reader {
+ public:
+  explicit archive_reader(const std::string &fname);
+  ~archive_reader();
+
+  archive_reader(const archive_reader &) = delete;
+  archive_reader &operator=(const archive_reader &) = delete;
+
+  const std::vector<std::string> &columns() const { return names; }
+  // Index of a column, -1 if there's none of that name
+  int column(const std::string &name) const;
+  uint64_t rows() const { return hdr.rows; }
+  size_t chunks() const { return hdr.chunks; }
+  // UINT64_MAX and 0 when empty
+  uint64_t tf_first() const;
+  uint64_t tf_last() const;
+  size_t file_size() const { return size; }
+
+  // Called with the 'n' rows of a chunk in the range, their timeframes and
+  // one array per requested column, valid until it returns
+  using scan_fn =
+    std::function<void(size_t n, const uint64_t *tf, const int32_t *const *vals)>;
+
+  // Decode the rows with tf_min <= tf <= tf_max of the columns 'cols', a
+  // chunk at a time
+  void scan(uint64_t tf_min, uint64_t tf_max, const std::vector<unsigned> &cols,
+            const scan_fn &fn) const;
+  archive_columns query(uint64_t tf_min, uint64_t tf_max,
+                        const std::vector<unsigned> &cols) const;
+
+  // Force the sequential (non-vectorized) decoder, used for testing
+  void set_force_scalar(bool force) { force_scalar = force; }
+
+ private:
+  const archive_column_ref &ref(size_t chunk, unsigned col) const
+  {
+    return crefs[chunk * (hdr.columns + 1) + col];
+  }
+  const uint8_t *bytes() const { return static_cast<const uint8_t *>(map); }
+  void release(const archive_column_ref &r) const;
+
+  void *map = nullptr;
+  size_t size = 0;
+  archive_file_header hdr;
+  std::vector<std::string> names;
+  const archive_chunk_desc *descs = nullptr;
+  const archive_column_ref *crefs = nullptr;
+  bool force_scalar = false;
+};
+
+} // namespace fofb
+
+#endif // FOFB_ARCHIVE_H_
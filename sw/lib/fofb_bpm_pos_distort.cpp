@@ -0,0 +1,179 @@
+// Software model of the xwb_fofb_sys_id BPM positions path
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "fofb_bpm_pos_distort.h"
+#include "wb_fofb_sys_id_regs_access.h"
+
+namespace fofb {
+
+namespace {
+
+using sys_id_regs = regs::wb_fofb_sys_id_regs;
+using flat_ctl = sys_id_regs::bpm_pos_flatenizer::ctl;
+using prbs_ctl_reg = sys_id_regs::prbs::ctl;
+
+constexpr unsigned c_VALID_WORDS = c_NUM_BPM_POS / 64;
+// Vertical positions start at index 256 (index MSB set)
+constexpr unsigned c_Y_INDEX_BASE = c_NUM_BPM_POS / 2;
+
+// f_signed_saturate(bpm_pos + level, 32) in 32 bits arithmetic, as the AVX2
+// kernel: the sum overflowed if its sign differs from both operands'
+inline int32_t sat_add(int32_t a, int32_t b)
+{
+  const int32_t s = int32_t(uint32_t(a) + uint32_t(b));
+  const int32_t sat = (a >> 31) ^ INT32_MAX;
+  return ((a ^ s) & (b ^ s)) < 0 ? sat : s;
+}
+
+inline bool received(const uint64_t *valid, unsigned idx)
+{
+  return !valid || (valid[idx / 64] >> (idx % 64) & 1);
+}
+
+} // namespace
+
+bpm_pos_distort_model::bpm_pos_distort_model(unsigned max_num):
+  flat_size(max_num), prbs_cfg(prbs_config::from_ctl(0)),
+  gen(prbs_cfg.lfsr_length, prbs_cfg.step_duration),
+  level_0(c_NUM_BPM_POS), level_1(c_NUM_BPM_POS)
+{
+  if (max_num == 0 || max_num > c_NUM_BPM_POS)
+    throw std::invalid_argument("unsupported number of BPM positions per flatenizer");
+}
+
+void bpm_pos_distort_model::load_regs(const wb_fofb_sys_id_regs &regs)
+{
+  set_base_bpm_id(regs.bpm_pos_flatenizer.ctl);
+  set_prbs_ctl(regs.prbs.ctl);
+  for (unsigned idx = 0; idx < c_NUM_BPM_POS; idx++)
+    set_levels(idx, prbs_levels::from_reg(regs.prbs.bpm_pos_distort.distort_ram[idx].levels));
+}
+
+void bpm_pos_distort_model::set_base_bpm_id(uint32_t ctl)
+{
+  base = flat_ctl::base_bpm_id::get(ctl);
+}
+
+void bpm_pos_distort_model::set_prbs_ctl(uint32_t ctl)
+{
+  const prbs_config cfg = prbs_config::from_ctl(ctl);
+  if (cfg.lfsr_length != prbs_cfg.lfsr_length || cfg.step_duration != prbs_cfg.step_duration) {
+    gen = prbs_gen(cfg.lfsr_length, cfg.step_duration);
+    tf = 0;
+  }
+  prbs_cfg = cfg;
+  prbs_ctl = ctl;
+}
+
+void bpm_pos_distort_model::set_levels(unsigned idx, const prbs_levels &lv)
+{
+  if (idx >= c_NUM_BPM_POS)
+    throw std::out_of_range("distortion levels index out of range");
+  level_0[idx] = lv.level_0;
+  level_1[idx] = lv.level_1;
+}
+
+void bpm_pos_distort_model::trigger()
+{
+  en = prbs_ctl_reg::bpm_pos_distort_en::get(prbs_ctl);
+  if (prbs_ctl_reg::rst::get(prbs_ctl)) {
+    gen.reset();
+    tf = 0;
+  }
+}
+
+void bpm_pos_distort_model::skip(uint64_t n)
+{
+  for (uint64_t i = 0; i < n; i++)
+    gen.next();
+  tf += n;
+}
+
+void bpm_pos_distort_model::reset()
+{
+  gen.reset();
+  en = false;
+  tf = 0;
+}
+
+void bpm_pos_distort_model::distort_tf(const int32_t *bpm_pos, bool prbs, int32_t *out) const
+{
+  if (!en) {
+    std::memcpy(out, bpm_pos, c_NUM_BPM_POS * sizeof(int32_t));
+    return;
+  }
+  const int32_t *lv = prbs ? level_1.data() : level_0.data();
+#ifdef __AVX2__
+  static_assert(c_NUM_BPM_POS % 8 == 0, "AVX2 kernel assumes whole vectors");
+  const __m256i max = _mm256_set1_epi32(INT32_MAX);
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i += 8) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bpm_pos + i));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(lv + i));
+    const __m256i s = _mm256_add_epi32(a, b);
+    const __m256i ovf = _mm256_and_si256(_mm256_xor_si256(a, s), _mm256_xor_si256(b, s));
+    const __m256i sat = _mm256_xor_si256(_mm256_srai_epi32(a, 31), max);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                        _mm256_blendv_epi8(s, sat, _mm256_srai_epi32(ovf, 31)));
+  }
+#else
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+    out[i] = sat_add(bpm_pos[i], lv[i]);
+#endif
+}
+
+void bpm_pos_distort_model::process(const int32_t *bpm_pos, const uint64_t *valid,
+                                    size_t n_tf, const bpm_pos_distort_out &out)
+{
+  const unsigned flat_base[2] = {base, c_Y_INDEX_BASE + base};
+
+  for (size_t t = 0; t < n_tf; t++) {
+    const int32_t *pos = bpm_pos + t * c_NUM_BPM_POS;
+    const uint64_t *v = valid ? valid + t * c_VALID_WORDS : nullptr;
+    const bool prbs = gen.value();
+
+    int32_t *distort = nullptr;
+    if (out.distort) {
+      distort = out.distort + t * c_NUM_BPM_POS;
+      distort_tf(pos, prbs, distort);
+    }
+
+    if (out.flat || out.flat_rcvd) {
+      const int32_t *lv = prbs ? level_1.data() : level_0.data();
+      for (unsigned axis = 0; axis < 2; axis++) {
+        for (unsigned i = 0; i < flat_size; i++) {
+          const unsigned idx = flat_base[axis] + i;
+          const bool rcvd = idx < c_NUM_BPM_POS && received(v, idx);
+          if (out.flat_rcvd)
+            out.flat_rcvd[(t * 2 + axis) * flat_size + i] = rcvd;
+          if (!out.flat)
+            continue;
+          int32_t *flat = out.flat + t * BPM_POS_FLATS * flat_size;
+          int32_t p = 0, d = 0;
+          if (rcvd) {
+            p = pos[idx];
+            d = distort ? distort[idx] : en ? sat_add(p, lv[idx]) : p;
+          }
+          flat[(BPM_POS_FLAT_X + axis) * flat_size + i] = p;
+          flat[(DISTORT_BPM_POS_FLAT_X + axis) * flat_size + i] = d;
+        }
+      }
+    }
+
+    if (out.prbs)
+      out.prbs[t] = prbs;
+    // prbs_valid_i comes with the set-points, at the end of the timeframe
+    gen.next();
+    tf++;
+  }
+}
+
+} // namespace fofb
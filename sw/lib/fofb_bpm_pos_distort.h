@@ -0,0 +1,124 @@
+// Software model of the xwb_fofb_sys_id BPM positions path
+//
+// Reproduces, timeframe by timeframe, what xwb_fofb_sys_id does with the BPM
+// positions fed to fofb_processing:
+//   - prbs_bpm_pos_distort adds to each position one of the two levels (nm)
+//     of its index in prbs.bpm_pos_distort.distort_ram, picked by the PRBS
+//     value, and saturates the sum to 32 bits. The distortion is enabled by
+//     prbs.ctl.bpm_pos_distort_en, which (as prbs.ctl.rst) only takes effect
+//     on the sys-id trigger. The PRBS iterates at the end of each timeframe
+//     (with the set-points), so the positions of the t-th timeframe after a
+//     PRBS reset see it after t iterations.
+//   - four bpm_pos_flatenizer instances expose the positions of indexes
+//     [base, base + max_num) (x, base = bpm_pos_flatenizer.ctl.base_bpm_id)
+//     and [256 + base, 256 + base + max_num) (y), before and after the
+//     distortion, 'max_num' being bpm_pos_flatenizer.max_num_cte. They are
+//     cleared at the end of each timeframe: positions not received in a
+//     timeframe read as zero. As in the gateware, the x window may run into
+//     the first y indexes.
+//
+// The model is a stream: state (PRBS, enable) carries over process() calls,
+// so arbitrarily long captures can be processed in chunks of any size with
+// the same result. Each timeframe's distortion is a saturating add over the
+// whole positions array, 8 positions at a time with AVX2.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_BPM_POS_DISTORT_H_
+#define FOFB_BPM_POS_DISTORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_prbs.h"
+#include "fofb_regs.h"
+
+namespace fofb {
+
+// g_MAX_NUM_BPM_POS_PER_FLAT of afc_ref_fofb_ctrl_gen (c_MAX_NUM_P2P_BPM_POS/2)
+constexpr unsigned c_BPM_POS_FLAT_MAX_NUM = 8;
+
+// Flatenizers, in the order process() outputs them
+enum bpm_pos_flat_sel {
+  BPM_POS_FLAT_X,
+  BPM_POS_FLAT_Y,
+  DISTORT_BPM_POS_FLAT_X,
+  DISTORT_BPM_POS_FLAT_Y,
+  BPM_POS_FLATS
+};
+
+// Outputs of process(), each one optional (nullptr)
+struct bpm_pos_distort_out {
+  // c_NUM_BPM_POS distorted positions per timeframe (distort_bpm_pos_o),
+  // indexed as the input
+  int32_t *distort = nullptr;
+  // BPM_POS_FLATS * max_num positions per timeframe, flatenizer by
+  // flatenizer (bpm_pos_flat_x_o, bpm_pos_flat_y_o, ...)
+  int32_t *flat = nullptr;
+  // 2 * max_num flags per timeframe, x then y (bpm_pos_flat_{x,y}_rcvd_o,
+  // the distorted flatenizers' are the same)
+  uint8_t *flat_rcvd = nullptr;
+  // PRBS value of each timeframe (prbs_o)
+  uint8_t *prbs = nullptr;
+};
+
+class bpm_pos_distort_model {
+ public:
+  // 'max_num' is g_MAX_NUM_BPM_POS_PER_FLAT
+  explicit bpm_pos_distort_model(unsigned max_num = c_BPM_POS_FLAT_MAX_NUM);
+
+  // Load bpm_pos_flatenizer.ctl, prbs.ctl and the distortion levels RAM from
+  // a register image. Like a register write, prbs.ctl only takes effect on
+  // the next trigger().
+  void load_regs(const wb_fofb_sys_id_regs &regs);
+
+  // Individual configuration accessors, values as written to the registers
+  void set_base_bpm_id(uint32_t ctl);
+  // Changing the LFSR length or step duration resets the PRBS
+  void set_prbs_ctl(uint32_t ctl);
+  void set_levels(unsigned idx, const prbs_levels &lv);
+
+  // sys-id trigger: latch prbs.ctl.bpm_pos_distort_en and reset the PRBS if
+  // prbs.ctl.rst is set
+  void trigger();
+
+  // Iterate the PRBS 'n' times, for captures starting after the PRBS reset
+  void skip(uint64_t n);
+
+  // Reset all internal state, as rst_n_i = '0'
+  void reset();
+
+  // Process 'n_tf' timeframes. 'bpm_pos' and 'valid' have the layout of
+  // fofb_processing_model::process(): c_NUM_BPM_POS positions per timeframe
+  // and c_NUM_BPM_POS / 64 received flags words (nullptr when all positions
+  // are received). Positions not received are distorted as well, they are
+  // only meaningless.
+  void process(const int32_t *bpm_pos, const uint64_t *valid, size_t n_tf,
+               const bpm_pos_distort_out &out);
+
+  unsigned max_num() const { return flat_size; }
+  unsigned base_bpm_id() const { return base; }
+  bool distort_en() const { return en; }
+  // PRBS iterations (timeframes) since the last PRBS reset
+  uint64_t timeframes() const { return tf; }
+
+ private:
+  void distort_tf(const int32_t *bpm_pos, bool prbs, int32_t *out) const;
+
+  unsigned flat_size;
+  unsigned base = 0;
+  uint32_t prbs_ctl = 0;
+  prbs_config prbs_cfg;
+  prbs_gen gen;
+  bool en = false;
+  uint64_t tf = 0;
+  // distort_ram levels, as structure of arrays
+  std::vector<int32_t> level_0;
+  std::vector<int32_t> level_1;
+};
+
+} // namespace fofb
+
+#endif // FOFB_BPM_POS_DISTORT_H_
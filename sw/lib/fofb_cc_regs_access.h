@@ -0,0 +1,64 @@
+// Typed register access for fofb_cc_regs
+//
+// Generated by gen_regs_access.py from fofb_cc_regs.cheby, do not edit.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_CC_REGS_ACCESS_H_
+#define FOFB_CC_REGS_ACCESS_H_
+
+#include "fofb_reg_access.h"
+
+namespace fofb {
+namespace regs {
+
+struct fofb_cc_regs {
+  static constexpr size_t size = FOFB_CC_REGS_SIZE;
+  static constexpr unsigned num_consts = 0;
+
+  struct cfg_val : reg_def<FOFB_CC_REGS_CFG_VAL, access::rw, 32> {
+    using act_part = field<FOFB_CC_REGS_CFG_VAL_ACT_PART>;
+    using unused = field<FOFB_CC_REGS_CFG_VAL_UNUSED>;
+    using err_clr = field<FOFB_CC_REGS_CFG_VAL_ERR_CLR>;
+    using cc_enable = field<FOFB_CC_REGS_CFG_VAL_CC_ENABLE>;
+    using tfs_override = field<FOFB_CC_REGS_CFG_VAL_TFS_OVERRIDE>;
+  };
+  struct toa_ctl : reg_def<FOFB_CC_REGS_TOA_CTL, access::rw, 32> {
+    using rd_en = field<FOFB_CC_REGS_TOA_CTL_RD_EN>;
+    using rd_str = field<FOFB_CC_REGS_TOA_CTL_RD_STR>;
+  };
+  struct toa_data : reg_def<FOFB_CC_REGS_TOA_DATA, access::rw, 32> {
+    using val = field<FOFB_CC_REGS_TOA_DATA_VAL_MASK>;
+  };
+  struct rcb_ctl : reg_def<FOFB_CC_REGS_RCB_CTL, access::rw, 32> {
+    using rd_en = field<FOFB_CC_REGS_RCB_CTL_RD_EN>;
+    using rd_str = field<FOFB_CC_REGS_RCB_CTL_RD_STR>;
+  };
+  struct rcb_data : reg_def<FOFB_CC_REGS_RCB_DATA, access::rw, 32> {
+    using val = field<FOFB_CC_REGS_RCB_DATA_VAL_MASK>;
+  };
+  struct xy_buff_ctl : reg_def<FOFB_CC_REGS_XY_BUFF_CTL, access::rw, 32> {
+    using unused = field<FOFB_CC_REGS_XY_BUFF_CTL_UNUSED_MASK>;
+    using addr = field<FOFB_CC_REGS_XY_BUFF_CTL_ADDR_MASK>;
+  };
+  struct xy_buff_data_msb : reg_def<FOFB_CC_REGS_XY_BUFF_DATA_MSB, access::rw, 32> {
+    using val = field<FOFB_CC_REGS_XY_BUFF_DATA_MSB_VAL_MASK>;
+  };
+  struct xy_buff_data_lsb : reg_def<FOFB_CC_REGS_XY_BUFF_DATA_LSB, access::rw, 32> {
+    using val = field<FOFB_CC_REGS_XY_BUFF_DATA_LSB_VAL_MASK>;
+  };
+  struct ram_reg {
+    static constexpr size_t depth = 2048;
+    struct data : mem_reg_def<FOFB_CC_REGS_RAM_REG + FOFB_CC_REGS_RAM_REG_DATA, FOFB_CC_REGS_RAM_REG_SIZE, 2048, access::rw, 32> {
+      using val = field<width_mask(32)>;
+    };
+  };
+};
+
+static_assert(fofb_cc_regs::size == sizeof(::fofb_cc_regs), "fofb_cc_regs layout mismatch");
+
+} // namespace regs
+} // namespace fofb
+
+#endif // FOFB_CC_REGS_ACCESS_H_
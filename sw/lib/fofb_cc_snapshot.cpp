@@ -0,0 +1,12 @@
+// Bulk snapshots of the FOFB CC diagnostic buffers
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include "fofb_cc_snapshot.h"
+
+namespace fofb {
+
+template class fofb_cc_snapshotter<mmap_device>;
+
+} // namespace fofb
@@ -0,0 +1,208 @@
+// Bulk snapshots of the FOFB CC diagnostic buffers
+//
+// The TOA (time of arrival) and RCB (received buffer) buffers are read
+// through a handshake: raising toa_ctl/rcb_ctl RD_EN freezes the buffer and
+// rewinds its read pointer, then each RD_STR loads the next word into
+// toa_data/rcb_data. The X/Y buffer is read by writing xy_buff_ctl.addr,
+// which loads the pair into xy_buff_data_msb/lsb.
+//
+// Bus reads are non-posted, so they set the pace while the writes are
+// posted. fofb_cc_snapshotter walks the three buffers together, posting the
+// RD_STR and address writes of an index before reading its data: the data
+// reads of one buffer cover the load latency of the others, RD_STR is
+// written whole instead of read-modified-written and, optionally, the X/Y
+// pair is read with a single 64 bits access. take_word_by_word() is the
+// plain handshake, buffer after buffer, kept as a reference.
+//
+// TOA and RCB stay frozen for the whole snapshot, so they belong to a single
+// timeframe. The X/Y buffer isn't frozen by the gateware: the CC
+// time_frame_count read right after freezing TOA/RCB and right after the last
+// X/Y read bound the timeframes its entries come from.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_CC_SNAPSHOT_H_
+#define FOFB_CC_SNAPSHOT_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "fofb_cc_regs_access.h"
+#include "fofb_cc_status.h"
+#include "fofb_device.h"
+
+namespace fofb {
+
+struct cc_snapshot_config {
+  // Words read from each buffer, 0 skips the buffer
+  unsigned toa_depth = c_CC_NODES;
+  unsigned rcb_depth = c_CC_NODES;
+  unsigned xy_depth = c_CC_XY_DEPTH;
+  // Read xy_buff_data_msb and xy_buff_data_lsb with one 64 bits access
+  bool xy_read64 = false;
+};
+
+struct cc_snapshot {
+  // time_frame_count when TOA/RCB were frozen and after the X/Y buffer read
+  uint32_t tf_start = 0;
+  uint32_t tf_end = 0;
+  std::vector<uint32_t> toa;
+  std::vector<uint32_t> rcb;
+  // xy_buff_data_msb in bits 63:32, xy_buff_data_lsb in bits 31:0
+  std::vector<uint64_t> xy;
+  // Time taken by the snapshot and bus transactions it issued
+  double duration_s = 0;
+  unsigned reads = 0;
+  unsigned writes = 0;
+};
+
+// 'Dev' provides read32(), write32() and read64() as mmap_device does
+template <typename Dev = mmap_device>
+class fofb_cc_snapshotter {
+ public:
+  // 'dev' maps a fofb_cc_regs block at 'base'
+  fofb_cc_snapshotter(Dev &d, size_t b = 0, const cc_snapshot_config &c = {})
+    : blk(d, b), base(b), cfg(c)
+  {
+    if (cfg.toa_depth > c_CC_NODES || cfg.rcb_depth > c_CC_NODES ||
+        cfg.xy_depth > c_CC_XY_DEPTH)
+      throw std::invalid_argument("snapshot depth larger than the CC buffers");
+  }
+
+  // Fill 'snap', reusing its vectors so repeated snapshots don't allocate
+  void take(cc_snapshot &snap);
+  void take_word_by_word(cc_snapshot &snap);
+
+  const cc_snapshot_config &config() const { return cfg; }
+
+ private:
+  using cc = regs::fofb_cc_regs;
+
+  void begin(cc_snapshot &snap);
+  void end(cc_snapshot &snap);
+
+  uint32_t read_tf()
+  {
+    reads++;
+    return blk.template read<cc::ram_reg::data>(cc_status::time_frame_count);
+  }
+
+  regs::reg_block<cc, Dev> blk;
+  size_t base;
+  cc_snapshot_config cfg;
+  std::chrono::steady_clock::time_point t0;
+  unsigned reads = 0;
+  unsigned writes = 0;
+};
+
+template <typename Dev>
+void fofb_cc_snapshotter<Dev>::begin(cc_snapshot &snap)
+{
+  snap.toa.resize(cfg.toa_depth);
+  snap.rcb.resize(cfg.rcb_depth);
+  snap.xy.resize(cfg.xy_depth);
+  reads = writes = 0;
+  t0 = std::chrono::steady_clock::now();
+
+  // Drop RD_EN first, so raising it freezes the current contents
+  blk.template write<cc::toa_ctl>(0);
+  blk.template write<cc::rcb_ctl>(0);
+  blk.template write_fields<cc::toa_ctl>(cc::toa_ctl::rd_en::val(1));
+  blk.template write_fields<cc::rcb_ctl>(cc::rcb_ctl::rd_en::val(1));
+  writes += 4;
+  // Reads don't pass the posted writes: the buffers are already frozen
+  snap.tf_start = read_tf();
+}
+
+template <typename Dev>
+void fofb_cc_snapshotter<Dev>::end(cc_snapshot &snap)
+{
+  snap.tf_end = read_tf();
+  blk.template write<cc::toa_ctl>(0);
+  blk.template write<cc::rcb_ctl>(0);
+  writes += 2;
+
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - t0;
+  snap.duration_s = elapsed.count();
+  snap.reads = reads;
+  snap.writes = writes;
+}
+
+template <typename Dev>
+void fofb_cc_snapshotter<Dev>::take(cc_snapshot &snap)
+{
+  constexpr uint32_t toa_str =
+    regs::compose(cc::toa_ctl::rd_en::val(1), cc::toa_ctl::rd_str::val(1));
+  constexpr uint32_t rcb_str =
+    regs::compose(cc::rcb_ctl::rd_en::val(1), cc::rcb_ctl::rd_str::val(1));
+
+  begin(snap);
+  const unsigned n = std::max({cfg.toa_depth, cfg.rcb_depth, cfg.xy_depth});
+  for (unsigned i = 0; i < n; i++) {
+    const bool toa = i < cfg.toa_depth;
+    const bool rcb = i < cfg.rcb_depth;
+    const bool xy = i < cfg.xy_depth;
+
+    if (xy)
+      blk.template write_fields<cc::xy_buff_ctl>(cc::xy_buff_ctl::addr::val(i));
+    if (toa)
+      blk.template write<cc::toa_ctl>(toa_str);
+    if (rcb)
+      blk.template write<cc::rcb_ctl>(rcb_str);
+    writes += xy + toa + rcb;
+
+    if (toa)
+      snap.toa[i] = blk.template read<cc::toa_data>();
+    if (rcb)
+      snap.rcb[i] = blk.template read<cc::rcb_data>();
+    reads += toa + rcb;
+    if (xy && cfg.xy_read64) {
+      // xy_buff_data_msb is the lower address
+      const uint64_t v = blk.device().read64(base + cc::xy_buff_data_msb::reg_addr);
+      snap.xy[i] = v << 32 | v >> 32;
+      reads++;
+    } else if (xy) {
+      const uint64_t msb = blk.template read<cc::xy_buff_data_msb>();
+      snap.xy[i] = msb << 32 | blk.template read<cc::xy_buff_data_lsb>();
+      reads += 2;
+    }
+  }
+  end(snap);
+}
+
+template <typename Dev>
+void fofb_cc_snapshotter<Dev>::take_word_by_word(cc_snapshot &snap)
+{
+  begin(snap);
+  for (unsigned i = 0; i < cfg.toa_depth; i++) {
+    blk.template modify<cc::toa_ctl>(cc::toa_ctl::rd_str::val(1));
+    snap.toa[i] = blk.template read<cc::toa_data>();
+  }
+  reads += 2 * cfg.toa_depth;
+  writes += cfg.toa_depth;
+  for (unsigned i = 0; i < cfg.rcb_depth; i++) {
+    blk.template modify<cc::rcb_ctl>(cc::rcb_ctl::rd_str::val(1));
+    snap.rcb[i] = blk.template read<cc::rcb_data>();
+  }
+  reads += 2 * cfg.rcb_depth;
+  writes += cfg.rcb_depth;
+  for (unsigned i = 0; i < cfg.xy_depth; i++) {
+    blk.template write_fields<cc::xy_buff_ctl>(cc::xy_buff_ctl::addr::val(i));
+    const uint64_t msb = blk.template read<cc::xy_buff_data_msb>();
+    snap.xy[i] = msb << 32 | blk.template read<cc::xy_buff_data_lsb>();
+  }
+  reads += 2 * cfg.xy_depth;
+  writes += cfg.xy_depth;
+  end(snap);
+}
+
+extern template class fofb_cc_snapshotter<mmap_device>;
+
+} // namespace fofb
+
+#endif // FOFB_CC_SNAPSHOT_H_
@@ -0,0 +1,63 @@
+// FOFB CC configuration and status words
+//
+// fofb_cc_regs ram_reg is a window on the configuration and status space of
+// the FOFB CC core (fai_cfg_a/fai_cfg_d in wb_fofb_ctrl_wrapper). Its layout
+// is defined by the core, which isn't part of this repository: the word
+// indexes below follow the DLS fofb_cc configuration interface (configuration
+// words from 0, status words from 256 to 511, configuration words again from
+// 512 up to the 2048 words of the window, such as the BPM map) and have to be
+// kept in sync with the core version in use.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_CC_STATUS_H_
+#define FOFB_CC_STATUS_H_
+
+namespace fofb {
+
+// Number of MGT links of the core
+constexpr unsigned c_CC_LINKS = 4;
+
+// Node address width (NodeW of the core): the TOA and RCB buffers hold one
+// word per node and the X/Y buffer one X/Y pair per node and plane
+constexpr unsigned c_CC_NODE_W = 8;
+constexpr unsigned c_CC_NODES = 1u << c_CC_NODE_W;
+constexpr unsigned c_CC_XY_DEPTH = 1u << (c_CC_NODE_W + 1);
+
+// ram_reg word indexes
+namespace cc_cfg {
+constexpr unsigned bpm_id = 0;
+constexpr unsigned time_frame_len = 1;
+constexpr unsigned mgt_powerdown = 2;
+constexpr unsigned mgt_loopback = 3;
+constexpr unsigned time_frame_dly = 4;
+constexpr unsigned golden_orb_x = 5;
+constexpr unsigned golden_orb_y = 6;
+constexpr unsigned cust_feature = 7;
+constexpr unsigned rx_polarity = 8;
+constexpr unsigned payload_sel = 9;
+constexpr unsigned fofb_data_sel = 10;
+} // namespace cc_cfg
+
+namespace cc_status {
+constexpr unsigned firmware_ver = 256;
+constexpr unsigned sys_status = 257;
+// One word per link, link 0 first
+constexpr unsigned link_partner = 258;
+constexpr unsigned link_up = 262;
+constexpr unsigned time_frame_count = 263;
+constexpr unsigned hard_err_cnt = 264;
+constexpr unsigned soft_err_cnt = 268;
+constexpr unsigned frame_err_cnt = 272;
+constexpr unsigned rx_pck_cnt = 276;
+constexpr unsigned tx_pck_cnt = 280;
+constexpr unsigned fod_process_time = 284;
+constexpr unsigned bpm_count = 285;
+// First word past the status window
+constexpr unsigned end = 512;
+} // namespace cc_status
+
+} // namespace fofb
+
+#endif // FOFB_CC_STATUS_H_
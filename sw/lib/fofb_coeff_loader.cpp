@@ -0,0 +1,182 @@
+// Delta loader for the fofb_processing coefficients and set-points RAMs
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "fofb_coeff_loader.h"
+
+namespace fofb {
+
+namespace {
+
+// Words compared at once when skipping unchanged parts of a RAM
+constexpr unsigned c_SKIP_CHUNK = 16;
+
+} // namespace
+
+fofb_coeff_loader::fofb_coeff_loader(mmap_device &d, unsigned channels):
+  dev(d),
+  num_regions(1 + channels),
+  shadow(num_regions * c_NUM_BPM_POS)
+{
+  if (channels > c_MAX_CHANNELS)
+    throw std::invalid_argument("unsupported number of channels");
+  if (dev.size() < sizeof(wb_fofb_processing_regs))
+    throw std::invalid_argument("device window smaller than wb_fofb_processing_regs");
+}
+
+size_t fofb_coeff_loader::region_addr(unsigned region) const
+{
+  return region == 0 ? WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK :
+         WB_FOFB_PROCESSING_REGS_CH + (region - 1) * WB_FOFB_PROCESSING_REGS_CH_SIZE +
+         WB_FOFB_PROCESSING_REGS_CH_COEFF_RAM_BANK;
+}
+
+const uint32_t *fofb_coeff_loader::region_data(const wb_fofb_processing_regs &img,
+                                               unsigned region)
+{
+  static_assert(sizeof(img.sps_ram_bank[0]) == sizeof(uint32_t) &&
+                sizeof(img.ch[0].coeff_ram_bank[0]) == sizeof(uint32_t),
+                "RAM banks must be arrays of words");
+  return region == 0 ? &img.sps_ram_bank[0].data :
+         &img.ch[region - 1].coeff_ram_bank[0].data;
+}
+
+uint32_t *fofb_coeff_loader::region_data(wb_fofb_processing_regs &img,
+                                         unsigned region)
+{
+  return const_cast<uint32_t *>(
+    region_data(static_cast<const wb_fofb_processing_regs &>(img), region));
+}
+
+void fofb_coeff_loader::sync()
+{
+  for (unsigned r = 0; r < num_regions; r++)
+    dev.read_burst(region_addr(r), &shadow[r * c_NUM_BPM_POS], c_NUM_BPM_POS);
+  shadow_valid = true;
+}
+
+void fofb_coeff_loader::set_shadow(const wb_fofb_processing_regs &img)
+{
+  for (unsigned r = 0; r < num_regions; r++)
+    std::memcpy(&shadow[r * c_NUM_BPM_POS], region_data(img, r),
+                c_NUM_BPM_POS * sizeof(uint32_t));
+  shadow_valid = true;
+}
+
+void fofb_coeff_loader::store_shadow(wb_fofb_processing_regs &img) const
+{
+  for (unsigned r = 0; r < num_regions; r++)
+    std::memcpy(region_data(img, r), &shadow[r * c_NUM_BPM_POS],
+                c_NUM_BPM_POS * sizeof(uint32_t));
+}
+
+void fofb_coeff_loader::check(unsigned region, unsigned idx, uint32_t val)
+{
+  if (val != shadow[region * c_NUM_BPM_POS + idx]) {
+    shadow_valid = false;
+    char msg[96];
+    std::snprintf(msg, sizeof(msg), "readback mismatch at 0x%zx: 0x%08x (expected 0x%08x)",
+                  region_addr(region) + idx * sizeof(uint32_t), val,
+                  shadow[region * c_NUM_BPM_POS + idx]);
+    throw std::runtime_error(msg);
+  }
+}
+
+coeff_load_stats fofb_coeff_loader::load(const wb_fofb_processing_regs &img,
+                                         verify_mode verify)
+{
+  coeff_load_stats st = {};
+  if (!shadow_valid)
+    sync();
+
+  bursts.clear();
+  for (unsigned r = 0; r < num_regions; r++) {
+    const uint32_t *src = region_data(img, r);
+    uint32_t *sh = &shadow[r * c_NUM_BPM_POS];
+    unsigned i = 0;
+    while (i < c_NUM_BPM_POS) {
+      if (i % c_SKIP_CHUNK == 0 &&
+          std::memcmp(src + i, sh + i, c_SKIP_CHUNK * sizeof(uint32_t)) == 0) {
+        i += c_SKIP_CHUNK;
+        continue;
+      }
+      if (src[i] == sh[i]) {
+        i++;
+        continue;
+      }
+
+      // Extend the burst while the unchanged words between changes are at
+      // most max_gap
+      unsigned end = i + 1;
+      st.words_changed++;
+      for (unsigned j = i + 1; j < c_NUM_BPM_POS && j - end < max_gap + 1; j++) {
+        if (src[j] != sh[j]) {
+          end = j + 1;
+          st.words_changed++;
+        }
+      }
+
+      dev.write_burst(region_addr(r) + i * sizeof(uint32_t), src + i, end - i);
+      std::memcpy(sh + i, src + i, (end - i) * sizeof(uint32_t));
+      bursts.push_back({r, i, end - i});
+      st.words_written += end - i;
+      i = end;
+    }
+  }
+  st.bursts = bursts.size();
+
+  switch (verify) {
+    case verify_mode::none:
+      break;
+
+    case verify_mode::sparse:
+      for (const auto &b: bursts) {
+        const unsigned idx = b.start + b.len - 1;
+        check(b.region, idx, dev.read32(region_addr(b.region) + idx * sizeof(uint32_t)));
+        st.words_read++;
+      }
+      for (unsigned n = 0; n < sparse_samples; n++) {
+        // xorshift64
+        sample_state ^= sample_state << 13;
+        sample_state ^= sample_state >> 7;
+        sample_state ^= sample_state << 17;
+        const size_t word = sample_state % shadow.size();
+        const unsigned r = word / c_NUM_BPM_POS;
+        const unsigned idx = word % c_NUM_BPM_POS;
+        check(r, idx, dev.read32(region_addr(r) + idx * sizeof(uint32_t)));
+        st.words_read++;
+      }
+      break;
+
+    case verify_mode::written: {
+      uint32_t buf[c_NUM_BPM_POS];
+      for (const auto &b: bursts) {
+        dev.read_burst(region_addr(b.region) + b.start * sizeof(uint32_t), buf, b.len);
+        for (unsigned k = 0; k < b.len; k++)
+          check(b.region, b.start + k, buf[k]);
+        st.words_read += b.len;
+      }
+      break;
+    }
+
+    case verify_mode::full: {
+      uint32_t buf[c_NUM_BPM_POS];
+      for (unsigned r = 0; r < num_regions; r++) {
+        dev.read_burst(region_addr(r), buf, c_NUM_BPM_POS);
+        for (unsigned k = 0; k < c_NUM_BPM_POS; k++)
+          check(r, k, buf[k]);
+        st.words_read += c_NUM_BPM_POS;
+      }
+      break;
+    }
+  }
+
+  return st;
+}
+
+} // namespace fofb
@@ -0,0 +1,98 @@
+// Delta loader for the fofb_processing coefficients and set-points RAMs
+//
+// Keeps a host shadow copy of ch[].coeff_ram_bank and sps_ram_bank. Loading a
+// new image writes only the words that differ from the shadow, coalescing
+// them into bursts of consecutive addresses (bridging short runs of unchanged
+// words, which is cheaper than starting a new burst). Instead of reading the
+// whole RAMs back, the default verification reads the last word of each
+// burst (which also flushes the posted writes) and a few words sampled across
+// the RAMs.
+//
+// The shadow is only as good as the assumption that nobody else writes the
+// RAMs: a failed verification invalidates it and the next load() resyncs.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_COEFF_LOADER_H_
+#define FOFB_COEFF_LOADER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_device.h"
+#include "fofb_regs.h"
+
+namespace fofb {
+
+enum class verify_mode {
+  // No readback
+  none,
+  // Last word of each burst plus sampled words
+  sparse,
+  // Every written word
+  written,
+  // Both RAMs entirely
+  full,
+};
+
+struct coeff_load_stats {
+  size_t words_changed;
+  size_t words_written;
+  size_t bursts;
+  size_t words_read;
+};
+
+class fofb_coeff_loader {
+ public:
+  // 'dev' maps a wb_fofb_processing_regs block, only the RAMs of the first
+  // 'channels' channels are handled
+  explicit fofb_coeff_loader(mmap_device &dev, unsigned channels = c_MAX_CHANNELS);
+
+  // Read the RAMs to (re)initialize the shadow copy
+  void sync();
+
+  // Take the RAMs contents of 'img' as the shadow copy, without any bus
+  // access (e.g. a shadow saved by a previous run)
+  void set_shadow(const wb_fofb_processing_regs &img);
+  void store_shadow(wb_fofb_processing_regs &img) const;
+
+  // Write the coefficients and set-points RAMs of 'img' that differ from the
+  // shadow copy, then verify. Throws std::runtime_error on mismatch.
+  coeff_load_stats load(const wb_fofb_processing_regs &img,
+                        verify_mode verify = verify_mode::sparse);
+
+  // Unchanged words bridged to merge two bursts
+  void set_max_gap(unsigned words) { max_gap = words; }
+  // Number of words sampled by verify_mode::sparse
+  void set_sparse_samples(unsigned n) { sparse_samples = n; }
+
+ private:
+  struct burst {
+    unsigned region;
+    unsigned start;
+    unsigned len;
+  };
+
+  size_t region_addr(unsigned region) const;
+  static const uint32_t *region_data(const wb_fofb_processing_regs &img,
+                                     unsigned region);
+  static uint32_t *region_data(wb_fofb_processing_regs &img, unsigned region);
+  void check(unsigned region, unsigned idx, uint32_t val);
+
+  mmap_device &dev;
+  unsigned num_regions;
+  unsigned max_gap = 4;
+  unsigned sparse_samples = 16;
+  uint64_t sample_state = 0x9e3779b97f4a7c15ull;
+  bool shadow_valid = false;
+
+  // Region 0 is sps_ram_bank, region 1 + ch is ch[ch].coeff_ram_bank
+  std::vector<uint32_t> shadow;
+  std::vector<burst> bursts;
+};
+
+} // namespace fofb
+
+#endif // FOFB_COEFF_LOADER_H_
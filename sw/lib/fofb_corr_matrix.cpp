@@ -0,0 +1,463 @@
+// Correction matrix: regularized pseudo-inverse of the orbit response matrix
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "fofb_corr_matrix.h"
+#include "fofb_fixed_point.h"
+
+namespace fofb {
+
+namespace {
+
+// Columns whose normalized inner product is below this are orthogonal
+constexpr double c_JACOBI_TOL = 1e-15;
+constexpr unsigned c_JACOBI_MAX_SWEEPS = 60;
+
+// Singular values below this, relative to the largest one, are rank
+// deficiency rather than data and are dropped by the updates
+constexpr double c_RANK_TOL = 1e-13;
+
+unsigned worker_count(unsigned threads, size_t work)
+{
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  return unsigned(std::max<size_t>(1, std::min<size_t>(std::max(threads, 1u), work)));
+}
+
+// Run fn(w, workers) on 'workers' threads, the calling one included
+void run_workers(unsigned workers, const std::function<void(unsigned, unsigned)> &fn)
+{
+  std::vector<std::thread> th;
+  for (unsigned w = 1; w < workers; w++)
+    th.emplace_back(fn, w, workers);
+  fn(0, workers);
+  for (std::thread &t: th)
+    t.join();
+}
+
+// Four partial sums, so that the loop doesn't wait on a single accumulator
+double dot(const double *x, const double *y, size_t n)
+{
+  double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    s0 += x[i] * y[i];
+    s1 += x[i + 1] * y[i + 1];
+    s2 += x[i + 2] * y[i + 2];
+    s3 += x[i + 3] * y[i + 3];
+  }
+  for (; i < n; i++)
+    s0 += x[i] * y[i];
+  return (s0 + s1) + (s2 + s3);
+}
+
+class step_barrier {
+ public:
+  explicit step_barrier(unsigned n): count(n) {}
+
+  void wait()
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    const unsigned gen = generation;
+    if (++arrived == count) {
+      arrived = 0;
+      generation++;
+      cv.notify_all();
+    } else {
+      cv.wait(lock, [&] { return gen != generation; });
+    }
+  }
+
+ private:
+  std::mutex mtx;
+  std::condition_variable cv;
+  unsigned count;
+  unsigned arrived = 0;
+  unsigned generation = 0;
+};
+
+// Orthogonalize the 'n' columns (of length 'm', contiguous) of 'w',
+// accumulating the rotations in the n x n column major 'vv'
+void jacobi_sweeps(std::vector<double> &w, std::vector<double> &vv, size_t m, size_t n,
+                   unsigned threads)
+{
+  // Round-robin pairing: every pair of columns once per sweep, in steps of
+  // disjoint pairs (a dummy column when n is odd)
+  const size_t np = n + (n & 1);
+  std::vector<std::pair<size_t, size_t>> sched;
+  std::vector<size_t> ring(np);
+  std::iota(ring.begin(), ring.end(), 0);
+  for (size_t r = 0; r + 1 < np; r++) {
+    for (size_t i = 0; i < np / 2; i++)
+      sched.emplace_back(ring[i], ring[np - 1 - i]);
+    std::rotate(ring.begin() + 1, ring.end() - 1, ring.end());
+  }
+  const size_t steps = np - 1;
+  const size_t per_step = np / 2;
+
+  const unsigned workers = worker_count(threads, per_step);
+  step_barrier barrier(workers);
+  // Rotations done by each worker in the current and the previous sweep
+  std::vector<unsigned char> rotated(2 * workers);
+  // Squared column norms, updated by the rotations and recomputed every
+  // sweep
+  std::vector<double> norm2(n);
+
+  run_workers(workers, [&](unsigned wk, unsigned nw) {
+    for (unsigned sweep = 0; sweep < c_JACOBI_MAX_SWEEPS; sweep++) {
+      unsigned char &mine = rotated[(sweep & 1) * nw + wk];
+      mine = 0;
+      for (size_t j = wk; j < n; j += nw)
+        norm2[j] = dot(&w[j * m], &w[j * m], m);
+      barrier.wait();
+      for (size_t st = 0; st < steps; st++) {
+        for (size_t i = wk; i < per_step; i += nw) {
+          const size_t p = sched[st * per_step + i].first;
+          const size_t q = sched[st * per_step + i].second;
+          if (p >= n || q >= n)
+            continue;
+          double *wp = &w[p * m], *wq = &w[q * m];
+          const double alpha = norm2[p], beta = norm2[q];
+          const double gamma = dot(wp, wq, m);
+          if (!(std::abs(gamma) > c_JACOBI_TOL * std::sqrt(alpha * beta)))
+            continue;
+          mine = 1;
+          const double zeta = (beta - alpha) / (2 * gamma);
+          const double t = std::copysign(1., zeta) / (std::abs(zeta) + std::hypot(1., zeta));
+          const double c = 1 / std::hypot(1., t);
+          const double s = c * t;
+          norm2[p] = alpha - t * gamma;
+          norm2[q] = beta + t * gamma;
+          for (size_t r = 0; r < m; r++) {
+            const double a = wp[r], b = wq[r];
+            wp[r] = c * a - s * b;
+            wq[r] = s * a + c * b;
+          }
+          double *vp = &vv[p * n], *vq = &vv[q * n];
+          for (size_t r = 0; r < n; r++) {
+            const double a = vp[r], b = vq[r];
+            vp[r] = c * a - s * b;
+            vq[r] = s * a + c * b;
+          }
+        }
+        barrier.wait();
+      }
+      // Every worker reaches the same decision, the flags of the next sweep
+      // live in the other half
+      bool any = false;
+      for (unsigned i = 0; i < nw; i++)
+        any = any || rotated[(sweep & 1) * nw + i];
+      if (!any)
+        break;
+    }
+  });
+}
+
+// [b | extra] * g, with b rows x k and g (k + 1) x (k + 1), keeping 'kk'
+// columns
+std::vector<double> extend_mul(const std::vector<double> &b, const std::vector<double> &extra,
+                               size_t rows, size_t k, const std::vector<double> &g, size_t kk,
+                               unsigned threads)
+{
+  std::vector<double> out(rows * kk);
+  const size_t gk = k + 1;
+  run_workers(worker_count(threads, rows / 64 + 1), [&](unsigned wk, unsigned nw) {
+    for (size_t r = wk; r < rows; r += nw) {
+      double *o = &out[r * kk];
+      for (size_t l = 0; l < k; l++) {
+        const double v = b[r * k + l];
+        if (v == 0)
+          continue;
+        for (size_t c = 0; c < kk; c++)
+          o[c] += v * g[l * gk + c];
+      }
+      if (extra[r] != 0)
+        for (size_t c = 0; c < kk; c++)
+          o[c] += extra[r] * g[k * gk + c];
+    }
+  });
+  return out;
+}
+
+} // namespace
+
+svd_factors svd(const std::vector<double> &a, size_t rows, size_t cols, unsigned threads)
+{
+  if (rows == 0 || cols == 0 || a.size() != rows * cols)
+    throw std::invalid_argument("invalid matrix dimensions");
+
+  // One-sided Jacobi on the columns of a, or of a^T when it's wide
+  const bool tr = rows < cols;
+  const size_t m = tr ? cols : rows;
+  const size_t n = tr ? rows : cols;
+  std::vector<double> w(m * n);
+  for (size_t i = 0; i < rows; i++)
+    for (size_t j = 0; j < cols; j++)
+      w[tr ? i * m + j : j * m + i] = a[i * cols + j];
+  std::vector<double> vv(n * n, 0);
+  for (size_t j = 0; j < n; j++)
+    vv[j * n + j] = 1;
+
+  jacobi_sweeps(w, vv, m, n, threads);
+
+  std::vector<double> norms(n);
+  for (size_t j = 0; j < n; j++) {
+    double s = 0;
+    for (size_t r = 0; r < m; r++)
+      s += w[j * m + r] * w[j * m + r];
+    norms[j] = std::sqrt(s);
+  }
+  std::vector<size_t> order(n);
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t x, size_t y) { return norms[x] > norms[y]; });
+
+  svd_factors f;
+  f.rows = rows;
+  f.cols = cols;
+  f.k = n;
+  f.s.resize(n);
+  // The left vectors of the factored matrix, and the right ones
+  std::vector<double> left(m * n, 0), right(n * n);
+  for (size_t c = 0; c < n; c++) {
+    const size_t j = order[c];
+    f.s[c] = norms[j];
+    if (norms[j] > 0)
+      for (size_t r = 0; r < m; r++)
+        left[r * n + c] = w[j * m + r] / norms[j];
+    for (size_t r = 0; r < n; r++)
+      right[r * n + c] = vv[j * n + r];
+  }
+  f.u = tr ? std::move(right) : std::move(left);
+  f.v = tr ? std::move(left) : std::move(right);
+  return f;
+}
+
+corr_matrix::corr_matrix(const std::vector<double> &orm, size_t b, size_t c,
+                         const corr_matrix_config &cf):
+  m(b),
+  n(c),
+  cfg(cf),
+  a(orm),
+  bpm_out(b),
+  corr_out(c)
+{
+  if (m == 0 || n == 0 || a.size() != m * n)
+    throw std::invalid_argument("invalid response matrix dimensions");
+  if (!(cfg.rcond >= 0) || !(cfg.tikhonov >= 0))
+    throw std::invalid_argument("invalid regularization");
+  recompute();
+}
+
+void corr_matrix::recompute()
+{
+  f = svd(a, m, n, cfg.threads);
+}
+
+void corr_matrix::rank_one_update(const std::vector<double> &x, const std::vector<double> &y)
+{
+  // a + x y^T = [U P] K [V Q]^T, with P and Q the parts of x and y out of
+  // the spans of U and V and K = diag(s, 0) + [U^T x; p] [V^T y; q]^T
+  const size_t k = f.k;
+  std::vector<double> xx(k + 1, 0), yy(k + 1, 0);
+  std::vector<double> px(x), qy(y);
+  for (size_t r = 0; r < m; r++)
+    for (size_t l = 0; l < k; l++)
+      xx[l] += f.u[r * k + l] * x[r];
+  for (size_t r = 0; r < n; r++)
+    for (size_t l = 0; l < k; l++)
+      yy[l] += f.v[r * k + l] * y[r];
+  for (size_t r = 0; r < m; r++)
+    for (size_t l = 0; l < k; l++)
+      px[r] -= f.u[r * k + l] * xx[l];
+  for (size_t r = 0; r < n; r++)
+    for (size_t l = 0; l < k; l++)
+      qy[r] -= f.v[r * k + l] * yy[l];
+
+  // Residuals lost to cancellation would break the orthogonality of [U P]
+  auto normalize = [](std::vector<double> &res, const std::vector<double> &orig) {
+    double nr = 0, no = 0;
+    for (size_t r = 0; r < res.size(); r++) {
+      nr += res[r] * res[r];
+      no += orig[r] * orig[r];
+    }
+    nr = std::sqrt(nr);
+    if (nr <= 1e-10 * std::sqrt(no)) {
+      std::fill(res.begin(), res.end(), 0);
+      return 0.;
+    }
+    for (double &v: res)
+      v /= nr;
+    return nr;
+  };
+  xx[k] = normalize(px, x);
+  yy[k] = normalize(qy, y);
+
+  std::vector<double> kmat((k + 1) * (k + 1), 0);
+  for (size_t i = 0; i <= k; i++) {
+    for (size_t j = 0; j <= k; j++)
+      kmat[i * (k + 1) + j] = xx[i] * yy[j];
+    if (i < k)
+      kmat[i * (k + 1) + i] += f.s[i];
+  }
+  const svd_factors g = svd(kmat, k + 1, k + 1, cfg.threads);
+
+  size_t kk = std::min({k + 1, m, n});
+  while (kk > 1 && !(g.s[kk - 1] > c_RANK_TOL * g.s[0]))
+    kk--;
+  f.u = extend_mul(f.u, px, m, k, g.u, kk, cfg.threads);
+  f.v = extend_mul(f.v, qy, n, k, g.v, kk, cfg.threads);
+  f.s.assign(g.s.begin(), g.s.begin() + kk);
+  f.k = kk;
+}
+
+void corr_matrix::exclude_bpm(size_t i)
+{
+  if (i >= m)
+    throw std::out_of_range("BPM position index out of range");
+  if (bpm_out[i])
+    return;
+  std::vector<double> x(m, 0), y(n);
+  x[i] = 1;
+  for (size_t j = 0; j < n; j++)
+    y[j] = -a[i * n + j];
+  rank_one_update(x, y);
+  std::fill(a.begin() + i * n, a.begin() + (i + 1) * n, 0);
+  bpm_out[i] = true;
+}
+
+void corr_matrix::exclude_corrector(size_t j)
+{
+  if (j >= n)
+    throw std::out_of_range("corrector index out of range");
+  if (corr_out[j])
+    return;
+  std::vector<double> x(m), y(n, 0);
+  for (size_t i = 0; i < m; i++)
+    x[i] = -a[i * n + j];
+  y[j] = 1;
+  rank_one_update(x, y);
+  for (size_t i = 0; i < m; i++)
+    a[i * n + j] = 0;
+  corr_out[j] = true;
+}
+
+size_t corr_matrix::num_sv_used() const
+{
+  if (f.k == 0 || !(f.s[0] > 0))
+    return 0;
+  size_t used = 0;
+  while (used < f.k && f.s[used] > 0 && f.s[used] >= cfg.rcond * f.s[0])
+    used++;
+  return cfg.num_sv ? std::min(used, cfg.num_sv) : used;
+}
+
+std::vector<double> corr_matrix::inverse() const
+{
+  const size_t used = num_sv_used();
+  const size_t k = f.k;
+  std::vector<double> inv_s(used);
+  const double damp = cfg.tikhonov * (k ? f.s[0] : 0);
+  for (size_t l = 0; l < used; l++)
+    inv_s[l] = f.s[l] / (f.s[l] * f.s[l] + damp * damp);
+
+  std::vector<double> inv(n * m, 0);
+  run_workers(worker_count(cfg.threads, n), [&](unsigned wk, unsigned nw) {
+    std::vector<double> vs(used);
+    for (size_t c = wk; c < n; c += nw) {
+      for (size_t l = 0; l < used; l++)
+        vs[l] = f.v[c * k + l] * inv_s[l];
+      double *row = &inv[c * m];
+      for (size_t b = 0; b < m; b++) {
+        double acc = 0;
+        for (size_t l = 0; l < used; l++)
+          acc += vs[l] * f.u[b * k + l];
+        row[b] = acc;
+      }
+    }
+  });
+  return inv;
+}
+
+corr_quant_stats quantize_corr_matrix(const std::vector<double> &inv, size_t bpms,
+                                      size_t first, unsigned channels,
+                                      const std::vector<double> &loop_gains,
+                                      const fofb_processing_generics &gen,
+                                      wb_fofb_processing_regs &img)
+{
+  if (bpms == 0 || bpms > c_NUM_BPM_POS || inv.size() % bpms)
+    throw std::invalid_argument("invalid pseudo-inverse dimensions");
+  if (channels > c_MAX_CHANNELS)
+    throw std::invalid_argument("unsupported number of channels");
+  const size_t rows = inv.size() / bpms;
+  if (!loop_gains.empty() && loop_gains.size() != rows)
+    throw std::invalid_argument("one loop gain per corrector is needed");
+
+  const unsigned coeff_width = gen.coeff_int_width + gen.coeff_frac_width + 1;
+  const unsigned gain_width = gen.gain_int_width + gen.gain_frac_width + 1;
+  if (coeff_width > 32 || gain_width > 32)
+    throw std::invalid_argument("coefficients and gains must fit in 32 bits");
+  const double coeff_scale = std::ldexp(1., int(gen.coeff_frac_width));
+  const double coeff_max = double(fp_max(coeff_width)) / coeff_scale;
+  const double gain_max = double(fp_max(gain_width)) / std::ldexp(1., int(gen.gain_frac_width));
+  const int e_min = -int(gen.gain_frac_width);
+  int e_max = 0;
+  while (std::ldexp(1., e_max) > gain_max)
+    e_max--;
+  while (std::ldexp(1., e_max + 1) <= gain_max)
+    e_max++;
+  if (e_max < e_min)
+    throw std::invalid_argument("accumulator gain can't hold any power of two");
+
+  corr_quant_stats st = {};
+  for (unsigned ch = 0; ch < channels; ch++) {
+    const size_t row = first + ch;
+    std::vector<double> vals(bpms, 0);
+    if (row < rows)
+      for (size_t i = 0; i < bpms; i++)
+        vals[i] = inv[row * bpms + i] * (loop_gains.empty() ? 1. : loop_gains[row]);
+    double peak = 0;
+    for (double v: vals)
+      peak = std::max(peak, std::abs(v));
+    st.max_val = std::max(st.max_val, peak);
+
+    auto &regs = img.ch[ch];
+    if (peak == 0) {
+      for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+        regs.coeff_ram_bank[i].data = 0;
+      regs.acc.gain = 0;
+      continue;
+    }
+
+    // Smallest gain that keeps the coefficients in range
+    int e = e_max;
+    while (e > e_min && peak / std::ldexp(1., e - 1) <= coeff_max)
+      e--;
+    const double gain = std::ldexp(1., e);
+
+    for (unsigned i = 0; i < c_NUM_BPM_POS; i++) {
+      const double v = i < bpms ? vals[i] : 0;
+      const int64_t raw = std::llround(v / gain * coeff_scale);
+      const int64_t q = fp_saturate(raw, coeff_width);
+      if (q != raw)
+        st.saturated++;
+      regs.coeff_ram_bank[i].data = uint32_t(q) << (32 - coeff_width);
+      st.max_err = std::max(st.max_err, std::abs(double(q) / coeff_scale * gain - v));
+    }
+    regs.acc.gain = uint32_t(int64_t(1) << (e + int(gen.gain_frac_width))) << (32 - gain_width);
+  }
+  return st;
+}
+
+} // namespace fofb
@@ -0,0 +1,129 @@
+// Correction matrix: regularized pseudo-inverse of the orbit response matrix
+//
+// The response matrix (BPM positions by correctors) is factored with a
+// one-sided Jacobi SVD whose rotations, for each step of the round-robin
+// column pairing, are spread over worker threads. The pseudo-inverse keeps
+// the 'num_sv' largest singular values above 'rcond' times the largest one,
+// optionally with Tikhonov damping.
+//
+// Excluding a BPM position (zeroing its row) or a corrector (zeroing its
+// column) is a rank one change of the matrix, applied to the factors with
+// Brand's update: only a (k + 1) x (k + 1) SVD and two thin products are
+// needed instead of a full factorization. The updated factors match a new
+// factorization to rounding error; recompute() starts from the current
+// matrix again after many updates.
+//
+// quantize_corr_matrix() turns rows of the pseudo-inverse, one per
+// fofb_processing channel, into coefficients RAM contents and accumulator
+// gains: each channel's gain is a power of two so that its coefficients use
+// as much of the g_COEFF_INT_WIDTH / g_COEFF_FRAC_WIDTH range as possible.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_CORR_MATRIX_H_
+#define FOFB_CORR_MATRIX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_processing_model.h"
+#include "fofb_regs.h"
+
+namespace fofb {
+
+// Thin SVD a = u diag(s) v^T of a rows x cols matrix, with k = min(rows,
+// cols) and s in decreasing order. Matrices are row major.
+struct svd_factors {
+  size_t rows = 0;
+  size_t cols = 0;
+  size_t k = 0;
+  // rows x k
+  std::vector<double> u;
+  std::vector<double> s;
+  // cols x k
+  std::vector<double> v;
+};
+
+// 'threads' workers, 0 for one per CPU. The result doesn't depend on the
+// number of threads.
+svd_factors svd(const std::vector<double> &a, size_t rows, size_t cols, unsigned threads = 1);
+
+struct corr_matrix_config {
+  // Singular values used, 0 for all of them
+  size_t num_sv = 0;
+  // Singular values below rcond times the largest one are dropped
+  double rcond = 1e-6;
+  // Tikhonov damping, relative to the largest singular value: s is
+  // inverted as s / (s**2 + (tikhonov * s_max)**2)
+  double tikhonov = 0;
+  // Worker threads, 0 for one per CPU
+  unsigned threads = 0;
+};
+
+class corr_matrix {
+ public:
+  // 'orm' is row major, one row per BPM position and one column per
+  // corrector
+  corr_matrix(const std::vector<double> &orm, size_t bpms, size_t correctors,
+              const corr_matrix_config &cfg = {});
+
+  size_t bpms() const { return m; }
+  size_t correctors() const { return n; }
+
+  // Zero a row or a column with a rank one update of the factors
+  void exclude_bpm(size_t i);
+  void exclude_corrector(size_t j);
+  bool bpm_excluded(size_t i) const { return bpm_out[i]; }
+  bool corrector_excluded(size_t j) const { return corr_out[j]; }
+
+  // Factor the current matrix from scratch
+  void recompute();
+
+  // Current (exclusions applied) response matrix and its factors
+  const std::vector<double> &orm() const { return a; }
+  const svd_factors &factors() const { return f; }
+
+  // Singular values used by the pseudo-inverse
+  size_t num_sv_used() const;
+
+  // Pseudo-inverse, row major, one row per corrector and one column per
+  // BPM position
+  std::vector<double> inverse() const;
+
+ private:
+  void rank_one_update(const std::vector<double> &x, const std::vector<double> &y);
+
+  size_t m;
+  size_t n;
+  corr_matrix_config cfg;
+  std::vector<double> a;
+  svd_factors f;
+  std::vector<bool> bpm_out;
+  std::vector<bool> corr_out;
+};
+
+struct corr_quant_stats {
+  // Largest error of coefficient times gain against the requested value
+  double max_err;
+  // Largest requested value
+  double max_val;
+  // Coefficients saturated (the gain couldn't grow any further)
+  size_t saturated;
+};
+
+// Fill ch[ch].coeff_ram_bank and ch[ch].acc.gain of 'img' for the channels
+// ch < 'channels': channel ch gets row first + ch of the pseudo-inverse
+// 'inv' ('bpms' columns) scaled by loop_gains[first + ch], or zeros past the
+// last row. The BPM position of column i goes to coefficient i. Formats
+// follow the coefficient and gain widths of 'gen'.
+corr_quant_stats quantize_corr_matrix(const std::vector<double> &inv, size_t bpms,
+                                      size_t first, unsigned channels,
+                                      const std::vector<double> &loop_gains,
+                                      const fofb_processing_generics &gen,
+                                      wb_fofb_processing_regs &img);
+
+} // namespace fofb
+
+#endif // FOFB_CORR_MATRIX_H_
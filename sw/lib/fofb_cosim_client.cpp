@@ -0,0 +1,273 @@
+// Controller side of the fofb_processing co-simulation shared memory
+// transport
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fofb_cosim_client.h"
+#include "fofb_host.h"
+
+namespace fofb {
+
+namespace {
+
+// Polls the simulation: spins first, as a response usually takes a few
+// microseconds of GHDL time, then yields and finally sleeps, so that a slow
+// simulation doesn't have a CPU taken away by its client
+class poller {
+ public:
+  poller(double timeout_s, const char *what):
+    deadline(std::chrono::steady_clock::now() +
+             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+               std::chrono::duration<double>(timeout_s))),
+    what(what)
+  {}
+
+  void wait()
+  {
+    if (polls++ < 64)
+      return;
+    if (std::chrono::steady_clock::now() > deadline)
+      throw std::runtime_error(std::string("co-simulation timeout: ") + what);
+    if (polls < 1024)
+      std::this_thread::yield();
+    else
+      std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+
+ private:
+  std::chrono::steady_clock::time_point deadline;
+  const char *what;
+  unsigned polls = 0;
+};
+
+} // namespace
+
+cosim_client::cosim_client(unsigned key, double timeout_s):
+  timeout_s(timeout_s)
+{
+  const std::string name = cosim_shm_name(key);
+  poller p(timeout_s, "waiting for the simulation to start");
+  // The simulation creates the object, then sizes it, then fills the header
+  for (;;) {
+    fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd >= 0) {
+      struct stat sb;
+      if (::fstat(fd, &sb) < 0) {
+        const auto err = sys_error("can't stat " + name);
+        ::close(fd);
+        throw err;
+      }
+      if (size_t(sb.st_size) >= sizeof(cosim_shm_layout))
+        break;
+      ::close(fd);
+      fd = -1;
+    } else if (errno != ENOENT) {
+      throw sys_error("can't open " + name);
+    }
+    p.wait();
+  }
+
+  void *map = ::mmap(nullptr, sizeof(cosim_shm_layout), PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+  if (map == MAP_FAILED) {
+    const auto err = sys_error("can't map " + name);
+    ::close(fd);
+    throw err;
+  }
+  shm = static_cast<cosim_shm_layout *>(map);
+
+  while (shm->hdr.magic.load(std::memory_order_acquire) != c_COSIM_SHM_MAGIC) {
+    try {
+      p.wait();
+    } catch (...) {
+      ::munmap(shm, sizeof(cosim_shm_layout));
+      ::close(fd);
+      throw;
+    }
+  }
+  if (shm->hdr.version != c_COSIM_SHM_VERSION) {
+    ::munmap(shm, sizeof(cosim_shm_layout));
+    ::close(fd);
+    throw std::runtime_error(name + ": unsupported co-simulation transport version");
+  }
+
+  // Nothing is sent before fofb_server_wait_con() took the rings over from
+  // the previous client
+  const uint32_t gen = shm->hdr.attach_gen.fetch_add(1, std::memory_order_acq_rel) + 1;
+  poller pa(timeout_s, "waiting for the simulation to accept the client");
+  while (shm->hdr.ack_gen.load(std::memory_order_acquire) != gen) {
+    try {
+      pa.wait();
+    } catch (...) {
+      ::munmap(shm, sizeof(cosim_shm_layout));
+      ::close(fd);
+      throw;
+    }
+  }
+  attached = true;
+}
+
+cosim_client::~cosim_client()
+{
+  if (attached) {
+    try {
+      disconnect();
+    } catch (const std::exception &) {
+      // The simulation is gone or stuck, nothing left to tell it
+    }
+  }
+  ::munmap(shm, sizeof(cosim_shm_layout));
+  ::close(fd);
+}
+
+cosim_frac_widths cosim_client::frac_widths() const
+{
+  return {shm->hdr.gain_frac_width, shm->hdr.coeffs_frac_width, shm->hdr.bpm_frac_width};
+}
+
+void cosim_client::send(uint32_t type, const int32_t *data, size_t n)
+{
+  if (!attached)
+    throw std::runtime_error("not attached to the simulation");
+  if (n > c_COSIM_MSG_MAX_WORDS)
+    throw std::invalid_argument("too many words for one message");
+
+  cosim_shm_ring &req = shm->req;
+  const uint32_t h = req.head.val.load(std::memory_order_relaxed);
+  poller p(timeout_s, "requests ring full");
+  while (h - req.tail.val.load(std::memory_order_acquire) == c_COSIM_RING_SLOTS)
+    p.wait();
+
+  cosim_msg &msg = req.slots[h % c_COSIM_RING_SLOTS];
+  msg.type = type;
+  msg.count = uint32_t(n);
+  if (n)
+    std::memcpy(msg.data, data, n * sizeof(int32_t));
+  req.head.val.store(h + 1, std::memory_order_release);
+}
+
+bool cosim_client::try_recv(int32_t &sp)
+{
+  cosim_shm_ring &resp = shm->resp;
+  const uint32_t t = resp.tail.val.load(std::memory_order_relaxed);
+  if (resp.head.val.load(std::memory_order_acquire) == t)
+    return false;
+  const cosim_msg &msg = resp.slots[t % c_COSIM_RING_SLOTS];
+  if (msg.type != COSIM_MSG_CORR_SP || msg.count < 1)
+    throw std::runtime_error("unexpected co-simulation response");
+  sp = msg.data[0];
+  resp.tail.val.store(t + 1, std::memory_order_release);
+  in_flight--;
+  return true;
+}
+
+void cosim_client::send_coeffs(const int32_t *coeffs, size_t n)
+{
+  send(COSIM_MSG_COEFF, coeffs, n);
+}
+
+void cosim_client::send_setpoints(const int32_t *sp, size_t n)
+{
+  send(COSIM_MSG_SETPOINT, sp, n);
+}
+
+void cosim_client::send_gain(int32_t gain)
+{
+  send(COSIM_MSG_GAIN, &gain, 1);
+}
+
+void cosim_client::clear_acc()
+{
+  send(COSIM_MSG_CLEAR_ACC, nullptr, 0);
+}
+
+void cosim_client::debug()
+{
+  send(COSIM_MSG_DEBUG, nullptr, 0);
+}
+
+void cosim_client::send_bpm_pos(const int32_t *pos, size_t n)
+{
+  // The simulation would block on a full responses ring and never take the
+  // next request
+  if (in_flight == c_COSIM_RING_SLOTS)
+    throw std::runtime_error("responses ring full, read the pending set-points first");
+  send(COSIM_MSG_BPM_POS, pos, n);
+  in_flight++;
+}
+
+int32_t cosim_client::recv_sp()
+{
+  if (in_flight == 0)
+    throw std::runtime_error("no set-point pending");
+  int32_t sp;
+  poller p(timeout_s, "waiting for a set-point");
+  while (!try_recv(sp))
+    p.wait();
+  return sp;
+}
+
+void cosim_client::process(const int32_t *pos, size_t n, size_t frames, int32_t *sp)
+{
+  if (in_flight)
+    throw std::runtime_error("set-points of earlier timeframes are pending");
+  size_t sent = 0, recvd = 0;
+  poller p(timeout_s, "waiting for a set-point");
+  while (recvd < frames) {
+    bool progress = false;
+    while (sent < frames && in_flight < c_COSIM_RING_SLOTS) {
+      send_bpm_pos(pos + sent * n, n);
+      sent++;
+      progress = true;
+    }
+    while (try_recv(sp[recvd])) {
+      recvd++;
+      progress = true;
+    }
+    if (progress)
+      p = poller(timeout_s, "waiting for a set-point");
+    else
+      p.wait();
+  }
+}
+
+void cosim_client::disconnect()
+{
+  send(COSIM_MSG_DISCONNECT, nullptr, 0);
+  attached = false;
+}
+
+void cosim_client::exit_simu()
+{
+  send(COSIM_MSG_EXIT, nullptr, 0);
+  attached = false;
+}
+
+int32_t cosim_client::to_fixed(double v, int frac_width)
+{
+  const double scaled = v * std::ldexp(1., frac_width);
+  if (scaled > double(INT32_MAX))
+    return INT32_MAX;
+  if (scaled < double(INT32_MIN))
+    return INT32_MIN;
+  if (std::isnan(scaled))
+    return 0;
+  return int32_t(scaled);
+}
+
+} // namespace fofb
@@ -0,0 +1,88 @@
+// Controller side of the fofb_processing co-simulation shared memory
+// transport
+//
+// Talks to fofb_processing_cosim built with g_SHM = true through the rings
+// of fofb_cosim_shm.h: coefficients, BPM set-points and BPM positions go as
+// whole vectors, one message each, instead of one text line per value over
+// TCP. BPM positions messages can be queued ahead of their responses (up to
+// the ring size), so process() keeps the simulation busy and a batch costs
+// about the simulation time alone.
+//
+// Values are fixed point words in the simulation formats (frac_widths());
+// to_fixed() converts as the TCP transport does.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_COSIM_CLIENT_H_
+#define FOFB_COSIM_CLIENT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fofb_cosim_shm.h"
+
+namespace fofb {
+
+struct cosim_frac_widths {
+  int gain;
+  int coeffs;
+  int bpm;
+};
+
+class cosim_client {
+ public:
+  // Attach to the simulation with key 'key' (its g_TCP_PORT), waiting up to
+  // 'timeout_s' for it to create the shared memory object. Every later wait
+  // for the simulation is bounded by 'timeout_s' too, std::runtime_error is
+  // thrown when it expires.
+  explicit cosim_client(unsigned key, double timeout_s = 10);
+  ~cosim_client();
+
+  cosim_client(const cosim_client &) = delete;
+  cosim_client &operator=(const cosim_client &) = delete;
+
+  cosim_frac_widths frac_widths() const;
+
+  // Up to 512 words each
+  void send_coeffs(const int32_t *coeffs, size_t n);
+  void send_setpoints(const int32_t *sp, size_t n);
+  void send_gain(int32_t gain);
+  void clear_acc();
+  // The simulation prints its state
+  void debug();
+
+  // Queue one timeframe of BPM positions, its set-point is read with
+  // recv_sp(). Blocks only when the requests ring is full.
+  void send_bpm_pos(const int32_t *pos, size_t n);
+  int32_t recv_sp();
+  // Responses not read yet
+  size_t pending() const { return in_flight; }
+
+  // Run 'frames' timeframes of 'n' positions each ('pos' row major), with
+  // as many of them in flight as the rings allow, and store one set-point
+  // per timeframe in 'sp'
+  void process(const int32_t *pos, size_t n, size_t frames, int32_t *sp);
+
+  // Leave the simulation running for another client
+  void disconnect();
+  // Finish the simulation
+  void exit_simu();
+
+  // Float to fixed point, saturating, truncating as fofb_server does
+  static int32_t to_fixed(double v, int frac_width);
+
+ private:
+  void send(uint32_t type, const int32_t *data, size_t n);
+  bool try_recv(int32_t &sp);
+
+  int fd = -1;
+  cosim_shm_layout *shm = nullptr;
+  double timeout_s;
+  size_t in_flight = 0;
+  bool attached = false;
+};
+
+} // namespace fofb
+
+#endif // FOFB_COSIM_CLIENT_H_
@@ -0,0 +1,106 @@
+// Shared memory transport of the fofb_processing co-simulation
+//
+// Layout of the shared memory object created by fofb_server (the Rust
+// VHPIDIRECT library linked to fofb_processing_cosim) when it is built with
+// g_SHM = true. It must match the ShmLayout struct of
+// hdl/testbench/fofb_processing_cosim/fofb_server/src/lib.rs.
+//
+// The object is /fofb_cosim_<key> (/dev/shm/fofb_cosim_<key>), 'key' being
+// the g_TCP_PORT generic. It holds a header and two single-producer
+// single-consumer rings of whole messages: requests from the client to the
+// simulation and responses (one per BPM positions message) back. Each ring
+// index is only written by its owner side, with release semantics, and both
+// sides poll the other side's index.
+//
+// The server fills the header and stores the magic number last. A client
+// attaches by incrementing 'attach_gen', which ends fofb_server_wait_con():
+// the server drops whatever a previous client left in the rings and copies
+// 'attach_gen' to 'ack_gen', after which the client may send. It leaves with
+// a COSIM_MSG_DISCONNECT message.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_COSIM_SHM_H_
+#define FOFB_COSIM_SHM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace fofb {
+
+constexpr uint32_t c_COSIM_SHM_MAGIC = 0x46534843; // "CHSF"
+constexpr uint32_t c_COSIM_SHM_VERSION = 1;
+constexpr unsigned c_COSIM_RING_SLOTS = 32;
+constexpr unsigned c_COSIM_MSG_MAX_WORDS = 512;
+
+// Message types, the requests match FOFBMsgType of fofb_server
+enum cosim_msg_type : uint32_t {
+  COSIM_MSG_COEFF = 0,
+  COSIM_MSG_SETPOINT = 1,
+  COSIM_MSG_BPM_POS = 2,
+  COSIM_MSG_GAIN = 3,
+  COSIM_MSG_CLEAR_ACC = 4,
+  COSIM_MSG_DEBUG = 5,
+  COSIM_MSG_DISCONNECT = 6,
+  COSIM_MSG_EXIT = 8,
+  // Response: data[0] is the corrector set-point
+  COSIM_MSG_CORR_SP = 0x100,
+};
+
+// 'count' words of fixed point data (coefficients, set-points and positions
+// in index order, the gain in data[0])
+struct cosim_msg {
+  uint32_t type;
+  uint32_t count;
+  int32_t data[c_COSIM_MSG_MAX_WORDS];
+};
+
+struct alignas(64) cosim_shm_index {
+  std::atomic<uint32_t> val;
+};
+
+struct cosim_shm_ring {
+  // Written by the producer
+  cosim_shm_index head;
+  // Written by the consumer
+  cosim_shm_index tail;
+  cosim_msg slots[c_COSIM_RING_SLOTS];
+};
+
+struct alignas(64) cosim_shm_header {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  // Fixed point formats of the simulation, as given to new_fofb_server_shm
+  int32_t gain_frac_width;
+  int32_t coeffs_frac_width;
+  int32_t bpm_frac_width;
+  // Written by the clients
+  std::atomic<uint32_t> attach_gen;
+  // Written by the server
+  std::atomic<uint32_t> ack_gen;
+};
+
+struct cosim_shm_layout {
+  cosim_shm_header hdr;
+  // Client to simulation
+  cosim_shm_ring req;
+  // Simulation to client
+  cosim_shm_ring resp;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "the rings are shared between processes");
+static_assert(sizeof(cosim_msg) == 2056 && sizeof(cosim_shm_ring) == 65920 &&
+              sizeof(cosim_shm_layout) == 131904, "layout shared with fofb_server");
+
+inline std::string cosim_shm_name(unsigned key)
+{
+  return "/fofb_cosim_" + std::to_string(key);
+}
+
+} // namespace fofb
+
+#endif // FOFB_COSIM_SHM_H_
@@ -0,0 +1,117 @@
+// Memory-mapped access to a gateware register block
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fofb_device.h"
+#include "fofb_host.h"
+
+namespace fofb {
+
+mmap_device::mmap_device(const std::string &path, size_t size, off_t offset,
+                         bool create):
+  win_size(size)
+{
+  if (size == 0 || size % sizeof(uint32_t))
+    throw std::invalid_argument("window size must be a multiple of 4 bytes");
+
+  fd = ::open(path.c_str(), O_RDWR | O_SYNC | (create ? O_CREAT : 0), 0644);
+  if (fd < 0)
+    throw sys_error("can't open " + path);
+
+  if (create) {
+    struct stat sb;
+    if (::fstat(fd, &sb) < 0 ||
+        (sb.st_size < off_t(offset + size) && ::ftruncate(fd, offset + size) < 0)) {
+      const auto err = sys_error("can't size " + path);
+      ::close(fd);
+      throw err;
+    }
+  }
+
+  // mmap() offsets must be page aligned
+  const off_t page_mask = ::sysconf(_SC_PAGESIZE) - 1;
+  const off_t map_offset = offset & ~page_mask;
+  map_size = size + (offset - map_offset);
+  map = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+               map_offset);
+  if (map == MAP_FAILED) {
+    const auto err = sys_error("can't map " + path);
+    ::close(fd);
+    throw err;
+  }
+  base = reinterpret_cast<volatile uint32_t *>(
+    static_cast<char *>(map) + (offset - map_offset));
+}
+
+mmap_device::~mmap_device()
+{
+  ::munmap(map, map_size);
+  ::close(fd);
+}
+
+void mmap_device::check_range(size_t addr, size_t n) const
+{
+  if (addr % sizeof(uint32_t) || addr > win_size ||
+      n > (win_size - addr) / sizeof(uint32_t))
+    throw std::out_of_range("access outside of the mapped window");
+}
+
+void mmap_device::bus_wait(uint64_t ns)
+{
+  // Spin: sleeping can't resolve sub-microsecond delays
+  const auto end = std::chrono::steady_clock::now() + std::chrono::nanoseconds(ns);
+  while (std::chrono::steady_clock::now() < end)
+    ;
+}
+
+void mmap_device::read_burst(size_t addr, uint32_t *dst, size_t n) const
+{
+  check_range(addr, n);
+  volatile uint32_t *src = &reg(addr);
+  for (size_t i = 0; i < n; i++)
+    dst[i] = src[i];
+  // One wait for the whole burst, so that the overshoot of each wait doesn't
+  // add up
+  if (read_ns)
+    bus_wait(read_ns * n);
+  st.reads += n;
+  st.read_bursts++;
+}
+
+void mmap_device::write_burst(size_t addr, const uint32_t *src, size_t n)
+{
+  check_range(addr, n);
+  volatile uint32_t *dst = &reg(addr);
+  for (size_t i = 0; i < n; i++)
+    dst[i] = src[i];
+  if (write_ns)
+    bus_wait(write_ns * n);
+  st.writes += n;
+  st.write_bursts++;
+}
+
+uint64_t mmap_device::read64(size_t addr) const
+{
+  check_range(addr, 2);
+  const volatile uint32_t *src = &reg(addr);
+  if (reinterpret_cast<uintptr_t>(src) % sizeof(uint64_t))
+    throw std::invalid_argument("64 bits access not 8 bytes aligned");
+  // Little-endian host: the lower address is the low half
+  const uint64_t val = *reinterpret_cast<const volatile uint64_t *>(src);
+  if (read_ns)
+    bus_wait(read_ns);
+  st.reads += 2;
+  st.read_bursts++;
+  return val;
+}
+
+} // namespace fofb
@@ -0,0 +1,108 @@
+// Memory-mapped access to a gateware register block
+//
+// Maps a window of a file: a PCIe BAR resource file (e.g.
+// /sys/bus/pci/devices/<bdf>/resource0), /dev/mem or, for testing, a regular
+// file standing in for the device. Every access is a 32 bits volatile access
+// (except read64(), for register pairs the gateware exposes as 64 bits data),
+// bursts are issued in increasing address order so that the host bridge can
+// coalesce them. Accesses are counted, so tools and tests can tell how many
+// bus transactions an operation costs.
+//
+// A stand-in device can also be given a per-word latency (set_latency()),
+// busy-waited after each access (once for all the words of a burst), to model
+// the cost of the PCIe/Wishbone bridge when benchmarking host code against
+// it.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_DEVICE_H_
+#define FOFB_DEVICE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <sys/types.h>
+
+namespace fofb {
+
+struct device_stats {
+  // Single word accesses (bursts included, word by word)
+  uint64_t reads;
+  uint64_t writes;
+  // Bursts of consecutive words
+  uint64_t read_bursts;
+  uint64_t write_bursts;
+};
+
+class mmap_device {
+ public:
+  // Map 'size' bytes at 'offset' of 'path'. With 'create', 'path' is a
+  // stand-in device: it is created if needed and extended to hold the window.
+  mmap_device(const std::string &path, size_t size, off_t offset = 0,
+              bool create = false);
+  ~mmap_device();
+
+  mmap_device(const mmap_device &) = delete;
+  mmap_device &operator=(const mmap_device &) = delete;
+
+  // 'addr' is a byte address relative to the window, as the cheby offsets
+  uint32_t read32(size_t addr) const
+  {
+    st.reads++;
+    const uint32_t val = reg(addr);
+    if (read_ns)
+      bus_wait(read_ns);
+    return val;
+  }
+
+  void write32(size_t addr, uint32_t val)
+  {
+    st.writes++;
+    reg(addr) = val;
+    if (write_ns)
+      bus_wait(write_ns);
+  }
+
+  // Read/write 'n' consecutive words starting at 'addr'
+  void read_burst(size_t addr, uint32_t *dst, size_t n) const;
+  void write_burst(size_t addr, const uint32_t *src, size_t n);
+
+  // Read the two words at 'addr' (8 bytes aligned) with a single 64 bits
+  // access, the word at 'addr' in the low half. Counted as a burst of two.
+  uint64_t read64(size_t addr) const;
+
+  // Latency added to each word read (read64() included, as a single access)
+  // and written, in ns. 0 (the default) disables it.
+  void set_latency(uint32_t read, uint32_t write)
+  {
+    read_ns = read;
+    write_ns = write;
+  }
+
+  size_t size() const { return win_size; }
+  const device_stats &stats() const { return st; }
+  void reset_stats() { st = {}; }
+
+ private:
+  volatile uint32_t &reg(size_t addr) const
+  {
+    return base[addr / sizeof(uint32_t)];
+  }
+  void check_range(size_t addr, size_t n) const;
+  static void bus_wait(uint64_t ns);
+
+  int fd;
+  void *map;
+  size_t map_size;
+  volatile uint32_t *base;
+  size_t win_size;
+  mutable device_stats st = {};
+  uint32_t read_ns = 0;
+  uint32_t write_ns = 0;
+};
+
+} // namespace fofb
+
+#endif // FOFB_DEVICE_H_
@@ -0,0 +1,363 @@
+// FOFB CC error counters telemetry
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "fofb_cc_regs_access.h"
+#include "fofb_err_telemetry.h"
+
+namespace fofb {
+
+namespace {
+
+static_assert(cc_status::soft_err_cnt == cc_status::hard_err_cnt + c_CC_LINKS &&
+              cc_status::frame_err_cnt == cc_status::soft_err_cnt + c_CC_LINKS,
+              "error counters must be consecutive words");
+
+// Records moved from the rings to the file at once
+constexpr size_t c_DRAIN_BATCH = 256;
+
+// Writer thread sleep when the rings are empty
+constexpr auto c_WRITER_IDLE = std::chrono::milliseconds(10);
+
+bool valid_header(const err_telemetry_file_header &hdr)
+{
+  return !std::memcmp(hdr.magic, c_ERR_TELEMETRY_FILE_MAGIC, sizeof(hdr.magic)) &&
+         hdr.version == c_ERR_TELEMETRY_FILE_VERSION &&
+         hdr.record_size == sizeof(err_telemetry_record);
+}
+
+} // namespace
+
+cc_err_counter_source::cc_err_counter_source(mmap_device &d, size_t base):
+  dev(d),
+  addr(base + regs::fofb_cc_regs::ram_reg::data::reg_addr(cc_status::hard_err_cnt))
+{
+  if (dev.size() < base + sizeof(::fofb_cc_regs))
+    throw std::invalid_argument("device window smaller than fofb_cc_regs");
+}
+
+void cc_err_counter_source::read(uint32_t (&cnt)[c_CC_ERR_COUNTERS])
+{
+  dev.read_burst(addr, cnt, c_CC_ERR_COUNTERS);
+  // Reads of a board that went away complete with all ones
+  if (std::all_of(cnt, cnt + c_CC_ERR_COUNTERS, [](uint32_t v) { return v == UINT32_MAX; }))
+    throw std::runtime_error("device not responding");
+}
+
+err_telemetry_writer::err_telemetry_writer(const std::string &fn):
+  fname(fn)
+{
+  // Writes always go to the end of the file, reads are used to check the
+  // header of an existing file
+  f = std::fopen(fname.c_str(), "ab+");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+
+  std::fseek(f, 0, SEEK_END);
+  err_telemetry_file_header hdr;
+  if (std::ftell(f) == 0) {
+    std::memcpy(hdr.magic, c_ERR_TELEMETRY_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = c_ERR_TELEMETRY_FILE_VERSION;
+    hdr.record_size = sizeof(err_telemetry_record);
+    if (std::fwrite(&hdr, sizeof(hdr), 1, f) != 1 || std::fflush(f)) {
+      std::fclose(f);
+      throw std::runtime_error(fname + ": write error");
+    }
+  } else {
+    std::fseek(f, 0, SEEK_SET);
+    if (std::fread(&hdr, sizeof(hdr), 1, f) != 1 || !valid_header(hdr)) {
+      std::fclose(f);
+      throw std::runtime_error(fname + ": not an error telemetry file");
+    }
+
+    // A record torn by a crash would misalign all the ones appended after
+    // it, it's cut off
+    std::fseek(f, 0, SEEK_END);
+    const long size = std::ftell(f);
+    const long whole = sizeof(hdr) + (size - long(sizeof(hdr))) /
+                       long(sizeof(err_telemetry_record)) * long(sizeof(err_telemetry_record));
+    if (whole != size && ftruncate(fileno(f), whole)) {
+      std::fclose(f);
+      throw std::runtime_error(fname + ": can't cut off a torn record");
+    }
+    std::fseek(f, 0, SEEK_END);
+  }
+}
+
+err_telemetry_writer::~err_telemetry_writer()
+{
+  std::fclose(f);
+}
+
+void err_telemetry_writer::write(const err_telemetry_record *recs, size_t n)
+{
+  if (std::fwrite(recs, sizeof(*recs), n, f) != n)
+    throw std::runtime_error(fname + ": write error");
+  num_records += n;
+}
+
+void err_telemetry_writer::flush()
+{
+  if (std::fflush(f))
+    throw std::runtime_error(fname + ": write error");
+}
+
+std::vector<err_telemetry_record> read_err_telemetry_file(const std::string &fname)
+{
+  FILE *f = std::fopen(fname.c_str(), "rb");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+
+  err_telemetry_file_header hdr;
+  if (std::fread(&hdr, sizeof(hdr), 1, f) != 1 || !valid_header(hdr)) {
+    std::fclose(f);
+    throw std::runtime_error(fname + ": not an error telemetry file");
+  }
+
+  std::vector<err_telemetry_record> recs;
+  err_telemetry_record buf[c_DRAIN_BATCH];
+  size_t n;
+  while ((n = std::fread(buf, sizeof(buf[0]), c_DRAIN_BATCH, f)) > 0)
+    recs.insert(recs.end(), buf, buf + n);
+  std::fclose(f);
+  return recs;
+}
+
+err_telemetry::err_telemetry(const std::vector<err_telemetry_target> &t,
+                             const err_telemetry_config &c):
+  targets(t),
+  states(t.size()),
+  cfg(c)
+{
+  if (targets.empty())
+    throw std::invalid_argument("no targets");
+  for (const err_telemetry_target &tgt: targets)
+    if (tgt.board > UINT8_MAX || tgt.halcs > UINT8_MAX || !tgt.src)
+      throw std::invalid_argument("invalid target");
+  if (!(cfg.rate_hz > 0) || cfg.rate_hz > 1e6)
+    throw std::invalid_argument("invalid polling rate");
+  if (cfg.threads == 0)
+    throw std::invalid_argument("at least one polling thread is needed");
+
+  n_threads = std::min<size_t>(cfg.threads, targets.size());
+  period_ns = uint64_t(1e9 / cfg.rate_hz);
+  keepalive = uint32_t(std::max(1., std::round(cfg.keepalive_s * cfg.rate_hz)));
+  for (unsigned i = 0; i < n_threads; i++)
+    rings.emplace_back(new spsc_ring<err_telemetry_record>(cfg.ring_size));
+  configure(now_ns());
+}
+
+err_telemetry::~err_telemetry()
+{
+  try {
+    stop();
+  } catch (const std::exception &) {
+    // A write error not collected by stop(), the threads are joined anyway
+  }
+}
+
+void err_telemetry::configure(uint64_t now)
+{
+  start_ns = now;
+  epoch_offset_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count() - int64_t(now_ns());
+  for (target_state &s: states)
+    s = target_state();
+}
+
+bool err_telemetry::sample(size_t t, uint32_t seq, uint64_t now, err_telemetry_record &rec)
+{
+  target_state &s = states[t];
+  std::memset(&rec, 0, sizeof(rec));
+  rec.t_ns = now + epoch_offset_ns;
+  rec.seq = seq;
+  rec.board = uint8_t(targets[t].board);
+  rec.halcs = uint8_t(targets[t].halcs);
+  if (s.started && seq > s.next_seq)
+    rec.flags |= ERR_REC_GAP;
+  if (s.lost)
+    rec.flags |= ERR_REC_DROPPED;
+  s.next_seq = seq + 1;
+  n_polls.fetch_add(1, std::memory_order_relaxed);
+
+  const bool due = seq - s.last_rec_seq >= keepalive;
+  const bool was_failing = s.failing;
+  uint32_t cnt[c_CC_ERR_COUNTERS];
+  try {
+    targets[t].src->read(cnt);
+  } catch (const std::runtime_error &) {
+    n_failures.fetch_add(1, std::memory_order_relaxed);
+    rec.flags |= ERR_REC_FAIL;
+    s.failing = true;
+    // A board back from a reset or power cycle counts from zero again, the
+    // next good read starts over from the absolute counters
+    s.started = false;
+    // Once per failure and keepalive interval
+    if (was_failing && !due && !(rec.flags & (ERR_REC_GAP | ERR_REC_DROPPED)))
+      return false;
+    s.last_rec_seq = seq;
+    s.lost = false;
+    return true;
+  }
+  s.failing = false;
+
+  bool changed = false;
+  if (!s.started) {
+    rec.flags |= ERR_REC_START;
+    std::memcpy(rec.cnt, cnt, sizeof(cnt));
+    s.started = true;
+  } else {
+    for (unsigned i = 0; i < c_CC_ERR_COUNTERS; i++) {
+      // Modulo 2**32, the counters wrap around
+      rec.cnt[i] = cnt[i] - s.prev[i];
+      changed = changed || rec.cnt[i];
+    }
+  }
+  std::memcpy(s.prev, cnt, sizeof(cnt));
+
+  if (!changed && !due && !was_failing && !rec.flags)
+    return false;
+  s.last_rec_seq = seq;
+  s.lost = false;
+  return true;
+}
+
+void err_telemetry::dropped(size_t t, const err_telemetry_record &rec)
+{
+  target_state &s = states[t];
+  n_dropped.fetch_add(1, std::memory_order_relaxed);
+  s.lost = true;
+  if (rec.flags & ERR_REC_START) {
+    // The next good read starts over from the absolute counters
+    s.started = false;
+  } else if (!(rec.flags & ERR_REC_FAIL)) {
+    // Back to the counters of the previous record
+    for (unsigned i = 0; i < c_CC_ERR_COUNTERS; i++)
+      s.prev[i] -= rec.cnt[i];
+  }
+}
+
+size_t err_telemetry::drain(err_telemetry_writer &w)
+{
+  err_telemetry_record buf[c_DRAIN_BATCH];
+  size_t total = 0;
+  for (auto &ring: rings) {
+    size_t n;
+    while ((n = ring->pop(buf, c_DRAIN_BATCH)) > 0) {
+      w.write(buf, n);
+      total += n;
+    }
+  }
+  return total;
+}
+
+err_telemetry_stats err_telemetry::stats() const
+{
+  err_telemetry_stats st;
+  st.polls = n_polls.load(std::memory_order_relaxed);
+  st.failures = n_failures.load(std::memory_order_relaxed);
+  st.records = n_records.load(std::memory_order_relaxed);
+  st.missed = n_missed.load(std::memory_order_relaxed);
+  st.dropped = n_dropped.load(std::memory_order_relaxed);
+  return st;
+}
+
+void err_telemetry::poll_thread(unsigned w)
+{
+  spsc_ring<err_telemetry_record> &ring = *rings[w];
+  err_telemetry_record rec;
+  uint64_t seq = 0;
+  for (;;) {
+    const std::chrono::steady_clock::time_point deadline(
+      std::chrono::nanoseconds(start_ns + seq * period_ns));
+    {
+      std::unique_lock<std::mutex> lock(stop_mutex);
+      if (stop_cv.wait_until(lock, deadline, [this] { return !polling.load(); }))
+        break;
+    }
+
+    // Intervals whose time has passed aren't polled anymore
+    const uint64_t now = now_ns();
+    const uint64_t cur = (now - start_ns) / period_ns;
+    if (cur > seq) {
+      n_missed.fetch_add(cur - seq, std::memory_order_relaxed);
+      seq = cur;
+    }
+
+    for (size_t t = w; t < targets.size(); t += n_threads) {
+      if (!sample(t, uint32_t(seq), now, rec))
+        continue;
+      if (ring.push(rec))
+        n_records.fetch_add(1, std::memory_order_relaxed);
+      else
+        dropped(t, rec);
+    }
+    seq++;
+  }
+}
+
+void err_telemetry::write_thread(err_telemetry_writer &w)
+{
+  try {
+    while (writing.load(std::memory_order_relaxed)) {
+      // Records are rare, flush them as they come so that the file can be
+      // followed live
+      if (drain(w))
+        w.flush();
+      else
+        std::this_thread::sleep_for(c_WRITER_IDLE);
+    }
+    drain(w);
+    w.flush();
+  } catch (...) {
+    // Kept for stop(), the rings fill up and the records are dropped
+    write_err = std::current_exception();
+    write_error.store(true);
+  }
+}
+
+void err_telemetry::start(err_telemetry_writer &w)
+{
+  if (polling.load())
+    throw std::logic_error("telemetry already running");
+  configure(now_ns());
+  write_err = nullptr;
+  write_error.store(false);
+  writing.store(true);
+  polling.store(true);
+  writer = std::thread(&err_telemetry::write_thread, this, std::ref(w));
+  for (unsigned i = 0; i < n_threads; i++)
+    pollers.emplace_back(&err_telemetry::poll_thread, this, i);
+}
+
+void err_telemetry::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock(stop_mutex);
+    polling.store(false);
+  }
+  stop_cv.notify_all();
+  for (std::thread &p: pollers)
+    p.join();
+  pollers.clear();
+  // The writer thread drains the rings once more after the last poll
+  writing.store(false);
+  if (writer.joinable())
+    writer.join();
+  if (write_err) {
+    std::exception_ptr e = write_err;
+    write_err = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+} // namespace fofb
@@ -0,0 +1,246 @@
+// FOFB CC error counters telemetry
+//
+// Polls the hard, soft and frame error counters of the 4 links of every FOFB
+// CC of the crate (one target per board slot and HALCS instance) at a fixed
+// rate. The targets are spread over a few polling threads, which read them
+// concurrently, and each polling thread pushes its records into its own
+// lock-free SPSC ring, drained by a single writer thread to a binary file.
+//
+// Records hold the counter increments since the previous record of the
+// target, and one is only written when a counter changed, a read failed or
+// 'keepalive_s' elapsed since the previous one, so a quiet crate costs
+// almost nothing to log at 100 Hz. The first record of each target in an
+// acquisition (ERR_REC_START) holds the absolute counters instead, and so
+// does the first one after a failed read, as the board may have been reset
+// and its counters started over in the meantime. When a
+// ring is full, the record is lost but not its increments: the target's
+// next record carries them (or is a START record again) and is flagged
+// ERR_REC_DROPPED, so accumulating the records still gives the counters.
+//
+// File format (native endianness): an err_telemetry_file_header, written
+// when the file is created, followed by err_telemetry_record entries. Later
+// acquisitions append to the same file, after cutting off a record torn by
+// a crash. scripts/err_telemetry_to_csv.py turns a file into the per board
+// CSV files of log_to_csv_files.py.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_ERR_TELEMETRY_H_
+#define FOFB_ERR_TELEMETRY_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fofb_cc_status.h"
+#include "fofb_device.h"
+#include "fofb_host.h"
+#include "fofb_spsc_ring.h"
+
+namespace fofb {
+
+// hard_err_cnt, soft_err_cnt and frame_err_cnt of each link, in the
+// ram_reg order
+constexpr unsigned c_CC_ERR_COUNTERS = 3 * c_CC_LINKS;
+
+constexpr char c_ERR_TELEMETRY_FILE_MAGIC[8] = {'F', 'O', 'F', 'B', 'E', 'R', 'R', 'S'};
+constexpr uint32_t c_ERR_TELEMETRY_FILE_VERSION = 1;
+
+struct err_telemetry_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+// Record flags
+// First record of the target in an acquisition or after a failed read, 'cnt'
+// holds the counters
+constexpr uint8_t ERR_REC_START = 0x1;
+// The counters couldn't be read, 'cnt' is zero
+constexpr uint8_t ERR_REC_FAIL = 0x2;
+// Intervals were skipped since the previous poll of the target
+constexpr uint8_t ERR_REC_GAP = 0x4;
+// Records of the target were lost since the previous one, this one carries
+// their increments
+constexpr uint8_t ERR_REC_DROPPED = 0x8;
+
+struct err_telemetry_record {
+  // Read time, ns since the Unix epoch
+  uint64_t t_ns;
+  // Polling interval index since the acquisition start
+  uint32_t seq;
+  uint8_t board;
+  uint8_t halcs;
+  uint8_t flags;
+  uint8_t reserved;
+  // Counter increments since the previous record of the target
+  uint32_t cnt[c_CC_ERR_COUNTERS];
+};
+
+static_assert(sizeof(err_telemetry_record) == 64,
+              "err_telemetry_record must not have padding");
+
+// Where the counters of a target come from
+class err_counter_source {
+ public:
+  virtual ~err_counter_source() = default;
+
+  // Throws std::runtime_error when the counters can't be read
+  virtual void read(uint32_t (&cnt)[c_CC_ERR_COUNTERS]) = 0;
+};
+
+// Counters read from the fofb_cc_regs ram_reg status words, in one burst
+class cc_err_counter_source : public err_counter_source {
+ public:
+  // 'dev' maps a fofb_cc_regs block at 'base'
+  explicit cc_err_counter_source(mmap_device &dev, size_t base = 0);
+
+  void read(uint32_t (&cnt)[c_CC_ERR_COUNTERS]) override;
+
+ private:
+  mmap_device &dev;
+  size_t addr;
+};
+
+struct err_telemetry_target {
+  unsigned board;
+  unsigned halcs;
+  err_counter_source *src;
+};
+
+struct err_telemetry_config {
+  // Polling rate
+  double rate_hz = 1;
+  // Polling threads, the targets are spread over them
+  unsigned threads = 4;
+  // A record is written at least this often for each target, 0 writes one
+  // every interval
+  double keepalive_s = 10;
+  // Capacity of each polling thread ring, in records, a power of two
+  size_t ring_size = 1 << 12;
+};
+
+struct err_telemetry_stats {
+  uint64_t polls;
+  uint64_t failures;
+  uint64_t records;
+  // Intervals skipped by late polling threads
+  uint64_t missed;
+  // Records not queued because a ring was full, their increments went to
+  // the target's next record
+  uint64_t dropped;
+};
+
+// Append-only writer of err_telemetry_record files
+class err_telemetry_writer {
+ public:
+  explicit err_telemetry_writer(const std::string &fname);
+  ~err_telemetry_writer();
+
+  err_telemetry_writer(const err_telemetry_writer &) = delete;
+  err_telemetry_writer &operator=(const err_telemetry_writer &) = delete;
+
+  void write(const err_telemetry_record *recs, size_t n);
+  void flush();
+
+  uint64_t records() const { return num_records; }
+
+ private:
+  std::string fname;
+  FILE *f;
+  uint64_t num_records = 0;
+};
+
+// Read a whole err_telemetry_record file
+std::vector<err_telemetry_record> read_err_telemetry_file(const std::string &fname);
+
+class err_telemetry {
+ public:
+  err_telemetry(const std::vector<err_telemetry_target> &targets,
+                const err_telemetry_config &cfg = {});
+  ~err_telemetry();
+
+  err_telemetry(const err_telemetry &) = delete;
+  err_telemetry &operator=(const err_telemetry &) = delete;
+
+  // Forget the previous counters and restart the interval count at
+  // 'now_ns' (steady clock, see now_ns())
+  void configure(uint64_t now_ns);
+
+  // Read target 't' for interval 'seq' at 'now_ns' and fill 'rec'. Returns
+  // whether 'rec' is to be written. A target is only ever sampled by one
+  // thread.
+  bool sample(size_t t, uint32_t seq, uint64_t now_ns, err_telemetry_record &rec);
+  // The record just returned by sample() for target 't' couldn't be
+  // written: carry it over to the target's next record
+  void dropped(size_t t, const err_telemetry_record &rec);
+
+  // Run the polling and writing threads until stop(). A write error stops
+  // the writer thread, the records are then dropped, and is rethrown by
+  // stop().
+  void start(err_telemetry_writer &w);
+  void stop();
+  // Whether the writer thread stopped on a write error
+  bool write_failed() const { return write_error.load(); }
+
+  // Consumer side: move the records in the rings to 'w'
+  size_t drain(err_telemetry_writer &w);
+
+  // Safe to call while running
+  err_telemetry_stats stats() const;
+
+ private:
+  struct target_state {
+    uint32_t prev[c_CC_ERR_COUNTERS];
+    // Next interval expected and last one recorded
+    uint32_t next_seq;
+    uint32_t last_rec_seq;
+    bool started;
+    bool failing;
+    // A record was dropped since the last one returned
+    bool lost;
+  };
+
+  void poll_thread(unsigned w);
+  void write_thread(err_telemetry_writer &w);
+
+  std::vector<err_telemetry_target> targets;
+  std::vector<target_state> states;
+  err_telemetry_config cfg;
+  unsigned n_threads;
+  uint64_t period_ns;
+  uint32_t keepalive;
+  uint64_t start_ns = 0;
+  // Unix epoch time minus steady clock time at configure()
+  int64_t epoch_offset_ns = 0;
+  std::vector<std::unique_ptr<spsc_ring<err_telemetry_record>>> rings;
+
+  std::atomic<uint64_t> n_polls{0};
+  std::atomic<uint64_t> n_failures{0};
+  std::atomic<uint64_t> n_records{0};
+  std::atomic<uint64_t> n_missed{0};
+  std::atomic<uint64_t> n_dropped{0};
+
+  std::atomic<bool> polling{false};
+  std::atomic<bool> writing{false};
+  std::atomic<bool> write_error{false};
+  std::exception_ptr write_err;
+  // Wakes the polling threads up on stop()
+  std::mutex stop_mutex;
+  std::condition_variable stop_cv;
+  std::vector<std::thread> pollers;
+  std::thread writer;
+};
+
+} // namespace fofb
+
+#endif // FOFB_ERR_TELEMETRY_H_
@@ -0,0 +1,75 @@
+// Radix-2 complex FFT
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cmath>
+#include <stdexcept>
+#include <utility>
+
+#include "fofb_fft.h"
+
+namespace fofb {
+
+namespace {
+
+// std::complex operator* handles infinities and NaNs through a library call
+inline cplx mul(cplx a, cplx b)
+{
+  return {a.real() * b.real() - a.imag() * b.imag(),
+          a.real() * b.imag() + a.imag() * b.real()};
+}
+
+} // namespace
+
+size_t fft_size(size_t n)
+{
+  size_t p = 1;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+fft_plan::fft_plan(size_t sz):
+  n(sz)
+{
+  if (n < 2 || (n & (n - 1)) || n > (size_t(1) << 31))
+    throw std::invalid_argument("FFT size must be a power of two");
+
+  unsigned bits = 0;
+  while ((size_t(1) << bits) < n)
+    bits++;
+  rev.resize(n);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t r = 0;
+    for (unsigned b = 0; b < bits; b++)
+      r |= uint32_t(i >> b & 1) << (bits - 1 - b);
+    rev[i] = r;
+  }
+
+  tw.resize(n / 2);
+  for (size_t k = 0; k < n / 2; k++)
+    tw[k] = std::polar(1., -2 * M_PI * double(k) / double(n));
+}
+
+void fft_plan::transform(cplx *x, bool inv) const
+{
+  for (size_t i = 0; i < n; i++)
+    if (i < rev[i])
+      std::swap(x[i], x[rev[i]]);
+
+  for (size_t len = 2; len <= n; len <<= 1) {
+    const size_t half = len / 2;
+    const size_t step = n / len;
+    for (size_t i = 0; i < n; i += len) {
+      for (size_t j = 0; j < half; j++) {
+        const cplx w = inv ? std::conj(tw[j * step]) : tw[j * step];
+        const cplx t = mul(w, x[i + j + half]);
+        x[i + j + half] = x[i + j] - t;
+        x[i + j] += t;
+      }
+    }
+  }
+}
+
+} // namespace fofb
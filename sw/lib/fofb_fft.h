@@ -0,0 +1,59 @@
+// Radix-2 complex FFT
+//
+// A plan holds the bit reversal permutation and the twiddle factors of one
+// power of two size, so it can be shared (read-only) by several threads each
+// transforming its own buffers. Real signals are transformed two at a time,
+// packed as the real and imaginary parts of a complex one (see
+// fft_split_real()).
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_FFT_H_
+#define FOFB_FFT_H_
+
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fofb {
+
+using cplx = std::complex<double>;
+
+class fft_plan {
+ public:
+  // 'n' must be a power of two
+  explicit fft_plan(size_t n);
+
+  size_t size() const { return n; }
+
+  // In place, unnormalized: inverse(forward(x)) == n * x
+  void forward(cplx *x) const { transform(x, false); }
+  void inverse(cplx *x) const { transform(x, true); }
+
+ private:
+  void transform(cplx *x, bool inv) const;
+
+  size_t n;
+  std::vector<uint32_t> rev;
+  // exp(-2 pi i k / n), k < n / 2
+  std::vector<cplx> tw;
+};
+
+// Smallest power of two >= n
+size_t fft_size(size_t n);
+
+// 'z' is the transform of a + i b, with a and b real: get the transforms of
+// a and b
+inline void fft_split_real(const cplx *z, size_t n, size_t k, cplx &a, cplx &b)
+{
+  const cplx zk = z[k];
+  const cplx zn = std::conj(z[(n - k) & (n - 1)]);
+  a = 0.5 * (zk + zn);
+  b = cplx(0, -0.5) * (zk - zn);
+}
+
+} // namespace fofb
+
+#endif // FOFB_FFT_H_
@@ -0,0 +1,82 @@
+// Fixed-point helpers mirroring the VHDL numeric_std / fixed_pkg semantics
+//
+// All values are carried as two's complement integers scaled by the
+// fractionary width of the corresponding VHDL signal.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_FIXED_POINT_H_
+#define FOFB_FIXED_POINT_H_
+
+#include <cstdint>
+
+namespace fofb {
+
+// Maximum value of a 'width' bits signed number
+constexpr int64_t fp_max(unsigned width)
+{
+  return (int64_t(1) << (width - 1)) - 1;
+}
+
+// Minimum value of a 'width' bits signed number
+constexpr int64_t fp_min(unsigned width)
+{
+  return -(int64_t(1) << (width - 1));
+}
+
+// Sign-extend the 'width' least significant bits of 'val'
+constexpr int64_t fp_sext(uint64_t val, unsigned width)
+{
+  return int64_t(val << (64 - width)) >> (64 - width);
+}
+
+// Take the 'width' most significant bits of a 32 bits word as a signed
+// number (left aligned fixed-point values in the Wishbone registers)
+constexpr int32_t fp_left_aligned(uint32_t word, unsigned width)
+{
+  return int32_t(word) >> (32 - width);
+}
+
+// numeric_std resize() of a signed number: when truncating, keep the sign bit
+// along with the 'width' - 1 rightmost bits
+constexpr int64_t fp_numeric_std_resize(int64_t val, unsigned width)
+{
+  return (val < 0 ? fp_min(width) : 0) |
+         (val & ((int64_t(1) << (width - 1)) - 1));
+}
+
+// fixed_pkg resize() overflow handling (fixed_saturate)
+constexpr int64_t fp_saturate(int64_t val, unsigned width)
+{
+  return val > fp_max(width) ? fp_max(width) :
+         val < fp_min(width) ? fp_min(width) : val;
+}
+
+// fixed_pkg resize() rounding (fixed_round): drop 'shift' fractionary bits
+// rounding to the nearest, ties to even
+constexpr int64_t fp_round(int64_t val, unsigned shift)
+{
+  if (shift == 0)
+    return val;
+  const int64_t trunc = val >> shift;
+  const int64_t rem = val & ((int64_t(1) << shift) - 1);
+  const int64_t half = int64_t(1) << (shift - 1);
+  return (rem > half || (rem == half && (trunc & 1))) ? trunc + 1 : trunc;
+}
+
+// fixed_pkg resize() with the default fixed_round and fixed_saturate styles
+constexpr int64_t fp_resize(int64_t val, unsigned shift, unsigned width)
+{
+  return fp_saturate(fp_round(val, shift), width);
+}
+
+// fixed_pkg resize() with the fixed_truncate and fixed_saturate styles
+constexpr int64_t fp_resize_trunc(int64_t val, unsigned shift, unsigned width)
+{
+  return fp_saturate(val >> shift, width);
+}
+
+} // namespace fofb
+
+#endif // FOFB_FIXED_POINT_H_
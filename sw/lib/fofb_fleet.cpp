@@ -0,0 +1,594 @@
+// Versioned configuration images and their deployment to many boards
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/stat.h>
+
+#include "fofb_cc_status.h"
+#include "fofb_device.h"
+#include "fofb_fleet.h"
+
+namespace fofb {
+
+namespace {
+
+constexpr char c_CFG_FILE_MAGIC[8] = {'F', 'O', 'F', 'B', 'C', 'F', 'G', '1'};
+constexpr uint32_t c_CFG_FILE_VERSION = 1;
+
+struct cfg_file_header {
+  char magic[8];
+  uint32_t version;
+  // Bit n set when part n follows, parts in cfg_part order
+  uint32_t parts;
+};
+
+std::vector<cfg_block> make_blocks()
+{
+  std::vector<cfg_block> blocks;
+  using proc_regs = wb_fofb_processing_regs;
+  const size_t proc_ch_size = sizeof(proc_regs::ch[0]);
+
+  blocks.push_back({"proc.sps", CFG_PROC, offsetof(proc_regs, sps_ram_bank),
+                    sizeof(proc_regs::sps_ram_bank) / 4});
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    const std::string pre = "proc.ch" + std::to_string(ch);
+    const size_t base = ch * proc_ch_size;
+    blocks.push_back({pre + ".coeffs", CFG_PROC,
+                      base + offsetof(proc_regs, ch[0].coeff_ram_bank),
+                      sizeof(proc_regs::ch[0].coeff_ram_bank) / 4});
+    blocks.push_back({pre + ".gain", CFG_PROC, base + offsetof(proc_regs, ch[0].acc.gain), 1});
+    blocks.push_back({pre + ".sp_limits", CFG_PROC,
+                      base + offsetof(proc_regs, ch[0].sp_limits),
+                      sizeof(proc_regs::ch[0].sp_limits) / 4});
+  }
+
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    blocks.push_back({"shaper.ch" + std::to_string(ch) + ".coeffs", CFG_SHAPER,
+                      offsetof(wb_fofb_shaper_filt_regs, ch) +
+                        ch * sizeof(wb_fofb_shaper_filt_regs::ch[0]),
+                      sizeof(wb_fofb_shaper_filt_regs::ch[0].coeffs) / 4});
+
+  blocks.push_back({"sys_id.prbs.sp_distort", CFG_SYS_ID,
+                    offsetof(wb_fofb_sys_id_regs, prbs.sp_distort),
+                    sizeof(wb_fofb_sys_id_regs::prbs.sp_distort) / 4});
+  blocks.push_back({"sys_id.prbs.bpm_pos_distort", CFG_SYS_ID,
+                    offsetof(wb_fofb_sys_id_regs, prbs.bpm_pos_distort),
+                    sizeof(wb_fofb_sys_id_regs::prbs.bpm_pos_distort) / 4});
+
+  // The configuration words on both sides of the status ones, which change
+  // all the time
+  blocks.push_back({"cc.cfg", CFG_CC, offsetof(fofb_cc_regs, ram_reg),
+                    cc_status::firmware_ver});
+  blocks.push_back({"cc.cfg_ext", CFG_CC, offsetof(fofb_cc_regs, ram_reg[cc_status::end]),
+                    sizeof(fofb_cc_regs::ram_reg) / 4 - cc_status::end});
+  return blocks;
+}
+
+uint64_t mix64(uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+uint64_t parse_hash(const std::string &s)
+{
+  if (s.size() != 16 || s.find_first_not_of("0123456789abcdef") != std::string::npos)
+    throw std::invalid_argument("invalid hash: " + s);
+  return std::strtoull(s.c_str(), nullptr, 16);
+}
+
+bool file_exists(const std::string &fname)
+{
+  struct stat sb;
+  return ::stat(fname.c_str(), &sb) == 0;
+}
+
+void make_dir(const std::string &dir)
+{
+  if (::mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+    throw std::runtime_error("can't create " + dir + ": " + std::strerror(errno));
+}
+
+// Write through a temporary file, so that readers never see a partial file
+template <typename F>
+void write_file_atomic(const std::string &fname, F write)
+{
+  const std::string tmp = fname + ".tmp";
+  {
+    std::ofstream fout(tmp, std::ios::binary | std::ios::trunc);
+    if (!fout)
+      throw std::runtime_error("can't open " + tmp);
+    write(fout);
+    if (!fout.flush())
+      throw std::runtime_error("can't write " + tmp);
+  }
+  if (std::rename(tmp.c_str(), fname.c_str()) < 0)
+    throw std::runtime_error("can't rename " + tmp + ": " + std::strerror(errno));
+}
+
+} // namespace
+
+size_t cfg_part_size(cfg_part part)
+{
+  static const size_t sizes[CFG_NUM_PARTS] = {
+    sizeof(wb_fofb_processing_regs), sizeof(wb_fofb_shaper_filt_regs),
+    sizeof(wb_fofb_sys_id_regs), sizeof(fofb_cc_regs)};
+  return sizes[part];
+}
+
+const char *cfg_part_name(cfg_part part)
+{
+  static const char *names[CFG_NUM_PARTS] = {"proc", "shaper", "sys_id", "cc"};
+  return names[part];
+}
+
+const std::vector<cfg_block> &cfg_blocks()
+{
+  static const std::vector<cfg_block> blocks = make_blocks();
+  return blocks;
+}
+
+// Not cryptographic: a murmur-style mix per word, enough to tell contents
+// apart and fast on large blocks
+uint64_t cfg_hash(const uint32_t *words, size_t n)
+{
+  uint64_t h = 0x9e3779b97f4a7c15ull ^ n;
+  for (size_t i = 0; i < n; i++) {
+    h = (h ^ words[i]) * 0x100000001b3ull;
+    h ^= h >> 29;
+  }
+  return mix64(h);
+}
+
+std::string cfg_hash_str(uint64_t h)
+{
+  char buf[17];
+  std::snprintf(buf, sizeof(buf), "%016" PRIx64, h);
+  return buf;
+}
+
+cfg_image::cfg_image() = default;
+
+uint32_t *cfg_image::part(cfg_part p)
+{
+  if (parts[p].empty())
+    parts[p].assign(cfg_part_size(p) / 4, 0);
+  return parts[p].data();
+}
+
+const uint32_t *cfg_image::part(cfg_part p) const
+{
+  if (parts[p].empty())
+    throw std::logic_error(std::string("no ") + cfg_part_name(p) + " image");
+  return parts[p].data();
+}
+
+void cfg_image::set_part(cfg_part p, const void *img, size_t size)
+{
+  if (size != cfg_part_size(p))
+    throw std::invalid_argument(std::string(cfg_part_name(p)) + " register image size mismatch");
+  std::memcpy(part(p), img, size);
+}
+
+std::vector<uint64_t> cfg_image::block_hashes() const
+{
+  const std::vector<cfg_block> &blocks = cfg_blocks();
+  std::vector<uint64_t> hashes(blocks.size(), 0);
+  for (size_t i = 0; i < blocks.size(); i++)
+    if (has(blocks[i].part))
+      hashes[i] = cfg_hash(&parts[blocks[i].part][blocks[i].addr / 4], blocks[i].words);
+  return hashes;
+}
+
+uint64_t cfg_image::hash() const
+{
+  const std::vector<uint64_t> hashes = block_hashes();
+  std::vector<uint32_t> words;
+  for (uint64_t h: hashes) {
+    words.push_back(uint32_t(h));
+    words.push_back(uint32_t(h >> 32));
+  }
+  return cfg_hash(words.data(), words.size());
+}
+
+void cfg_image::save(const std::string &fname) const
+{
+  cfg_file_header hdr;
+  std::memcpy(hdr.magic, c_CFG_FILE_MAGIC, sizeof(hdr.magic));
+  hdr.version = c_CFG_FILE_VERSION;
+  hdr.parts = 0;
+  for (unsigned p = 0; p < CFG_NUM_PARTS; p++)
+    if (has(cfg_part(p)))
+      hdr.parts |= 1u << p;
+  write_file_atomic(fname, [&](std::ofstream &fout) {
+    fout.write(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    for (unsigned p = 0; p < CFG_NUM_PARTS; p++)
+      if (has(cfg_part(p)))
+        fout.write(reinterpret_cast<const char *>(parts[p].data()), cfg_part_size(cfg_part(p)));
+  });
+}
+
+cfg_image cfg_image::load(const std::string &fname)
+{
+  std::ifstream fin(fname, std::ios::binary);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+  cfg_file_header hdr;
+  if (!fin.read(reinterpret_cast<char *>(&hdr), sizeof(hdr)) ||
+      std::memcmp(hdr.magic, c_CFG_FILE_MAGIC, sizeof(hdr.magic)))
+    throw std::runtime_error(fname + ": not a configuration image");
+  if (hdr.version != c_CFG_FILE_VERSION)
+    throw std::runtime_error(fname + ": unsupported configuration image version");
+  cfg_image img;
+  for (unsigned p = 0; p < CFG_NUM_PARTS; p++) {
+    if (!(hdr.parts & (1u << p)))
+      continue;
+    if (!fin.read(reinterpret_cast<char *>(img.part(cfg_part(p))), cfg_part_size(cfg_part(p))))
+      throw std::runtime_error(fname + ": truncated configuration image");
+  }
+  return img;
+}
+
+cfg_store::cfg_store(const std::string &dir):
+  dir(dir)
+{
+  make_dir(dir);
+  make_dir(dir + "/images");
+}
+
+std::string cfg_store::image_path(uint64_t h) const
+{
+  return dir + "/images/" + cfg_hash_str(h) + ".cfg";
+}
+
+uint64_t cfg_store::put(const cfg_image &img, const std::string &version)
+{
+  if (version.empty() || version.find_first_of(" \t\n#") != std::string::npos)
+    throw std::invalid_argument("invalid version name: '" + version + "'");
+  for (const cfg_version &v: versions())
+    if (v.name == version)
+      throw std::invalid_argument("version " + version + " already exists");
+
+  const uint64_t h = img.hash();
+  if (!file_exists(image_path(h)))
+    img.save(image_path(h));
+
+  std::ofstream fout(dir + "/versions.txt", std::ios::app);
+  if (!fout)
+    throw std::runtime_error("can't open " + dir + "/versions.txt");
+  fout << version << ' ' << cfg_hash_str(h) << ' ' << int64_t(std::time(nullptr)) << '\n';
+  if (!fout.flush())
+    throw std::runtime_error("can't write " + dir + "/versions.txt");
+  return h;
+}
+
+uint64_t cfg_store::resolve(const std::string &version_or_hash) const
+{
+  // The latest version of that name wins, names are unique anyway
+  uint64_t h = 0;
+  bool found = false;
+  for (const cfg_version &v: versions()) {
+    if (v.name == version_or_hash) {
+      h = v.hash;
+      found = true;
+    }
+  }
+  if (found)
+    return h;
+  if (version_or_hash.size() == 16 &&
+      version_or_hash.find_first_not_of("0123456789abcdef") == std::string::npos) {
+    h = parse_hash(version_or_hash);
+    if (file_exists(image_path(h)))
+      return h;
+  }
+  throw std::runtime_error("unknown configuration version " + version_or_hash);
+}
+
+cfg_image cfg_store::get(const std::string &version_or_hash) const
+{
+  const uint64_t h = resolve(version_or_hash);
+  cfg_image img = cfg_image::load(image_path(h));
+  if (img.hash() != h)
+    throw std::runtime_error(image_path(h) + ": contents don't match the hash");
+  return img;
+}
+
+std::vector<cfg_version> cfg_store::versions() const
+{
+  std::vector<cfg_version> vs;
+  std::ifstream fin(dir + "/versions.txt");
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream ss(line);
+    cfg_version v;
+    std::string hash;
+    if (!(ss >> v.name >> hash >> v.time))
+      throw std::runtime_error(dir + "/versions.txt: malformed line");
+    v.hash = parse_hash(hash);
+    vs.push_back(v);
+  }
+  return vs;
+}
+
+std::vector<fleet_board> read_fleet_file(const std::string &fname)
+{
+  std::ifstream fin(fname);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+  std::vector<fleet_board> boards;
+  std::string line;
+  unsigned lineno = 0;
+  while (std::getline(fin, line)) {
+    lineno++;
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    fleet_board b;
+    if (!(ss >> b.name))
+      continue;
+    std::string off[CFG_NUM_PARTS];
+    if (!(ss >> b.device >> off[0] >> off[1] >> off[2] >> off[3]))
+      throw std::runtime_error(fname + ":" + std::to_string(lineno) + ": malformed line");
+    for (unsigned p = 0; p < CFG_NUM_PARTS; p++) {
+      if (off[p] == "-") {
+        b.offset[p] = -1;
+      } else {
+        char *end;
+        b.offset[p] = off_t(std::strtoull(off[p].c_str(), &end, 0));
+        if (*end != '\0')
+          throw std::runtime_error(fname + ":" + std::to_string(lineno) + ": invalid offset");
+      }
+    }
+    for (const fleet_board &o: boards)
+      if (o.name == b.name)
+        throw std::runtime_error(fname + ": board " + b.name + " listed twice");
+    boards.push_back(b);
+  }
+  return boards;
+}
+
+void fleet_manifest::save(const std::string &fname) const
+{
+  write_file_atomic(fname, [&](std::ofstream &fout) {
+    fout << "image " << cfg_hash_str(image) << '\n';
+    for (const auto &b: blocks)
+      fout << b.first << ' ' << cfg_hash_str(b.second) << '\n';
+  });
+}
+
+fleet_manifest fleet_manifest::load(const std::string &fname)
+{
+  fleet_manifest m;
+  std::ifstream fin(fname);
+  if (!fin)
+    return m;
+  std::string name, hash;
+  while (fin >> name >> hash) {
+    if (name == "image")
+      m.image = parse_hash(hash);
+    else
+      m.blocks[name] = parse_hash(hash);
+  }
+  return m;
+}
+
+fleet_deployer::fleet_deployer(const std::vector<fleet_board> &boards,
+                               const std::string &state_dir, const fleet_config &cfg):
+  boards(boards),
+  state_dir(state_dir),
+  cfg(cfg)
+{
+  if (cfg.samples == 0)
+    throw std::invalid_argument("at least one sampled word per block is needed");
+  make_dir(state_dir);
+  std::ifstream fin(state_dir + "/sampled_checks");
+  if (fin && !(fin >> sampled_checks))
+    sampled_checks = 0;
+}
+
+std::string fleet_deployer::manifest_path(const fleet_board &b) const
+{
+  return state_dir + "/" + b.name + ".manifest";
+}
+
+template <typename F>
+std::vector<fleet_board_result> fleet_deployer::run(F f)
+{
+  std::vector<fleet_board_result> res(boards.size());
+  unsigned threads = cfg.threads ? cfg.threads : unsigned(boards.size());
+  threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, boards.size())));
+
+  // Boards are independent: each worker takes the next one until none is
+  // left, and a failing board doesn't stop the others
+  std::atomic<size_t> next{0};
+  auto worker = [&] {
+    size_t i;
+    while ((i = next.fetch_add(1)) < boards.size()) {
+      const auto start = std::chrono::steady_clock::now();
+      try {
+        res[i] = f(boards[i]);
+        res[i].ok = true;
+      } catch (const std::exception &e) {
+        res[i] = {};
+        res[i].ok = false;
+        res[i].error = e.what();
+      }
+      res[i].board = boards[i].name;
+      res[i].seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+  };
+
+  std::vector<std::thread> th;
+  for (unsigned w = 1; w < threads; w++)
+    th.emplace_back(worker);
+  worker();
+  for (std::thread &t: th)
+    t.join();
+  return res;
+}
+
+namespace {
+
+// One window per part both the board and the image have
+struct board_windows {
+  std::unique_ptr<mmap_device> dev[CFG_NUM_PARTS];
+
+  board_windows(const fleet_board &b, const cfg_image &img)
+  {
+    for (unsigned p = 0; p < CFG_NUM_PARTS; p++)
+      if (b.offset[p] >= 0 && img.has(cfg_part(p)))
+        dev[p].reset(new mmap_device(b.device, cfg_part_size(cfg_part(p)), b.offset[p]));
+  }
+
+  size_t reads() const
+  {
+    size_t n = 0;
+    for (const auto &d: dev)
+      if (d)
+        n += d->stats().reads;
+    return n;
+  }
+};
+
+} // namespace
+
+fleet_board_result fleet_deployer::deploy_board(const fleet_board &b, const cfg_image &img,
+                                                const std::vector<uint64_t> &hashes,
+                                                deploy_mode mode)
+{
+  const std::vector<cfg_block> &blocks = cfg_blocks();
+  fleet_board_result r = {};
+  board_windows win(b, img);
+  fleet_manifest m = fleet_manifest::load(manifest_path(b));
+  // Only complete deployments get the image hash
+  m.image = 0;
+  std::vector<uint32_t> buf;
+
+  try {
+    for (size_t i = 0; i < blocks.size(); i++) {
+      const cfg_block &blk = blocks[i];
+      mmap_device *dev = win.dev[blk.part].get();
+      if (!dev)
+        continue;
+      const uint32_t *want = img.part(blk.part) + blk.addr / 4;
+      buf.resize(blk.words);
+
+      const auto it = m.blocks.find(blk.name);
+      if (mode == deploy_mode::manifest && it != m.blocks.end() && it->second == hashes[i]) {
+        r.blocks_skipped++;
+        continue;
+      }
+      if (mode == deploy_mode::verify) {
+        dev->read_burst(blk.addr, buf.data(), blk.words);
+        if (cfg_hash(buf.data(), blk.words) == hashes[i]) {
+          m.blocks[blk.name] = hashes[i];
+          r.blocks_skipped++;
+          continue;
+        }
+      }
+
+      // Forget the block until it's known to be right
+      m.blocks.erase(blk.name);
+      dev->write_burst(blk.addr, want, blk.words);
+      dev->read_burst(blk.addr, buf.data(), blk.words);
+      if (cfg_hash(buf.data(), blk.words) != hashes[i])
+        throw std::runtime_error(b.name + ": " + blk.name + " readback mismatch");
+      m.blocks[blk.name] = hashes[i];
+      r.blocks_written++;
+      r.words_written += blk.words;
+    }
+  } catch (...) {
+    m.save(manifest_path(b));
+    throw;
+  }
+
+  m.image = img.hash();
+  m.save(manifest_path(b));
+  r.words_read = win.reads();
+  return r;
+}
+
+fleet_board_result fleet_deployer::check_board(const fleet_board &b, const cfg_image &img,
+                                               const std::vector<uint64_t> &hashes,
+                                               check_mode mode, uint64_t round)
+{
+  const std::vector<cfg_block> &blocks = cfg_blocks();
+  fleet_board_result r = {};
+
+  if (mode == check_mode::manifest) {
+    const fleet_manifest m = fleet_manifest::load(manifest_path(b));
+    for (size_t i = 0; i < blocks.size(); i++) {
+      if (b.offset[blocks[i].part] < 0 || !img.has(blocks[i].part))
+        continue;
+      const auto it = m.blocks.find(blocks[i].name);
+      if (it == m.blocks.end() || it->second != hashes[i])
+        r.drifted.push_back(blocks[i].name);
+    }
+    return r;
+  }
+
+  board_windows win(b, img);
+  std::vector<uint32_t> buf;
+  for (size_t i = 0; i < blocks.size(); i++) {
+    const cfg_block &blk = blocks[i];
+    const mmap_device *dev = win.dev[blk.part].get();
+    if (!dev)
+      continue;
+    const uint32_t *want = img.part(blk.part) + blk.addr / 4;
+    bool same = true;
+    if (mode == check_mode::sampled && cfg.samples < blk.words) {
+      // Spread over the block, a word further on each check, so that
+      // repeated checks go through the whole block
+      const size_t stride = (blk.words + cfg.samples - 1) / cfg.samples;
+      for (size_t idx = round % stride; idx < blk.words && same; idx += stride)
+        same = dev->read32(blk.addr + idx * 4) == want[idx];
+    } else {
+      buf.resize(blk.words);
+      dev->read_burst(blk.addr, buf.data(), blk.words);
+      same = cfg_hash(buf.data(), blk.words) == hashes[i];
+    }
+    if (!same)
+      r.drifted.push_back(blk.name);
+  }
+  r.words_read = win.reads();
+  return r;
+}
+
+std::vector<fleet_board_result> fleet_deployer::deploy(const cfg_image &img, deploy_mode mode)
+{
+  const std::vector<uint64_t> hashes = img.block_hashes();
+  return run([&](const fleet_board &b) { return deploy_board(b, img, hashes, mode); });
+}
+
+std::vector<fleet_board_result> fleet_deployer::check(const cfg_image &img, check_mode mode)
+{
+  const std::vector<uint64_t> hashes = img.block_hashes();
+  const uint64_t round = mode == check_mode::sampled ? sampled_checks++ : 0;
+  if (mode == check_mode::sampled)
+    write_file_atomic(state_dir + "/sampled_checks",
+                      [&](std::ofstream &fout) { fout << sampled_checks << '\n'; });
+  return run([&](const fleet_board &b) { return check_board(b, img, hashes, mode, round); });
+}
+
+} // namespace fofb
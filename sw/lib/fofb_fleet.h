@@ -0,0 +1,211 @@
+// Versioned configuration images and their deployment to many boards
+//
+// A configuration image holds the register images of up to four parts of a
+// board (fofb_processing, fofb_shaper_filt, fofb_sys_id and the FOFB CC),
+// of which only the configuration blocks (cfg_blocks()) are deployed: the
+// coefficients and set-points RAMs, accumulator gains and set-point limits,
+// the shaper coefficients, the PRBS distortion levels and the FOFB CC
+// configuration words. Every block has a 64 bits content hash, and the image
+// hash is the hash of its block hashes, so equal configurations have equal
+// hashes whatever the registers outside of the blocks hold.
+//
+// cfg_store keeps images in a directory, one file per image named after its
+// hash, with a log of named versions.
+//
+// fleet_deployer writes an image to every board concurrently, one worker
+// thread per board (up to 'threads'), so updating a ring costs about one
+// board's update time. Each board has a manifest (the per-block hashes last
+// deployed to it), kept by the caller in a state directory, and blocks whose
+// manifest hash matches the image are not touched. Written blocks are read
+// back in one burst and their hash checked.
+//
+// There is no hash engine in the gateware: drift checks read every block
+// back in a single burst and compare its hash with the image, or, for a
+// cheaper check, a few sampled words of each block, other ones each time
+// (the number of sampled checks done is kept with the manifests). A manifest
+// check compares the manifests alone, without any bus access.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_FLEET_H_
+#define FOFB_FLEET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "fofb_regs.h"
+
+namespace fofb {
+
+enum cfg_part : unsigned {
+  CFG_PROC,
+  CFG_SHAPER,
+  CFG_SYS_ID,
+  CFG_CC,
+  CFG_NUM_PARTS,
+};
+
+// Register image size and name of each part
+size_t cfg_part_size(cfg_part part);
+const char *cfg_part_name(cfg_part part);
+
+struct cfg_block {
+  std::string name;
+  cfg_part part;
+  // Byte address in the part and size
+  size_t addr;
+  size_t words;
+};
+
+const std::vector<cfg_block> &cfg_blocks();
+
+uint64_t cfg_hash(const uint32_t *words, size_t n);
+std::string cfg_hash_str(uint64_t h);
+
+class cfg_image {
+ public:
+  cfg_image();
+
+  bool has(cfg_part part) const { return !parts[part].empty(); }
+  // Zeroed register image of 'part', allocated on first use
+  uint32_t *part(cfg_part part);
+  const uint32_t *part(cfg_part part) const;
+  // Copy a whole register image of 'part'
+  void set_part(cfg_part part, const void *img, size_t size);
+
+  // Hash of each block of cfg_blocks(), 0 for the blocks of missing parts
+  std::vector<uint64_t> block_hashes() const;
+  uint64_t hash() const;
+
+  void save(const std::string &fname) const;
+  static cfg_image load(const std::string &fname);
+
+ private:
+  std::vector<uint32_t> parts[CFG_NUM_PARTS];
+};
+
+struct cfg_version {
+  std::string name;
+  uint64_t hash;
+  // Seconds since the Unix epoch
+  int64_t time;
+};
+
+class cfg_store {
+ public:
+  // 'dir' is created if needed
+  explicit cfg_store(const std::string &dir);
+
+  // Store 'img' (once per content) under 'version', which must be new.
+  // Returns the image hash.
+  uint64_t put(const cfg_image &img, const std::string &version);
+  // By version name or by hash (16 hex digits)
+  cfg_image get(const std::string &version_or_hash) const;
+  uint64_t resolve(const std::string &version_or_hash) const;
+  std::vector<cfg_version> versions() const;
+
+ private:
+  std::string image_path(uint64_t h) const;
+
+  std::string dir;
+};
+
+struct fleet_board {
+  std::string name;
+  std::string device;
+  // Offset of each part in 'device', -1 when the board doesn't have it
+  off_t offset[CFG_NUM_PARTS];
+};
+
+// One board per line: "name device proc shaper sys_id cc", the last four
+// being the part offsets or '-'. '#' starts a comment.
+std::vector<fleet_board> read_fleet_file(const std::string &fname);
+
+// Block hashes last deployed to a board, by block name
+struct fleet_manifest {
+  uint64_t image = 0;
+  std::map<std::string, uint64_t> blocks;
+
+  void save(const std::string &fname) const;
+  // Empty manifest if 'fname' doesn't exist
+  static fleet_manifest load(const std::string &fname);
+};
+
+enum class deploy_mode {
+  // Skip the blocks whose manifest hash matches
+  manifest,
+  // Read every block back and write those that differ (repairs drift)
+  verify,
+  // Write every block
+  force,
+};
+
+enum class check_mode {
+  // Manifests only, no bus access
+  manifest,
+  // 'samples' words of each block, other ones on each check: every word is
+  // read after (block words / 'samples') checks
+  sampled,
+  // Every block in one burst, hashed
+  full,
+};
+
+struct fleet_board_result {
+  std::string board;
+  bool ok;
+  // Exception message when !ok
+  std::string error;
+  size_t blocks_written;
+  size_t blocks_skipped;
+  size_t words_written;
+  size_t words_read;
+  // Blocks differing from the image (check), by name
+  std::vector<std::string> drifted;
+  double seconds;
+};
+
+struct fleet_config {
+  // Worker threads, 0 for one per board
+  unsigned threads = 0;
+  // Words per block for check_mode::sampled
+  unsigned samples = 4;
+};
+
+class fleet_deployer {
+ public:
+  // Manifests are kept in 'state_dir' as <board>.manifest
+  fleet_deployer(const std::vector<fleet_board> &boards, const std::string &state_dir,
+                 const fleet_config &cfg = {});
+
+  std::vector<fleet_board_result> deploy(const cfg_image &img,
+                                         deploy_mode mode = deploy_mode::manifest);
+  std::vector<fleet_board_result> check(const cfg_image &img,
+                                        check_mode mode = check_mode::full);
+
+ private:
+  template <typename F>
+  std::vector<fleet_board_result> run(F f);
+
+  fleet_board_result deploy_board(const fleet_board &b, const cfg_image &img,
+                                  const std::vector<uint64_t> &hashes, deploy_mode mode);
+  fleet_board_result check_board(const fleet_board &b, const cfg_image &img,
+                                 const std::vector<uint64_t> &hashes, check_mode mode,
+                                 uint64_t round);
+  std::string manifest_path(const fleet_board &b) const;
+
+  std::vector<fleet_board> boards;
+  std::string state_dir;
+  fleet_config cfg;
+  // Sampled checks done, shifting the sampled words, kept in 'state_dir'
+  uint64_t sampled_checks = 0;
+};
+
+} // namespace fofb
+
+#endif // FOFB_FLEET_H_
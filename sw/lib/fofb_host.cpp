@@ -0,0 +1,43 @@
+// Host system helpers shared by the library
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "fofb_host.h"
+
+namespace fofb {
+
+namespace {
+
+// Waits closer than this are spent spinning instead of sleeping
+constexpr uint64_t c_SPIN_NS = 200000;
+
+} // namespace
+
+uint64_t now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t wait_until(uint64_t t, const std::atomic<bool> *run)
+{
+  uint64_t now = now_ns();
+  if (t > now + c_SPIN_NS)
+    std::this_thread::sleep_for(std::chrono::nanoseconds(t - now - c_SPIN_NS / 2));
+  while ((now = now_ns()) < t && (!run || run->load(std::memory_order_relaxed)))
+    ;
+  return now;
+}
+
+std::runtime_error sys_error(const std::string &what)
+{
+  return std::runtime_error(what + ": " + std::strerror(errno));
+}
+
+} // namespace fofb
@@ -0,0 +1,33 @@
+// Host system helpers shared by the library
+//
+// now_ns() is the steady clock all the polling and real-time loops time
+// themselves with. wait_until() waits for such a time with a sub-microsecond
+// precision: it sleeps until shortly before it, then spins, as sleeping alone
+// wakes up tens of microseconds late.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_HOST_H_
+#define FOFB_HOST_H_
+
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+namespace fofb {
+
+// Steady clock time, in ns
+uint64_t now_ns();
+
+// Wait until now_ns() reaches 't', or until 'run' (if given) is cleared.
+// Returns the last now_ns() read.
+uint64_t wait_until(uint64_t t, const std::atomic<bool> *run = nullptr);
+
+// 'what' followed by the description of errno
+std::runtime_error sys_error(const std::string &what);
+
+} // namespace fofb
+
+#endif // FOFB_HOST_H_
@@ -0,0 +1,273 @@
+// Synchronized loop closing and opening
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "fofb_cc_regs_access.h"
+#include "fofb_loop_seq.h"
+#include "wb_fofb_processing_regs_access.h"
+
+namespace fofb {
+
+namespace {
+
+using proc_regs = regs::wb_fofb_processing_regs;
+using acc_ctl = proc_regs::ch<0>::acc::ctl;
+using cfg_val = regs::fofb_cc_regs::cfg_val;
+
+template <size_t... I>
+constexpr std::array<size_t, sizeof...(I)> acc_ctl_addrs(std::index_sequence<I...>)
+{
+  return {proc_regs::ch<I>::acc::ctl::reg_addr...};
+}
+
+template <size_t... I>
+constexpr std::array<size_t, sizeof...(I)> acc_gain_addrs(std::index_sequence<I...>)
+{
+  return {proc_regs::ch<I>::acc::gain::reg_addr...};
+}
+
+constexpr auto c_CTL_ADDRS = acc_ctl_addrs(std::make_index_sequence<c_MAX_CHANNELS>());
+constexpr auto c_GAIN_ADDRS = acc_gain_addrs(std::make_index_sequence<c_MAX_CHANNELS>());
+
+// Delay between the end of the pre-faulting reads and the first batch
+constexpr uint64_t c_START_DELAY_NS = 100000;
+
+// Linear ramp step 'k' of 'n' from 0 to 'gain' (a signed value)
+uint32_t ramp_gain(uint32_t gain, uint64_t k, uint64_t n)
+{
+  return uint32_t(int32_t(int64_t(int32_t(gain)) * int64_t(k) / int64_t(n)));
+}
+
+} // namespace
+
+uint32_t acc_gain_from_real(double gain, unsigned frac_bits)
+{
+  if (frac_bits > 31)
+    throw std::invalid_argument("invalid number of fractional bits");
+  const double v = std::round(std::ldexp(gain, frac_bits));
+  if (!(v >= INT32_MIN && v <= INT32_MAX))
+    throw std::out_of_range("gain out of range");
+  return uint32_t(int32_t(v));
+}
+
+loop_sequencer::loop_sequencer(mmap_device &p, size_t pb, mmap_device *c, size_t cb,
+                               const loop_seq_config &cf):
+  proc(p),
+  proc_base(pb),
+  cc(c),
+  cc_base(cb),
+  cfg(cf)
+{
+  if (cfg.channels == 0 || cfg.channels >> c_MAX_CHANNELS)
+    throw std::invalid_argument("invalid channels mask");
+  if (!(cfg.tf_rate_hz > 0))
+    throw std::invalid_argument("invalid timeframe rate");
+  if (proc.size() < proc_base + sizeof(wb_fofb_processing_regs))
+    throw std::invalid_argument("device window smaller than wb_fofb_processing_regs");
+  if (cc && cc->size() < cc_base + sizeof(::fofb_cc_regs))
+    throw std::invalid_argument("device window smaller than fofb_cc_regs");
+}
+
+size_t loop_sequencer::ctl_addr(unsigned ch) const
+{
+  return proc_base + c_CTL_ADDRS[ch];
+}
+
+size_t loop_sequencer::gain_addr(unsigned ch) const
+{
+  return proc_base + c_GAIN_ADDRS[ch];
+}
+
+loop_seq_write loop_sequencer::cc_cfg_val(bool enable)
+{
+  // The other cfg_val fields keep their current value
+  const size_t addr = cc_base + cfg_val::reg_addr;
+  return {cc, addr, cfg_val::cc_enable::put(cc->read32(addr), enable)};
+}
+
+loop_seq_plan loop_sequencer::plan_close(const std::vector<uint32_t> &gains, bool clear,
+                                         unsigned ramp_tfs, bool cc_enable)
+{
+  if (gains.size() != c_MAX_CHANNELS)
+    throw std::invalid_argument("one gain per channel expected");
+
+  loop_seq_plan plan = {};
+  plan.freeze = false;
+  plan.cc_enable = cc && cc_enable ? 1 : -1;
+  const uint32_t ctl = clear ? acc_ctl::clear::put(0, 1) : 0;
+
+  loop_seq_batch release = {};
+  if (plan.cc_enable > 0)
+    release.pre.push_back(cc_cfg_val(true));
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    if (!(cfg.channels >> ch & 1))
+      continue;
+    plan.gains[ch] = gains[ch];
+    release.pre.push_back({&proc, gain_addr(ch), ramp_tfs ? 0 : gains[ch]});
+    release.writes.push_back({&proc, ctl_addr(ch), ctl});
+  }
+  plan.batches.push_back(std::move(release));
+
+  for (unsigned k = 1; k <= ramp_tfs; k++) {
+    loop_seq_batch b = {};
+    b.tf = k;
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+      if (cfg.channels >> ch & 1)
+        b.writes.push_back({&proc, gain_addr(ch), ramp_gain(gains[ch], k, ramp_tfs)});
+    plan.batches.push_back(std::move(b));
+  }
+  return plan;
+}
+
+loop_seq_plan loop_sequencer::plan_open(unsigned ramp_tfs, bool cc_disable)
+{
+  loop_seq_plan plan = {};
+  plan.freeze = true;
+  plan.cc_enable = cc && cc_disable ? 0 : -1;
+
+  uint32_t gains[c_MAX_CHANNELS] = {};
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    if (!(cfg.channels >> ch & 1))
+      continue;
+    gains[ch] = proc.read32(gain_addr(ch));
+    plan.gains[ch] = ramp_tfs ? 0 : gains[ch];
+  }
+
+  for (unsigned k = 0; k < ramp_tfs; k++) {
+    loop_seq_batch b = {};
+    b.tf = k;
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+      if (cfg.channels >> ch & 1)
+        b.writes.push_back({&proc, gain_addr(ch),
+                            ramp_gain(gains[ch], ramp_tfs - 1 - k, ramp_tfs)});
+    plan.batches.push_back(std::move(b));
+  }
+
+  loop_seq_batch freeze = {};
+  freeze.tf = ramp_tfs;
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    if (cfg.channels >> ch & 1)
+      freeze.writes.push_back({&proc, ctl_addr(ch), acc_ctl::freeze::put(0, 1)});
+  if (plan.cc_enable == 0)
+    freeze.post.push_back(cc_cfg_val(false));
+  plan.batches.push_back(std::move(freeze));
+  return plan;
+}
+
+void loop_sequencer::issue(const loop_seq_plan &plan, loop_seq_report &rep)
+{
+  // Touch every target register, so the batches don't fault
+  for (const loop_seq_batch &b: plan.batches)
+    for (const auto *ws: {&b.pre, &b.writes, &b.post})
+      for (const loop_seq_write &w: *ws)
+        w.dev->read32(w.addr);
+
+  const uint64_t start = now_ns() + c_START_DELAY_NS;
+  for (size_t i = 0; i < plan.batches.size(); i++) {
+    const loop_seq_batch &b = plan.batches[i];
+    loop_seq_batch_timing &t = rep.batches[i];
+    t.tf = b.tf;
+    t.due_ns = start + uint64_t(std::llround(b.tf * 1e9 / cfg.tf_rate_hz));
+    wait_until(t.due_ns);
+
+    t.start_ns = now_ns();
+    const loop_seq_write *last = nullptr;
+    for (const loop_seq_write &w: b.pre) {
+      w.dev->write32(w.addr, w.val);
+      last = &w;
+    }
+    t.first_ns = t.last_ns = now_ns();
+    for (size_t j = 0; j < b.writes.size(); j++) {
+      b.writes[j].dev->write32(b.writes[j].addr, b.writes[j].val);
+      if (j == 0)
+        t.first_ns = now_ns();
+      last = &b.writes[j];
+    }
+    if (!b.writes.empty())
+      t.last_ns = now_ns();
+    for (const loop_seq_write &w: b.post) {
+      w.dev->write32(w.addr, w.val);
+      last = &w;
+    }
+    // Posted writes are flushed by a read
+    if (last)
+      last->dev->read32(last->addr);
+    t.flushed_ns = now_ns();
+  }
+}
+
+void loop_sequencer::verify(const loop_seq_plan &plan)
+{
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    if (!(cfg.channels >> ch & 1))
+      continue;
+    if (proc.read32(gain_addr(ch)) != plan.gains[ch] ||
+        bool(acc_ctl::freeze::get(proc.read32(ctl_addr(ch)))) != plan.freeze)
+      throw std::runtime_error("channel " + std::to_string(ch) +
+                               " accumulator readback mismatch");
+  }
+  if (plan.cc_enable >= 0 &&
+      int(cfg_val::cc_enable::get(cc->read32(cc_base + cfg_val::reg_addr))) !=
+      plan.cc_enable)
+    throw std::runtime_error("FOFB CC enable readback mismatch");
+}
+
+loop_seq_report loop_sequencer::run(const loop_seq_plan &plan)
+{
+  loop_seq_report rep = {};
+  rep.tf_ns = uint64_t(std::llround(1e9 / cfg.tf_rate_hz));
+  rep.batches.resize(plan.batches.size());
+
+  std::exception_ptr err;
+  std::thread th([&]() {
+    try {
+      if (cfg.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg.cpu, &set);
+        const int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (e)
+          throw std::runtime_error(std::string("can't pin the sequence thread: ") +
+                                   std::strerror(e));
+      }
+      if (cfg.rt_priority > 0) {
+        sched_param param = {};
+        param.sched_priority = cfg.rt_priority;
+        const int e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (e)
+          throw std::runtime_error(std::string("can't set sequence thread priority: ") +
+                                   std::strerror(e));
+      }
+      issue(plan, rep);
+    } catch (...) {
+      err = std::current_exception();
+    }
+  });
+  th.join();
+  if (err)
+    std::rethrow_exception(err);
+
+  for (const loop_seq_batch_timing &t: rep.batches) {
+    rep.max_skew_ns = std::max(rep.max_skew_ns, t.last_ns - t.first_ns);
+    rep.max_late_ns = std::max(rep.max_late_ns, t.start_ns - t.due_ns);
+  }
+  verify(plan);
+  return rep;
+}
+
+} // namespace fofb
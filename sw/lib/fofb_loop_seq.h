@@ -0,0 +1,137 @@
+// Synchronized loop closing and opening
+//
+// Closing or opening the loop switches ch[].acc.ctl (FREEZE, CLEAR) of every
+// channel and, optionally, FOFB CC cfg_val.CC_ENABLE. Channels switched
+// timeframes apart kick the beam, so loop_sequencer plans the whole write
+// set ahead of time (reading whatever it needs then) and issues it as tight
+// batches of single writes:
+//   - the plan is a list of batches, each due a whole number of timeframes
+//     after the start; a gain ramp is one batch per timeframe;
+//   - each batch has 'pre' writes (staging gains of frozen channels, CC
+//     enable), then the 'writes' that switch the channels, back to back,
+//     then 'post' writes (CC disable);
+//   - run() issues the plan from a thread pinned to a CPU (and SCHED_FIFO if
+//     asked to), after reading every target register once so no page fault
+//     or TLB miss hits the batches, sleeping then spinning until each batch
+//     is due. Each batch is flushed by reading its last register back.
+// The skew of a batch is the time between the first and the last of its
+// channel writes returning; the goal is to keep it within a timeframe (about
+// 20.8 us at 48 kHz).
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_LOOP_SEQ_H_
+#define FOFB_LOOP_SEQ_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_device.h"
+#include "fofb_host.h"
+#include "fofb_regs.h"
+
+namespace fofb {
+
+struct loop_seq_write {
+  mmap_device *dev;
+  size_t addr;
+  uint32_t val;
+};
+
+struct loop_seq_batch {
+  // Timeframes after the start of the sequence
+  uint64_t tf;
+  std::vector<loop_seq_write> pre;
+  std::vector<loop_seq_write> writes;
+  std::vector<loop_seq_write> post;
+};
+
+struct loop_seq_plan {
+  std::vector<loop_seq_batch> batches;
+  // Expected ch[].acc.gain and ch[].acc.ctl.FREEZE of the channels and
+  // cfg_val.CC_ENABLE (-1 if untouched) once the plan ran
+  uint32_t gains[c_MAX_CHANNELS];
+  bool freeze;
+  int cc_enable;
+};
+
+struct loop_seq_config {
+  // Channels switched, bit i for ch[i]
+  uint32_t channels = (1u << c_MAX_CHANNELS) - 1;
+  double tf_rate_hz = 48000;
+  // CPU running the sequence, -1 for any
+  int cpu = -1;
+  // SCHED_FIFO priority of the sequence thread, 0 keeps the default policy
+  int rt_priority = 0;
+};
+
+struct loop_seq_batch_timing {
+  uint64_t tf;
+  // Steady clock times (see now_ns()): due time, start of
+  // the batch, return of its first and last channel writes and of the
+  // flushing read
+  uint64_t due_ns;
+  uint64_t start_ns;
+  uint64_t first_ns;
+  uint64_t last_ns;
+  uint64_t flushed_ns;
+};
+
+struct loop_seq_report {
+  std::vector<loop_seq_batch_timing> batches;
+  uint64_t tf_ns;
+  // Largest skew and start delay past the due time over the batches
+  uint64_t max_skew_ns;
+  uint64_t max_late_ns;
+
+  bool within_tf() const { return max_skew_ns < tf_ns; }
+};
+
+class loop_sequencer {
+ public:
+  // 'proc' maps a wb_fofb_processing_regs block at 'proc_base' and 'cc', if
+  // not nullptr, a fofb_cc_regs block at 'cc_base'
+  loop_sequencer(mmap_device &proc, size_t proc_base, mmap_device *cc, size_t cc_base,
+                 const loop_seq_config &cfg = {});
+
+  // Close the loop with 'gains' (ch[].acc.gain values, indexed by channel):
+  // with 'clear', the accumulators are cleared as they are released. Without
+  // a ramp, the gains are staged while the channels are frozen; with
+  // 'ramp_tfs' > 0, the channels are released with zero gains which then
+  // ramp linearly to 'gains' over 'ramp_tfs' timeframes. With 'cc_enable'
+  // (and a CC block), cfg_val.CC_ENABLE is set first.
+  loop_seq_plan plan_close(const std::vector<uint32_t> &gains, bool clear,
+                           unsigned ramp_tfs = 0, bool cc_enable = false);
+
+  // Open the loop: freeze the channels, after ramping their current gains
+  // (as read now) down to zero over 'ramp_tfs' timeframes. With
+  // 'cc_disable' (and a CC block), cfg_val.CC_ENABLE is cleared last.
+  loop_seq_plan plan_open(unsigned ramp_tfs = 0, bool cc_disable = false);
+
+  // Issue 'plan', then check the registers against it. Throws
+  // std::runtime_error on mismatch.
+  loop_seq_report run(const loop_seq_plan &plan);
+
+ private:
+  size_t ctl_addr(unsigned ch) const;
+  size_t gain_addr(unsigned ch) const;
+  loop_seq_write cc_cfg_val(bool enable);
+  void issue(const loop_seq_plan &plan, loop_seq_report &rep);
+  void verify(const loop_seq_plan &plan);
+
+  mmap_device &proc;
+  size_t proc_base;
+  mmap_device *cc;
+  size_t cc_base;
+  loop_seq_config cfg;
+};
+
+// ch[].acc.gain value for a real gain, given
+// fixed_point_pos.accs_gains fractional bits
+uint32_t acc_gain_from_real(double gain, unsigned frac_bits);
+
+} // namespace fofb
+
+#endif // FOFB_LOOP_SEQ_H_
@@ -0,0 +1,250 @@
+// Closed-loop FOFB simulator
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "fofb_fixed_point.h"
+#include "fofb_loop_sim.h"
+
+namespace fofb {
+
+namespace {
+
+constexpr unsigned c_VALID_WORDS = c_NUM_BPM_POS / 64;
+
+// xorshift64*, cheap enough to draw a few numbers per position and
+// timeframe
+struct sim_rng {
+  uint64_t state;
+
+  explicit sim_rng(uint64_t seed): state(seed * 0x9e3779b97f4a7c15ull + 1) {}
+
+  uint64_t next()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+  }
+
+  // Uniform in [0, 1)
+  double uniform() { return double(next() >> 11) * 0x1p-53; }
+
+  // Zero mean, unit variance, approximately normal: the sum of four 16 bits
+  // uniforms
+  double normal()
+  {
+    const uint64_t r = next();
+    const double sum = double(r & 0xffff) + double(r >> 16 & 0xffff) +
+                       double(r >> 32 & 0xffff) + double(r >> 48);
+    return (sum * 0x1p-16 - 2) * std::sqrt(3.);
+  }
+};
+
+uint32_t scale_gain(uint32_t reg, unsigned width, double scale)
+{
+  const double g = double(fp_left_aligned(reg, width)) * scale;
+  const int64_t q = fp_saturate(int64_t(std::llround(std::max(std::min(g, 0x1p62), -0x1p62))),
+                                width);
+  return uint32_t(q) << (32 - width);
+}
+
+int32_t to_pos(double v)
+{
+  return int32_t(std::lround(std::max(std::min(v, double(INT32_MAX)), double(INT32_MIN))));
+}
+
+} // namespace
+
+loop_sim_result run_loop_sim(const loop_sim_machine &m, const loop_sim_scenario &sc)
+{
+  const size_t boards = m.proc_regs.size();
+  const size_t n_corr = boards * c_MAX_CHANNELS;
+  if (boards == 0)
+    throw std::invalid_argument("no boards");
+  if (!m.shaper_regs.empty() && m.shaper_regs.size() != boards)
+    throw std::invalid_argument("one shaper register image per board is needed");
+  if (m.bpms == 0 || m.bpms > c_NUM_BPM_POS || m.orm.size() != m.bpms * n_corr)
+    throw std::invalid_argument("invalid response matrix dimensions");
+  if (m.delay_tf == 0)
+    throw std::invalid_argument("the plant delay must be at least one timeframe");
+  if (!(m.corr_pole >= 0 && m.corr_pole < 1))
+    throw std::invalid_argument("invalid corrector pole");
+
+  const size_t bpms = m.bpms;
+  const unsigned gain_width = m.proc_gen.gain_int_width + m.proc_gen.gain_frac_width + 1;
+
+  std::vector<std::unique_ptr<fofb_processing_model>> procs;
+  std::vector<std::unique_ptr<fofb_shaper_filt_model>> shapers;
+  auto img = std::make_unique<wb_fofb_processing_regs>();
+  for (size_t b = 0; b < boards; b++) {
+    std::memcpy(img.get(), &m.proc_regs[b], sizeof(*img));
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+      img->ch[ch].acc.gain = scale_gain(img->ch[ch].acc.gain, gain_width, sc.gain_scale);
+    img->loop_intlk.ctl = sc.intlk_ctl & ~WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR;
+    img->loop_intlk.orb_distort_limit = sc.orb_distort_limit;
+    img->loop_intlk.min_num_pkts = sc.min_num_pkts;
+    procs.emplace_back(new fofb_processing_model(m.proc_gen));
+    procs.back()->load_regs(*img);
+    if (!m.shaper_regs.empty()) {
+      shapers.emplace_back(new fofb_shaper_filt_model(m.shaper_gen));
+      shapers.back()->load_regs(m.shaper_regs[b]);
+    }
+  }
+
+  // Column major response matrix, so that the plant update is a sum of
+  // scaled columns
+  std::vector<double> orm_cols(bpms * n_corr);
+  for (size_t i = 0; i < bpms; i++)
+    for (size_t j = 0; j < n_corr; j++)
+      orm_cols[j * bpms + i] = m.orm[i * n_corr + j];
+
+  sim_rng rng(sc.seed);
+  std::vector<double> sine_c(bpms), sine_s(bpms), step(bpms);
+  for (size_t i = 0; i < bpms; i++) {
+    const double ph = 2 * M_PI * rng.uniform();
+    sine_c[i] = std::cos(ph) * sc.sine_amp;
+    sine_s[i] = std::sin(ph) * sc.sine_amp;
+    step[i] = rng.normal() * sc.step_amp;
+  }
+
+  // Corrector outputs and the plant response to them, delay_tf timeframes
+  // back
+  std::vector<double> kick(n_corr, 0);
+  std::vector<double> resp_ring(bpms * m.delay_tf, 0);
+  int32_t pos[c_NUM_BPM_POS] = {};
+  uint64_t valid[c_VALID_WORDS];
+  int16_t sp[c_MAX_CHANNELS];
+  std::vector<double> orbit_sq, dist_sq;
+
+  loop_sim_result res = {};
+  res.intlk_tf = -1;
+  uint64_t t = 0;
+  for (; t < sc.timeframes; t++) {
+    double *resp = &resp_ring[(t % m.delay_tf) * bpms];
+    const double sn = std::sin(2 * M_PI * sc.sine_freq * double(t));
+    const double cs = std::cos(2 * M_PI * sc.sine_freq * double(t));
+    double osq = 0, dsq = 0;
+    std::memset(valid, 0, sizeof(valid));
+    for (size_t i = 0; i < bpms; i++) {
+      double d = sine_s[i] * cs + sine_c[i] * sn;
+      if (sc.noise_rms > 0)
+        d += rng.normal() * sc.noise_rms;
+      if (t >= sc.step_tf)
+        d += step[i];
+      const double o = d + resp[i];
+      pos[i] = to_pos(o);
+      osq += o * o;
+      dsq += d * d;
+
+      const bool out = i < sc.outage_bpms && t >= sc.outage_tf;
+      const bool lost = sc.pkt_loss > 0 && rng.uniform() < sc.pkt_loss;
+      if (!out && !lost)
+        valid[i / 64] |= uint64_t(1) << (i % 64);
+    }
+    orbit_sq.push_back(osq);
+    dist_sq.push_back(dsq);
+
+    uint32_t sta = 0;
+    std::fill(resp, resp + bpms, 0.);
+    for (size_t b = 0; b < boards; b++) {
+      fofb_processing_result pr;
+      procs[b]->process(pos, valid, 1, &pr);
+      sta |= pr.loop_intlk_sta;
+      if (!shapers.empty())
+        shapers[b]->process(pr.sp, 1, sp);
+      else
+        std::memcpy(sp, pr.sp, sizeof(sp));
+      for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+        res.sp_peak = std::max(res.sp_peak, std::abs(int32_t(pr.sp[ch])));
+        const size_t j = b * c_MAX_CHANNELS + ch;
+        kick[j] += (1 - m.corr_pole) * (double(sp[ch]) - kick[j]);
+        if (kick[j] == 0)
+          continue;
+        const double *col = &orm_cols[j * bpms];
+        for (size_t i = 0; i < bpms; i++)
+          resp[i] += kick[j] * col[i];
+      }
+    }
+
+    if (sta && res.intlk_tf < 0) {
+      res.intlk_tf = int64_t(t);
+      res.intlk_sta = sta;
+      if (sc.stop_on_intlk) {
+        t++;
+        break;
+      }
+    }
+  }
+
+  res.timeframes = t;
+  double osum = 0, dsum = 0;
+  for (size_t i = t / 2; i < t; i++) {
+    osum += orbit_sq[i];
+    dsum += dist_sq[i];
+  }
+  const double n = double(t - t / 2) * double(bpms);
+  res.orbit_rms = n > 0 ? std::sqrt(osum / n) : 0;
+  res.disturbance_rms = n > 0 ? std::sqrt(dsum / n) : 0;
+  return res;
+}
+
+std::vector<loop_sim_result> run_loop_sims(const loop_sim_machine &m,
+                                           const std::vector<loop_sim_scenario> &scs,
+                                           unsigned threads, loop_sim_batch_stats *st)
+{
+  std::vector<loop_sim_result> res(scs.size());
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = unsigned(std::max<size_t>(1, std::min<size_t>(threads, scs.size())));
+
+  // Scenarios are taken one at a time, as their lengths may differ a lot
+  // (stop_on_intlk)
+  std::atomic<size_t> next{0};
+  std::atomic<uint64_t> tfs{0};
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&] {
+    size_t i;
+    while ((i = next.fetch_add(1)) < scs.size()) {
+      try {
+        res[i] = run_loop_sim(m, scs[i]);
+        tfs.fetch_add(res[i].timeframes);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_mutex);
+        if (!error)
+          error = std::current_exception();
+        next.store(scs.size());
+      }
+    }
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> th;
+  for (unsigned w = 1; w < threads; w++)
+    th.emplace_back(worker);
+  worker();
+  for (std::thread &t: th)
+    t.join();
+  if (error)
+    std::rethrow_exception(error);
+
+  if (st) {
+    st->timeframes = tfs.load();
+    st->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  return res;
+}
+
+} // namespace fofb
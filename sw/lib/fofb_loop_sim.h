@@ -0,0 +1,114 @@
+// Closed-loop FOFB simulator
+//
+// Every timeframe, the BPM positions go through one fofb_processing model
+// per board (dot product, accumulators, sp_limits and the loop interlock),
+// the set-points through the boards' fofb_shaper_filt models, and the
+// filtered set-points drive the plant: a first order low pass per corrector
+// (power supply and vacuum chamber), a delay of whole timeframes and the
+// orbit response matrix, on top of a disturbance (white noise, a sine, an
+// orbit step) and of packet loss (random positions missing, or a set of
+// positions lost for good from some timeframe on).
+//
+// Scenarios (gain scaling, loop interlock settings, disturbances) are
+// independent and deterministic given their seed, so a batch is spread over
+// worker threads without changing its results.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_LOOP_SIM_H_
+#define FOFB_LOOP_SIM_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_processing_model.h"
+#include "fofb_regs.h"
+#include "fofb_shaper_filt_model.h"
+
+namespace fofb {
+
+// What is shared by every scenario of a batch
+struct loop_sim_machine {
+  fofb_processing_generics proc_gen;
+  fofb_shaper_filt_generics shaper_gen;
+
+  // One register image per board, board b drives correctors 12b to 12b + 11.
+  // The loop_intlk registers are taken from the scenarios instead.
+  std::vector<wb_fofb_processing_regs> proc_regs;
+  // Empty to bypass the shaper filters, otherwise one image per board
+  std::vector<wb_fofb_shaper_filt_regs> shaper_regs;
+
+  // BPM positions 0 to bpms - 1 are simulated, the others never arrive
+  size_t bpms = 0;
+  // Row major, bpms x (12 * boards): position change, in BPM position units,
+  // per set-point unit of each corrector
+  std::vector<double> orm;
+  // Corrector low pass pole, per timeframe (0: the corrector follows its
+  // set-point within a timeframe)
+  double corr_pole = 0;
+  // Timeframes from a set-point to the positions it affects
+  unsigned delay_tf = 1;
+};
+
+struct loop_sim_scenario {
+  uint64_t timeframes = 48000;
+  uint64_t seed = 1;
+  // Scales ch[].acc.gain of every channel (saturating to its range)
+  double gain_scale = 1;
+
+  // loop_intlk.ctl source enables, orb_distort_limit and min_num_pkts
+  uint32_t intlk_ctl = 0;
+  uint32_t orb_distort_limit = 0;
+  uint32_t min_num_pkts = 0;
+  // Stop at the first interlock
+  bool stop_on_intlk = true;
+
+  // White noise on every position (RMS)
+  double noise_rms = 0;
+  // Sine on every position, random phase per position, 'sine_freq' in
+  // cycles per timeframe
+  double sine_amp = 0;
+  double sine_freq = 0;
+  // Random orbit step of 'step_amp' (RMS) applied at 'step_tf'
+  double step_amp = 0;
+  uint64_t step_tf = 0;
+  // Probability of each position missing in each timeframe
+  double pkt_loss = 0;
+  // Positions 0 to outage_bpms - 1 stop arriving from 'outage_tf' on
+  size_t outage_bpms = 0;
+  uint64_t outage_tf = 0;
+};
+
+struct loop_sim_result {
+  uint64_t timeframes;
+  // First timeframe with loop_intlk.sta set on any board, -1 if none
+  int64_t intlk_tf;
+  // loop_intlk.sta of all boards ORed at that point
+  uint32_t intlk_sta;
+  // RMS of the positions, closed loop and of the disturbance alone, over the
+  // second half of the simulated timeframes
+  double orbit_rms;
+  double disturbance_rms;
+  // Largest set-point magnitude
+  int32_t sp_peak;
+};
+
+struct loop_sim_batch_stats {
+  uint64_t timeframes;
+  double seconds;
+};
+
+// Simulate one scenario
+loop_sim_result run_loop_sim(const loop_sim_machine &m, const loop_sim_scenario &sc);
+
+// Simulate every scenario with 'threads' workers (0 for one per CPU)
+std::vector<loop_sim_result> run_loop_sims(const loop_sim_machine &m,
+                                           const std::vector<loop_sim_scenario> &scs,
+                                           unsigned threads = 0,
+                                           loop_sim_batch_stats *st = nullptr);
+
+} // namespace fofb
+
+#endif // FOFB_LOOP_SIM_H_
@@ -0,0 +1,271 @@
+// Decoder for captures of FOFB packets with set-points
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "fofb_packet_decoder.h"
+#include "fofb_host.h"
+
+namespace fofb {
+
+namespace {
+
+bool accepted(const uint32_t *pkt, const packet_filter *filter)
+{
+  return !filter ||
+         (pkt[0] >= filter->tf_min && pkt[0] <= filter->tf_max &&
+          (filter->bpm_ids.none() || filter->bpm_ids.test(pkt[3] & c_MAX_BPM_ID)));
+}
+
+void decode_one(const uint32_t *pkt, uint64_t idx, packet_columns &cols, size_t k)
+{
+  cols.idx[k] = idx;
+  cols.tf_cntr_32[k] = pkt[0];
+  cols.bpm_y[k] = int32_t(pkt[1]);
+  cols.bpm_x[k] = int32_t(pkt[2]);
+  cols.tf_cntr_16[k] = uint16_t(pkt[3] >> 16);
+  cols.tf_start[k] = uint8_t(pkt[3] >> 15 & 1);
+  cols.bpm_id[k] = uint16_t(pkt[3] & c_MAX_BPM_ID);
+  for (unsigned i = 0; i < c_PACKET_SPS; i++) {
+    cols.sp_x[i][k] = int16_t(pkt[4 + i] >> 16);
+    cols.sp_y[i][k] = int16_t(pkt[4 + i]);
+  }
+}
+
+#ifdef __AVX2__
+
+// Store the 8 32-bit lanes of 'v' (in the 16-bit range) as 16-bit values
+inline void store_16(void *dst, __m256i v)
+{
+  const __m256i p = _mm256_permute4x64_epi64(_mm256_packs_epi32(v, v), 0x08);
+  _mm_storeu_si128(static_cast<__m128i *>(dst), _mm256_castsi256_si128(p));
+}
+
+inline void store_16u(void *dst, __m256i v)
+{
+  const __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+  _mm_storeu_si128(static_cast<__m128i *>(dst), _mm256_castsi256_si128(p));
+}
+
+// Decode 8 packets, all of them accepted
+inline void decode_8(const __m256i *w, uint64_t idx, packet_columns &cols, size_t k)
+{
+  const __m256i idx_v = _mm256_set1_epi64x(idx);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(&cols.idx[k]),
+                      _mm256_add_epi64(idx_v, _mm256_setr_epi64x(0, 1, 2, 3)));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(&cols.idx[k + 4]),
+                      _mm256_add_epi64(idx_v, _mm256_setr_epi64x(4, 5, 6, 7)));
+
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(&cols.tf_cntr_32[k]), w[0]);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(&cols.bpm_y[k]), w[1]);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(&cols.bpm_x[k]), w[2]);
+
+  store_16u(&cols.tf_cntr_16[k], _mm256_srli_epi32(w[3], 16));
+  store_16u(&cols.bpm_id[k], _mm256_and_si256(w[3], _mm256_set1_epi32(c_MAX_BPM_ID)));
+  const __m256i start = _mm256_and_si256(_mm256_srli_epi32(w[3], 15), _mm256_set1_epi32(1));
+  const __m256i start16 = _mm256_packus_epi32(start, start);
+  const __m256i start8 = _mm256_packus_epi16(start16, start16);
+  // Bytes 0-3 of each 128-bit lane
+  const uint64_t start_bytes =
+    uint32_t(_mm256_extract_epi32(start8, 0)) |
+    uint64_t(uint32_t(_mm256_extract_epi32(start8, 4))) << 32;
+  std::memcpy(&cols.tf_start[k], &start_bytes, sizeof(start_bytes));
+
+  for (unsigned i = 0; i < c_PACKET_SPS; i++) {
+    store_16(&cols.sp_x[i][k], _mm256_srai_epi32(w[4 + i], 16));
+    store_16(&cols.sp_y[i][k], _mm256_srai_epi32(_mm256_slli_epi32(w[4 + i], 16), 16));
+  }
+}
+
+// Transpose 8 packets into w[j] = word j of the 8 packets
+inline void transpose_8(const uint32_t *pkts, __m256i *w)
+{
+  __m256i r[8], t[8], u[8];
+  for (unsigned p = 0; p < 8; p++)
+    r[p] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(pkts + p * c_PACKET_WORDS));
+  for (unsigned p = 0; p < 8; p += 2) {
+    t[p] = _mm256_unpacklo_epi32(r[p], r[p + 1]);
+    t[p + 1] = _mm256_unpackhi_epi32(r[p], r[p + 1]);
+  }
+  for (unsigned p = 0; p < 8; p += 4) {
+    u[p] = _mm256_unpacklo_epi64(t[p], t[p + 2]);
+    u[p + 1] = _mm256_unpackhi_epi64(t[p], t[p + 2]);
+    u[p + 2] = _mm256_unpacklo_epi64(t[p + 1], t[p + 3]);
+    u[p + 3] = _mm256_unpackhi_epi64(t[p + 1], t[p + 3]);
+  }
+  for (unsigned j = 0; j < 4; j++) {
+    w[j] = _mm256_permute2x128_si256(u[j], u[j + 4], 0x20);
+    w[j + 4] = _mm256_permute2x128_si256(u[j], u[j + 4], 0x31);
+  }
+}
+
+// Bit p set if packet p of 'w' has tf_cntr_32 in the filter range
+inline unsigned tf_range_mask(const __m256i *w, const packet_filter &filter)
+{
+  // Unsigned comparisons through the signed ones
+  const __m256i bias = _mm256_set1_epi32(INT32_MIN);
+  const __m256i tf = _mm256_xor_si256(w[0], bias);
+  const __m256i below = _mm256_cmpgt_epi32(
+    _mm256_set1_epi32(int32_t(filter.tf_min ^ 0x80000000u)), tf);
+  const __m256i above = _mm256_cmpgt_epi32(
+    tf, _mm256_set1_epi32(int32_t(filter.tf_max ^ 0x80000000u)));
+  return ~unsigned(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(below, above)))) &
+         0xff;
+}
+
+size_t decode_packets_vec(const uint32_t *words, size_t n, uint64_t first,
+                          const packet_filter *filter, packet_columns &cols)
+{
+  size_t k = 0;
+  size_t p = 0;
+  __m256i w[8];
+  for (; p + 8 <= n; p += 8) {
+    const uint32_t *pkts = words + p * c_PACKET_WORDS;
+    transpose_8(pkts, w);
+
+    unsigned mask = 0xff;
+    if (filter) {
+      mask = tf_range_mask(w, *filter);
+      if (mask && filter->bpm_ids.any())
+        for (unsigned i = 0; i < 8; i++)
+          if (!filter->bpm_ids.test(pkts[i * c_PACKET_WORDS + 3] & c_MAX_BPM_ID))
+            mask &= ~(1u << i);
+    }
+
+    if (mask == 0xff) {
+      decode_8(w, first + p, cols, k);
+      k += 8;
+    } else {
+      for (unsigned i = 0; mask; i++, mask >>= 1)
+        if (mask & 1)
+          decode_one(pkts + i * c_PACKET_WORDS, first + p + i, cols, k++);
+    }
+  }
+  for (; p < n; p++) {
+    const uint32_t *pkt = words + p * c_PACKET_WORDS;
+    if (accepted(pkt, filter))
+      decode_one(pkt, first + p, cols, k++);
+  }
+  return k;
+}
+
+#endif
+
+} // namespace
+
+void packet_columns::reserve(size_t n)
+{
+  if (idx.size() >= n)
+    return;
+  idx.resize(n);
+  tf_cntr_32.resize(n);
+  tf_cntr_16.resize(n);
+  tf_start.resize(n);
+  bpm_id.resize(n);
+  bpm_x.resize(n);
+  bpm_y.resize(n);
+  for (unsigned i = 0; i < c_PACKET_SPS; i++) {
+    sp_x[i].resize(n);
+    sp_y[i].resize(n);
+  }
+}
+
+void packet_filter::add_bpm_ids(const std::string &list)
+{
+  const char *s = list.c_str();
+  while (*s) {
+    char *end;
+    const unsigned long lo = std::strtoul(s, &end, 0);
+    unsigned long hi = lo;
+    if (end == s)
+      throw std::invalid_argument("invalid bpm_id list: " + list);
+    s = end;
+    if (*s == '-') {
+      hi = std::strtoul(s + 1, &end, 0);
+      if (end == s + 1)
+        throw std::invalid_argument("invalid bpm_id list: " + list);
+      s = end;
+    }
+    if (lo > hi || hi > c_MAX_BPM_ID)
+      throw std::invalid_argument("invalid bpm_id range in: " + list);
+    for (unsigned long id = lo; id <= hi; id++)
+      bpm_ids.set(id);
+    if (*s == ',')
+      s++;
+    else if (*s)
+      throw std::invalid_argument("invalid bpm_id list: " + list);
+  }
+}
+
+size_t decode_packets(const uint32_t *words, size_t n, uint64_t first,
+                      const packet_filter *filter, packet_columns &cols,
+                      bool force_scalar)
+{
+  cols.reserve(n);
+#ifdef __AVX2__
+  if (!force_scalar) {
+    cols.count = decode_packets_vec(words, n, first, filter, cols);
+    return cols.count;
+  }
+#else
+  (void)force_scalar;
+#endif
+  size_t k = 0;
+  for (size_t p = 0; p < n; p++) {
+    const uint32_t *pkt = words + p * c_PACKET_WORDS;
+    if (accepted(pkt, filter))
+      decode_one(pkt, first + p, cols, k++);
+  }
+  cols.count = k;
+  return k;
+}
+
+capture_file::capture_file(const std::string &path)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw sys_error("can't open " + path);
+  struct stat sb;
+  if (::fstat(fd, &sb) < 0) {
+    const auto err = sys_error("can't stat " + path);
+    ::close(fd);
+    throw err;
+  }
+  size = sb.st_size;
+  if (size % (c_PACKET_WORDS * sizeof(uint32_t))) {
+    ::close(fd);
+    throw std::runtime_error(path + ": size isn't a whole number of packets");
+  }
+  if (size > 0) {
+    map = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      const auto err = sys_error("can't map " + path);
+      ::close(fd);
+      throw err;
+    }
+    // The capture is read once, front to back
+    ::madvise(map, size, MADV_SEQUENTIAL);
+  }
+  ::close(fd);
+}
+
+capture_file::~capture_file()
+{
+  if (map)
+    ::munmap(map, size);
+}
+
+} // namespace fofb
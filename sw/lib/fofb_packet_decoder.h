@@ -0,0 +1,92 @@
+// Decoder for captures of FOFB packets with set-points
+//
+// A capture is a sequence of 8 words (native endianness) per packet, as
+// printed one packet per line by the acquisition and parsed by
+// scripts/reformat_fofb_packet_v2.py:
+//
+//   word 0: tf_cntr_32
+//   word 1: bpm_y
+//   word 2: bpm_x
+//   word 3: tf_cntr_16 (31:16), tf_start (15), bpm_id (14:0)
+//   words 4 to 7: sp_x_i (31:16), sp_y_i (15:0), i = 0 to 3
+//
+// Packets are decoded to columns (one array per field). With AVX2, each
+// block of 8 packets is transposed with shuffles so every field is extracted
+// for 8 packets at once.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_PACKET_DECODER_H_
+#define FOFB_PACKET_DECODER_H_
+
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace fofb {
+
+constexpr unsigned c_PACKET_WORDS = 8;
+constexpr unsigned c_PACKET_SPS = 4;
+constexpr unsigned c_MAX_BPM_ID = 0x7fff;
+
+// Decoded packets, one vector per field. The vectors may be larger than
+// 'count', only the first 'count' elements are valid.
+struct packet_columns {
+  size_t count = 0;
+  // Packet index in the capture
+  std::vector<uint64_t> idx;
+  std::vector<uint32_t> tf_cntr_32;
+  std::vector<uint16_t> tf_cntr_16;
+  std::vector<uint8_t> tf_start;
+  std::vector<uint16_t> bpm_id;
+  std::vector<int32_t> bpm_x;
+  std::vector<int32_t> bpm_y;
+  std::vector<int16_t> sp_x[c_PACKET_SPS];
+  std::vector<int16_t> sp_y[c_PACKET_SPS];
+
+  // Make room for 'n' packets
+  void reserve(size_t n);
+};
+
+struct packet_filter {
+  // tf_cntr_32 range, inclusive
+  uint32_t tf_min = 0;
+  uint32_t tf_max = UINT32_MAX;
+  // Accepted bpm_ids, all of them when empty
+  std::bitset<c_MAX_BPM_ID + 1> bpm_ids;
+
+  // Parse a list such as "0-7,16,300-303"
+  void add_bpm_ids(const std::string &list);
+};
+
+// Decode 'n' packets from 'words' (packet index 'first' in the capture),
+// keeping those accepted by 'filter' (nullptr accepts all of them).
+// Returns the number of packets stored in 'cols', which is reserved as
+// needed.
+size_t decode_packets(const uint32_t *words, size_t n, uint64_t first,
+                      const packet_filter *filter, packet_columns &cols,
+                      bool force_scalar = false);
+
+// Read-only mapping of a capture file
+class capture_file {
+ public:
+  explicit capture_file(const std::string &path);
+  ~capture_file();
+
+  capture_file(const capture_file &) = delete;
+  capture_file &operator=(const capture_file &) = delete;
+
+  const uint32_t *words() const { return static_cast<const uint32_t *>(map); }
+  size_t num_packets() const { return size / (c_PACKET_WORDS * sizeof(uint32_t)); }
+
+ private:
+  void *map = nullptr;
+  size_t size = 0;
+};
+
+} // namespace fofb
+
+#endif // FOFB_PACKET_DECODER_H_
@@ -0,0 +1,557 @@
+// Loop interlock post-mortem capture
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "fofb_cc_regs_access.h"
+#include "fofb_postmortem.h"
+
+namespace fofb {
+
+namespace {
+
+using proc_regs = regs::wb_fofb_processing_regs;
+
+template <size_t... I>
+constexpr std::array<size_t, sizeof...(I)> sp_decim_data_addrs(std::index_sequence<I...>)
+{
+  return {proc_regs::ch<I>::sp_decim::data::reg_addr...};
+}
+
+constexpr auto c_DATA_ADDRS = sp_decim_data_addrs(std::make_index_sequence<c_MAX_CHANNELS>());
+
+// link_up, time_frame_count, then the error counters, read in one burst
+static_assert(cc_status::time_frame_count == cc_status::link_up + 1 &&
+              cc_status::hard_err_cnt == cc_status::time_frame_count + 1,
+              "CC status words must be consecutive");
+constexpr size_t c_CC_WORDS = 2 + c_CC_ERR_COUNTERS;
+
+// Longest wait of the threads before checking for stop()
+constexpr auto c_IDLE_WAIT = std::chrono::milliseconds(100);
+constexpr int c_EPOLL_WAIT_MS = 100;
+
+// intlk_sim STA_CLR service period
+constexpr auto c_SIM_PERIOD = std::chrono::microseconds(50);
+
+bool valid_header(const postmortem_file_header &hdr)
+{
+  return !std::memcmp(hdr.magic, c_POSTMORTEM_FILE_MAGIC, sizeof(hdr.magic)) &&
+         hdr.version == c_POSTMORTEM_FILE_VERSION &&
+         hdr.record_size == sizeof(postmortem_sample);
+}
+
+std::string errno_str(const std::string &what)
+{
+  return what + ": " + std::strerror(errno);
+}
+
+} // namespace
+
+void write_postmortem_file(const std::string &fname, const postmortem_file_header &hdr,
+                           const postmortem_sample *samples)
+{
+  // Written aside and renamed, so a complete file appears at once
+  const std::string tmp = fname + ".tmp";
+  FILE *f = std::fopen(tmp.c_str(), "wb");
+  if (!f)
+    throw std::runtime_error("can't open " + tmp);
+  postmortem_file_header h = hdr;
+  std::memcpy(h.magic, c_POSTMORTEM_FILE_MAGIC, sizeof(h.magic));
+  h.version = c_POSTMORTEM_FILE_VERSION;
+  h.record_size = sizeof(postmortem_sample);
+  const bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1 &&
+                  std::fwrite(samples, sizeof(*samples), h.count, f) == h.count;
+  if (std::fclose(f) || !ok) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error(tmp + ": write error");
+  }
+  if (std::rename(tmp.c_str(), fname.c_str())) {
+    std::remove(tmp.c_str());
+    throw std::runtime_error(errno_str("can't rename " + tmp));
+  }
+}
+
+std::vector<postmortem_sample> read_postmortem_file(const std::string &fname,
+                                                    postmortem_file_header *hdr)
+{
+  FILE *f = std::fopen(fname.c_str(), "rb");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+
+  postmortem_file_header h;
+  if (std::fread(&h, sizeof(h), 1, f) != 1 || !valid_header(h)) {
+    std::fclose(f);
+    throw std::runtime_error(fname + ": not a post-mortem file");
+  }
+  std::vector<postmortem_sample> samples(h.count);
+  const bool ok = std::fread(samples.data(), sizeof(samples[0]), h.count, f) == h.count &&
+                  std::fgetc(f) == EOF;
+  std::fclose(f);
+  if (!ok)
+    throw std::runtime_error(fname + ": sample count mismatch");
+  if (hdr)
+    *hdr = h;
+  return samples;
+}
+
+uio_irq::uio_irq(const std::string &path)
+{
+  ufd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | O_NONBLOCK);
+  if (ufd < 0)
+    throw std::runtime_error(errno_str("can't open " + path));
+  // Unmask the interrupt
+  const uint32_t en = 1;
+  if (::write(ufd, &en, sizeof(en)) != sizeof(en)) {
+    ::close(ufd);
+    throw std::runtime_error(errno_str(path + ": can't enable the interrupt"));
+  }
+}
+
+uio_irq::~uio_irq()
+{
+  ::close(ufd);
+}
+
+void uio_irq::ack()
+{
+  uint32_t count;
+  if (::read(ufd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+    throw std::runtime_error(errno_str("UIO interrupt read"));
+  const uint32_t en = 1;
+  if (::write(ufd, &en, sizeof(en)) != sizeof(en))
+    throw std::runtime_error(errno_str("UIO interrupt enable"));
+}
+
+event_irq::event_irq()
+{
+  efd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (efd < 0)
+    throw std::runtime_error(errno_str("can't create eventfd"));
+}
+
+event_irq::~event_irq()
+{
+  ::close(efd);
+}
+
+void event_irq::ack()
+{
+  uint64_t count;
+  if (::read(efd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+    throw std::runtime_error(errno_str("eventfd read"));
+}
+
+void event_irq::fire()
+{
+  const uint64_t one = 1;
+  if (::write(efd, &one, sizeof(one)) != sizeof(one))
+    throw std::runtime_error(errno_str("eventfd write"));
+}
+
+postmortem_capture::postmortem_capture(mmap_device &p, size_t pb, mmap_device *c, size_t cb,
+                                       const postmortem_config &cf, intlk_irq *i):
+  proc(p),
+  proc_base(pb),
+  blk(p, pb),
+  cc(c),
+  cc_addr(cb + regs::fofb_cc_regs::ram_reg::data::reg_addr(cc_status::link_up)),
+  cfg(cf),
+  irq(i)
+{
+  if (!(cfg.rate_hz > 0) || cfg.rate_hz > 1e6)
+    throw std::invalid_argument("invalid sampling rate");
+  if (cfg.depth < 2 || (cfg.depth & (cfg.depth - 1)))
+    throw std::invalid_argument("history depth must be a power of two");
+  if (cfg.depth > UINT32_MAX)
+    throw std::invalid_argument("history depth too large");
+  if (cfg.mask == 0)
+    throw std::invalid_argument("empty interlock mask");
+  if (proc.size() < proc_base + sizeof(wb_fofb_processing_regs))
+    throw std::invalid_argument("device window smaller than wb_fofb_processing_regs");
+  if (cc && cc->size() < cb + sizeof(::fofb_cc_regs))
+    throw std::invalid_argument("device window smaller than fofb_cc_regs");
+  period_ns = uint64_t(1e9 / cfg.rate_hz);
+  hist.resize(cfg.depth);
+  dump_buf.resize(cfg.depth);
+}
+
+postmortem_capture::~postmortem_capture()
+{
+  stop();
+}
+
+uint32_t postmortem_capture::sample(uint64_t now, uint64_t &sta_ns)
+{
+  postmortem_sample &s = hist[seq & (cfg.depth - 1)];
+  s.t_ns = now + epoch_offset_ns;
+  s.seq = uint32_t(seq);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    s.sp_decim[ch] = int32_t(proc.read32(proc_base + c_DATA_ADDRS[ch]));
+  uint32_t words[c_CC_WORDS] = {};
+  if (cc)
+    cc->read_burst(cc_addr, words, c_CC_WORDS);
+  s.cc_link_up = words[0];
+  s.cc_time_frame_count = words[1];
+  std::memcpy(s.cc_err, words + 2, sizeof(s.cc_err));
+  // Last, so an interlock it shows is frozen right away
+  sta_ns = now_ns();
+  s.loop_intlk_sta = blk.read<proc_regs::loop_intlk::sta>();
+  seq++;
+
+  // Only the capture thread writes the counters
+  n_samples.store(n_samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  return s.loop_intlk_sta;
+}
+
+bool postmortem_capture::check(uint32_t sta, uint64_t now)
+{
+  if (!(sta & cfg.mask)) {
+    sta_clear_seen = true;
+    return false;
+  }
+  // Still the interlock already dumped (or present at start)
+  if (!sta_clear_seen)
+    return false;
+
+  trig_sta = sta;
+  trig_detect_ns = now;
+  trig_freeze_ns = now_ns();
+  sta_clear_seen = false;
+  state.store(FROZEN, std::memory_order_release);
+
+  const uint64_t latency = trig_freeze_ns - now;
+  if (latency > max_freeze_latency.load(std::memory_order_relaxed))
+    max_freeze_latency.store(latency, std::memory_order_relaxed);
+  update_cpu_time();
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+  }
+  state_cv.notify_all();
+  return true;
+}
+
+bool postmortem_capture::wait_armed()
+{
+  std::unique_lock<std::mutex> lock(state_mutex);
+  while (state.load(std::memory_order_acquire) != ARMED) {
+    if (!running.load(std::memory_order_relaxed))
+      return false;
+    state_cv.wait_for(lock, c_IDLE_WAIT);
+  }
+  return running.load(std::memory_order_relaxed);
+}
+
+void postmortem_capture::update_cpu_time()
+{
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  cpu_ns.store(uint64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec, std::memory_order_relaxed);
+}
+
+void postmortem_capture::capture_poll()
+{
+  next_sample_ns = now_ns();
+  while (running.load(std::memory_order_relaxed)) {
+    if (state.load(std::memory_order_acquire) != ARMED) {
+      if (!wait_armed())
+        break;
+      // The history restarts, the time frozen isn't missed samples
+      next_sample_ns = now_ns();
+    }
+
+    uint64_t now = now_ns();
+    if (now >= next_sample_ns) {
+      const uint64_t late = (now - next_sample_ns) / period_ns;
+      if (late)
+        n_missed.store(n_missed.load(std::memory_order_relaxed) + late,
+                       std::memory_order_relaxed);
+      next_sample_ns += (late + 1) * period_ns;
+      uint64_t sta_ns;
+      const uint32_t sta = sample(now, sta_ns);
+      if (check(sta, sta_ns))
+        continue;
+      update_cpu_time();
+    } else {
+      const uint32_t sta = blk.read<proc_regs::loop_intlk::sta>();
+      n_sta_reads.store(n_sta_reads.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+      if (check(sta, now))
+        continue;
+    }
+
+    if (cfg.poll_ns) {
+      const uint64_t next = std::min(now + cfg.poll_ns, next_sample_ns);
+      wait_until(next, &running);
+    }
+  }
+}
+
+void postmortem_capture::capture_irq()
+{
+  const int tfd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (tfd < 0)
+    throw std::runtime_error(errno_str("can't create timerfd"));
+  const int ep = ::epoll_create1(EPOLL_CLOEXEC);
+  if (ep < 0) {
+    ::close(tfd);
+    throw std::runtime_error(errno_str("can't create epoll instance"));
+  }
+  epoll_event ev = {};
+  ev.events = EPOLLIN;
+  ev.data.fd = irq->fd();
+  ::epoll_ctl(ep, EPOLL_CTL_ADD, irq->fd(), &ev);
+  ev.data.fd = tfd;
+  ::epoll_ctl(ep, EPOLL_CTL_ADD, tfd, &ev);
+
+  // steady_clock is CLOCK_MONOTONIC
+  auto arm_timer = [&]() {
+    itimerspec its = {};
+    const uint64_t first = now_ns() + period_ns;
+    its.it_value.tv_sec = first / 1000000000;
+    its.it_value.tv_nsec = first % 1000000000;
+    its.it_interval.tv_sec = period_ns / 1000000000;
+    its.it_interval.tv_nsec = period_ns % 1000000000;
+    ::timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, nullptr);
+  };
+  auto disarm_timer = [&]() {
+    const itimerspec its = {};
+    ::timerfd_settime(tfd, 0, &its, nullptr);
+  };
+
+  // Sample right away, as the polling loop does
+  uint64_t sta_ns;
+  const uint32_t sta = sample(now_ns(), sta_ns);
+  check(sta, sta_ns);
+  arm_timer();
+  while (running.load(std::memory_order_relaxed)) {
+    if (state.load(std::memory_order_acquire) != ARMED) {
+      disarm_timer();
+      if (!wait_armed())
+        break;
+      arm_timer();
+    }
+
+    epoll_event evs[2];
+    const int n = ::epoll_wait(ep, evs, 2, c_EPOLL_WAIT_MS);
+    for (int i = 0; i < n && state.load(std::memory_order_relaxed) == ARMED; i++) {
+      if (evs[i].data.fd == tfd) {
+        uint64_t expirations = 0;
+        if (::read(tfd, &expirations, sizeof(expirations)) != sizeof(expirations))
+          continue;
+        if (expirations > 1)
+          n_missed.store(n_missed.load(std::memory_order_relaxed) + expirations - 1,
+                         std::memory_order_relaxed);
+        const uint32_t sta = sample(now_ns(), sta_ns);
+        check(sta, sta_ns);
+      } else {
+        irq->ack();
+        n_irqs.store(n_irqs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        const uint64_t t = now_ns();
+        const uint32_t sta = blk.read<proc_regs::loop_intlk::sta>();
+        n_sta_reads.store(n_sta_reads.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_relaxed);
+        check(sta, t);
+      }
+    }
+    update_cpu_time();
+  }
+  ::close(ep);
+  ::close(tfd);
+}
+
+void postmortem_capture::capture_thread()
+{
+  if (irq)
+    capture_irq();
+  else
+    capture_poll();
+  update_cpu_time();
+}
+
+void postmortem_capture::dump_thread()
+{
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(state_mutex);
+      while (state.load(std::memory_order_acquire) != FROZEN) {
+        if (!running.load(std::memory_order_relaxed))
+          return;
+        state_cv.wait_for(lock, c_IDLE_WAIT);
+      }
+    }
+
+    // The history is ours until re-armed
+    const uint64_t count = std::min<uint64_t>(seq - hist_start, cfg.depth);
+    for (uint64_t i = 0; i < count; i++)
+      dump_buf[i] = hist[(seq - count + i) & (cfg.depth - 1)];
+
+    postmortem_event e;
+    e.sta = trig_sta;
+    e.detect_ns = trig_detect_ns;
+    e.freeze_ns = trig_freeze_ns;
+    e.samples = count;
+
+    postmortem_file_header hdr = {};
+    hdr.trigger_sta = trig_sta;
+    hdr.count = uint32_t(count);
+    hdr.trigger_t_ns = trig_detect_ns + epoch_offset_ns;
+    hdr.freeze_latency_ns = trig_freeze_ns - trig_detect_ns;
+    e.file = cfg.out_dir + "/fofb_postmortem_" + std::to_string(hdr.trigger_t_ns) + ".bin";
+    try {
+      write_postmortem_file(e.file, hdr, dump_buf.data());
+    } catch (const std::exception &ex) {
+      e.error = ex.what();
+    }
+
+    // The capture thread is idle, the device is ours as well
+    blk.modify<proc_regs::loop_intlk::ctl>(proc_regs::loop_intlk::ctl::sta_clr::val(1));
+    e.clear_ns = now_ns();
+    {
+      std::lock_guard<std::mutex> lock(events_mutex);
+      evs.push_back(std::move(e));
+    }
+
+    hist_start = seq;
+    {
+      std::lock_guard<std::mutex> lock(state_mutex);
+      state.store(ARMED, std::memory_order_release);
+    }
+    state_cv.notify_all();
+  }
+}
+
+void postmortem_capture::start()
+{
+  if (running.load())
+    throw std::logic_error("capture already running");
+  start_ns = now_ns();
+  epoch_offset_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count() - int64_t(start_ns);
+  seq = 0;
+  hist_start = 0;
+  sta_clear_seen = false;
+  state.store(ARMED);
+  running.store(true);
+  dumper = std::thread(&postmortem_capture::dump_thread, this);
+  capturer = std::thread(&postmortem_capture::capture_thread, this);
+
+  if (cfg.rt_priority > 0) {
+    sched_param param = {};
+    param.sched_priority = cfg.rt_priority;
+    const int err = pthread_setschedparam(capturer.native_handle(), SCHED_FIFO, &param);
+    if (err) {
+      stop();
+      throw std::runtime_error(std::string("can't set capture thread priority: ") +
+                               std::strerror(err));
+    }
+  }
+}
+
+void postmortem_capture::stop()
+{
+  if (!running.load())
+    return;
+  {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    running.store(false);
+  }
+  state_cv.notify_all();
+  if (capturer.joinable())
+    capturer.join();
+  if (dumper.joinable())
+    dumper.join();
+  state.store(STOPPED);
+  stop_ns = now_ns();
+}
+
+postmortem_stats postmortem_capture::stats() const
+{
+  postmortem_stats st;
+  st.samples = n_samples.load(std::memory_order_relaxed);
+  st.missed = n_missed.load(std::memory_order_relaxed);
+  st.sta_reads = n_sta_reads.load(std::memory_order_relaxed);
+  st.irqs = n_irqs.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(events_mutex);
+    st.events = evs.size();
+  }
+  st.max_freeze_latency_ns = max_freeze_latency.load(std::memory_order_relaxed);
+  st.cpu_ns = cpu_ns.load(std::memory_order_relaxed);
+  st.wall_ns = (running.load() ? now_ns() : stop_ns) - start_ns;
+  return st;
+}
+
+std::vector<postmortem_event> postmortem_capture::events() const
+{
+  std::lock_guard<std::mutex> lock(events_mutex);
+  return evs;
+}
+
+intlk_sim::intlk_sim(mock_board &board, event_irq *i):
+  gw(board.path(), sizeof(wb_fofb_processing_regs), c_MOCK_PROC_OFF),
+  irq(i)
+{
+  th = std::thread(&intlk_sim::run, this);
+}
+
+intlk_sim::~intlk_sim()
+{
+  running.store(false);
+  th.join();
+}
+
+uint64_t intlk_sim::raise(uint32_t sta)
+{
+  uint64_t t;
+  {
+    std::lock_guard<std::mutex> lock(gw_mutex);
+    t = now_ns();
+    gw.write32(proc_regs::loop_intlk::sta::reg_addr,
+               gw.read32(proc_regs::loop_intlk::sta::reg_addr) | sta);
+  }
+  if (irq)
+    irq->fire();
+  return t;
+}
+
+void intlk_sim::run()
+{
+  using ctl = proc_regs::loop_intlk::ctl;
+  uint32_t tick = 0;
+  while (running.load()) {
+    {
+      std::lock_guard<std::mutex> lock(gw_mutex);
+      const uint32_t c = gw.read32(ctl::reg_addr);
+      if (ctl::sta_clr::get(c)) {
+        gw.write32(proc_regs::loop_intlk::sta::reg_addr, 0);
+        gw.write32(ctl::reg_addr, ctl::sta_clr::put(c, 0));
+        n_clears++;
+      }
+      // A slow ramp per channel
+      tick++;
+      for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+        gw.write32(c_DATA_ADDRS[ch], uint32_t(int32_t(tick) * int32_t(ch + 1) - 1000));
+    }
+    std::this_thread::sleep_for(c_SIM_PERIOD);
+  }
+}
+
+} // namespace fofb
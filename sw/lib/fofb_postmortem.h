@@ -0,0 +1,315 @@
+// Loop interlock post-mortem capture
+//
+// When loop_intlk.sta raises ORB_DISTORT or PACKET_LOSS, the loop opens and
+// what led to it is gone unless it was being recorded. postmortem_capture
+// keeps a history of the last 'depth' samples of the decimated set-points
+// (sp_decim.data of every channel), loop_intlk.sta and the FOFB CC link and
+// error counters state, sampled at a fixed rate by a capture thread into a
+// preallocated circular buffer only that thread writes (no locks, no
+// allocation once started).
+//
+// Between samples, the capture thread watches loop_intlk.sta:
+//   - with an interlock interrupt (an intlk_irq, such as a UIO device), it
+//     sleeps in epoll on the interrupt and a timerfd ticking the samples, and
+//     reads loop_intlk.sta as soon as the interrupt fires;
+//   - otherwise it polls loop_intlk.sta back to back (or every 'poll_ns'),
+//     trading a CPU for the detection latency.
+// loop_intlk.sta is read with every sample as well, so an interrupt that
+// never comes only delays the detection to the next sample.
+//
+// An interlock is a 'mask' bit of loop_intlk.sta going from clear to set.
+// The capture thread then freezes the history (it stops writing it and hands
+// it over with a release store) and the dump thread writes it to a
+// post-mortem file, then writes loop_intlk.ctl.STA_CLR and re-arms the
+// capture, which resumes once loop_intlk.sta reads clear again. The
+// detection time (the loop_intlk.sta read that saw the interlock), the
+// freeze time and the CPU time of the capture thread are kept, so the
+// latency and cost of each mode can be measured, against a real board or the
+// intlk_sim stand-in.
+//
+// None of the gateware designs of this repository routes the loop interlock
+// to an interrupt yet; uio_irq supports it for when one does.
+//
+// File format (native endianness): a postmortem_file_header followed by its
+// 'count' postmortem_sample entries, oldest first.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_POSTMORTEM_H_
+#define FOFB_POSTMORTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fofb_cc_status.h"
+#include "fofb_device.h"
+#include "fofb_err_telemetry.h"
+#include "fofb_host.h"
+#include "fofb_reg_bench.h"
+#include "fofb_regs.h"
+#include "wb_fofb_processing_regs_access.h"
+
+namespace fofb {
+
+constexpr char c_POSTMORTEM_FILE_MAGIC[8] = {'F', 'O', 'F', 'B', 'P', 'M', 'R', 'T'};
+constexpr uint32_t c_POSTMORTEM_FILE_VERSION = 1;
+
+struct postmortem_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  // loop_intlk.sta as read on detection
+  uint32_t trigger_sta;
+  // Samples following the header
+  uint32_t count;
+  // Detection time, ns since the Unix epoch
+  uint64_t trigger_t_ns;
+  // Detection to freeze delay
+  uint64_t freeze_latency_ns;
+};
+
+static_assert(sizeof(postmortem_file_header) == 40,
+              "postmortem_file_header must not have padding");
+
+struct postmortem_sample {
+  // Read time, ns since the Unix epoch
+  uint64_t t_ns;
+  // Sample index since the capture start
+  uint32_t seq;
+  uint32_t loop_intlk_sta;
+  // sp_decim.data of each channel
+  int32_t sp_decim[c_MAX_CHANNELS];
+  // FOFB CC link_up and time_frame_count status words and the hard, soft
+  // and frame error counters of each link (in the ram_reg order), zero
+  // without a CC block
+  uint32_t cc_link_up;
+  uint32_t cc_time_frame_count;
+  uint32_t cc_err[c_CC_ERR_COUNTERS];
+};
+
+static_assert(sizeof(postmortem_sample) == 120, "postmortem_sample must not have padding");
+
+// Write a post-mortem file, 'samples' oldest first
+void write_postmortem_file(const std::string &fname, const postmortem_file_header &hdr,
+                           const postmortem_sample *samples);
+
+// Read a post-mortem file, fills 'hdr' if not nullptr
+std::vector<postmortem_sample> read_postmortem_file(const std::string &fname,
+                                                    postmortem_file_header *hdr = nullptr);
+
+// Interlock interrupt
+class intlk_irq {
+ public:
+  virtual ~intlk_irq() = default;
+
+  // Readable when the interrupt fired
+  virtual int fd() const = 0;
+
+  // Consume the pending interrupt and enable it again
+  virtual void ack() = 0;
+};
+
+// Interrupt of a UIO device (/dev/uioN): reads return the interrupt count
+// and writing 1 unmasks the interrupt
+class uio_irq : public intlk_irq {
+ public:
+  explicit uio_irq(const std::string &path);
+  ~uio_irq() override;
+
+  int fd() const override { return ufd; }
+  void ack() override;
+
+ private:
+  int ufd;
+};
+
+// Interrupt raised by software, through an eventfd
+class event_irq : public intlk_irq {
+ public:
+  event_irq();
+  ~event_irq() override;
+
+  int fd() const override { return efd; }
+  void ack() override;
+  void fire();
+
+ private:
+  int efd;
+};
+
+struct postmortem_config {
+  // History sampling rate
+  double rate_hz = 10000;
+  // History length, in samples, a power of two
+  size_t depth = 1 << 14;
+  // loop_intlk.sta bits that trigger a post-mortem
+  uint32_t mask = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT |
+                  WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_PACKET_LOSS;
+  // Without an interrupt, minimum interval between two loop_intlk.sta reads,
+  // 0 to poll back to back
+  uint64_t poll_ns = 0;
+  // Post-mortem files are written to out_dir/fofb_postmortem_<t_ns>.bin,
+  // t_ns being the detection time (ns since the Unix epoch)
+  std::string out_dir = ".";
+  // SCHED_FIFO priority of the capture thread, 0 keeps the default policy
+  int rt_priority = 0;
+};
+
+struct postmortem_event {
+  uint32_t sta;
+  // Steady clock times (see now_ns()) of the detection, the freeze and the
+  // STA_CLR write, after the file was written
+  uint64_t detect_ns;
+  uint64_t freeze_ns;
+  uint64_t clear_ns;
+  // Samples in the file
+  size_t samples;
+  std::string file;
+  // Why the file couldn't be written, empty on success
+  std::string error;
+};
+
+struct postmortem_stats {
+  uint64_t samples;
+  // Samples skipped by a late capture thread
+  uint64_t missed;
+  // loop_intlk.sta reads between samples (polling) or on interrupts
+  uint64_t sta_reads;
+  uint64_t irqs;
+  uint64_t events;
+  uint64_t max_freeze_latency_ns;
+  // CPU time used by the capture thread, and wall time, since start()
+  uint64_t cpu_ns;
+  uint64_t wall_ns;
+};
+
+class postmortem_capture {
+ public:
+  // 'proc' maps a wb_fofb_processing_regs block at 'proc_base' and 'cc', if
+  // not nullptr, a fofb_cc_regs block at 'cc_base' (possibly on the same
+  // device). With 'irq', the interlock is waited for on it.
+  postmortem_capture(mmap_device &proc, size_t proc_base, mmap_device *cc, size_t cc_base,
+                     const postmortem_config &cfg = {}, intlk_irq *irq = nullptr);
+  ~postmortem_capture();
+
+  postmortem_capture(const postmortem_capture &) = delete;
+  postmortem_capture &operator=(const postmortem_capture &) = delete;
+
+  // Run the capture and dump threads until stop()
+  void start();
+  void stop();
+
+  // Safe to call while running
+  postmortem_stats stats() const;
+  std::vector<postmortem_event> events() const;
+
+ private:
+  enum capture_state {
+    ARMED,
+    FROZEN,
+    STOPPED,
+  };
+
+  // Take a history sample at 'now', returns its loop_intlk.sta, read at
+  // 'sta_ns'
+  uint32_t sample(uint64_t now, uint64_t &sta_ns);
+  // Check a loop_intlk.sta value read at 'now', freezing on an interlock.
+  // Returns whether the history was frozen.
+  bool check(uint32_t sta, uint64_t now);
+  // Wait for the dump thread to re-arm the capture, false on stop()
+  bool wait_armed();
+  void update_cpu_time();
+  void capture_poll();
+  void capture_irq();
+  void capture_thread();
+  void dump_thread();
+
+  mmap_device &proc;
+  size_t proc_base;
+  regs::reg_block<regs::wb_fofb_processing_regs> blk;
+  mmap_device *cc;
+  size_t cc_addr;
+  postmortem_config cfg;
+  intlk_irq *irq;
+  uint64_t period_ns;
+
+  // History, written by the capture thread while ARMED and read by the dump
+  // thread while FROZEN
+  std::vector<postmortem_sample> hist;
+  // Oldest first copy of the history being dumped
+  std::vector<postmortem_sample> dump_buf;
+  uint64_t seq = 0;
+  // First sample since the capture was (re-)armed
+  uint64_t hist_start = 0;
+  uint64_t next_sample_ns = 0;
+  // Unix epoch time minus steady clock time at start()
+  int64_t epoch_offset_ns = 0;
+  // A mask bit has to read clear before the next interlock
+  bool sta_clear_seen = false;
+  // Interlock being dumped, written by the capture thread before freezing
+  uint32_t trig_sta = 0;
+  uint64_t trig_detect_ns = 0;
+  uint64_t trig_freeze_ns = 0;
+
+  std::atomic<int> state{STOPPED};
+  std::atomic<bool> running{false};
+  // Wakes the dump thread on a freeze and the capture thread on re-arming
+  std::mutex state_mutex;
+  std::condition_variable state_cv;
+  mutable std::mutex events_mutex;
+  std::vector<postmortem_event> evs;
+
+  uint64_t start_ns = 0;
+  uint64_t stop_ns = 0;
+  std::atomic<uint64_t> n_samples{0};
+  std::atomic<uint64_t> n_missed{0};
+  std::atomic<uint64_t> n_sta_reads{0};
+  std::atomic<uint64_t> n_irqs{0};
+  std::atomic<uint64_t> max_freeze_latency{0};
+  std::atomic<uint64_t> cpu_ns{0};
+  std::thread capturer;
+  std::thread dumper;
+};
+
+// Stand-in for the loop interlock of a mock_board: raises loop_intlk.sta
+// bits (and an interrupt) on request and, from its own thread, serves
+// loop_intlk.ctl.STA_CLR as the gateware does, clearing the status and the
+// autoclear bit. It also updates the channels' sp_decim.data, so the
+// history shows activity.
+class intlk_sim {
+ public:
+  explicit intlk_sim(mock_board &board, event_irq *irq = nullptr);
+  ~intlk_sim();
+
+  intlk_sim(const intlk_sim &) = delete;
+  intlk_sim &operator=(const intlk_sim &) = delete;
+
+  // Set 'sta' bits of loop_intlk.sta and fire the interrupt. Returns the
+  // steady clock time (see now_ns()) of the write.
+  uint64_t raise(uint32_t sta);
+
+  // STA_CLR writes served
+  uint64_t clears() const { return n_clears.load(); }
+
+ private:
+  void run();
+
+  // Serializes the accesses of raise() and of the thread
+  std::mutex gw_mutex;
+  mmap_device gw;
+  event_irq *irq;
+  std::atomic<uint64_t> n_clears{0};
+  std::atomic<bool> running{true};
+  std::thread th;
+};
+
+} // namespace fofb
+
+#endif // FOFB_POSTMORTEM_H_
@@ -0,0 +1,117 @@
+// Software model of the fofb_sys_id PRBS excitation
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <stdexcept>
+
+#include "fofb_prbs.h"
+#include "fofb_regs.h"
+#include "wb_fofb_sys_id_regs_access.h"
+
+namespace fofb {
+
+namespace {
+
+using prbs_ctl = regs::wb_fofb_sys_id_regs::prbs::ctl;
+using prbs_lv = regs::wb_fofb_sys_id_regs::prbs::bpm_pos_distort::distort_ram::levels;
+
+constexpr uint32_t taps_mask(unsigned a, unsigned b, unsigned c = 0, unsigned d = 0)
+{
+  return (uint32_t(1) << (a - 1)) | (uint32_t(1) << (b - 1)) |
+         (c ? uint32_t(1) << (c - 1) : 0) | (d ? uint32_t(1) << (d - 1) : 0);
+}
+
+// XAPP052 table 3, indexed by LFSR length
+constexpr uint32_t c_TAPS[c_PRBS_MAX_LFSR_LENGTH + 1] = {
+  0, 0,
+  taps_mask(2, 1), taps_mask(3, 2), taps_mask(4, 3), taps_mask(5, 3),
+  taps_mask(6, 5), taps_mask(7, 6), taps_mask(8, 6, 5, 4), taps_mask(9, 5),
+  taps_mask(10, 7), taps_mask(11, 9), taps_mask(12, 6, 4, 1), taps_mask(13, 4, 3, 1),
+  taps_mask(14, 5, 3, 1), taps_mask(15, 14), taps_mask(16, 15, 13, 4), taps_mask(17, 14),
+  taps_mask(18, 11), taps_mask(19, 6, 2, 1), taps_mask(20, 17), taps_mask(21, 19),
+  taps_mask(22, 21), taps_mask(23, 18), taps_mask(24, 23, 22, 17), taps_mask(25, 22),
+  taps_mask(26, 6, 2, 1), taps_mask(27, 5, 2, 1), taps_mask(28, 25), taps_mask(29, 27),
+  taps_mask(30, 6, 4, 1), taps_mask(31, 28), taps_mask(32, 22, 2, 1),
+};
+
+} // namespace
+
+prbs_config prbs_config::from_ctl(uint32_t ctl)
+{
+  prbs_config cfg;
+  cfg.lfsr_length = prbs_ctl::lfsr_length::get(ctl) + 2;
+  cfg.step_duration = prbs_ctl::step_duration::get(ctl) + 1;
+  cfg.sp_taps_sel = prbs_ctl::sp_distort_mov_avg_num_taps_sel::get(ctl);
+  return cfg;
+}
+
+uint32_t prbs_config::to_ctl() const
+{
+  return regs::compose(prbs_ctl::lfsr_length::val(lfsr_length - 2),
+                       prbs_ctl::step_duration::val(step_duration - 1),
+                       prbs_ctl::sp_distort_mov_avg_num_taps_sel::val(sp_taps_sel));
+}
+
+prbs_levels prbs_levels::from_reg(uint32_t levels)
+{
+  prbs_levels lv;
+  lv.level_0 = int16_t(prbs_lv::level_0::get_signed(levels));
+  lv.level_1 = int16_t(prbs_lv::level_1::get_signed(levels));
+  return lv;
+}
+
+uint32_t prbs_levels::to_reg() const
+{
+  return regs::compose(prbs_lv::level_0::val(uint16_t(level_0)),
+                       prbs_lv::level_1::val(uint16_t(level_1)));
+}
+
+prbs_gen::prbs_gen(unsigned lfsr_length, unsigned step_duration)
+{
+  if (lfsr_length < c_PRBS_MIN_LFSR_LENGTH || lfsr_length > c_PRBS_MAX_LFSR_LENGTH)
+    throw std::invalid_argument("unsupported LFSR length");
+  if (step_duration < 1 || step_duration > c_PRBS_MAX_STEP_DURATION)
+    throw std::invalid_argument("unsupported PRBS step duration");
+  taps = c_TAPS[lfsr_length];
+  mask = lfsr_length == 32 ? UINT32_MAX : (uint32_t(1) << lfsr_length) - 1;
+  step = step_duration;
+}
+
+void prbs_gen::reset()
+{
+  lfsr = 0;
+  count = 0;
+}
+
+std::vector<uint8_t> prbs_sequence(const prbs_config &cfg, size_t n)
+{
+  prbs_gen gen(cfg.lfsr_length, cfg.step_duration);
+  std::vector<uint8_t> seq(n);
+  for (size_t i = 0; i < n; i++)
+    seq[i] = gen.next();
+  return seq;
+}
+
+std::vector<int32_t> prbs_sp_distortion(const prbs_config &cfg, const prbs_levels &lv,
+                                        size_t n)
+{
+  if (cfg.sp_taps_sel > c_PRBS_SP_MAX_TAPS_SEL)
+    throw std::invalid_argument("unsupported number of averaging taps");
+  prbs_gen gen(cfg.lfsr_length, cfg.step_duration);
+  const unsigned taps = 1u << cfg.sp_taps_sel;
+  // mov_avg_dyn starts from a zeroed history
+  int32_t hist[1u << c_PRBS_SP_MAX_TAPS_SEL] = {};
+  int32_t sum = 0;
+  std::vector<int32_t> out(n);
+  for (size_t i = 0; i < n; i++) {
+    const int32_t d = gen.next() ? lv.level_1 : lv.level_0;
+    int32_t &oldest = hist[i & (taps - 1)];
+    sum += d - oldest;
+    oldest = d;
+    out[i] = sum >> cfg.sp_taps_sel;
+  }
+  return out;
+}
+
+} // namespace fofb
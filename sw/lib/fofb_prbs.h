@@ -0,0 +1,107 @@
+// Software model of the fofb_sys_id PRBS excitation
+//
+// prbs_gen reproduces prbs_gen_for_sys_id: an LFSR of 2 to 32 bits with
+// XNOR feedback from the maximal length taps of Xilinx XAPP052, cleared on
+// reset, shifted once every 'step_duration' PRBS iterations (FOFB cycles)
+// and whose newest bit is the PRBS value. prbs_sp_distort then maps each
+// value to one of the channel's two distortion levels and averages the last
+// 2**sp_distort_mov_avg_num_taps_sel of them (mov_avg_dyn: sum, then
+// arithmetic shift right).
+//
+// prbs_gen_for_sys_id and mov_avg_dyn come from infra-cores, not part of
+// this repository. Nothing here depends on the sequence phase after a reset
+// matching the gateware: captures are aligned to the model by correlation
+// (see fofb_sys_id.h).
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_PRBS_H_
+#define FOFB_PRBS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fofb {
+
+constexpr unsigned c_PRBS_MIN_LFSR_LENGTH = 2;
+constexpr unsigned c_PRBS_MAX_LFSR_LENGTH = 32;
+constexpr unsigned c_PRBS_MAX_STEP_DURATION = 1024;
+// c_SP_MOV_AVG_MAX_ORDER_SEL of xwb_fofb_sys_id
+constexpr unsigned c_PRBS_SP_MAX_TAPS_SEL = 3;
+
+// Decoded prbs.ctl
+struct prbs_config {
+  unsigned lfsr_length = 32;
+  // PRBS iterations per LFSR step
+  unsigned step_duration = 1;
+  // Set-points distortion averaged over 2**sp_taps_sel iterations
+  unsigned sp_taps_sel = 0;
+
+  // From the prbs.ctl register value (fields hold length - 2 and
+  // duration - 1)
+  static prbs_config from_ctl(uint32_t ctl);
+  uint32_t to_ctl() const;
+
+  // Sequence period, in PRBS iterations
+  uint64_t period() const
+  {
+    return ((uint64_t(1) << lfsr_length) - 1) * step_duration;
+  }
+};
+
+// Distortion levels for PRBS values 0 and 1, as in sp_distort.ch[].levels
+// and bpm_pos_distort.distort_ram[]
+struct prbs_levels {
+  int16_t level_0 = 0;
+  int16_t level_1 = 0;
+
+  static prbs_levels from_reg(uint32_t levels);
+  uint32_t to_reg() const;
+};
+
+class prbs_gen {
+ public:
+  explicit prbs_gen(unsigned lfsr_length = 32, unsigned step_duration = 1);
+
+  void reset();
+
+  // One PRBS iteration, returns the PRBS value
+  bool next()
+  {
+    if (count == 0)
+      shift();
+    if (++count == step)
+      count = 0;
+    return lfsr & 1;
+  }
+
+  // Current PRBS value, as last returned by next() (0 after a reset)
+  bool value() const { return lfsr & 1; }
+
+ private:
+  void shift()
+  {
+    const uint32_t fb = ~__builtin_parity(lfsr & taps) & 1;
+    lfsr = ((lfsr << 1) | fb) & mask;
+  }
+
+  uint32_t taps;
+  uint32_t mask;
+  unsigned step;
+  uint32_t lfsr = 0;
+  unsigned count = 0;
+};
+
+// The first 'n' PRBS values after a reset
+std::vector<uint8_t> prbs_sequence(const prbs_config &cfg, size_t n);
+
+// The first 'n' averaged distortions prbs_sp_distort adds to a channel's
+// set-points after a reset
+std::vector<int32_t> prbs_sp_distortion(const prbs_config &cfg, const prbs_levels &lv,
+                                        size_t n);
+
+} // namespace fofb
+
+#endif // FOFB_PRBS_H_
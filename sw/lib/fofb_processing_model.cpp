@@ -0,0 +1,398 @@
+// Bit-exact software model of the fofb_processing gateware
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "fofb_fixed_point.h"
+#include "fofb_processing_model.h"
+
+namespace fofb {
+
+namespace {
+
+// loop_intlk trigger indexes (c_FOFB_LOOP_INTLK_DISTORT_ID and
+// c_FOFB_LOOP_INTLK_PKT_LOSS_ID), they match the loop_intlk.sta bits
+constexpr uint32_t c_LOOP_INTLK_DISTORT = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT;
+constexpr uint32_t c_LOOP_INTLK_PKT_LOSS = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_PACKET_LOSS;
+
+// c_SP_COEFF_RAM_ADDR_WIDTH
+constexpr unsigned c_SP_COEFF_RAM_ADDR_WIDTH = 9;
+
+// Coefficients row stride, 12 channels fill 3 vectors of 4 64-bit lanes
+constexpr unsigned c_CH_STRIDE = c_MAX_CHANNELS;
+
+unsigned ceil_log2(uint32_t val)
+{
+  unsigned bits = 0;
+  while ((uint64_t(1) << bits) < val)
+    bits++;
+  return bits;
+}
+
+} // namespace
+
+unsigned sp_decim_ratio_eff(uint32_t ratio, uint32_t ratio_max)
+{
+  return ratio & uint32_t((uint64_t(1) << ceil_log2(ratio_max)) - 1);
+}
+
+void fofb_processing_generics::from_regs(const wb_fofb_processing_regs &regs)
+{
+  if (regs.fixed_point_pos.coeff > 31 || regs.fixed_point_pos.accs_gains > 31)
+    throw std::invalid_argument("invalid fixed_point_pos register values");
+  coeff_int_width = 31 - regs.fixed_point_pos.coeff;
+  gain_int_width = 31 - regs.fixed_point_pos.accs_gains;
+  sp_decim_max_ratio = regs.sp_decim_ratio_max;
+}
+
+fofb_processing_model::fofb_processing_model(const fofb_processing_generics &g):
+  gen(g),
+  coeffs(c_NUM_BPM_POS * c_CH_STRIDE)
+{
+  coeff_width = gen.coeff_int_width + gen.coeff_frac_width + 1;
+  bpm_pos_err_width = gen.bpm_pos_int_width + gen.bpm_pos_frac_width + 1;
+  dot_prod_acc_width = gen.coeff_int_width + gen.bpm_pos_int_width +
+                       gen.dot_prod_acc_extra_width + 1 +
+                       gen.coeff_frac_width + gen.bpm_pos_frac_width + 1;
+  gain_width = gen.gain_int_width + gen.gain_frac_width + 1;
+  sp_width = gen.sp_int_width + gen.sp_frac_width + 1;
+
+  if (gen.channels == 0 || gen.channels > c_MAX_CHANNELS)
+    throw std::invalid_argument("unsupported number of channels");
+  if (coeff_width > 32 || bpm_pos_err_width > 32)
+    throw std::invalid_argument("coefficients and BPM position errors must "
+                                "fit in 32 bits");
+  if (sp_width > 16)
+    throw std::invalid_argument("set-points must fit in 16 bits");
+  if (dot_prod_acc_width > 62 || dot_prod_acc_width + gain_width > 63)
+    throw std::invalid_argument("dot product accumulator too wide");
+  if (gen.coeff_frac_width + gen.bpm_pos_frac_width + gen.gain_frac_width <
+      gen.sp_frac_width)
+    throw std::invalid_argument("set-point fractionary width too large");
+
+  std::memset(coeff_regs, 0, sizeof(coeff_regs));
+  std::memset(coeff_abs_sum, 0, sizeof(coeff_abs_sum));
+  std::memset(sps, 0, sizeof(sps));
+  for (auto &chst: chs) {
+    chst = {};
+    chst.sp_decim_ratio = 0;
+  }
+  loop_intlk_ctl = 0;
+  loop_intlk_orb_distort_limit = 0;
+  loop_intlk_min_num_pkts = 0;
+  loop_intlk_distort_limit = 0;
+  loop_intlk_min_num_meas = 0;
+  reset();
+}
+
+void fofb_processing_model::reset()
+{
+  for (auto &chst: chs) {
+    chst.acc = 0;
+    chst.res_acc_sum = 0;
+    chst.sp_filtered = 0;
+    chst.sp_filtered_samples = 0;
+    chst.sp_decim = 0;
+  }
+  std::memset(bpm_pos_prev, 0, sizeof(bpm_pos_prev));
+  loop_intlk_state = 0;
+  sp_decim_valid_pending = 0;
+}
+
+void fofb_processing_model::set_coeff(unsigned ch, unsigned idx, uint32_t val)
+{
+  int64_t &coeff = coeffs[idx * c_CH_STRIDE + ch];
+  coeff_abs_sum[ch] -= std::abs(coeff);
+  coeff_regs[ch][idx] = val;
+  // coeff_fp: the most significant bits of the coefficient RAM data
+  coeff = fp_left_aligned(val, coeff_width);
+  coeff_abs_sum[ch] += std::abs(coeff);
+}
+
+void fofb_processing_model::set_sp(unsigned idx, uint32_t val)
+{
+  sps[idx] = val;
+}
+
+void fofb_processing_model::set_acc_gain(unsigned ch, uint32_t val)
+{
+  chs[ch].gain_reg = val;
+  // Fixed-point values are aligned to the left
+  chs[ch].gain = fp_left_aligned(val, gain_width);
+}
+
+void fofb_processing_model::set_acc_freeze(unsigned ch, bool freeze)
+{
+  chs[ch].freeze = freeze;
+}
+
+void fofb_processing_model::set_sp_limits(unsigned ch, uint32_t max, uint32_t min)
+{
+  chs[ch].sp_max_reg = max;
+  chs[ch].sp_min_reg = min;
+  chs[ch].sp_max = fp_sext(max, sp_width);
+  chs[ch].sp_min = fp_sext(min, sp_width);
+}
+
+void fofb_processing_model::set_sp_decim_ratio(unsigned ch, uint32_t ratio)
+{
+  channel_state &chst = chs[ch];
+  chst.sp_decim_ratio_reg = ratio;
+  unsigned new_ratio = sp_decim_ratio_eff(ratio, gen.sp_decim_max_ratio);
+  if (new_ratio != chst.sp_decim_ratio) {
+    // sp_decim_ratio_changed: resets decimation/filtering regs
+    chst.sp_filtered = 0;
+    chst.sp_filtered_samples = 0;
+  }
+  chst.sp_decim_ratio = new_ratio;
+}
+
+void fofb_processing_model::set_loop_intlk_ctl(uint32_t ctl)
+{
+  if (ctl & WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR)
+    loop_intlk_state = 0;
+  loop_intlk_ctl = ctl & ~WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR;
+}
+
+void fofb_processing_model::set_loop_intlk_orb_distort_limit(uint32_t val)
+{
+  loop_intlk_orb_distort_limit = val;
+  // Truncated to g_BPM_POS_INT_WIDTH bits, then compared as a signed number
+  loop_intlk_distort_limit = fp_sext(val, gen.bpm_pos_int_width);
+}
+
+void fofb_processing_model::set_loop_intlk_min_num_pkts(uint32_t val)
+{
+  loop_intlk_min_num_pkts = val;
+  // Each DCC packet has 2 measurements
+  const unsigned mask = (1u << c_SP_COEFF_RAM_ADDR_WIDTH) - 1;
+  loop_intlk_min_num_meas = ((val & mask) << 1) & mask;
+}
+
+void fofb_processing_model::clear_acc(unsigned ch)
+{
+  chs[ch].acc = 0;
+  chs[ch].res_acc_sum = 0;
+  // Clearing the accumulator also generates a set-point valid pulse
+  decimate(ch);
+}
+
+void fofb_processing_model::load_regs(const wb_fofb_processing_regs &regs)
+{
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+    set_sp(i, regs.sps_ram_bank[i].data);
+
+  for (unsigned ch = 0; ch < gen.channels; ch++) {
+    for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+      set_coeff(ch, i, regs.ch[ch].coeff_ram_bank[i].data);
+    set_acc_gain(ch, regs.ch[ch].acc.gain);
+    set_acc_freeze(ch, regs.ch[ch].acc.ctl & WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_FREEZE);
+    set_sp_limits(ch, regs.ch[ch].sp_limits.max, regs.ch[ch].sp_limits.min);
+    set_sp_decim_ratio(ch, regs.ch[ch].sp_decim.ratio);
+    if (regs.ch[ch].acc.ctl & WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_CLEAR)
+      clear_acc(ch);
+  }
+
+  set_loop_intlk_orb_distort_limit(regs.loop_intlk.orb_distort_limit);
+  set_loop_intlk_min_num_pkts(regs.loop_intlk.min_num_pkts);
+  set_loop_intlk_ctl(regs.loop_intlk.ctl);
+}
+
+void fofb_processing_model::store_regs(wb_fofb_processing_regs &regs) const
+{
+  regs.fixed_point_pos.coeff = 31 - gen.coeff_int_width;
+  regs.fixed_point_pos.accs_gains = 31 - gen.gain_int_width;
+  regs.loop_intlk.ctl = loop_intlk_ctl;
+  regs.loop_intlk.sta = loop_intlk_state;
+  regs.loop_intlk.orb_distort_limit = loop_intlk_orb_distort_limit;
+  regs.loop_intlk.min_num_pkts = loop_intlk_min_num_pkts;
+  regs.sp_decim_ratio_max = gen.sp_decim_max_ratio;
+
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+    regs.sps_ram_bank[i].data = sps[i];
+
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    const channel_state &chst = chs[ch];
+    for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+      regs.ch[ch].coeff_ram_bank[i].data = coeff_regs[ch][i];
+    regs.ch[ch].acc.ctl = chst.freeze ? WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_FREEZE : 0;
+    regs.ch[ch].acc.gain = chst.gain_reg;
+    regs.ch[ch].sp_limits.max = chst.sp_max_reg;
+    regs.ch[ch].sp_limits.min = chst.sp_min_reg;
+    regs.ch[ch].sp_decim.data = uint32_t(chst.sp_decim);
+    regs.ch[ch].sp_decim.ratio = chst.sp_decim_ratio_reg;
+  }
+}
+
+void fofb_processing_model::decimate(unsigned ch)
+{
+  channel_state &chst = chs[ch];
+  // Computes the low-pass filtered setpoint (32 bits wrapping sum)
+  chst.sp_filtered = int32_t(uint32_t(chst.sp_filtered) + uint32_t(chst.acc));
+  chst.sp_filtered_samples++;
+  if (chst.sp_filtered_samples == chst.sp_decim_ratio + 1) {
+    chst.sp_decim = chst.sp_filtered;
+    chst.sp_filtered = 0;
+    chst.sp_filtered_samples = 0;
+    sp_decim_valid_pending |= 1u << ch;
+  }
+}
+
+int64_t fofb_processing_model::calc_dot_prod_seq(const int64_t *err,
+                                                 const uint64_t *valid,
+                                                 unsigned ch) const
+{
+  int64_t acc = 0;
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++) {
+    if (valid && !(valid[i / 64] & (uint64_t(1) << (i % 64))))
+      continue;
+    // Saturate on each accumulation, as resize() in dot_prod does
+    acc = fp_saturate(acc + coeffs[i * c_CH_STRIDE + ch] * err[i],
+                      dot_prod_acc_width);
+  }
+  return acc;
+}
+
+void fofb_processing_model::calc_dot_prod_vec(const int64_t *err,
+                                              int64_t *dot) const
+{
+#ifdef __AVX2__
+  static_assert(c_CH_STRIDE == 12, "AVX2 kernel assumes 3 vectors per row");
+  __m256i acc0 = _mm256_setzero_si256();
+  __m256i acc1 = _mm256_setzero_si256();
+  __m256i acc2 = _mm256_setzero_si256();
+  const int64_t *c = coeffs.data();
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++, c += c_CH_STRIDE) {
+    // Both operands fit in 32 bits, so the 32x32 -> 64 bits signed multiply
+    // of the lower half of each lane is exact
+    const __m256i e = _mm256_set1_epi64x(err[i]);
+    acc0 = _mm256_add_epi64(acc0, _mm256_mul_epi32(e,
+             _mm256_loadu_si256(reinterpret_cast<const __m256i *>(c))));
+    acc1 = _mm256_add_epi64(acc1, _mm256_mul_epi32(e,
+             _mm256_loadu_si256(reinterpret_cast<const __m256i *>(c + 4))));
+    acc2 = _mm256_add_epi64(acc2, _mm256_mul_epi32(e,
+             _mm256_loadu_si256(reinterpret_cast<const __m256i *>(c + 8))));
+  }
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dot), acc0);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dot + 4), acc1);
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dot + 8), acc2);
+#else
+  // Wrapping arithmetic, as the AVX2 kernel: overflowing sums are discarded
+  // by the caller anyway
+  uint64_t acc[c_CH_STRIDE] = {};
+  const int64_t *c = coeffs.data();
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++, c += c_CH_STRIDE)
+    for (unsigned ch = 0; ch < c_CH_STRIDE; ch++)
+      acc[ch] += uint64_t(c[ch] * err[i]);
+  for (unsigned ch = 0; ch < c_CH_STRIDE; ch++)
+    dot[ch] = int64_t(acc[ch]);
+#endif
+}
+
+void fofb_processing_model::process_tf(const int32_t *bpm_pos,
+                                       const uint64_t *valid,
+                                       fofb_processing_result *res)
+{
+  alignas(32) int64_t err[c_NUM_BPM_POS];
+  alignas(32) int64_t dot[c_CH_STRIDE];
+  const int64_t err_min = fp_min(bpm_pos_err_width);
+  int64_t max_abs_err = 0;
+  unsigned meas_cnt = 0;
+  uint32_t trigs = 0;
+
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++) {
+    const bool is_valid = !valid || (valid[i / 64] & (uint64_t(1) << (i % 64)));
+    int32_t pos = bpm_pos[i];
+    if (gen.use_moving_avg) {
+      // Average with the position of the last time frame
+      const int32_t cur = pos;
+      pos = int32_t((int64_t(cur) + bpm_pos_prev[i]) >> 1);
+      if (is_valid)
+        bpm_pos_prev[i] = cur;
+    }
+    if (!is_valid) {
+      err[i] = 0;
+      continue;
+    }
+    // 32 bits subtraction, then numeric_std resize() to the error width
+    const int64_t e = fp_numeric_std_resize(int32_t(sps[i] - uint32_t(pos)),
+                                            bpm_pos_err_width);
+    err[i] = e;
+    // Orbit distortion check, abs() wraps for the most negative value
+    const int64_t mag = std::abs(e);
+    if ((e == err_min ? e : mag) > loop_intlk_distort_limit)
+      trigs |= c_LOOP_INTLK_DISTORT;
+    max_abs_err = std::max(max_abs_err, mag);
+    meas_cnt++;
+  }
+
+  // Packet loss check, the measurements counter is c_SP_COEFF_RAM_ADDR_WIDTH
+  // bits wide
+  if ((meas_cnt & ((1u << c_SP_COEFF_RAM_ADDR_WIDTH) - 1)) < loop_intlk_min_num_meas)
+    trigs |= c_LOOP_INTLK_PKT_LOSS;
+
+  // loop_intlk.ctl source enable bits are the status bits shifted by one
+  loop_intlk_state |= trigs & (loop_intlk_ctl >> 1);
+
+  if (!force_scalar)
+    calc_dot_prod_vec(err, dot);
+
+  const int64_t acc_max = fp_max(dot_prod_acc_width);
+  const unsigned gain_shift = gen.coeff_frac_width + gen.bpm_pos_frac_width +
+                              gen.gain_frac_width - gen.sp_frac_width;
+
+  for (unsigned ch = 0; ch < gen.channels; ch++) {
+    channel_state &chst = chs[ch];
+
+    // Fall back to the sequential sum if any partial sum could saturate
+    if (force_scalar ||
+        (max_abs_err != 0 && coeff_abs_sum[ch] > acc_max / max_abs_err))
+      dot[ch] = calc_dot_prod_seq(err, valid, ch);
+
+    if (!chst.freeze && !loop_intlk_state) {
+      const int64_t res_mult_gain = fp_resize(dot[ch] * chst.gain, gain_shift,
+                                              sp_width);
+      chst.res_acc_sum = fp_saturate(chst.acc + res_mult_gain, sp_width);
+    }
+
+    if (chst.res_acc_sum > chst.sp_max)
+      chst.acc = chst.sp_max;
+    else if (chst.res_acc_sum < chst.sp_min)
+      chst.acc = chst.sp_min;
+    else
+      chst.acc = chst.res_acc_sum;
+
+    decimate(ch);
+  }
+
+  if (res) {
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      res->sp[ch] = int16_t(chs[ch].acc);
+      res->sp_decim[ch] = chs[ch].sp_decim;
+    }
+    res->sp_decim_valid = sp_decim_valid_pending;
+    res->loop_intlk_sta = loop_intlk_state;
+  }
+  sp_decim_valid_pending = 0;
+}
+
+void fofb_processing_model::process(const int32_t *bpm_pos,
+                                    const uint64_t *valid, size_t n_tf,
+                                    fofb_processing_result *res)
+{
+  for (size_t tf = 0; tf < n_tf; tf++) {
+    process_tf(bpm_pos + tf * c_NUM_BPM_POS,
+               valid ? valid + tf * (c_NUM_BPM_POS / 64) : nullptr,
+               res ? res + tf : nullptr);
+  }
+}
+
+} // namespace fofb
@@ -0,0 +1,190 @@
+// Bit-exact software model of the fofb_processing gateware
+//
+// Reproduces, timeframe by timeframe, the behavior of fofb_processing and
+// its fofb_processing_channel instances: BPM position error computation,
+// dot product against each channel's coefficients RAM (with the dot product
+// accumulator saturation), accumulator gain, set-point accumulator, sp_limits
+// saturation, set-point decimation and the loop interlock sources.
+//
+// The dot product for all channels is evaluated at once with the channels laid
+// out in SIMD lanes (AVX2 when available). Whenever the dot product
+// accumulator could saturate, the affected channels are recomputed
+// sequentially in BPM index order. The gateware accumulates in packet arrival
+// order, so only timeframes that saturate the dot product accumulator may
+// differ from the hardware.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_PROCESSING_MODEL_H_
+#define FOFB_PROCESSING_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_regs.h"
+
+namespace fofb {
+
+// fofb_processing / fofb_processing_channel generics. Default values match
+// the ones used by afc_ref_fofb_ctrl_gen.
+struct fofb_processing_generics {
+  // g_COEFF_INT_WIDTH / g_COEFF_FRAC_WIDTH
+  unsigned coeff_int_width = 0;
+  unsigned coeff_frac_width = 17;
+
+  // g_BPM_POS_INT_WIDTH / g_BPM_POS_FRAC_WIDTH
+  unsigned bpm_pos_int_width = 20;
+  unsigned bpm_pos_frac_width = 0;
+
+  // g_DOT_PROD_ACC_EXTRA_WIDTH
+  unsigned dot_prod_acc_extra_width = 4;
+
+  // c_FOFB_GAIN_INT_WIDTH / c_FOFB_GAIN_FRAC_WIDTH
+  unsigned gain_int_width = 0;
+  unsigned gain_frac_width = 15;
+
+  // c_FOFB_SP_INT_WIDTH / c_FOFB_SP_FRAC_WIDTH
+  unsigned sp_int_width = 15;
+  unsigned sp_frac_width = 0;
+
+  // c_FOFB_SP_DECIM_MAX_RATIO
+  unsigned sp_decim_max_ratio = 8191;
+
+  // g_USE_MOVING_AVG
+  bool use_moving_avg = false;
+
+  // g_CHANNELS
+  unsigned channels = c_MAX_CHANNELS;
+
+  // Update the integer widths from the read-only fixed_point_pos registers,
+  // the fractionary widths aren't exposed by the gateware
+  void from_regs(const wb_fofb_processing_regs &regs);
+};
+
+// Output of a single timeframe
+struct fofb_processing_result {
+  // Set-point for each channel (sp_arr_o)
+  int16_t sp[c_MAX_CHANNELS];
+
+  // Decimated set-point for each channel (sp_decim_arr_o), only meaningful if
+  // the respective sp_decim_valid bit is set
+  int32_t sp_decim[c_MAX_CHANNELS];
+
+  // Decimated set-point valid, bit i corresponds to channel i
+  uint16_t sp_decim_valid;
+
+  // loop_intlk.sta after this timeframe
+  uint32_t loop_intlk_sta;
+};
+
+// Decimation ratio used by the gateware for a ch[].sp_decim.ratio register
+// value: only its lowest ceil(log2(sp_decim_ratio_max)) bits are kept
+unsigned sp_decim_ratio_eff(uint32_t ratio, uint32_t ratio_max);
+
+class fofb_processing_model {
+ public:
+  explicit fofb_processing_model(const fofb_processing_generics &gen = {});
+
+  // Load every rw register (coefficients and set-points RAMs, accumulator
+  // gains and control, saturation limits, decimation ratios, loop interlock
+  // control) from a register image. ch[].acc.ctl.CLEAR and loop_intlk.ctl.STA_CLR
+  // behave as the autoclear bits they are in the gateware.
+  void load_regs(const wb_fofb_processing_regs &regs);
+
+  // Fill a register image with the current model configuration and state
+  // (read-only registers included)
+  void store_regs(wb_fofb_processing_regs &regs) const;
+
+  // Individual configuration accessors, values as written to the registers
+  void set_coeff(unsigned ch, unsigned idx, uint32_t val);
+  void set_sp(unsigned idx, uint32_t val);
+  void set_acc_gain(unsigned ch, uint32_t val);
+  void set_acc_freeze(unsigned ch, bool freeze);
+  void set_sp_limits(unsigned ch, uint32_t max, uint32_t min);
+  void set_sp_decim_ratio(unsigned ch, uint32_t ratio);
+  void set_loop_intlk_ctl(uint32_t ctl);
+  void set_loop_intlk_orb_distort_limit(uint32_t val);
+  void set_loop_intlk_min_num_pkts(uint32_t val);
+
+  // ch[].acc.ctl.CLEAR pulse
+  void clear_acc(unsigned ch);
+
+  // Reset all internal state, as rst_n_i = '0'
+  void reset();
+
+  // Process 'n_tf' timeframes. 'bpm_pos' holds c_NUM_BPM_POS positions per
+  // timeframe (index 0 to 255 horizontal, 256 to 511 vertical). 'valid' holds
+  // c_NUM_BPM_POS / 64 words per timeframe, bit (i % 64) of word i / 64
+  // flagging if position i was received; nullptr means all positions were
+  // received. 'res' receives one result per timeframe and may be nullptr.
+  void process(const int32_t *bpm_pos, const uint64_t *valid, size_t n_tf,
+               fofb_processing_result *res);
+
+  // Force the sequential (non-vectorized) dot product, used for testing
+  void set_force_scalar(bool force) { force_scalar = force; }
+
+  const fofb_processing_generics &generics() const { return gen; }
+  int16_t sp(unsigned ch) const { return int16_t(chs[ch].acc); }
+  uint32_t loop_intlk_sta() const { return loop_intlk_state; }
+
+ private:
+  struct channel_state {
+    int64_t acc;
+    int64_t res_acc_sum;
+    int64_t gain;
+    int64_t sp_max;
+    int64_t sp_min;
+    bool freeze;
+    uint32_t gain_reg;
+    uint32_t sp_max_reg;
+    uint32_t sp_min_reg;
+    uint32_t sp_decim_ratio_reg;
+    unsigned sp_decim_ratio;
+    int32_t sp_filtered;
+    unsigned sp_filtered_samples;
+    int32_t sp_decim;
+  };
+
+  void decimate(unsigned ch);
+  int64_t calc_dot_prod_seq(const int64_t *err, const uint64_t *valid,
+                            unsigned ch) const;
+  void calc_dot_prod_vec(const int64_t *err, int64_t *dot) const;
+  void process_tf(const int32_t *bpm_pos, const uint64_t *valid,
+                  fofb_processing_result *res);
+
+  fofb_processing_generics gen;
+  unsigned coeff_width;
+  unsigned bpm_pos_err_width;
+  unsigned dot_prod_acc_width;
+  unsigned gain_width;
+  unsigned sp_width;
+  bool force_scalar = false;
+
+  // Coefficients as seen by the dot product (coeff_fp), laid out as
+  // [c_NUM_BPM_POS][c_MAX_CHANNELS] so all channels are contiguous
+  std::vector<int64_t> coeffs;
+  uint32_t coeff_regs[c_MAX_CHANNELS][c_NUM_BPM_POS];
+  // Sum of the coefficients' absolute values of each channel
+  int64_t coeff_abs_sum[c_MAX_CHANNELS];
+  uint32_t sps[c_NUM_BPM_POS];
+  int32_t bpm_pos_prev[c_NUM_BPM_POS];
+
+  channel_state chs[c_MAX_CHANNELS];
+
+  uint32_t loop_intlk_ctl;
+  uint32_t loop_intlk_orb_distort_limit;
+  uint32_t loop_intlk_min_num_pkts;
+  int64_t loop_intlk_distort_limit;
+  unsigned loop_intlk_min_num_meas;
+  uint32_t loop_intlk_state;
+
+  // Decimated set-points generated outside process() (by clear_acc()) are
+  // reported in the next timeframe result
+  uint16_t sp_decim_valid_pending;
+};
+
+} // namespace fofb
+
+#endif // FOFB_PROCESSING_MODEL_H_
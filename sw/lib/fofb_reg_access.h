@@ -0,0 +1,221 @@
+// Typed register access on top of the cheby register maps
+//
+// The <map>_access.h headers, generated by gen_regs_access.py from the
+// .cheby files, describe every register as a type carrying its address
+// (taken from the cheby-generated C header macros), access mode and fields.
+// reg_block<Map> performs the bus accesses: field values are combined at
+// compile time, so writing several fields costs a single bus write, and
+// read-only constants (fixed_point_pos, num_biquads, ...) are read once and
+// then served from a cache.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_REG_ACCESS_H_
+#define FOFB_REG_ACCESS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "fofb_device.h"
+#include "fofb_regs.h"
+
+namespace fofb {
+namespace regs {
+
+enum class access {
+  rw,
+  ro,
+  // Read-only register whose value is fixed at synthesis time
+  ro_const,
+};
+
+constexpr unsigned mask_shift(uint32_t mask)
+{
+  unsigned shift = 0;
+  while (shift < 32 && !(mask & (uint32_t(1) << shift)))
+    shift++;
+  return shift;
+}
+
+constexpr uint32_t width_mask(unsigned width)
+{
+  return width >= 32 ? 0xffffffffu : (uint32_t(1) << width) - 1;
+}
+
+template <typename Field>
+struct field_value {
+  uint32_t val;
+};
+
+// Register field, 'Mask' is the cheby mask macro (the field macro itself for
+// single bit fields)
+template <uint32_t Mask>
+struct field {
+  static constexpr uint32_t mask = Mask;
+  static constexpr unsigned shift = mask_shift(Mask);
+  static constexpr unsigned width = mask_shift(~(Mask >> shift));
+
+  static constexpr uint32_t get(uint32_t reg) { return (reg & mask) >> shift; }
+
+  // Field value as a two's complement number
+  static constexpr int32_t get_signed(uint32_t reg)
+  {
+    return int32_t(get(reg) << (32 - width)) >> (32 - width);
+  }
+
+  static constexpr uint32_t put(uint32_t reg, uint32_t val)
+  {
+    return (reg & ~mask) | ((val << shift) & mask);
+  }
+
+  static constexpr field_value<field> val(uint32_t v) { return {v}; }
+};
+
+// Register at a fixed address. The members are prefixed so they can't clash
+// with the field names (e.g. fofb_cc_regs xy_buff_ctl has an 'addr' field)
+template <size_t Addr, access Access, unsigned Width, int ConstIdx = -1>
+struct reg_def {
+  static constexpr size_t reg_addr = Addr;
+  static constexpr access reg_access = Access;
+  static constexpr uint32_t reg_mask = width_mask(Width);
+  // Slot in the read-only constants cache
+  static constexpr int reg_const_idx = ConstIdx;
+  static constexpr bool reg_is_mem = false;
+};
+
+// Register of each element of a memory
+template <size_t Addr, size_t Stride, size_t Depth, access Access, unsigned Width>
+struct mem_reg_def {
+  static constexpr size_t reg_stride = Stride;
+  static constexpr size_t reg_depth = Depth;
+  static constexpr access reg_access = Access;
+  static constexpr uint32_t reg_mask = width_mask(Width);
+  static constexpr int reg_const_idx = -1;
+  static constexpr bool reg_is_mem = true;
+
+  static constexpr size_t reg_addr(size_t idx) { return Addr + idx * Stride; }
+};
+
+namespace detail {
+
+template <typename Reg>
+constexpr uint32_t fields_mask()
+{
+  return 0;
+}
+
+template <typename Reg, typename F, typename... Fs>
+constexpr uint32_t fields_mask()
+{
+  return F::mask | fields_mask<Reg, Fs...>();
+}
+
+constexpr uint32_t put_fields(uint32_t reg)
+{
+  return reg;
+}
+
+template <typename F, typename... Fs>
+constexpr uint32_t put_fields(uint32_t reg, field_value<F> v, field_value<Fs>... vs)
+{
+  return put_fields(F::put(reg, v.val), vs...);
+}
+
+} // namespace detail
+
+// Compose a register value from field values, the other bits are zero
+template <typename... Fs>
+constexpr uint32_t compose(field_value<Fs>... vs)
+{
+  return detail::put_fields(0, vs...);
+}
+
+// Access to a register block of map 'Map' (a generated <map>_access.h
+// namespace struct) mapped at 'base' of 'Dev'
+template <typename Map, typename Dev = mmap_device>
+class reg_block {
+ public:
+  explicit reg_block(Dev &d, size_t b = 0): dev(d), base(b) {}
+
+  template <typename Reg>
+  uint32_t read()
+  {
+    static_assert(!Reg::reg_is_mem, "memory registers need an index");
+    if constexpr (Reg::reg_const_idx >= 0) {
+      constexpr uint32_t bit = uint32_t(1) << Reg::reg_const_idx;
+      if (!(const_valid & bit)) {
+        consts[Reg::reg_const_idx] = dev.read32(base + Reg::reg_addr);
+        const_valid |= bit;
+      }
+      return consts[Reg::reg_const_idx];
+    } else {
+      return dev.read32(base + Reg::reg_addr);
+    }
+  }
+
+  template <typename Reg>
+  uint32_t read(size_t idx)
+  {
+    static_assert(Reg::reg_is_mem, "only memory registers take an index");
+    return dev.read32(base + Reg::reg_addr(idx));
+  }
+
+  template <typename Field, typename Reg>
+  uint32_t read_field()
+  {
+    return Field::get(read<Reg>());
+  }
+
+  template <typename Reg>
+  void write(uint32_t val)
+  {
+    static_assert(!Reg::reg_is_mem, "memory registers need an index");
+    static_assert(Reg::reg_access == access::rw, "register is read-only");
+    dev.write32(base + Reg::reg_addr, val);
+  }
+
+  template <typename Reg>
+  void write(size_t idx, uint32_t val)
+  {
+    static_assert(Reg::reg_is_mem, "only memory registers take an index");
+    static_assert(Reg::reg_access == access::rw, "register is read-only");
+    dev.write32(base + Reg::reg_addr(idx), val);
+  }
+
+  // Write the given fields, zeroing every other bit: a single bus write
+  template <typename Reg, typename... Fs>
+  void write_fields(field_value<Fs>... vs)
+  {
+    write<Reg>(compose(vs...));
+  }
+
+  // Update the given fields, keeping the other ones: a read and a write, or
+  // just the write when the fields cover the whole register
+  template <typename Reg, typename... Fs>
+  void modify(field_value<Fs>... vs)
+  {
+    constexpr uint32_t mask = detail::fields_mask<Reg, Fs...>();
+    if constexpr ((mask & Reg::reg_mask) == Reg::reg_mask)
+      write<Reg>(compose(vs...));
+    else
+      write<Reg>(detail::put_fields(read<Reg>(), vs...));
+  }
+
+  // Forget the cached constants (e.g. after reprogramming the FPGA)
+  void invalidate_consts() { const_valid = 0; }
+
+  Dev &device() { return dev; }
+
+ private:
+  Dev &dev;
+  size_t base;
+  uint32_t consts[Map::num_consts > 0 ? Map::num_consts : 1] = {};
+  uint32_t const_valid = 0;
+};
+
+} // namespace regs
+} // namespace fofb
+
+#endif // FOFB_REG_ACCESS_H_
@@ -0,0 +1,348 @@
+// Register access micro-benchmarks against a mock board
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+#include "fofb_cc_snapshot.h"
+#include "fofb_coeff_loader.h"
+#include "fofb_reg_bench.h"
+#include "fofb_sp_decim_acq.h"
+
+namespace fofb {
+
+namespace {
+
+using proc_regs = wb_fofb_processing_regs;
+using shaper_regs = wb_fofb_shaper_filt_regs;
+
+// Order of the CSV columns
+const char *const c_REPORT_HEADER =
+  "benchmark,iterations,median_us,p99_us,mean_us,reads,writes,read_bursts,write_bursts,"
+  "bus_us";
+
+uint64_t splitmix64(uint64_t &state)
+{
+  uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+  const size_t i = size_t(p * (sorted.size() - 1) + 0.5);
+  return sorted[std::min(i, sorted.size() - 1)];
+}
+
+} // namespace
+
+mock_board::mock_board(const std::string &path):
+  fname(path.empty() ? "/dev/shm/fofb_mock_" + std::to_string(::getpid()) : path),
+  remove(path.empty())
+{
+  const off_t offs[4] = {c_MOCK_PROC_OFF, c_MOCK_SHAPER_OFF, c_MOCK_SYS_ID_OFF, c_MOCK_CC_OFF};
+  const size_t sizes[4] = {sizeof(proc_regs), sizeof(shaper_regs),
+                           sizeof(wb_fofb_sys_id_regs), sizeof(fofb_cc_regs)};
+  try {
+    // Sized for the whole board
+    mmap_device(fname, c_MOCK_BOARD_SIZE, 0, true);
+    for (unsigned i = 0; i < 4; i++)
+      devs[i].reset(new mmap_device(fname, sizes[i], offs[i]));
+  } catch (...) {
+    if (remove)
+      ::unlink(fname.c_str());
+    throw;
+  }
+}
+
+mock_board::~mock_board()
+{
+  for (auto &d: devs)
+    d.reset();
+  if (remove)
+    ::unlink(fname.c_str());
+}
+
+void mock_board::set_latency(uint32_t read_ns, uint32_t write_ns)
+{
+  for (auto &d: devs)
+    d->set_latency(read_ns, write_ns);
+}
+
+device_stats mock_board::stats() const
+{
+  device_stats st = {};
+  for (const auto &d: devs) {
+    st.reads += d->stats().reads;
+    st.writes += d->stats().writes;
+    st.read_bursts += d->stats().read_bursts;
+    st.write_bursts += d->stats().write_bursts;
+  }
+  return st;
+}
+
+void mock_board::reset_stats()
+{
+  for (auto &d: devs)
+    d->reset_stats();
+}
+
+const std::vector<std::string> &reg_bench_names()
+{
+  static const std::vector<std::string> names = {
+    "matrix_upload", "shaper_reload", "cc_drain", "cc_drain_wbw", "sp_decim_poll",
+    "intlk_status",
+  };
+  return names;
+}
+
+fofb_reg_bench::fofb_reg_bench(mock_board &b, const reg_bench_config &c):
+  board(b),
+  cfg(c)
+{
+  if (cfg.iterations == 0)
+    throw std::invalid_argument("no iterations");
+  for (const std::string &name: cfg.only)
+    if (std::find(reg_bench_names().begin(), reg_bench_names().end(), name) ==
+        reg_bench_names().end())
+      throw std::invalid_argument("unknown benchmark " + name);
+}
+
+template <typename F>
+reg_bench_result fofb_reg_bench::measure(const std::string &name, F op)
+{
+  for (unsigned i = 0; i < cfg.warmup; i++)
+    op();
+
+  std::vector<double> t(cfg.iterations);
+  board.reset_stats();
+  for (unsigned i = 0; i < cfg.iterations; i++) {
+    const auto start = std::chrono::steady_clock::now();
+    op();
+    t[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                     start).count();
+  }
+  const device_stats st = board.stats();
+
+  reg_bench_result r;
+  r.name = name;
+  r.iterations = cfg.iterations;
+  double sum = 0;
+  for (double v: t)
+    sum += v;
+  r.mean_us = sum / cfg.iterations;
+  std::sort(t.begin(), t.end());
+  r.median_us = percentile(t, 0.5);
+  r.p99_us = percentile(t, 0.99);
+  r.reads = double(st.reads) / cfg.iterations;
+  r.writes = double(st.writes) / cfg.iterations;
+  r.read_bursts = double(st.read_bursts) / cfg.iterations;
+  r.write_bursts = double(st.write_bursts) / cfg.iterations;
+  r.bus_us = (double(st.reads) * cfg.read_ns + double(st.writes) * cfg.write_ns) / 1e3 /
+             cfg.iterations;
+  return r;
+}
+
+reg_bench_result fofb_reg_bench::matrix_upload()
+{
+  // Two images differing in (almost) every word, loaded in turn
+  uint64_t state = 1;
+  std::unique_ptr<proc_regs> img[2] = {std::make_unique<proc_regs>(),
+                                       std::make_unique<proc_regs>()};
+  for (auto &p: img) {
+    for (auto &w: p->sps_ram_bank)
+      w.data = uint32_t(splitmix64(state));
+    for (auto &ch: p->ch)
+      for (auto &w: ch.coeff_ram_bank)
+        w.data = uint32_t(splitmix64(state));
+  }
+
+  fofb_coeff_loader loader(board.proc());
+  loader.set_shadow(*img[1]);
+  unsigned n = 0;
+  return measure("matrix_upload", [&] { loader.load(*img[n++ % 2]); });
+}
+
+reg_bench_result fofb_reg_bench::shaper_reload()
+{
+  constexpr size_t c_WORDS = sizeof(shaper_regs::ch[0].coeffs) / sizeof(uint32_t);
+  uint64_t state = 2;
+  std::vector<uint32_t> coeffs(c_MAX_CHANNELS * c_WORDS);
+  for (uint32_t &c: coeffs)
+    c = uint32_t(splitmix64(state));
+
+  mmap_device &dev = board.shaper();
+  return measure("shaper_reload", [&] {
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+      dev.write_burst(offsetof(shaper_regs, ch) + ch * sizeof(shaper_regs::ch[0]),
+                      &coeffs[ch * c_WORDS], c_WORDS);
+    // Flush the posted writes
+    dev.read32(offsetof(shaper_regs, ch) + (c_MAX_CHANNELS - 1) * sizeof(shaper_regs::ch[0]) +
+               (c_WORDS - 1) * sizeof(uint32_t));
+  });
+}
+
+reg_bench_result fofb_reg_bench::cc_drain(bool word_by_word)
+{
+  fofb_cc_snapshotter<> snapper(board.cc());
+  cc_snapshot snap;
+  if (word_by_word)
+    return measure("cc_drain_wbw", [&] { snapper.take_word_by_word(snap); });
+  return measure("cc_drain", [&] { snapper.take(snap); });
+}
+
+reg_bench_result fofb_reg_bench::sp_decim_poll()
+{
+  // Every channel's ring samples are kept, the writer thread isn't run
+  sp_decim_acq_config acq_cfg;
+  acq_cfg.ring_size = 1;
+  while (acq_cfg.ring_size < size_t(c_MAX_CHANNELS) * (cfg.warmup + cfg.iterations + 1))
+    acq_cfg.ring_size *= 2;
+  sp_decim_acq acq(board.proc(), 0, acq_cfg);
+  uint64_t now = 0;
+  acq.configure(now);
+
+  // A step longer than any decimation period, so that every channel is due
+  const uint64_t step = uint64_t(acq.period_ns(0)) * 2 + 1;
+  for (unsigned ch = 1; ch < c_MAX_CHANNELS; ch++)
+    if (acq.period_ns(ch) * 2 > step)
+      throw std::logic_error("sp_decim periods differ");
+  // The first poll reads the channels' values, the second ends the search
+  // for their updates
+  for (unsigned i = 0; i < 2; i++)
+    acq.poll(now += step);
+  return measure("sp_decim_poll", [&] {
+    now += step;
+    if (acq.poll(now) != c_MAX_CHANNELS)
+      throw std::logic_error("sp_decim channels not due");
+  });
+}
+
+reg_bench_result fofb_reg_bench::intlk_status()
+{
+  mmap_device &dev = board.proc();
+  volatile uint32_t sink = 0;
+  return measure("intlk_status", [&] {
+    sink = dev.read32(WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA);
+  });
+}
+
+std::vector<reg_bench_result> fofb_reg_bench::run()
+{
+  board.set_latency(cfg.read_ns, cfg.write_ns);
+
+  std::vector<reg_bench_result> res;
+  auto want = [&](const char *name) {
+    return cfg.only.empty() ||
+      std::find(cfg.only.begin(), cfg.only.end(), name) != cfg.only.end();
+  };
+  if (want("matrix_upload"))
+    res.push_back(matrix_upload());
+  if (want("shaper_reload"))
+    res.push_back(shaper_reload());
+  if (want("cc_drain"))
+    res.push_back(cc_drain(false));
+  if (want("cc_drain_wbw"))
+    res.push_back(cc_drain(true));
+  if (want("sp_decim_poll"))
+    res.push_back(sp_decim_poll());
+  if (want("intlk_status"))
+    res.push_back(intlk_status());
+  return res;
+}
+
+void write_reg_bench_report(std::ostream &out, const reg_bench_config &cfg,
+                            const std::vector<reg_bench_result> &res)
+{
+  out << "# read_ns " << cfg.read_ns << " write_ns " << cfg.write_ns << "\n";
+  out << c_REPORT_HEADER << "\n";
+  char line[256];
+  for (const reg_bench_result &r: res) {
+    std::snprintf(line, sizeof(line), "%s,%u,%.3f,%.3f,%.3f,%.2f,%.2f,%.2f,%.2f,%.3f\n",
+                  r.name.c_str(), r.iterations, r.median_us, r.p99_us, r.mean_us, r.reads,
+                  r.writes, r.read_bursts, r.write_bursts, r.bus_us);
+    out << line;
+  }
+}
+
+std::vector<reg_bench_result> read_reg_bench_report(const std::string &fname)
+{
+  std::ifstream fin(fname);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+
+  std::vector<reg_bench_result> res;
+  std::string line;
+  bool header = false;
+  unsigned lineno = 0;
+  while (std::getline(fin, line)) {
+    lineno++;
+    if (line.empty() || line[0] == '#')
+      continue;
+    if (!header) {
+      if (line != c_REPORT_HEADER)
+        throw std::runtime_error(fname + ": not a benchmark report");
+      header = true;
+      continue;
+    }
+
+    std::istringstream ls(line);
+    reg_bench_result r;
+    char sep[9];
+    std::getline(ls, r.name, ',');
+    ls >> r.iterations >> sep[0] >> r.median_us >> sep[1] >> r.p99_us >> sep[2] >>
+      r.mean_us >> sep[3] >> r.reads >> sep[4] >> r.writes >> sep[5] >> r.read_bursts >>
+      sep[6] >> r.write_bursts >> sep[7] >> r.bus_us;
+    if (!ls || !std::all_of(sep, sep + 8, [](char c) { return c == ','; }))
+      throw std::runtime_error(fname + ":" + std::to_string(lineno) + ": invalid line");
+    res.push_back(r);
+  }
+  return res;
+}
+
+std::vector<std::string> compare_reg_bench(const std::vector<reg_bench_result> &baseline,
+                                           const std::vector<reg_bench_result> &res,
+                                           double tolerance)
+{
+  std::vector<std::string> regs;
+  char msg[256];
+  for (const reg_bench_result &r: res) {
+    auto b = std::find_if(baseline.begin(), baseline.end(),
+                          [&](const reg_bench_result &x) { return x.name == r.name; });
+    if (b == baseline.end())
+      continue;
+
+    const std::pair<const char *, double> counts[] = {
+      {"reads", r.reads - b->reads},
+      {"writes", r.writes - b->writes},
+      {"read bursts", r.read_bursts - b->read_bursts},
+      {"write bursts", r.write_bursts - b->write_bursts},
+    };
+    for (const auto &c: counts) {
+      // The report rounds to 0.01
+      if (c.second > 0.005) {
+        std::snprintf(msg, sizeof(msg), "%s: %.2f more %s per iteration", r.name.c_str(),
+                      c.second, c.first);
+        regs.push_back(msg);
+      }
+    }
+    if (r.median_us > b->median_us * (1 + tolerance)) {
+      std::snprintf(msg, sizeof(msg), "%s: median %.3f us, baseline %.3f us (+%.1f%%)",
+                    r.name.c_str(), r.median_us, b->median_us,
+                    (r.median_us / b->median_us - 1) * 100);
+      regs.push_back(msg);
+    }
+  }
+  return regs;
+}
+
+} // namespace fofb
@@ -0,0 +1,150 @@
+// Register access micro-benchmarks against a mock board
+//
+// mock_board is a stand-in for the register space of a board: a shared memory
+// file (in /dev/shm by default, so other processes may map it too) holding a
+// wb_fofb_processing_regs, a wb_fofb_shaper_filt_regs, a wb_fofb_sys_id_regs
+// and a fofb_cc_regs block, each mapped by its own mmap_device with the same
+// per-access read and write latency, standing in for the PCIe/Wishbone
+// bridge. Nothing emulates the gateware behind the registers: the benchmarks
+// only rely on what the host code writes and reads.
+//
+// fofb_reg_bench runs the host operations of the library on it, with their
+// real access patterns:
+//   matrix_upload   fofb_coeff_loader::load() of a whole new coefficients and
+//                   set-points image, sparse verification
+//   shaper_reload   every channel's shaper coefficients in one burst each,
+//                   flushed by reading the last word back
+//   cc_drain        fofb_cc_snapshotter::take() of the TOA, RCB and X/Y
+//                   buffers
+//   cc_drain_wbw    the same with take_word_by_word()
+//   sp_decim_poll   sp_decim_acq::poll() with the 12 channels due
+//   intlk_status    loop_intlk.sta read
+// Every iteration is timed and the bus accesses it issued counted: the
+// access counts are deterministic, so a change in them is a regression
+// whatever the timing noise, while the times are compared with a tolerance.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_REG_BENCH_H_
+#define FOFB_REG_BENCH_H_
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "fofb_device.h"
+#include "fofb_regs.h"
+
+namespace fofb {
+
+// Board address map of the mock board
+constexpr off_t c_MOCK_PROC_OFF = 0x0;
+constexpr off_t c_MOCK_SHAPER_OFF = 0x10000;
+constexpr off_t c_MOCK_SYS_ID_OFF = 0x14000;
+constexpr off_t c_MOCK_CC_OFF = 0x18000;
+constexpr size_t c_MOCK_BOARD_SIZE = 0x1c000;
+
+class mock_board {
+ public:
+  // Create (or reuse) the file at 'path', an empty path being a new
+  // /dev/shm/fofb_mock_<pid> file removed on destruction
+  explicit mock_board(const std::string &path = "");
+  ~mock_board();
+
+  mock_board(const mock_board &) = delete;
+  mock_board &operator=(const mock_board &) = delete;
+
+  // Latency of every device, in ns per word
+  void set_latency(uint32_t read_ns, uint32_t write_ns);
+
+  mmap_device &proc() { return *devs[0]; }
+  mmap_device &shaper() { return *devs[1]; }
+  mmap_device &sys_id() { return *devs[2]; }
+  mmap_device &cc() { return *devs[3]; }
+
+  // Summed over the four devices
+  device_stats stats() const;
+  void reset_stats();
+
+  const std::string &path() const { return fname; }
+
+ private:
+  std::string fname;
+  bool remove;
+  std::unique_ptr<mmap_device> devs[4];
+};
+
+struct reg_bench_config {
+  // Per-access latency: the order of a non-posted PCIe read round trip and
+  // of a posted write
+  uint32_t read_ns = 1000;
+  uint32_t write_ns = 100;
+  unsigned iterations = 200;
+  // Untimed iterations run first
+  unsigned warmup = 5;
+  // Benchmarks to run by name, empty for all of them
+  std::vector<std::string> only;
+};
+
+struct reg_bench_result {
+  std::string name;
+  unsigned iterations;
+  // Time per iteration, in us
+  double median_us;
+  double p99_us;
+  double mean_us;
+  // Bus accesses per iteration
+  double reads;
+  double writes;
+  double read_bursts;
+  double write_bursts;
+  // Time the accesses cost at the configured latency, in us: the rest of
+  // the measured time is host-side overhead, plus the overshoot of the mock
+  // latency wait (a few tens of ns per single access)
+  double bus_us;
+};
+
+// Names of the benchmarks, in run order
+const std::vector<std::string> &reg_bench_names();
+
+class fofb_reg_bench {
+ public:
+  fofb_reg_bench(mock_board &board, const reg_bench_config &cfg = {});
+
+  std::vector<reg_bench_result> run();
+
+ private:
+  template <typename F>
+  reg_bench_result measure(const std::string &name, F op);
+
+  reg_bench_result matrix_upload();
+  reg_bench_result shaper_reload();
+  reg_bench_result cc_drain(bool word_by_word);
+  reg_bench_result sp_decim_poll();
+  reg_bench_result intlk_status();
+
+  mock_board &board;
+  reg_bench_config cfg;
+};
+
+// CSV report, one line per benchmark after a header line; '#' lines carry
+// the configuration and are skipped when reading
+void write_reg_bench_report(std::ostream &out, const reg_bench_config &cfg,
+                            const std::vector<reg_bench_result> &res);
+std::vector<reg_bench_result> read_reg_bench_report(const std::string &fname);
+
+// Differences of 'res' from 'baseline' counting as regressions: any access
+// count increase, or a median time more than 'tolerance' (relative) above
+// the baseline's. One message per regression.
+std::vector<std::string> compare_reg_bench(const std::vector<reg_bench_result> &baseline,
+                                           const std::vector<reg_bench_result> &res,
+                                           double tolerance);
+
+} // namespace fofb
+
+#endif // FOFB_REG_BENCH_H_
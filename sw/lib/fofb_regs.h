@@ -0,0 +1,44 @@
+// Cheby-generated register layouts of the FOFB controller gateware
+//
+// The headers generated by cheby (see each module's cheby/build_cheby.sh) use
+// the fixed-width integer types without including <stdint.h>, so they are
+// always included through this file.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_REGS_H_
+#define FOFB_REGS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "wb_fofb_processing_regs.h"
+#include "wb_fofb_shaper_filt_regs.h"
+#include "wb_fofb_sys_id_regs.h"
+#include "wb_fofb_cc_regs.h"
+
+namespace fofb {
+
+// Maximum number of channels exposed by the register interfaces
+// (c_MAX_CHANNELS in xwb_fofb_processing and xwb_fofb_shaper_filt)
+constexpr unsigned c_MAX_CHANNELS = 12;
+
+// Number of BPM positions / set-points / coefficients per channel
+// (2**c_SP_COEFF_RAM_ADDR_WIDTH)
+constexpr unsigned c_NUM_BPM_POS = 512;
+
+static_assert(sizeof(wb_fofb_processing_regs) == WB_FOFB_PROCESSING_REGS_SIZE,
+              "wb_fofb_processing_regs layout mismatch");
+static_assert(offsetof(wb_fofb_processing_regs, ch) == WB_FOFB_PROCESSING_REGS_CH,
+              "wb_fofb_processing_regs layout mismatch");
+static_assert(sizeof(wb_fofb_shaper_filt_regs) == WB_FOFB_SHAPER_FILT_REGS_SIZE,
+              "wb_fofb_shaper_filt_regs layout mismatch");
+static_assert(sizeof(wb_fofb_sys_id_regs) == WB_FOFB_SYS_ID_REGS_SIZE,
+              "wb_fofb_sys_id_regs layout mismatch");
+static_assert(sizeof(fofb_cc_regs) == FOFB_CC_REGS_SIZE,
+              "fofb_cc_regs layout mismatch");
+
+} // namespace fofb
+
+#endif // FOFB_REGS_H_
@@ -0,0 +1,317 @@
+// Real-time host fallback correction engine
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+
+#include "fofb_rt_engine.h"
+
+namespace fofb {
+
+namespace {
+
+// Delay between the thread setup and the first cycle
+constexpr uint64_t c_START_DELAY_NS = 1000000;
+
+// Engine thread stack touched before the first cycle
+constexpr size_t c_STACK_PREFAULT = 256 * 1024;
+
+void prefault_stack()
+{
+  volatile char buf[c_STACK_PREFAULT];
+  for (size_t i = 0; i < sizeof(buf); i += 4096)
+    buf[i] = 0;
+}
+
+void inc(std::atomic<uint64_t> &v)
+{
+  v.store(v.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+} // namespace
+
+uint64_t rt_histogram::quantile_ns(double q) const
+{
+  if (count == 0)
+    return 0;
+  uint64_t rank = uint64_t(std::ceil(q * count));
+  if (rank < 1)
+    rank = 1;
+  uint64_t seen = 0;
+  for (unsigned b = 0; b < c_RT_HIST_BINS - 1; b++) {
+    seen += bins[b];
+    if (seen >= rank)
+      return std::min((b + 1) * c_RT_HIST_BIN_NS, max_ns);
+  }
+  return max_ns;
+}
+
+rt_replay_source::rt_replay_source(std::vector<int32_t> bpm_pos, bool l):
+  pos(std::move(bpm_pos)),
+  n_tf(pos.size() / c_NUM_BPM_POS),
+  loop(l)
+{
+  if (n_tf == 0 || pos.size() % c_NUM_BPM_POS)
+    throw std::invalid_argument("BPM positions aren't a whole number of timeframes");
+}
+
+rt_source_status rt_replay_source::next(int32_t *bpm_pos, uint64_t *valid)
+{
+  if (cur == n_tf) {
+    if (!loop)
+      return RT_SRC_END;
+    cur = 0;
+  }
+  std::memcpy(bpm_pos, &pos[cur * c_NUM_BPM_POS], c_NUM_BPM_POS * sizeof(int32_t));
+  for (unsigned w = 0; w < c_NUM_BPM_POS / 64; w++)
+    valid[w] = ~uint64_t(0);
+  cur++;
+  return RT_SRC_OK;
+}
+
+std::vector<int32_t> read_bpm_pos_file(const std::string &fname)
+{
+  FILE *f = std::fopen(fname.c_str(), "rb");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+  std::vector<int32_t> pos;
+  int32_t buf[c_NUM_BPM_POS];
+  size_t n;
+  while ((n = std::fread(buf, sizeof(int32_t), c_NUM_BPM_POS, f)) == c_NUM_BPM_POS)
+    pos.insert(pos.end(), buf, buf + c_NUM_BPM_POS);
+  const bool err = std::ferror(f);
+  std::fclose(f);
+  if (err)
+    throw std::runtime_error(fname + ": read error");
+  if (n || pos.empty())
+    throw std::runtime_error(fname + ": size isn't a multiple of a timeframe");
+  return pos;
+}
+
+rt_source_status rt_xy_shm_source::next(int32_t *bpm_pos, uint64_t *valid)
+{
+  if (!shm.pop(frame))
+    return RT_SRC_EMPTY;
+  xy_frame_to_bpm_pos(frame, bpm_pos, valid);
+  return RT_SRC_OK;
+}
+
+void rt_engine::atomic_histogram::add(uint64_t ns)
+{
+  const uint64_t b = std::min<uint64_t>(ns / c_RT_HIST_BIN_NS, c_RT_HIST_BINS - 1);
+  inc(bins[b]);
+  inc(count);
+  if (ns > max_ns.load(std::memory_order_relaxed))
+    max_ns.store(ns, std::memory_order_relaxed);
+}
+
+void rt_engine::atomic_histogram::clear()
+{
+  for (std::atomic<uint64_t> &b: bins)
+    b.store(0, std::memory_order_relaxed);
+  count.store(0, std::memory_order_relaxed);
+  max_ns.store(0, std::memory_order_relaxed);
+}
+
+rt_histogram rt_engine::atomic_histogram::load() const
+{
+  rt_histogram h;
+  for (unsigned b = 0; b < c_RT_HIST_BINS; b++)
+    h.bins[b] = bins[b].load(std::memory_order_relaxed);
+  h.count = count.load(std::memory_order_relaxed);
+  h.max_ns = max_ns.load(std::memory_order_relaxed);
+  return h;
+}
+
+rt_engine::rt_engine(const wb_fofb_processing_regs &proc_regs,
+                     const wb_fofb_shaper_filt_regs *shaper_regs, rt_pos_source &s,
+                     const rt_engine_config &c, const fofb_processing_generics &proc_gen,
+                     const fofb_shaper_filt_generics &shaper_gen):
+  proc(proc_gen),
+  src(s),
+  cfg(c),
+  bpm_pos(c_NUM_BPM_POS),
+  valid(c_NUM_BPM_POS / 64)
+{
+  if (!(cfg.tf_rate_hz > 0))
+    throw std::invalid_argument("invalid timeframe rate");
+  period_ns = uint64_t(std::llround(1e9 / cfg.tf_rate_hz));
+  proc.load_regs(proc_regs);
+  if (shaper_regs) {
+    shaper_ptr.reset(new fofb_shaper_filt_model(shaper_gen));
+    shaper_ptr->load_regs(*shaper_regs);
+  }
+  if (cfg.output_ring)
+    out.reset(new spsc_ring<rt_engine_step>(cfg.output_ring));
+  wake.clear();
+  compute.clear();
+  latency.clear();
+}
+
+rt_engine::~rt_engine()
+{
+  try {
+    stop();
+  } catch (const std::exception &) {
+    // Only setup errors are rethrown, nothing left to clean up
+  }
+}
+
+void rt_engine::start()
+{
+  if (th.joinable())
+    throw std::logic_error("engine already started");
+  if (cfg.lock_memory && ::mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+    throw std::runtime_error(std::string("can't lock the process memory: ") +
+                             std::strerror(errno));
+  for (std::atomic<uint64_t> *v: {&n_cycles, &n_timeframes, &n_underruns, &n_overruns,
+                                  &n_dropped})
+    v->store(0);
+  wake.clear();
+  compute.clear();
+  latency.clear();
+  err = nullptr;
+  stop_req.store(false);
+  active.store(true);
+  th = std::thread(&rt_engine::engine_thread, this);
+}
+
+void rt_engine::wait()
+{
+  if (th.joinable())
+    th.join();
+  if (err) {
+    std::exception_ptr e = err;
+    err = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+void rt_engine::stop()
+{
+  stop_req.store(true);
+  wait();
+}
+
+rt_engine_stats rt_engine::stats() const
+{
+  rt_engine_stats st;
+  st.cycles = n_cycles.load(std::memory_order_relaxed);
+  st.timeframes = n_timeframes.load(std::memory_order_relaxed);
+  st.underruns = n_underruns.load(std::memory_order_relaxed);
+  st.overruns = n_overruns.load(std::memory_order_relaxed);
+  st.dropped = n_dropped.load(std::memory_order_relaxed);
+  st.wake = wake.load();
+  st.compute = compute.load();
+  st.latency = latency.load();
+  return st;
+}
+
+void rt_engine::setup_thread()
+{
+  if (cfg.cpu >= 0) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cfg.cpu, &set);
+    const int e = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (e)
+      throw std::runtime_error(std::string("can't pin the engine thread: ") + std::strerror(e));
+  }
+  if (cfg.rt_priority > 0) {
+    sched_param param = {};
+    param.sched_priority = cfg.rt_priority;
+    const int e = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (e)
+      throw std::runtime_error(std::string("can't set engine thread priority: ") +
+                               std::strerror(e));
+  }
+  if (cfg.lock_memory)
+    prefault_stack();
+}
+
+void rt_engine::run_cycles()
+{
+  fofb_processing_result res;
+  rt_engine_step step = {};
+  uint64_t due = now_ns() + c_START_DELAY_NS;
+  uint64_t tf = 0;
+  for (uint64_t cycle = 0; cfg.cycles == 0 || cycle < cfg.cycles; cycle++) {
+    if (stop_req.load(std::memory_order_relaxed))
+      break;
+    if (cfg.free_run)
+      due = now_ns();
+    else
+      wait_until(due);
+    const uint64_t start = now_ns();
+    const uint64_t deadline = due + period_ns;
+
+    // A free-running engine waits for the source as long as it takes
+    rt_source_status st;
+    while ((st = src.next(bpm_pos.data(), valid.data())) == RT_SRC_EMPTY &&
+           !stop_req.load(std::memory_order_relaxed) &&
+           (cfg.free_run || now_ns() < deadline))
+      ;
+    if (st == RT_SRC_END)
+      break;
+
+    const uint64_t got = now_ns();
+    if (st == RT_SRC_OK) {
+      proc.process(bpm_pos.data(), valid.data(), 1, &res);
+      if (shaper_ptr)
+        shaper_ptr->process(res.sp, 1, step.filt_sp);
+      else
+        std::memcpy(step.filt_sp, res.sp, sizeof(step.filt_sp));
+    }
+    const uint64_t end = now_ns();
+
+    if (st == RT_SRC_OK) {
+      compute.add(end - got);
+      inc(n_timeframes);
+      if (out) {
+        step.cycle = cycle;
+        step.tf = tf;
+        std::memcpy(step.sp, res.sp, sizeof(step.sp));
+        step.loop_intlk_sta = res.loop_intlk_sta;
+        step.compute_ns = uint32_t(end - got);
+        if (!out->push(step))
+          inc(n_dropped);
+      }
+      tf++;
+    } else {
+      inc(n_underruns);
+    }
+    wake.add(start - due);
+    latency.add(end - due);
+    if (!cfg.free_run && end > deadline)
+      inc(n_overruns);
+    inc(n_cycles);
+    due += period_ns;
+  }
+}
+
+void rt_engine::engine_thread()
+{
+  try {
+    setup_thread();
+    run_cycles();
+  } catch (...) {
+    err = std::current_exception();
+  }
+  active.store(false, std::memory_order_release);
+}
+
+} // namespace fofb
@@ -0,0 +1,243 @@
+// Real-time host fallback correction engine
+//
+// Runs the whole correction chain of a board on the host, one timeframe per
+// cycle of the loop clock (48 kHz by default): the fofb_processing model
+// (dot product with the coefficients RAM, accumulators with their gains,
+// sp_limits saturation, loop interlock) and, when given their coefficients,
+// the fofb_shaper_filt biquads, both models of the gateware configured from
+// the same register images. The fofb_processing set-points can be compared
+// word for word with the board's (but for the timeframes saturating the dot
+// product accumulator, see fofb_processing_model.h). The shaper model was
+// only checked against the fofb_shaper_filt testbench, within its 5%
+// tolerance (see fofb_shaper_filt_model.h), so filtered set-points may differ
+// from the board's by a few LSBs. It serves to qualify new controller
+// algorithms under the loop deadline and as a reference for the gateware
+// datapath.
+//
+// The positions come from an rt_pos_source: a recording held in memory
+// (rt_replay_source) or the shared memory stand-in for the FOFB CC X/Y
+// buffer (rt_xy_shm_source, see fofb_xy_shm.h).
+//
+// The cycles run on their own thread, pinned to 'cpu' with SCHED_FIFO
+// 'rt_priority' if given and, with 'lock_memory', the process memory locked
+// (mlockall) and the thread stack pre-faulted before the first cycle. The
+// models and buffers are set up by the constructor: a cycle doesn't
+// allocate, lock or make system calls besides reading the clock, and a
+// source has to behave likewise. Each cycle sleeps then spins to its due
+// time, takes the timeframe from the source (waiting for it until the
+// cycle's deadline, the next due time) and runs the chain. Per cycle, the
+// wake-up delay (start minus due time, the jitter), the compute time and the
+// latency (end minus due time) go to histograms readable while running;
+// cycles ending past their deadline are overruns and cycles without a
+// timeframe underruns. The step outputs are published to a ring for a
+// consumer thread.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_RT_ENGINE_H_
+#define FOFB_RT_ENGINE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fofb_host.h"
+#include "fofb_processing_model.h"
+#include "fofb_regs.h"
+#include "fofb_shaper_filt_model.h"
+#include "fofb_spsc_ring.h"
+#include "fofb_xy_shm.h"
+
+namespace fofb {
+
+// Histogram bins, c_RT_HIST_BIN_NS wide: 0 to 51.2 us, the last bin also
+// counts everything longer
+constexpr unsigned c_RT_HIST_BINS = 512;
+constexpr uint64_t c_RT_HIST_BIN_NS = 100;
+
+struct rt_histogram {
+  uint64_t bins[c_RT_HIST_BINS];
+  uint64_t count;
+  uint64_t max_ns;
+
+  // Upper bound of the bin holding the 'q' quantile (max_ns in the last
+  // bin, or if lower), 0 when empty
+  uint64_t quantile_ns(double q) const;
+};
+
+enum rt_source_status {
+  RT_SRC_OK,
+  // Next timeframe not available yet
+  RT_SRC_EMPTY,
+  // No more timeframes
+  RT_SRC_END,
+};
+
+// Called from the engine thread: next() must not allocate or block
+class rt_pos_source {
+ public:
+  virtual ~rt_pos_source() = default;
+
+  // Fill c_NUM_BPM_POS positions and c_NUM_BPM_POS / 64 valid words (see
+  // fofb_processing_model::process()) with the next timeframe
+  virtual rt_source_status next(int32_t *bpm_pos, uint64_t *valid) = 0;
+};
+
+class rt_replay_source : public rt_pos_source {
+ public:
+  // c_NUM_BPM_POS positions per timeframe, all received. With 'loop', the
+  // recording restarts when it ends.
+  explicit rt_replay_source(std::vector<int32_t> bpm_pos, bool loop = false);
+
+  rt_source_status next(int32_t *bpm_pos, uint64_t *valid) override;
+
+  size_t timeframes() const { return n_tf; }
+
+ private:
+  std::vector<int32_t> pos;
+  size_t n_tf;
+  size_t cur = 0;
+  bool loop;
+};
+
+// Read a BPM positions file (c_NUM_BPM_POS native int32 per timeframe, the
+// fofb_processing_replay input)
+std::vector<int32_t> read_bpm_pos_file(const std::string &fname);
+
+class rt_xy_shm_source : public rt_pos_source {
+ public:
+  explicit rt_xy_shm_source(xy_shm &shm): shm(shm) {}
+
+  rt_source_status next(int32_t *bpm_pos, uint64_t *valid) override;
+
+ private:
+  xy_shm &shm;
+  xy_shm_frame frame;
+};
+
+struct rt_engine_config {
+  double tf_rate_hz = 48000;
+  // CPU running the cycles, -1 for any
+  int cpu = -1;
+  // SCHED_FIFO priority of the engine thread, 0 keeps the default policy
+  int rt_priority = 0;
+  // mlockall() the process memory and pre-fault the engine thread stack
+  bool lock_memory = false;
+  // Run the cycles back to back instead of on the loop clock (throughput)
+  bool free_run = false;
+  // Cycles to run, 0 until stop() or the end of the source
+  uint64_t cycles = 0;
+  // Capacity of the step outputs ring (a power of two), 0 not to publish
+  // them
+  size_t output_ring = 0;
+};
+
+struct rt_engine_step {
+  // Cycle and timeframe processed by it (underruns don't have one)
+  uint64_t cycle;
+  uint64_t tf;
+  // fofb_processing set-points and, with the shaper filters, the filtered
+  // ones (a copy of 'sp' otherwise)
+  int16_t sp[c_MAX_CHANNELS];
+  int16_t filt_sp[c_MAX_CHANNELS];
+  uint32_t loop_intlk_sta;
+  uint32_t compute_ns;
+};
+
+struct rt_engine_stats {
+  uint64_t cycles;
+  // Timeframes processed
+  uint64_t timeframes;
+  // Cycles that got no timeframe from the source before their deadline
+  uint64_t underruns;
+  // Cycles ending past their deadline
+  uint64_t overruns;
+  // Steps not published, the outputs ring being full
+  uint64_t dropped;
+  rt_histogram wake;
+  rt_histogram compute;
+  rt_histogram latency;
+};
+
+class rt_engine {
+ public:
+  // 'shaper_regs' may be nullptr to bypass the shaper filters. The models
+  // are configured from the register images as given, with the generics
+  // passed (see fofb_processing_generics::from_regs()).
+  rt_engine(const wb_fofb_processing_regs &proc_regs,
+            const wb_fofb_shaper_filt_regs *shaper_regs, rt_pos_source &src,
+            const rt_engine_config &cfg = {}, const fofb_processing_generics &proc_gen = {},
+            const fofb_shaper_filt_generics &shaper_gen = {});
+  ~rt_engine();
+
+  rt_engine(const rt_engine &) = delete;
+  rt_engine &operator=(const rt_engine &) = delete;
+
+  void start();
+  // Wait for the configured cycles or the end of the source, rethrowing a
+  // setup error of the engine thread
+  void wait();
+  void stop();
+  bool running() const { return active.load(std::memory_order_acquire); }
+
+  // Safe to call while running
+  rt_engine_stats stats() const;
+
+  // Consumer side of the step outputs ring, nullptr without one
+  spsc_ring<rt_engine_step> *outputs() { return out.get(); }
+
+  // Models state, not to be used while running: store_regs() gives the
+  // register image the board would read back
+  const fofb_processing_model &processing() const { return proc; }
+  const fofb_shaper_filt_model *shaper() const { return shaper_ptr.get(); }
+
+ private:
+  struct atomic_histogram {
+    std::atomic<uint64_t> bins[c_RT_HIST_BINS];
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> max_ns;
+
+    void add(uint64_t ns);
+    void clear();
+    rt_histogram load() const;
+  };
+
+  void setup_thread();
+  void run_cycles();
+  void engine_thread();
+
+  fofb_processing_model proc;
+  std::unique_ptr<fofb_shaper_filt_model> shaper_ptr;
+  rt_pos_source &src;
+  rt_engine_config cfg;
+  uint64_t period_ns;
+
+  std::vector<int32_t> bpm_pos;
+  std::vector<uint64_t> valid;
+  std::unique_ptr<spsc_ring<rt_engine_step>> out;
+
+  std::thread th;
+  std::exception_ptr err;
+  std::atomic<bool> stop_req{false};
+  std::atomic<bool> active{false};
+
+  // Written by the engine thread
+  std::atomic<uint64_t> n_cycles{0};
+  std::atomic<uint64_t> n_timeframes{0};
+  std::atomic<uint64_t> n_underruns{0};
+  std::atomic<uint64_t> n_overruns{0};
+  std::atomic<uint64_t> n_dropped{0};
+  atomic_histogram wake;
+  atomic_histogram compute;
+  atomic_histogram latency;
+};
+
+} // namespace fofb
+
+#endif // FOFB_RT_ENGINE_H_
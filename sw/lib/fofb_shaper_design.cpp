@@ -0,0 +1,625 @@
+// Fixed-point realization search for fofb_shaper_filt filter designs
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "fofb_fixed_point.h"
+#include "fofb_shaper_design.h"
+
+namespace fofb {
+
+namespace {
+
+// iir_filt x_i / y_o fractionary width, as in the model
+constexpr unsigned c_X_Y_FRAC_WIDTH = 1;
+
+// Frequency response errors are relative to the ideal response, or to this
+// fraction of its peak where it's smaller (stopbands)
+constexpr double c_RESP_FLOOR = 1e-3;
+
+constexpr double c_SP_MAX = 32767;
+constexpr double c_SP_MIN = -32768;
+
+uint64_t splitmix64(uint64_t &state)
+{
+  uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// Roots of 1 + c1 z^-1 + c2 z^-2, complex pairs once
+void monic_roots(double c1, double c2, std::vector<std::complex<double>> &roots)
+{
+  if (c2 == 0) {
+    if (c1 != 0)
+      roots.emplace_back(-c1, 0);
+    return;
+  }
+  const double disc = c1 * c1 - 4 * c2;
+  if (disc < 0) {
+    roots.emplace_back(-c1 / 2, std::sqrt(-disc) / 2);
+  } else {
+    // Without cancellation
+    const double q = -(c1 + std::copysign(std::sqrt(disc), c1)) / 2;
+    roots.emplace_back(q, 0);
+    roots.emplace_back(c2 / q, 0);
+  }
+}
+
+unsigned factorial(unsigned n)
+{
+  return n <= 1 ? 1 : n * factorial(n - 1);
+}
+
+} // namespace
+
+shaper_design shaper_design_from_biquads(const std::vector<biquad_coeffs> &biquads)
+{
+  shaper_design d;
+  for (const biquad_coeffs &c: biquads) {
+    if (c[0] == 0 && c[1] == 0 && c[2] == 0)
+      throw std::invalid_argument("biquad with a null numerator");
+    if (c[0] == 0)
+      throw std::invalid_argument("biquads with b0 = 0 (delays) aren't supported");
+    d.gain *= c[0];
+    monic_roots(c[1] / c[0], c[2] / c[0], d.zeros);
+    monic_roots(c[3], c[4], d.poles);
+  }
+  return d;
+}
+
+// Monic second order section 1 + c1 z^-1 + c2 z^-2
+struct shaper_explorer::section {
+  double c1 = 0;
+  double c2 = 0;
+  // Largest root modulus and that root, for the pairing heuristic
+  double radius = 0;
+  std::complex<double> root;
+  bool empty = true;
+};
+
+struct shaper_explorer::context {
+  fofb_shaper_filt_generics gen;
+  shaper_explore_config cfg;
+  double gain;
+  unsigned n;
+  std::vector<section> zs, ps;
+
+  // z^-1 and z^-2 on the frequency grid
+  std::vector<double> z1re, z1im, z2re, z2im;
+  // Ideal response and the inverse of the error reference
+  std::vector<double> hre, him, inv_ref;
+
+  std::vector<int16_t> stim;
+  // Ideal filter output, saturated to the set-points range
+  std::vector<double> ideal_out;
+
+  double coeff_max;
+  double coeff_lsb;
+  // Rounding steps of the biquads' state and interfaces, in set-point LSBs
+  double w_lsb;
+  double u_lsb;
+
+  double cost(const shaper_quant_metrics &m) const
+  {
+    switch (cfg.metric) {
+      case shaper_metric::resp:
+        return m.resp_err;
+      case shaper_metric::noise:
+        return m.noise_rms;
+      default:
+        return m.sim_err_rms;
+    }
+  }
+
+  bool better(const shaper_quant_metrics &a, const shaper_quant_metrics &b) const
+  {
+    return a.saturations < b.saturations ||
+      (a.saturations == b.saturations && cost(a) < cost(b));
+  }
+
+  // Response of a biquad on the grid
+  void response(const biquad_coeffs &c, double *re, double *im) const
+  {
+    const size_t np = z1re.size();
+    const double *z1r = z1re.data(), *z1i = z1im.data();
+    const double *z2r = z2re.data(), *z2i = z2im.data();
+    size_t i = 0;
+#ifdef __AVX2__
+    const __m256d b0 = _mm256_set1_pd(c[0]), b1 = _mm256_set1_pd(c[1]);
+    const __m256d b2 = _mm256_set1_pd(c[2]), a1 = _mm256_set1_pd(c[3]);
+    const __m256d a2 = _mm256_set1_pd(c[4]), one = _mm256_set1_pd(1);
+    for (; i + 4 <= np; i += 4) {
+      const __m256d zr1 = _mm256_loadu_pd(z1r + i), zi1 = _mm256_loadu_pd(z1i + i);
+      const __m256d zr2 = _mm256_loadu_pd(z2r + i), zi2 = _mm256_loadu_pd(z2i + i);
+      // Same operations order as the scalar loop
+      const __m256d nr = _mm256_add_pd(_mm256_add_pd(b0, _mm256_mul_pd(b1, zr1)),
+                                       _mm256_mul_pd(b2, zr2));
+      const __m256d ni = _mm256_add_pd(_mm256_mul_pd(b1, zi1), _mm256_mul_pd(b2, zi2));
+      const __m256d dr = _mm256_add_pd(_mm256_add_pd(one, _mm256_mul_pd(a1, zr1)),
+                                       _mm256_mul_pd(a2, zr2));
+      const __m256d di = _mm256_add_pd(_mm256_mul_pd(a1, zi1), _mm256_mul_pd(a2, zi2));
+      const __m256d inv = _mm256_div_pd(one, _mm256_add_pd(_mm256_mul_pd(dr, dr),
+                                                           _mm256_mul_pd(di, di)));
+      _mm256_storeu_pd(re + i, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(nr, dr),
+                                                           _mm256_mul_pd(ni, di)), inv));
+      _mm256_storeu_pd(im + i, _mm256_mul_pd(_mm256_sub_pd(_mm256_mul_pd(ni, dr),
+                                                           _mm256_mul_pd(nr, di)), inv));
+    }
+#endif
+    for (; i < np; i++) {
+      const double nr = c[0] + c[1] * z1r[i] + c[2] * z2r[i];
+      const double ni = c[1] * z1i[i] + c[2] * z2i[i];
+      const double dr = 1 + c[3] * z1r[i] + c[4] * z2r[i];
+      const double di = c[3] * z1i[i] + c[4] * z2i[i];
+      const double inv = 1 / (dr * dr + di * di);
+      re[i] = (nr * dr + ni * di) * inv;
+      im[i] = (ni * dr - nr * di) * inv;
+    }
+  }
+
+  std::vector<biquad_coeffs> cascade(const std::vector<unsigned> &pairing,
+                                     const std::vector<unsigned> &order) const;
+};
+
+std::vector<biquad_coeffs> shaper_explorer::context::cascade(
+  const std::vector<unsigned> &pairing, const std::vector<unsigned> &order) const
+{
+  const size_t np = z1re.size();
+  std::vector<double> pre(np, 1), pim(np, 0), rre(np), rim(np);
+  std::vector<biquad_coeffs> bq(n);
+  double g_total = 1;
+  for (unsigned i = 0; i < n; i++) {
+    const section &p = ps[order[i]];
+    const section &z = zs[pairing[order[i]]];
+    biquad_coeffs c = {1, z.c1, z.c2, p.c1, p.c2};
+
+    double g;
+    if (i == n - 1) {
+      g = gain / g_total;
+    } else {
+      // Unity peak gain of the cascade so far, within the coefficients' range
+      response(c, rre.data(), rim.data());
+      double peak = 0;
+      for (size_t k = 0; k < np; k++) {
+        const double re = pre[k] * rre[k] - pim[k] * rim[k];
+        const double im = pre[k] * rim[k] + pim[k] * rre[k];
+        pre[k] = re;
+        pim[k] = im;
+        peak = std::max(peak, re * re + im * im);
+      }
+      if (!(peak > 0))
+        throw std::invalid_argument("null partial cascade");
+      g = std::min(1 / std::sqrt(peak),
+                   coeff_max / std::max({1.0, std::abs(z.c1), std::abs(z.c2)}));
+      for (size_t k = 0; k < np; k++) {
+        pre[k] *= g;
+        pim[k] *= g;
+      }
+      g_total *= g;
+    }
+    c[0] = g;
+    c[1] *= g;
+    c[2] *= g;
+    bq[i] = c;
+  }
+  return bq;
+}
+
+// Evaluates up to c_MAX_CHANNELS candidates at once, one per model channel
+class shaper_explorer::worker {
+ public:
+  explicit worker(const context &c):
+    ctx(c),
+    model(lane_generics(c.gen)),
+    in(c.stim.size() * c_MAX_CHANNELS),
+    out(in.size()),
+    qre(size_t(c.gen.num_biquads) * c.z1re.size()),
+    qim(qre.size()),
+    sre(c.z1re.size()),
+    sim(sre.size())
+  {
+    for (size_t t = 0; t < c.stim.size(); t++)
+      std::fill_n(&in[t * c_MAX_CHANNELS], c_MAX_CHANNELS, c.stim[t]);
+    model.set_count_saturations(true);
+  }
+
+  void evaluate(shaper_candidate *const *cands, unsigned num);
+
+ private:
+  static fofb_shaper_filt_generics lane_generics(fofb_shaper_filt_generics g)
+  {
+    g.channels = c_MAX_CHANNELS;
+    return g;
+  }
+
+  void freq_metrics(const std::vector<biquad_coeffs> &bq, shaper_quant_metrics &m);
+
+  const context &ctx;
+  fofb_shaper_filt_model model;
+  std::vector<int16_t> in, out;
+  // Quantized biquads' responses and suffix products of the cascade
+  std::vector<double> qre, qim, sre, sim;
+};
+
+void shaper_explorer::worker::freq_metrics(const std::vector<biquad_coeffs> &bq,
+                                           shaper_quant_metrics &m)
+{
+  const size_t np = ctx.z1re.size();
+  for (size_t i = 0; i < bq.size(); i++) {
+    biquad_coeffs q;
+    for (unsigned k = 0; k < 5; k++) {
+      const unsigned width = ctx.gen.coeff_int_width + ctx.gen.coeff_frac_width;
+      q[k] = fp_left_aligned(model.coeff_to_reg(bq[i][k]), width) * ctx.coeff_lsb;
+    }
+    ctx.response(q, &qre[i * np], &qim[i * np]);
+  }
+
+  // Each rounding point's noise goes through the rest of the cascade: the
+  // state's through its own biquad too
+  std::fill(sre.begin(), sre.end(), 1.0);
+  std::fill(sim.begin(), sim.end(), 0.0);
+  const double w_var = ctx.w_lsb * ctx.w_lsb / 12, u_var = ctx.u_lsb * ctx.u_lsb / 12;
+  double noise = 0;
+  for (size_t i = bq.size(); i-- > 0;) {
+    const double *rre = &qre[i * np], *rim = &qim[i * np];
+    double s_gain = 0, w_gain = 0;
+    for (size_t k = 0; k < np; k++) {
+      s_gain += sre[k] * sre[k] + sim[k] * sim[k];
+      const double re = sre[k] * rre[k] - sim[k] * rim[k];
+      const double im = sre[k] * rim[k] + sim[k] * rre[k];
+      w_gain += re * re + im * im;
+      sre[k] = re;
+      sim[k] = im;
+    }
+    noise += (w_var * w_gain + u_var * s_gain) / np;
+  }
+  m.noise_rms = std::sqrt(noise);
+
+  double err = 0;
+  for (size_t k = 0; k < np; k++) {
+    const double dr = sre[k] - ctx.hre[k], di = sim[k] - ctx.him[k];
+    err = std::max(err, (dr * dr + di * di) * ctx.inv_ref[k] * ctx.inv_ref[k]);
+  }
+  m.resp_err = std::sqrt(err);
+}
+
+void shaper_explorer::worker::evaluate(shaper_candidate *const *cands, unsigned num)
+{
+  for (unsigned l = 0; l < num; l++) {
+    shaper_candidate &c = *cands[l];
+    if (c.biquads.empty())
+      c.biquads = ctx.cascade(c.pairing, c.order);
+    freq_metrics(c.biquads, c.metrics);
+    load_cascade(model, l, c.biquads);
+  }
+
+  model.reset();
+  model.clear_saturations();
+  model.process(in.data(), ctx.stim.size(), out.data());
+  for (unsigned l = 0; l < num; l++) {
+    double err = 0;
+    for (size_t t = 0; t < ctx.stim.size(); t++) {
+      const double d = out[t * c_MAX_CHANNELS + l] - ctx.ideal_out[t];
+      err += d * d;
+    }
+    cands[l]->metrics.sim_err_rms = std::sqrt(err / ctx.stim.size());
+    cands[l]->metrics.saturations = model.saturations(l);
+  }
+}
+
+shaper_explorer::shaper_explorer(const fofb_shaper_filt_generics &g,
+                                 const shaper_explore_config &c):
+  gen(g),
+  cfg(c)
+{
+  gen.channels = c_MAX_CHANNELS;
+  // Validates the generics
+  fofb_shaper_filt_model check(gen);
+  if (gen.num_biquads == 0)
+    throw std::invalid_argument("no biquads");
+  if (cfg.grid_points == 0 || cfg.step_len + cfg.chirp_len == 0)
+    throw std::invalid_argument("empty frequency grid or stimulus");
+}
+
+void shaper_explorer::load_cascade(fofb_shaper_filt_model &model, unsigned ch,
+                                   const std::vector<biquad_coeffs> &biquads)
+{
+  for (unsigned b = 0; b < model.generics().num_biquads; b++) {
+    const biquad_coeffs c = b < biquads.size() ? biquads[b] : biquad_coeffs{1, 0, 0, 0, 0};
+    for (unsigned k = 0; k < 5; k++)
+      model.set_coeff(ch, b * c_SHAPER_FILT_COEFFS_PER_BIQUAD + k, model.coeff_to_reg(c[k]));
+  }
+}
+
+shaper_explore_result shaper_explorer::explore(const std::vector<biquad_coeffs> &given_all) const
+{
+  const std::vector<biquad_coeffs> given(
+    given_all.begin(), given_all.begin() + std::min<size_t>(given_all.size(), gen.num_biquads));
+  if (given.empty())
+    throw std::invalid_argument("no biquads given");
+
+  context ctx;
+  ctx.gen = gen;
+  ctx.cfg = cfg;
+
+  // Sections: complex pairs alone, real roots paired by decreasing value
+  const shaper_design d = shaper_design_from_biquads(given);
+  ctx.gain = d.gain;
+  auto make_sections = [](const std::vector<std::complex<double>> &roots) {
+    std::vector<section> secs;
+    std::vector<double> reals;
+    for (const std::complex<double> &r: roots) {
+      if (r.imag() != 0) {
+        section s;
+        s.c1 = -2 * r.real();
+        s.c2 = std::norm(r);
+        s.radius = std::abs(r);
+        s.root = r;
+        s.empty = false;
+        secs.push_back(s);
+      } else {
+        reals.push_back(r.real());
+      }
+    }
+    std::sort(reals.rbegin(), reals.rend());
+    for (size_t i = 0; i < reals.size(); i += 2) {
+      section s;
+      const double r1 = reals[i], r2 = i + 1 < reals.size() ? reals[i + 1] : 0;
+      s.c1 = -(r1 + r2);
+      s.c2 = r1 * r2;
+      s.radius = std::max(std::abs(r1), std::abs(r2));
+      s.root = std::abs(r1) >= std::abs(r2) ? r1 : r2;
+      s.empty = false;
+      secs.push_back(s);
+    }
+    return secs;
+  };
+  ctx.zs = make_sections(d.zeros);
+  ctx.ps = make_sections(d.poles);
+  ctx.n = unsigned(std::max<size_t>({ctx.zs.size(), ctx.ps.size(), 1}));
+  if (ctx.n > gen.num_biquads)
+    throw std::logic_error("more sections than biquads");
+  ctx.zs.resize(ctx.n);
+  ctx.ps.resize(ctx.n);
+
+  const unsigned coeff_width = gen.coeff_int_width + gen.coeff_frac_width;
+  ctx.coeff_lsb = std::ldexp(1.0, -int(gen.coeff_frac_width));
+  ctx.coeff_max = double(fp_max(coeff_width)) * ctx.coeff_lsb;
+  ctx.u_lsb = std::ldexp(1.0, -int(c_X_Y_FRAC_WIDTH + gen.ifcs_extra_bits));
+  ctx.w_lsb = ctx.u_lsb * std::ldexp(1.0, -int(gen.arith_extra_bits));
+
+  // Midpoints of a uniform grid, so that mean squared responses are the
+  // noise gains
+  const size_t np = cfg.grid_points;
+  ctx.z1re.resize(np);
+  ctx.z1im.resize(np);
+  ctx.z2re.resize(np);
+  ctx.z2im.resize(np);
+  for (size_t k = 0; k < np; k++) {
+    const double w = M_PI * (k + 0.5) / np;
+    ctx.z1re[k] = std::cos(w);
+    ctx.z1im[k] = -std::sin(w);
+    ctx.z2re[k] = std::cos(2 * w);
+    ctx.z2im[k] = -std::sin(2 * w);
+  }
+  ctx.hre.assign(np, 1);
+  ctx.him.assign(np, 0);
+  {
+    std::vector<double> rre(np), rim(np);
+    for (const biquad_coeffs &c: given) {
+      ctx.response(c, rre.data(), rim.data());
+      for (size_t k = 0; k < np; k++) {
+        const double re = ctx.hre[k] * rre[k] - ctx.him[k] * rim[k];
+        ctx.him[k] = ctx.hre[k] * rim[k] + ctx.him[k] * rre[k];
+        ctx.hre[k] = re;
+      }
+    }
+  }
+  double peak = 0;
+  for (size_t k = 0; k < np; k++)
+    peak = std::max(peak, std::hypot(ctx.hre[k], ctx.him[k]));
+  ctx.inv_ref.resize(np);
+  for (size_t k = 0; k < np; k++)
+    ctx.inv_ref[k] = 1 / std::max(std::hypot(ctx.hre[k], ctx.him[k]), c_RESP_FLOOR * peak);
+
+  // Stimulus and the ideal filter's output, in double precision
+  for (unsigned t = 0; t < cfg.step_len; t++)
+    ctx.stim.push_back(int16_t(c_SP_MAX));
+  for (unsigned t = 0; t < cfg.step_len; t++)
+    ctx.stim.push_back(int16_t(c_SP_MIN));
+  for (unsigned t = 0; t < cfg.chirp_len; t++)
+    ctx.stim.push_back(int16_t(std::lround(c_SP_MAX * std::sin(M_PI * t * t / (2.0 * cfg.chirp_len)))));
+  {
+    std::vector<double> w1(given.size()), w2(given.size());
+    for (int16_t x: ctx.stim) {
+      double u = x;
+      for (size_t b = 0; b < given.size(); b++) {
+        const biquad_coeffs &c = given[b];
+        const double w = u - c[3] * w1[b] - c[4] * w2[b];
+        u = c[0] * w + c[1] * w1[b] + c[2] * w2[b];
+        w2[b] = w1[b];
+        w1[b] = w;
+      }
+      ctx.ideal_out.push_back(std::min(c_SP_MAX, std::max(c_SP_MIN, u)));
+    }
+  }
+
+  unsigned threads = cfg.threads ? cfg.threads : std::thread::hardware_concurrency();
+  threads = std::max(1u, threads);
+  std::vector<std::unique_ptr<worker>> workers;
+
+  // Evaluate 'cands' in batches of c_MAX_CHANNELS, over the worker threads
+  auto evaluate = [&](std::vector<shaper_candidate> &cands) {
+    const size_t batches = (cands.size() + c_MAX_CHANNELS - 1) / c_MAX_CHANNELS;
+    const unsigned nth = unsigned(std::max<size_t>(1, std::min<size_t>(threads, batches)));
+    while (workers.size() < nth)
+      workers.emplace_back(new worker(ctx));
+
+    std::atomic<size_t> next{0};
+    auto work = [&](worker &w) {
+      size_t b;
+      while ((b = next.fetch_add(1)) < batches) {
+        shaper_candidate *ptrs[c_MAX_CHANNELS];
+        const size_t first = b * c_MAX_CHANNELS;
+        const unsigned num = unsigned(std::min<size_t>(c_MAX_CHANNELS, cands.size() - first));
+        for (unsigned l = 0; l < num; l++)
+          ptrs[l] = &cands[first + l];
+        w.evaluate(ptrs, num);
+      }
+    };
+    std::vector<std::thread> th;
+    for (unsigned t = 1; t < nth; t++)
+      th.emplace_back(work, std::ref(*workers[t]));
+    work(*workers[0]);
+    for (std::thread &t: th)
+      t.join();
+  };
+
+  shaper_explore_result res;
+  std::vector<shaper_candidate> cands(1);
+  cands[0].biquads = given;
+  evaluate(cands);
+  res.given = cands[0];
+
+  // Keeps the first of equally good candidates, so the result doesn't depend
+  // on the evaluation order
+  bool have_best = false;
+  auto take_best = [&](const std::vector<shaper_candidate> &cs) {
+    for (const shaper_candidate &c: cs)
+      if (!have_best || ctx.better(c.metrics, res.best.metrics)) {
+        res.best = c;
+        have_best = true;
+      }
+    res.evaluated += cs.size();
+  };
+
+  const unsigned n = ctx.n;
+  std::vector<unsigned> ident(n);
+  for (unsigned i = 0; i < n; i++)
+    ident[i] = i;
+  const double space = double(factorial(n)) * factorial(n);
+
+  if (space <= double(cfg.max_candidates)) {
+    res.exhaustive = true;
+    cands.clear();
+    std::vector<unsigned> pairing = ident;
+    do {
+      std::vector<unsigned> order = ident;
+      do {
+        shaper_candidate c;
+        c.pairing = pairing;
+        c.order = order;
+        cands.push_back(c);
+      } while (std::next_permutation(order.begin(), order.end()));
+    } while (std::next_permutation(pairing.begin(), pairing.end()));
+    evaluate(cands);
+    take_best(cands);
+    return res;
+  }
+
+  // Starting points: poles closest to the unit circle first, each with the
+  // nearest free zero section, cascaded by increasing then decreasing radius
+  std::vector<unsigned> by_radius = ident;
+  std::stable_sort(by_radius.begin(), by_radius.end(), [&](unsigned a, unsigned b) {
+    return ctx.ps[a].radius > ctx.ps[b].radius;
+  });
+  std::vector<unsigned> heur_pairing(n);
+  std::vector<bool> used(n, false);
+  for (unsigned p: by_radius) {
+    unsigned best_z = n;
+    double best_dist = INFINITY;
+    for (unsigned z = 0; z < n; z++) {
+      if (used[z])
+        continue;
+      const double dist = ctx.ps[p].empty || ctx.zs[z].empty ? HUGE_VAL / 2 :
+                          std::abs(ctx.ps[p].root - ctx.zs[z].root);
+      if (best_z == n || dist < best_dist) {
+        best_z = z;
+        best_dist = dist;
+      }
+    }
+    used[best_z] = true;
+    heur_pairing[p] = best_z;
+  }
+  std::vector<std::pair<std::vector<unsigned>, std::vector<unsigned>>> starts = {
+    {heur_pairing, std::vector<unsigned>(by_radius.rbegin(), by_radius.rend())},
+    {heur_pairing, by_radius},
+  };
+
+  std::set<std::vector<unsigned>> visited;
+  auto key = [](const shaper_candidate &c) {
+    std::vector<unsigned> k = c.pairing;
+    k.insert(k.end(), c.order.begin(), c.order.end());
+    return k;
+  };
+  uint64_t rng = 1;
+  for (size_t s = 0; res.evaluated < cfg.max_candidates; s++) {
+    shaper_candidate cur;
+    if (s < starts.size()) {
+      cur.pairing = starts[s].first;
+      cur.order = starts[s].second;
+    } else {
+      cur.pairing = cur.order = ident;
+      for (unsigned i = n - 1; i > 0; i--) {
+        std::swap(cur.pairing[i], cur.pairing[splitmix64(rng) % (i + 1)]);
+        std::swap(cur.order[i], cur.order[splitmix64(rng) % (i + 1)]);
+      }
+    }
+    if (!visited.insert(key(cur)).second)
+      continue;
+    cands.assign(1, cur);
+    evaluate(cands);
+    take_best(cands);
+    cur = cands[0];
+
+    // Hill climbing over the swaps of two pairings or two positions
+    while (res.evaluated < cfg.max_candidates) {
+      cands.clear();
+      for (unsigned i = 0; i < n; i++) {
+        for (unsigned j = i + 1; j < n; j++) {
+          for (int what = 0; what < 2; what++) {
+            shaper_candidate c;
+            c.pairing = cur.pairing;
+            c.order = cur.order;
+            std::vector<unsigned> &v = what ? c.order : c.pairing;
+            std::swap(v[i], v[j]);
+            if (!visited.count(key(c)))
+              cands.push_back(c);
+          }
+        }
+      }
+      cands.resize(std::min(cands.size(), cfg.max_candidates - res.evaluated));
+      if (cands.empty())
+        break;
+      for (const shaper_candidate &c: cands)
+        visited.insert(key(c));
+      evaluate(cands);
+      take_best(cands);
+
+      const shaper_candidate *next = &cur;
+      for (const shaper_candidate &c: cands)
+        if (ctx.better(c.metrics, next->metrics))
+          next = &c;
+      if (next == &cur)
+        break;
+      cur = *next;
+    }
+  }
+  return res;
+}
+
+} // namespace fofb
@@ -0,0 +1,140 @@
+// Fixed-point realization search for fofb_shaper_filt filter designs
+//
+// A filter given as a cascade of biquads (the fofb_shaper_filt_coeffs.dat
+// format) is factored into its gain, zeros and poles, which are regrouped
+// into second order sections: each complex conjugate pair is a section, real
+// roots are paired by decreasing value. How the zero sections are paired with
+// the pole sections and in which order the sections are cascaded doesn't
+// change the ideal response, but it does change the quantized one, the
+// roundoff noise and, since the gateware biquads are Direct Form II, the
+// internal state levels: a high-Q pole pair overflows unless the sections
+// before it attenuate its resonance.
+//
+// For each candidate pairing and ordering the gain is spread over the
+// sections with L-infinity scaling (each partial cascade peaks at unity gain,
+// within the coefficients' range, the last section taking the rest), the
+// coefficients are quantized as coeff_to_reg() does and the candidate is
+// rated by:
+//   - its internal saturations, counted by the fixed-point
+//     fofb_shaper_filt_model (see there how far it matches the gateware) on
+//     a full-scale step and chirp, 12 candidates at once (one per model
+//     channel);
+//   - the RMS difference between the model output and the ideal filter's on
+//     the same stimulus, in set-point LSBs (sim);
+//   - the largest relative error of the quantized frequency response on a
+//     uniform grid, evaluated over whole arrays of frequency points (resp);
+//   - the roundoff noise at the output, from the noise gain of each rounding
+//     point on the same grid, in set-point LSBs (noise).
+// Candidates with fewer saturations win, then the lower chosen metric.
+//
+// Every pairing and ordering is tried when there are at most
+// 'max_candidates' of them ((n!)^2 for n sections: 576 for 4). Otherwise a
+// local search (swapping two pairings or two positions at a time) starts from
+// the usual heuristic (poles closest to the unit circle paired first with
+// their nearest zeros, cascaded in increasing or decreasing pole radius) and
+// from random restarts, until 'max_candidates' have been evaluated.
+// Candidates are evaluated by worker threads; the result doesn't depend on
+// their number.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_SHAPER_DESIGN_H_
+#define FOFB_SHAPER_DESIGN_H_
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_shaper_filt_model.h"
+
+namespace fofb {
+
+// b0, b1, b2, a1 and a2 (a0 = 1)
+using biquad_coeffs = std::array<double, 5>;
+
+struct shaper_design {
+  double gain = 1;
+  // Complex roots are listed once, with a positive imaginary part
+  std::vector<std::complex<double>> zeros;
+  std::vector<std::complex<double>> poles;
+};
+
+// Factor a cascade; biquads with b0 = 0 (pure delays) aren't supported
+shaper_design shaper_design_from_biquads(const std::vector<biquad_coeffs> &biquads);
+
+enum class shaper_metric {
+  sim,
+  resp,
+  noise,
+};
+
+struct shaper_explore_config {
+  // Worker threads, 0 for one per CPU
+  unsigned threads = 0;
+  // Frequency points, uniform from 0 to the Nyquist frequency
+  unsigned grid_points = 4096;
+  size_t max_candidates = 20000;
+  shaper_metric metric = shaper_metric::sim;
+  // Stimulus: a full-scale positive then negative step of 'step_len'
+  // timeframes each, then a full-scale linear chirp from 0 to the Nyquist
+  // frequency in 'chirp_len' timeframes
+  unsigned step_len = 1024;
+  unsigned chirp_len = 8192;
+};
+
+struct shaper_quant_metrics {
+  uint64_t saturations = 0;
+  double sim_err_rms = 0;
+  double resp_err = 0;
+  double noise_rms = 0;
+};
+
+struct shaper_candidate {
+  // pairing[p] is the zero section paired with pole section p, order[i] the
+  // pole section at position i of the cascade. Empty for the given cascade.
+  std::vector<unsigned> pairing;
+  std::vector<unsigned> order;
+  // Cascade, before quantization
+  std::vector<biquad_coeffs> biquads;
+  shaper_quant_metrics metrics;
+};
+
+struct shaper_explore_result {
+  // The input cascade as is
+  shaper_candidate given;
+  shaper_candidate best;
+  size_t evaluated = 0;
+  bool exhaustive = false;
+};
+
+class shaper_explorer {
+ public:
+  // 'gen' gives the number of biquads and the fixed-point formats; its
+  // 'channels' is ignored
+  explicit shaper_explorer(const fofb_shaper_filt_generics &gen,
+                           const shaper_explore_config &cfg = {});
+
+  // Search the realizations of the first 'num_biquads' biquads of 'given'.
+  // The best cascade has at most 'num_biquads' biquads.
+  shaper_explore_result explore(const std::vector<biquad_coeffs> &given) const;
+
+  // Fill the biquads of channel 'ch' of a model with a cascade, the biquads
+  // beyond it with b0 = 1
+  static void load_cascade(fofb_shaper_filt_model &model, unsigned ch,
+                           const std::vector<biquad_coeffs> &biquads);
+
+ private:
+  struct context;
+  struct section;
+  class worker;
+
+  fofb_shaper_filt_generics gen;
+  shaper_explore_config cfg;
+};
+
+} // namespace fofb
+
+#endif // FOFB_SHAPER_DESIGN_H_
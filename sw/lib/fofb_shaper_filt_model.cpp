@@ -0,0 +1,287 @@
+// Fixed-point software model of the xwb_fofb_shaper_filt gateware
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "fofb_fixed_point.h"
+#include "fofb_shaper_filt_model.h"
+
+namespace fofb {
+
+namespace {
+
+// c_SP_WIDTH
+constexpr unsigned c_SP_WIDTH = 16;
+
+// iir_filt x_i / y_o fractionary width (SFIXED needs at least one
+// fractionary bit)
+constexpr unsigned c_X_Y_FRAC_WIDTH = 1;
+
+} // namespace
+
+void fofb_shaper_filt_generics::from_regs(const wb_fofb_shaper_filt_regs &regs)
+{
+  num_biquads = regs.num_biquads;
+  coeff_int_width = (regs.coeffs_fp_repr & WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_INT_WIDTH_MASK) >>
+                    WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_INT_WIDTH_SHIFT;
+  coeff_frac_width = (regs.coeffs_fp_repr & WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_FRAC_WIDTH_MASK) >>
+                     WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_FRAC_WIDTH_SHIFT;
+}
+
+fofb_shaper_filt_model::fofb_shaper_filt_model(const fofb_shaper_filt_generics &g):
+  gen(g)
+{
+  coeff_width = gen.coeff_int_width + gen.coeff_frac_width;
+  ifc_frac_width = c_X_Y_FRAC_WIDTH + gen.ifcs_extra_bits;
+  ifc_width = c_SP_WIDTH + c_X_Y_FRAC_WIDTH + 2 * gen.ifcs_extra_bits;
+  w_frac_width = ifc_frac_width + gen.arith_extra_bits;
+  w_width = ifc_width + 2 * gen.arith_extra_bits;
+
+  if (gen.channels == 0 || gen.channels > c_MAX_CHANNELS)
+    throw std::invalid_argument("unsupported number of channels");
+  if (gen.num_biquads > c_SHAPER_FILT_MAX_BIQUADS)
+    throw std::invalid_argument("ABI supports up to 10 biquads");
+  if (gen.coeff_int_width < 1 || gen.coeff_frac_width < 1 || coeff_width > 32)
+    throw std::invalid_argument("unsupported coefficients' fixed-point "
+                                "representation");
+  // Keeps every biquad sum exactly representable in a double
+  if (coeff_width + w_width > 53)
+    throw std::invalid_argument("biquad arithmetic too wide");
+
+  std::memset(coeffs, 0, sizeof(coeffs));
+  std::memset(coeffs_d, 0, sizeof(coeffs_d));
+  reset();
+  clear_saturations();
+}
+
+void fofb_shaper_filt_model::reset()
+{
+  std::memset(w1, 0, sizeof(w1));
+  std::memset(w2, 0, sizeof(w2));
+  std::memset(w1_d, 0, sizeof(w1_d));
+  std::memset(w2_d, 0, sizeof(w2_d));
+}
+
+uint64_t fofb_shaper_filt_model::saturations(unsigned ch) const
+{
+  return sat[ch] + uint64_t(sat_d[ch]);
+}
+
+void fofb_shaper_filt_model::clear_saturations()
+{
+  std::memset(sat, 0, sizeof(sat));
+  std::memset(sat_d, 0, sizeof(sat_d));
+}
+
+void fofb_shaper_filt_model::set_force_scalar(bool force)
+{
+  if (force == force_scalar)
+    return;
+  force_scalar = force;
+#ifdef __AVX2__
+  // Without AVX2 the sequential path is always used, there's nothing to sync
+  for (unsigned k = 0; k < c_SHAPER_FILT_MAX_BIQUADS; k++) {
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      if (force) {
+        w1[k][ch] = int64_t(w1_d[k][ch]);
+        w2[k][ch] = int64_t(w2_d[k][ch]);
+      } else {
+        w1_d[k][ch] = double(w1[k][ch]);
+        w2_d[k][ch] = double(w2[k][ch]);
+      }
+    }
+  }
+#endif
+}
+
+uint32_t fofb_shaper_filt_model::coeff_to_reg(double coeff) const
+{
+  const double val = std::nearbyint(std::ldexp(coeff, int(gen.coeff_frac_width)));
+  const int64_t fp = val >= double(fp_max(coeff_width)) ? fp_max(coeff_width) :
+                     val <= double(fp_min(coeff_width)) ? fp_min(coeff_width) :
+                     int64_t(val);
+  return uint32_t(uint64_t(fp) << (32 - coeff_width));
+}
+
+void fofb_shaper_filt_model::set_coeff(unsigned ch, unsigned idx, uint32_t val)
+{
+  const unsigned biquad = idx / c_SHAPER_FILT_COEFFS_PER_BIQUAD;
+  const unsigned k = idx % c_SHAPER_FILT_COEFFS_PER_BIQUAD;
+  // Writes to non-instantiated biquads or unused words are discarded
+  if (ch >= gen.channels || biquad >= gen.num_biquads || k >= NUM_COEFFS)
+    return;
+  const int64_t coeff = fp_left_aligned(val, coeff_width);
+  coeffs[k][biquad][ch] = coeff;
+  coeffs_d[k][biquad][ch] = double(coeff);
+}
+
+void fofb_shaper_filt_model::load_regs(const wb_fofb_shaper_filt_regs &regs)
+{
+  for (unsigned ch = 0; ch < gen.channels; ch++)
+    for (unsigned i = 0; i < c_SHAPER_FILT_MAX_BIQUADS * c_SHAPER_FILT_COEFFS_PER_BIQUAD; i++)
+      set_coeff(ch, i, regs.ch[ch].coeffs[i].val);
+}
+
+void fofb_shaper_filt_model::store_regs(wb_fofb_shaper_filt_regs &regs) const
+{
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    for (unsigned i = 0; i < c_SHAPER_FILT_MAX_BIQUADS * c_SHAPER_FILT_COEFFS_PER_BIQUAD; i++) {
+      const unsigned biquad = i / c_SHAPER_FILT_COEFFS_PER_BIQUAD;
+      const unsigned k = i % c_SHAPER_FILT_COEFFS_PER_BIQUAD;
+      regs.ch[ch].coeffs[i].val =
+        (ch < gen.channels && biquad < gen.num_biquads && k < NUM_COEFFS) ?
+        uint32_t(uint64_t(coeffs[k][biquad][ch]) << (32 - coeff_width)) : 0;
+    }
+  }
+  regs.num_biquads = gen.num_biquads;
+  regs.coeffs_fp_repr =
+    (gen.coeff_int_width << WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_INT_WIDTH_SHIFT) |
+    (gen.coeff_frac_width << WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_FRAC_WIDTH_SHIFT);
+}
+
+template <bool SAT>
+void fofb_shaper_filt_model::process_seq(const int16_t *sp, size_t n_tf,
+                                         int16_t *filt_sp)
+{
+  const unsigned u_shift = gen.coeff_frac_width + w_frac_width - ifc_frac_width;
+  // Signed values are scaled by multiplying, shifting negative ones left is UB
+  const int64_t u_scale = int64_t(1) << u_shift;
+
+  for (size_t tf = 0; tf < n_tf; tf++, sp += c_MAX_CHANNELS, filt_sp += c_MAX_CHANNELS) {
+    for (unsigned ch = 0; ch < gen.channels; ch++) {
+      // x_i is sfixed(15 downto -1), widening it to the interface is exact
+      int64_t u = int64_t(sp[ch]) * (int64_t(1) << ifc_frac_width);
+
+      for (unsigned k = 0; k < gen.num_biquads; k++) {
+        // w[n] = x[n] - a1*w[n-1] - a2*w[n-2]
+        const int64_t w_r = fp_round(u * u_scale - coeffs[A1][k][ch] * w1[k][ch] -
+                                     coeffs[A2][k][ch] * w2[k][ch],
+                                     gen.coeff_frac_width);
+        const int64_t w = fp_saturate(w_r, w_width);
+        // y[n] = b0*w[n] + b1*w[n-1] + b2*w[n-2]
+        const int64_t y = coeffs[B0][k][ch] * w + coeffs[B1][k][ch] * w1[k][ch] +
+                          coeffs[B2][k][ch] * w2[k][ch];
+        w2[k][ch] = w1[k][ch];
+        w1[k][ch] = w;
+        const int64_t u_r = fp_round(y, u_shift);
+        u = fp_saturate(u_r, ifc_width);
+        if (SAT)
+          sat[ch] += (w != w_r) + (u != u_r);
+      }
+
+      // y_o is sfixed(15 downto -1), the extra interface bits are truncated;
+      // then to_signed()
+      const int64_t y = fp_resize_trunc(u, ifc_frac_width - c_X_Y_FRAC_WIDTH,
+                                        c_SP_WIDTH + c_X_Y_FRAC_WIDTH);
+      filt_sp[ch] = int16_t(fp_resize(y, c_X_Y_FRAC_WIDTH, c_SP_WIDTH));
+    }
+  }
+}
+
+template <bool SAT>
+void fofb_shaper_filt_model::process_vec(const int16_t *sp, size_t n_tf,
+                                         int16_t *filt_sp)
+{
+#ifdef __AVX2__
+  static_assert(c_MAX_CHANNELS % 4 == 0, "channels must fill whole vectors");
+  constexpr int c_ROUND = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+  const unsigned u_shift = gen.coeff_frac_width + w_frac_width - ifc_frac_width;
+
+  const __m256d x_scale = _mm256_set1_pd(std::ldexp(1.0, int(ifc_frac_width)));
+  const __m256d u_scale = _mm256_set1_pd(std::ldexp(1.0, int(u_shift)));
+  const __m256d w_scale = _mm256_set1_pd(std::ldexp(1.0, -int(gen.coeff_frac_width)));
+  const __m256d y_scale = _mm256_set1_pd(std::ldexp(1.0, -int(u_shift)));
+  const __m256d o_scale = _mm256_set1_pd(
+    std::ldexp(1.0, -int(ifc_frac_width - c_X_Y_FRAC_WIDTH)));
+  const __m256d sp_scale = _mm256_set1_pd(std::ldexp(1.0, -int(c_X_Y_FRAC_WIDTH)));
+  const __m256d w_max = _mm256_set1_pd(double(fp_max(w_width)));
+  const __m256d w_min = _mm256_set1_pd(double(fp_min(w_width)));
+  const __m256d ifc_max = _mm256_set1_pd(double(fp_max(ifc_width)));
+  const __m256d ifc_min = _mm256_set1_pd(double(fp_min(ifc_width)));
+  const __m256d o_max = _mm256_set1_pd(double(fp_max(c_SP_WIDTH + c_X_Y_FRAC_WIDTH)));
+  const __m256d o_min = _mm256_set1_pd(double(fp_min(c_SP_WIDTH + c_X_Y_FRAC_WIDTH)));
+  const __m256d sp_max = _mm256_set1_pd(double(fp_max(c_SP_WIDTH)));
+  const __m256d sp_min = _mm256_set1_pd(double(fp_min(c_SP_WIDTH)));
+  const __m256d one = _mm256_set1_pd(1);
+
+  for (size_t tf = 0; tf < n_tf; tf++, sp += c_MAX_CHANNELS, filt_sp += c_MAX_CHANNELS) {
+    for (unsigned ch = 0; ch < gen.channels; ch += 4) {
+      const __m128i x = _mm_cvtepi16_epi32(
+        _mm_loadl_epi64(reinterpret_cast<const __m128i *>(sp + ch)));
+      __m256d u = _mm256_mul_pd(_mm256_cvtepi32_pd(x), x_scale);
+      __m256d satv = SAT ? _mm256_load_pd(&sat_d[ch]) : _mm256_setzero_pd();
+
+      for (unsigned k = 0; k < gen.num_biquads; k++) {
+        const __m256d w1v = _mm256_load_pd(&w1_d[k][ch]);
+        const __m256d w2v = _mm256_load_pd(&w2_d[k][ch]);
+
+        // Every operand is an integer and every sum fits in 53 bits, so the
+        // double arithmetic is exact; scaling by powers of two is exact too
+        __m256d acc = _mm256_mul_pd(u, u_scale);
+        acc = _mm256_sub_pd(acc, _mm256_mul_pd(_mm256_load_pd(&coeffs_d[A1][k][ch]), w1v));
+        acc = _mm256_sub_pd(acc, _mm256_mul_pd(_mm256_load_pd(&coeffs_d[A2][k][ch]), w2v));
+        const __m256d w_r = _mm256_round_pd(_mm256_mul_pd(acc, w_scale), c_ROUND);
+        const __m256d w = _mm256_min_pd(_mm256_max_pd(w_r, w_min), w_max);
+
+        __m256d y = _mm256_mul_pd(_mm256_load_pd(&coeffs_d[B0][k][ch]), w);
+        y = _mm256_add_pd(y, _mm256_mul_pd(_mm256_load_pd(&coeffs_d[B1][k][ch]), w1v));
+        y = _mm256_add_pd(y, _mm256_mul_pd(_mm256_load_pd(&coeffs_d[B2][k][ch]), w2v));
+
+        _mm256_store_pd(&w2_d[k][ch], w1v);
+        _mm256_store_pd(&w1_d[k][ch], w);
+
+        const __m256d u_r = _mm256_round_pd(_mm256_mul_pd(y, y_scale), c_ROUND);
+        u = _mm256_min_pd(_mm256_max_pd(u_r, ifc_min), ifc_max);
+        if (SAT) {
+          satv = _mm256_add_pd(satv, _mm256_and_pd(_mm256_cmp_pd(w, w_r, _CMP_NEQ_OQ), one));
+          satv = _mm256_add_pd(satv, _mm256_and_pd(_mm256_cmp_pd(u, u_r, _CMP_NEQ_OQ), one));
+        }
+      }
+      if (SAT)
+        _mm256_store_pd(&sat_d[ch], satv);
+
+      __m256d o = _mm256_floor_pd(_mm256_mul_pd(u, o_scale));
+      o = _mm256_min_pd(_mm256_max_pd(o, o_min), o_max);
+      o = _mm256_round_pd(_mm256_mul_pd(o, sp_scale), c_ROUND);
+      o = _mm256_min_pd(_mm256_max_pd(o, sp_min), sp_max);
+
+      const __m128i o32 = _mm256_cvtpd_epi32(o);
+      int16_t out[8];
+      _mm_storeu_si128(reinterpret_cast<__m128i *>(out), _mm_packs_epi32(o32, o32));
+      // The last vector may cover channels beyond g_CHANNELS
+      for (unsigned i = 0; i < 4 && ch + i < gen.channels; i++)
+        filt_sp[ch + i] = out[i];
+    }
+  }
+#else
+  process_seq<SAT>(sp, n_tf, filt_sp);
+#endif
+}
+
+void fofb_shaper_filt_model::process(const int16_t *sp, size_t n_tf,
+                                     int16_t *filt_sp)
+{
+#ifdef __AVX2__
+  const bool vec = !force_scalar;
+#else
+  const bool vec = false;
+#endif
+  if (vec && count_sat)
+    process_vec<true>(sp, n_tf, filt_sp);
+  else if (vec)
+    process_vec<false>(sp, n_tf, filt_sp);
+  else if (count_sat)
+    process_seq<true>(sp, n_tf, filt_sp);
+  else
+    process_seq<false>(sp, n_tf, filt_sp);
+}
+
+} // namespace fofb
@@ -0,0 +1,143 @@
+// Fixed-point software model of the xwb_fofb_shaper_filt gateware
+//
+// Each channel is an iir_filt: a cascade of 'num_biquads' Direct Form II
+// biquads (a0 = 1). Set-points enter as sfixed(15 downto -1), the interfaces
+// between biquads carry g_IFCS_EXTRA_BITS extra integer and fractionary bits,
+// the biquads' internal state carries g_ARITH_EXTRA_BITS more on top of that
+// and the output is converted back to a 16 bits set-point. Every resize
+// saturates and rounds to the nearest (ties to even), the fixed_pkg defaults,
+// except for y_o, which truncates the extra interface bits.
+//
+// The iir_filt sources aren't part of this repository: the internal widths
+// follow the generics' documentation, and the model was only checked against
+// the fofb_shaper_filt testbench vectors, which come from a floating point
+// reference, within their 5% tolerance. It isn't known to be bit-exact.
+//
+// All channels are filtered at once with the state kept as structure of
+// arrays, each channel in a SIMD lane. The vector path carries the integers
+// in doubles (exact, since the widest sum stays below 53 bits) so that AVX2
+// can round and saturate them; the sequential path uses 64 bits integers and
+// serves as reference.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_SHAPER_FILT_MODEL_H_
+#define FOFB_SHAPER_FILT_MODEL_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "fofb_regs.h"
+
+namespace fofb {
+
+// c_MAX_ABI_BIQUADS: the register interface supports up to 20th order filters
+constexpr unsigned c_SHAPER_FILT_MAX_BIQUADS = 10;
+
+// Coefficients RAM words reserved for each biquad (b0, b1, b2, a1, a2 and 3
+// unused words)
+constexpr unsigned c_SHAPER_FILT_COEFFS_PER_BIQUAD = 8;
+
+// xwb_fofb_shaper_filt generics. Default values match the ones used by
+// afc_ref_fofb_ctrl_gen.
+struct fofb_shaper_filt_generics {
+  // g_NUM_BIQUADS
+  unsigned num_biquads = 4;
+
+  // g_COEFF_INT_WIDTH / g_COEFF_FRAC_WIDTH
+  unsigned coeff_int_width = 2;
+  unsigned coeff_frac_width = 16;
+
+  // g_ARITH_EXTRA_BITS
+  unsigned arith_extra_bits = 0;
+
+  // g_IFCS_EXTRA_BITS
+  unsigned ifcs_extra_bits = 4;
+
+  // g_CHANNELS
+  unsigned channels = c_MAX_CHANNELS;
+
+  // Update the number of biquads and the coefficients widths from the
+  // read-only num_biquads and coeffs_fp_repr registers, the extra bits
+  // aren't exposed by the gateware
+  void from_regs(const wb_fofb_shaper_filt_regs &regs);
+};
+
+class fofb_shaper_filt_model {
+ public:
+  explicit fofb_shaper_filt_model(const fofb_shaper_filt_generics &gen = {});
+
+  // Load every channel's coefficients from a register image
+  void load_regs(const wb_fofb_shaper_filt_regs &regs);
+
+  // Fill a register image with the current coefficients, as read back from
+  // the gateware (truncated to the coefficients' width, with
+  // non-instantiated biquads and unused words read as zero), and the
+  // read-only registers
+  void store_regs(wb_fofb_shaper_filt_regs &regs) const;
+
+  // Write coefficients RAM word 'idx' of channel 'ch', value as written to
+  // the register (left aligned)
+  void set_coeff(unsigned ch, unsigned idx, uint32_t val);
+
+  // Convert a real coefficient to its register value, saturating to the
+  // coefficients' range as to_sfixed() does
+  uint32_t coeff_to_reg(double coeff) const;
+
+  // Clear the biquads' state, as rst_n_i = '0'
+  void reset();
+
+  // Filter 'n_tf' timeframes. 'sp' and 'filt_sp' hold c_MAX_CHANNELS
+  // set-points per timeframe (channels beyond g_CHANNELS are ignored) and
+  // may alias.
+  void process(const int16_t *sp, size_t n_tf, int16_t *filt_sp);
+
+  // Force the sequential (non-vectorized) path, used for testing. The
+  // filters' state carries over.
+  void set_force_scalar(bool force);
+
+  // Count, per channel, the samples saturated by the biquads' internal state
+  // and interface resizes (not by the output conversion), off by default
+  void set_count_saturations(bool count) { count_sat = count; }
+  uint64_t saturations(unsigned ch) const;
+  void clear_saturations();
+
+  const fofb_shaper_filt_generics &generics() const { return gen; }
+
+ private:
+  // Per biquad, per channel arrays, so that all channels of a biquad are
+  // contiguous
+  template <typename T>
+  using biquad_arr = T[c_SHAPER_FILT_MAX_BIQUADS][c_MAX_CHANNELS];
+
+  enum { B0, B1, B2, A1, A2, NUM_COEFFS };
+
+  template <bool SAT>
+  void process_seq(const int16_t *sp, size_t n_tf, int16_t *filt_sp);
+  template <bool SAT>
+  void process_vec(const int16_t *sp, size_t n_tf, int16_t *filt_sp);
+
+  fofb_shaper_filt_generics gen;
+  unsigned coeff_width;
+  unsigned ifc_frac_width;
+  unsigned ifc_width;
+  unsigned w_frac_width;
+  unsigned w_width;
+  bool force_scalar = false;
+  bool count_sat = false;
+
+  alignas(32) biquad_arr<int64_t> coeffs[NUM_COEFFS];
+  alignas(32) biquad_arr<int64_t> w1, w2;
+
+  alignas(32) biquad_arr<double> coeffs_d[NUM_COEFFS];
+  alignas(32) biquad_arr<double> w1_d, w2_d;
+
+  // Saturations counted by each path
+  uint64_t sat[c_MAX_CHANNELS];
+  alignas(32) double sat_d[c_MAX_CHANNELS];
+};
+
+} // namespace fofb
+
+#endif // FOFB_SHAPER_FILT_MODEL_H_
@@ -0,0 +1,440 @@
+// Decimated set-points acquisition
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "fofb_processing_model.h"
+#include "fofb_sp_decim_acq.h"
+
+namespace fofb {
+
+namespace {
+
+using proc_regs = regs::wb_fofb_processing_regs;
+
+template <size_t... I>
+constexpr std::array<size_t, sizeof...(I)> sp_decim_data_addrs(std::index_sequence<I...>)
+{
+  return {proc_regs::ch<I>::sp_decim::data::reg_addr...};
+}
+
+template <size_t... I>
+constexpr std::array<size_t, sizeof...(I)> sp_decim_ratio_addrs(std::index_sequence<I...>)
+{
+  return {proc_regs::ch<I>::sp_decim::ratio::reg_addr...};
+}
+
+constexpr auto c_DATA_ADDRS = sp_decim_data_addrs(std::make_index_sequence<c_MAX_CHANNELS>());
+constexpr auto c_RATIO_ADDRS = sp_decim_ratio_addrs(std::make_index_sequence<c_MAX_CHANNELS>());
+
+// Samples moved from the ring to the file at once
+constexpr size_t c_DRAIN_BATCH = 1024;
+
+// Half width of the window read around an expected update, as a fraction of
+// the period, at least c_WINDOW_MIN_NS and at most a quarter of the period
+constexpr double c_WINDOW_FRACTION = 1. / 32;
+constexpr double c_WINDOW_MIN_NS = 20000;
+
+// Fraction of the error on a measured update time corrected on the period,
+// and the largest correction, relative to the nominal period
+constexpr double c_PERIOD_GAIN = 1. / 8;
+constexpr double c_MAX_DRIFT = 1e-3;
+
+// Writer thread sleep when the ring is empty
+constexpr auto c_WRITER_IDLE = std::chrono::milliseconds(1);
+
+} // namespace
+
+sp_decim_writer::sp_decim_writer(const std::string &fn):
+  fname(fn)
+{
+  // Writes always go to the end of the file, reads are used to check the
+  // header of an existing file
+  f = std::fopen(fname.c_str(), "ab+");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+  std::setvbuf(f, nullptr, _IOFBF, 1 << 20);
+
+  std::fseek(f, 0, SEEK_END);
+  if (std::ftell(f) == 0) {
+    sp_decim_file_header hdr;
+    std::memcpy(hdr.magic, c_SP_DECIM_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = c_SP_DECIM_FILE_VERSION;
+    hdr.record_size = sizeof(sp_decim_record);
+    if (std::fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+      std::fclose(f);
+      throw std::runtime_error(fname + ": write error");
+    }
+  } else {
+    sp_decim_file_header hdr;
+    std::fseek(f, 0, SEEK_SET);
+    if (std::fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        std::memcmp(hdr.magic, c_SP_DECIM_FILE_MAGIC, sizeof(hdr.magic)) ||
+        hdr.version != c_SP_DECIM_FILE_VERSION ||
+        hdr.record_size != sizeof(sp_decim_record)) {
+      std::fclose(f);
+      throw std::runtime_error(fname + ": not a decimated set-points file");
+    }
+
+    // A record torn by a crash would misalign all the ones appended after
+    // it, it's cut off
+    std::fseek(f, 0, SEEK_END);
+    const long size = std::ftell(f);
+    const long whole = sizeof(hdr) + (size - long(sizeof(hdr))) /
+                       long(sizeof(sp_decim_record)) * long(sizeof(sp_decim_record));
+    if (whole != size && ftruncate(fileno(f), whole)) {
+      std::fclose(f);
+      throw std::runtime_error(fname + ": can't cut off a torn record");
+    }
+    std::fseek(f, 0, SEEK_END);
+  }
+}
+
+sp_decim_writer::~sp_decim_writer()
+{
+  std::fclose(f);
+}
+
+void sp_decim_writer::write(const sp_decim_record *recs, size_t n)
+{
+  if (std::fwrite(recs, sizeof(*recs), n, f) != n)
+    throw std::runtime_error(fname + ": write error");
+  num_records += n;
+}
+
+void sp_decim_writer::flush()
+{
+  if (std::fflush(f))
+    throw std::runtime_error(fname + ": write error");
+}
+
+std::vector<sp_decim_record> read_sp_decim_file(const std::string &fname)
+{
+  FILE *f = std::fopen(fname.c_str(), "rb");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+
+  sp_decim_file_header hdr;
+  if (std::fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+      std::memcmp(hdr.magic, c_SP_DECIM_FILE_MAGIC, sizeof(hdr.magic)) ||
+      hdr.version != c_SP_DECIM_FILE_VERSION ||
+      hdr.record_size != sizeof(sp_decim_record)) {
+    std::fclose(f);
+    throw std::runtime_error(fname + ": not a decimated set-points file");
+  }
+
+  std::vector<sp_decim_record> recs;
+  sp_decim_record buf[c_DRAIN_BATCH];
+  size_t n;
+  while ((n = std::fread(buf, sizeof(buf[0]), c_DRAIN_BATCH, f)) > 0)
+    recs.insert(recs.end(), buf, buf + n);
+  std::fclose(f);
+  return recs;
+}
+
+sp_decim_acq::sp_decim_acq(mmap_device &d, size_t b, const sp_decim_acq_config &c):
+  dev(d),
+  base(b),
+  blk(d, b),
+  cfg(c),
+  ring(c.ring_size)
+{
+  if (cfg.channels == 0 || cfg.channels > c_MAX_CHANNELS)
+    throw std::invalid_argument("unsupported number of channels");
+  if (!(cfg.tf_rate_hz > 0))
+    throw std::invalid_argument("invalid timeframe rate");
+  if (dev.size() < base + sizeof(wb_fofb_processing_regs))
+    throw std::invalid_argument("device window smaller than wb_fofb_processing_regs");
+}
+
+sp_decim_acq::~sp_decim_acq()
+{
+  try {
+    stop();
+  } catch (const std::exception &) {
+    // A write error not collected by stop(), the threads are joined anyway
+  }
+}
+
+void sp_decim_acq::configure(uint64_t now)
+{
+  const uint32_t ratio_max = blk.read<proc_regs::sp_decim_ratio_max>();
+  epoch_offset_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count() - int64_t(now_ns());
+
+  for (unsigned ch = 0; ch < cfg.channels; ch++) {
+    channel &c = chs[ch];
+    c.data_addr = base + c_DATA_ADDRS[ch];
+    c.ratio = sp_decim_ratio_eff(dev.read32(base + c_RATIO_ADDRS[ch]), ratio_max);
+    c.period_ns = (c.ratio + 1) * 1e9 / cfg.tf_rate_hz;
+    c.est_period_ns = c.period_ns;
+    c.window_ns = std::min(std::max(c.period_ns * c_WINDOW_FRACTION, c_WINDOW_MIN_NS),
+                           c.period_ns / 4);
+    c.next_edge_ns = now + c.period_ns;
+    c.search_end_ns = now + uint64_t(c.period_ns + c.window_ns);
+    c.read_ns = now;
+    c.val = 0;
+    c.have_val = false;
+    c.searching = true;
+    c.locked = false;
+    c.edge_ns = now;
+    c.edge_known = false;
+    c.seen = false;
+    c.seq = 0;
+    c.started = false;
+  }
+}
+
+bool sp_decim_acq::sample(unsigned ch, int32_t val, double edge, uint64_t now, uint8_t flags)
+{
+  channel &c = chs[ch];
+  uint64_t seq = 0;
+  if (!c.started) {
+    flags |= SP_DECIM_REC_START;
+  } else {
+    const uint64_t n = std::max<long long>(1, std::llround((edge - c.edge_ns) /
+                                                           c.est_period_ns));
+    seq = c.seq + n;
+    if (n > 1) {
+      flags |= SP_DECIM_REC_GAP;
+      n_missed.store(n_missed.load(std::memory_order_relaxed) + (n - 1),
+                     std::memory_order_relaxed);
+    }
+  }
+  // Only the polling side writes the counters
+  if (flags & SP_DECIM_REC_AMBIGUOUS)
+    n_ambiguous.store(n_ambiguous.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_relaxed);
+  c.started = true;
+  c.edge_ns = edge;
+  c.seq = seq;
+
+  const uint64_t latency = now > edge ? uint64_t(now - edge) : 0;
+  sp_decim_record rec;
+  rec.t_ns = now + epoch_offset_ns;
+  rec.seq = uint32_t(seq);
+  rec.val = val;
+  rec.latency_ns = latency > UINT32_MAX ? UINT32_MAX : uint32_t(latency);
+  rec.ratio = uint16_t(c.ratio);
+  rec.ch = uint8_t(ch);
+  rec.flags = flags;
+
+  if (!ring.push(rec)) {
+    n_dropped.store(n_dropped.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+    return false;
+  }
+  n_samples.store(n_samples.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+  sum_latency.store(sum_latency.load(std::memory_order_relaxed) + latency,
+                    std::memory_order_relaxed);
+  if (latency > max_latency.load(std::memory_order_relaxed))
+    max_latency.store(latency, std::memory_order_relaxed);
+  return true;
+}
+
+unsigned sp_decim_acq::poll(uint64_t now)
+{
+  unsigned pushed = 0;
+  for (unsigned ch = 0; ch < cfg.channels; ch++) {
+    channel &c = chs[ch];
+    if (!c.searching && now + c.window_ns < c.next_edge_ns)
+      continue;
+
+    const int32_t val = int32_t(dev.read32(c.data_addr));
+    const uint64_t prev_read = c.read_ns;
+    c.read_ns = now;
+    if (!c.have_val) {
+      c.val = val;
+      c.have_val = true;
+      continue;
+    }
+
+    if (val != c.val) {
+      c.val = val;
+      if (now - prev_read <= c.window_ns) {
+        // Updated between the two reads. The periods since the last sample
+        // are uncertain if its update time was guessed.
+        const double edge = prev_read + (now - prev_read) / 2.;
+        if (c.locked) {
+          const double err = edge - c.next_edge_ns;
+          c.est_period_ns = std::min(std::max(c.est_period_ns + err * c_PERIOD_GAIN,
+                                              c.period_ns * (1 - c_MAX_DRIFT)),
+                                     c.period_ns * (1 + c_MAX_DRIFT));
+        }
+        const bool guessed = c.started && !c.edge_known;
+        pushed += sample(ch, val, edge, now, guessed ? SP_DECIM_REC_AMBIGUOUS : 0);
+        c.seen = true;
+        c.edge_known = true;
+        c.locked = true;
+        c.searching = false;
+        c.next_edge_ns = edge + c.est_period_ns;
+        continue;
+      }
+
+      // Seen long after the previous read: count the updates expected since
+      // the last sample. When one is too close to the read to tell whether
+      // it came, it's taken as not come yet, and if it had, the next sample
+      // shows a gap instead of all the following ones being a period ahead.
+      const double since = now - c.edge_ns;
+      const double margin = c.locked ? c.window_ns : c.est_period_ns / 2;
+      const double lo = std::floor((since - margin) / c.est_period_ns);
+      const double hi = std::floor((since + margin) / c.est_period_ns);
+      // Unless the update of the last sample wasn't seen and no other one is
+      // due: it's that update, late, and its period is already sampled
+      if (!c.started || c.seen || lo >= 1) {
+        const double edge = c.started ? c.edge_ns + std::max(1., lo) * c.est_period_ns : now;
+        const bool ambiguous = c.started && lo >= 1 && lo != hi;
+        pushed += sample(ch, val, edge, now, ambiguous ? SP_DECIM_REC_AMBIGUOUS : 0);
+        c.seen = true;
+        c.edge_known = c.locked;
+      }
+      if (c.locked)
+        n_relocks.store(n_relocks.load(std::memory_order_relaxed) + 1,
+                        std::memory_order_relaxed);
+      c.locked = false;
+      c.searching = true;
+      c.search_end_ns = now + uint64_t(c.est_period_ns + c.window_ns);
+      continue;
+    }
+
+    // No update seen, for constant set-points or when it was missed: the
+    // value is sampled once per period anyway
+    if (c.searching) {
+      if (now < c.search_end_ns)
+        continue;
+      pushed += sample(ch, val, now, now, SP_DECIM_REC_AMBIGUOUS);
+      c.seen = false;
+      c.edge_known = false;
+      c.searching = false;
+      c.next_edge_ns = now + c.est_period_ns;
+    } else if (now > c.next_edge_ns + c.window_ns) {
+      // Latest expected update whose window has passed
+      const double edge = c.next_edge_ns + c.est_period_ns *
+                          std::floor((now - c.window_ns - c.next_edge_ns) / c.est_period_ns);
+      pushed += sample(ch, val, edge, now, SP_DECIM_REC_AMBIGUOUS);
+      c.seen = false;
+      c.edge_known = c.locked;
+      c.next_edge_ns = edge + c.est_period_ns;
+    }
+  }
+  return pushed;
+}
+
+uint64_t sp_decim_acq::next_poll_ns() const
+{
+  uint64_t next = UINT64_MAX;
+  for (unsigned ch = 0; ch < cfg.channels; ch++) {
+    const channel &c = chs[ch];
+    if (c.searching)
+      return 0;
+    next = std::min(next, uint64_t(std::max(0., std::ceil(c.next_edge_ns - c.window_ns))));
+  }
+  return next;
+}
+
+size_t sp_decim_acq::drain(sp_decim_writer &w)
+{
+  sp_decim_record buf[c_DRAIN_BATCH];
+  size_t total = 0;
+  size_t n;
+  while ((n = ring.pop(buf, c_DRAIN_BATCH)) > 0) {
+    w.write(buf, n);
+    total += n;
+  }
+  return total;
+}
+
+sp_decim_acq_stats sp_decim_acq::stats() const
+{
+  sp_decim_acq_stats st;
+  st.samples = n_samples.load(std::memory_order_relaxed);
+  st.missed = n_missed.load(std::memory_order_relaxed);
+  st.ambiguous = n_ambiguous.load(std::memory_order_relaxed);
+  st.relocks = n_relocks.load(std::memory_order_relaxed);
+  st.dropped = n_dropped.load(std::memory_order_relaxed);
+  st.max_latency_ns = max_latency.load(std::memory_order_relaxed);
+  st.sum_latency_ns = sum_latency.load(std::memory_order_relaxed);
+  return st;
+}
+
+void sp_decim_acq::poll_thread()
+{
+  while (polling.load(std::memory_order_relaxed)) {
+    poll(now_ns());
+
+    // Wait for the next poll. Between continuous reads, let other threads of
+    // the CPU run.
+    const uint64_t next = next_poll_ns();
+    if (wait_until(next, &polling) >= next)
+      std::this_thread::yield();
+  }
+}
+
+void sp_decim_acq::write_thread(sp_decim_writer &w)
+{
+  try {
+    while (writing.load(std::memory_order_relaxed))
+      if (drain(w) == 0)
+        std::this_thread::sleep_for(c_WRITER_IDLE);
+    drain(w);
+    w.flush();
+  } catch (...) {
+    // Kept for stop(), the ring fills up and the samples are dropped
+    write_err = std::current_exception();
+    write_error.store(true);
+  }
+}
+
+void sp_decim_acq::start(sp_decim_writer &w)
+{
+  if (polling.load())
+    throw std::logic_error("acquisition already running");
+  configure(now_ns());
+  write_err = nullptr;
+  write_error.store(false);
+  writing.store(true);
+  polling.store(true);
+  writer = std::thread(&sp_decim_acq::write_thread, this, std::ref(w));
+  poller = std::thread(&sp_decim_acq::poll_thread, this);
+
+  if (cfg.rt_priority > 0) {
+    sched_param param = {};
+    param.sched_priority = cfg.rt_priority;
+    const int err = pthread_setschedparam(poller.native_handle(), SCHED_FIFO, &param);
+    if (err) {
+      stop();
+      throw std::runtime_error(std::string("can't set polling thread priority: ") +
+                               std::strerror(err));
+    }
+  }
+}
+
+void sp_decim_acq::stop()
+{
+  // The writer thread drains the ring once more after the last poll
+  polling.store(false);
+  if (poller.joinable())
+    poller.join();
+  writing.store(false);
+  if (writer.joinable())
+    writer.join();
+  if (write_err) {
+    std::exception_ptr e = write_err;
+    write_err = nullptr;
+    std::rethrow_exception(e);
+  }
+}
+
+} // namespace fofb
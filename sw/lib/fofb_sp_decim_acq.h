@@ -0,0 +1,238 @@
+// Decimated set-points acquisition
+//
+// ch[].sp_decim.data holds the sum of the last ratio + 1 set-points of each
+// channel and is updated once per decimation period, (ratio + 1) timeframes,
+// with no flag telling a new value arrived, on the timeframe clock, which
+// the host clock drifts against. The period follows from the ratio the
+// gateware actually applies (see sp_decim_ratio_eff()) and the timeframe
+// rate, which has to be given, it isn't exposed by the gateware.
+//
+// sp_decim_acq finds when each channel is updated: it reads data
+// continuously until the value changes, then only in a short window around
+// each expected update, taking the new value as soon as it shows. The update
+// times measured in the windows correct the channel's period, tracking the
+// drift. An update seen outside its window (a late poll, or a phase jump)
+// starts a new search. An update that isn't seen (set-points that didn't
+// change, or a change between two possible periods) gives a sample flagged
+// SP_DECIM_REC_AMBIGUOUS, which may repeat the previous period.
+//
+// The polling side pushes the samples into a lock-free SPSC ring and a writer
+// thread appends them to a binary file, so disk latency never delays a poll.
+// Polls delayed by more than a period are not hidden: the skipped periods
+// show as a gap in the sample sequence numbers and are counted.
+//
+// File format (native endianness): an sp_decim_file_header, written when the
+// file is created, followed by sp_decim_record entries. Later acquisitions
+// append to the same file, after cutting off a record torn by a crash, each
+// one starting with an SP_DECIM_REC_START record.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_SP_DECIM_ACQ_H_
+#define FOFB_SP_DECIM_ACQ_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fofb_device.h"
+#include "fofb_host.h"
+#include "fofb_regs.h"
+#include "fofb_spsc_ring.h"
+#include "wb_fofb_processing_regs_access.h"
+
+namespace fofb {
+
+constexpr char c_SP_DECIM_FILE_MAGIC[8] = {'F', 'O', 'F', 'B', 'S', 'P', 'D', 'C'};
+constexpr uint32_t c_SP_DECIM_FILE_VERSION = 1;
+
+struct sp_decim_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+};
+
+// Record flags
+// First sample of an acquisition
+constexpr uint8_t SP_DECIM_REC_START = 0x1;
+// Periods were skipped since the previous sample of the channel
+constexpr uint8_t SP_DECIM_REC_GAP = 0x2;
+// The update wasn't seen: the value may belong to the period before or after
+// the sample's
+constexpr uint8_t SP_DECIM_REC_AMBIGUOUS = 0x4;
+
+struct sp_decim_record {
+  // Read time, ns since the Unix epoch
+  uint64_t t_ns;
+  // Decimation period index since the acquisition start
+  uint32_t seq;
+  // sp_decim.data
+  int32_t val;
+  // Delay between the (measured or expected) update and the read
+  uint32_t latency_ns;
+  // Effective decimation ratio
+  uint16_t ratio;
+  uint8_t ch;
+  uint8_t flags;
+};
+
+static_assert(sizeof(sp_decim_record) == 24, "sp_decim_record must not have padding");
+
+struct sp_decim_acq_config {
+  // Timeframe rate
+  double tf_rate_hz = 48000;
+  // Channels acquired, 0 to channels - 1
+  unsigned channels = c_MAX_CHANNELS;
+  // Ring capacity in samples, a power of two
+  size_t ring_size = 1 << 16;
+  // SCHED_FIFO priority of the polling thread, 0 keeps the default policy.
+  // Without it, decimation ratios below a few tens miss periods.
+  int rt_priority = 0;
+};
+
+struct sp_decim_acq_stats {
+  uint64_t samples;
+  // Periods skipped by late polls
+  uint64_t missed;
+  // Samples flagged SP_DECIM_REC_AMBIGUOUS
+  uint64_t ambiguous;
+  // Searches for the update time after an update outside its window
+  uint64_t relocks;
+  // Samples lost because the ring was full
+  uint64_t dropped;
+  uint64_t max_latency_ns;
+  uint64_t sum_latency_ns;
+};
+
+// Append-only writer of sp_decim_record files
+class sp_decim_writer {
+ public:
+  explicit sp_decim_writer(const std::string &fname);
+  ~sp_decim_writer();
+
+  sp_decim_writer(const sp_decim_writer &) = delete;
+  sp_decim_writer &operator=(const sp_decim_writer &) = delete;
+
+  void write(const sp_decim_record *recs, size_t n);
+  void flush();
+
+  uint64_t records() const { return num_records; }
+
+ private:
+  std::string fname;
+  FILE *f;
+  uint64_t num_records = 0;
+};
+
+// Read a whole sp_decim_record file
+std::vector<sp_decim_record> read_sp_decim_file(const std::string &fname);
+
+class sp_decim_acq {
+ public:
+  // 'dev' maps a wb_fofb_processing_regs block at 'base'
+  sp_decim_acq(mmap_device &dev, size_t base = 0, const sp_decim_acq_config &cfg = {});
+  ~sp_decim_acq();
+
+  sp_decim_acq(const sp_decim_acq &) = delete;
+  sp_decim_acq &operator=(const sp_decim_acq &) = delete;
+
+  // Read sp_decim_ratio_max and the channels' ratios and restart the search
+  // for their update times at 'now_ns' (steady clock, see now_ns())
+  void configure(uint64_t now_ns);
+
+  // Producer side: read the channels searching for an update or in their
+  // update window at 'now_ns', returns the number of samples pushed
+  unsigned poll(uint64_t now_ns);
+
+  // Time of the next read, in the past while a channel is searching or in
+  // its update window (poll() is then called as often as possible)
+  uint64_t next_poll_ns() const;
+
+  // Consumer side: move the samples in the ring to 'w'
+  size_t drain(sp_decim_writer &w);
+
+  // Run the polling and writing threads until stop(), which throws the
+  // error that stopped the writing thread, if any
+  void start(sp_decim_writer &w);
+  void stop();
+  // The writing thread stopped on an error, samples are being dropped
+  bool write_failed() const { return write_error.load(); }
+
+  // Effective decimation ratio of channel 'ch'
+  unsigned ratio(unsigned ch) const { return chs[ch].ratio; }
+  // Decimation period of channel 'ch', in ns
+  double period_ns(unsigned ch) const { return chs[ch].period_ns; }
+  // The same, as measured on the host clock
+  double tracked_period_ns(unsigned ch) const { return chs[ch].est_period_ns; }
+  // Whether the update time of channel 'ch' is known
+  bool locked(unsigned ch) const { return chs[ch].locked; }
+
+  // Safe to call while running, counters are updated by the polling thread
+  sp_decim_acq_stats stats() const;
+
+ private:
+  struct channel {
+    size_t data_addr;
+    unsigned ratio;
+    double period_ns;
+    double est_period_ns;
+    // Half width of the window read around an expected update
+    double window_ns;
+    // Expected time of the next update
+    double next_edge_ns;
+    // End of the search for an update
+    uint64_t search_end_ns;
+    // Last read
+    uint64_t read_ns;
+    int32_t val;
+    bool have_val;
+    bool searching;
+    bool locked;
+    // Update time and index of the last sample, whether that time was
+    // measured or expected on a locked channel, and whether the update was
+    // seen
+    double edge_ns;
+    bool edge_known;
+    bool seen;
+    uint64_t seq;
+    bool started;
+  };
+
+  bool sample(unsigned ch, int32_t val, double edge_ns, uint64_t now_ns, uint8_t flags);
+  void poll_thread();
+  void write_thread(sp_decim_writer &w);
+
+  mmap_device &dev;
+  size_t base;
+  regs::reg_block<regs::wb_fofb_processing_regs> blk;
+  sp_decim_acq_config cfg;
+  channel chs[c_MAX_CHANNELS];
+  // Unix epoch time minus steady clock time at configure()
+  int64_t epoch_offset_ns = 0;
+  spsc_ring<sp_decim_record> ring;
+
+  std::atomic<uint64_t> n_samples{0};
+  std::atomic<uint64_t> n_missed{0};
+  std::atomic<uint64_t> n_ambiguous{0};
+  std::atomic<uint64_t> n_relocks{0};
+  std::atomic<uint64_t> n_dropped{0};
+  std::atomic<uint64_t> max_latency{0};
+  std::atomic<uint64_t> sum_latency{0};
+
+  std::atomic<bool> polling{false};
+  std::atomic<bool> writing{false};
+  std::atomic<bool> write_error{false};
+  std::exception_ptr write_err;
+  std::thread poller;
+  std::thread writer;
+};
+
+} // namespace fofb
+
+#endif // FOFB_SP_DECIM_ACQ_H_
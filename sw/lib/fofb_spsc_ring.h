@@ -0,0 +1,89 @@
+// Lock-free single-producer single-consumer ring buffer
+//
+// One thread pushes and another one pops, without locks: each index is only
+// written by its owner thread and published with release semantics. Each
+// side keeps a cached copy of the other side's index, so the shared cache
+// lines are only touched when the ring looks full (or empty).
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_SPSC_RING_H_
+#define FOFB_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace fofb {
+
+template <typename T>
+class spsc_ring {
+  static_assert(std::is_trivially_copyable<T>::value, "ring elements are copied around");
+
+ public:
+  // 'capacity' must be a power of two
+  explicit spsc_ring(size_t capacity):
+    buf(capacity),
+    mask(capacity - 1)
+  {
+    if (capacity < 2 || (capacity & (capacity - 1)))
+      throw std::invalid_argument("ring capacity must be a power of two");
+  }
+
+  size_t capacity() const { return buf.size(); }
+
+  // Producer side, returns false if the ring is full
+  bool push(const T &v)
+  {
+    const size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail_cache == buf.size()) {
+      tail_cache = tail.load(std::memory_order_acquire);
+      if (h - tail_cache == buf.size())
+        return false;
+    }
+    buf[h & mask] = v;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side, pops up to 'max' elements into 'out' and returns how many
+  size_t pop(T *out, size_t max)
+  {
+    const size_t t = tail.load(std::memory_order_relaxed);
+    if (head_cache - t < max)
+      head_cache = head.load(std::memory_order_acquire);
+    size_t n = head_cache - t;
+    if (n > max)
+      n = max;
+    for (size_t i = 0; i < n; i++)
+      out[i] = buf[(t + i) & mask];
+    tail.store(t + n, std::memory_order_release);
+    return n;
+  }
+
+  // Number of elements in the ring, exact only when called from one of the
+  // two sides with the other one idle
+  size_t size() const
+  {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+ private:
+  std::vector<T> buf;
+  const size_t mask;
+
+  // Written by the producer
+  alignas(64) std::atomic<size_t> head{0};
+  size_t tail_cache = 0;
+
+  // Written by the consumer
+  alignas(64) std::atomic<size_t> tail{0};
+  size_t head_cache = 0;
+};
+
+} // namespace fofb
+
+#endif // FOFB_SPSC_RING_H_
@@ -0,0 +1,207 @@
+// System identification from the PRBS excitation
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <thread>
+
+#include "fofb_sys_id.h"
+
+namespace fofb {
+
+namespace {
+
+// Cross spectra of x with a and b, packed two signals per transform: 'z'
+// holds the transform of a + i b and gets conj(X) A + i conj(X) B, whose
+// inverse transform is r_xa + i r_xb
+void cross_spectra(cplx *z, const cplx *xf, size_t n)
+{
+  for (size_t k = 0; k <= n / 2; k++) {
+    const size_t m = (n - k) & (n - 1);
+    cplx ak, bk, am, bm;
+    fft_split_real(z, n, k, ak, bk);
+    fft_split_real(z, n, m, am, bm);
+    const cplx xk = std::conj(xf[k]), xm = std::conj(xf[m]);
+    z[k] = xk * ak + cplx(0, 1) * (xk * bk);
+    z[m] = xm * am + cplx(0, 1) * (xm * bm);
+  }
+}
+
+} // namespace
+
+sys_id_engine::sys_id_engine(const std::vector<double> &excitation, const sys_id_config &c):
+  cfg(c),
+  x(excitation),
+  plan(fft_size(std::max<size_t>(excitation.size() + c.lags, 2)))
+{
+  const size_t k = cfg.lags;
+  if (k == 0 || x.size() < 2 * k)
+    throw std::invalid_argument("excitation shorter than twice the impulse response");
+  if (!(cfg.regularization >= 0))
+    throw std::invalid_argument("invalid regularization");
+
+  double mean = 0;
+  for (double v: x)
+    mean += v;
+  mean /= double(x.size());
+  for (double &v: x)
+    v -= mean;
+
+  const size_t n = plan.size();
+  xf.assign(n, 0);
+  for (size_t t = 0; t < x.size(); t++)
+    xf[t] = x[t];
+  plan.forward(xf.data());
+
+  std::vector<cplx> r(n);
+  for (size_t i = 0; i < n; i++)
+    r[i] = std::norm(xf[i]);
+  plan.inverse(r.data());
+  if (!(r[0].real() > 0))
+    throw std::invalid_argument("constant excitation");
+
+  // Toeplitz autocorrelation matrix, lower triangle factored in place
+  chol.assign(k * k, 0);
+  for (size_t i = 0; i < k; i++)
+    for (size_t j = 0; j <= i; j++)
+      chol[i * k + j] = r[i - j].real() / double(n);
+  const double diag = chol[0] * cfg.regularization;
+  for (size_t i = 0; i < k; i++) {
+    chol[i * k + i] += diag;
+    for (size_t j = 0; j <= i; j++) {
+      double s = chol[i * k + j];
+      for (size_t l = 0; l < j; l++)
+        s -= chol[i * k + l] * chol[j * k + l];
+      if (i == j) {
+        if (!(s > 0))
+          throw std::invalid_argument("excitation not persistently exciting over the lags");
+        chol[i * k + i] = std::sqrt(s);
+      } else {
+        chol[i * k + j] = s / chol[j * k + j];
+      }
+    }
+  }
+}
+
+void sys_id_engine::estimate_pairs(const int32_t *data, size_t stride, size_t n_signals,
+                                   unsigned worker, unsigned workers, sys_id_response &res) const
+{
+  const size_t n = plan.size();
+  const size_t t_len = x.size();
+  const size_t k = cfg.lags;
+  std::vector<cplx> z(n);
+  std::vector<double> h(k);
+
+  for (size_t a = 2 * worker; a < n_signals; a += 2 * workers) {
+    const size_t b = a + 1 < n_signals ? a + 1 : a;
+    double mean_a = 0, mean_b = 0;
+    for (size_t t = 0; t < t_len; t++) {
+      mean_a += data[t * stride + a];
+      mean_b += data[t * stride + b];
+    }
+    mean_a /= double(t_len);
+    mean_b /= double(t_len);
+    for (size_t t = 0; t < t_len; t++)
+      z[t] = cplx(data[t * stride + a] - mean_a, data[t * stride + b] - mean_b);
+    std::fill(z.begin() + t_len, z.end(), 0);
+
+    plan.forward(z.data());
+    cross_spectra(z.data(), xf.data(), n);
+    plan.inverse(z.data());
+
+    for (unsigned part = 0; part < (b == a ? 1 : 2); part++) {
+      const size_t s = part ? b : a;
+      // L L^T h = r_xy
+      for (size_t i = 0; i < k; i++) {
+        double v = (part ? z[i].imag() : z[i].real()) / double(n);
+        for (size_t l = 0; l < i; l++)
+          v -= chol[i * k + l] * h[l];
+        h[i] = v / chol[i * k + i];
+      }
+      for (size_t i = k; i-- > 0;) {
+        double v = h[i];
+        for (size_t l = i + 1; l < k; l++)
+          v -= chol[l * k + i] * h[l];
+        h[i] = v / chol[i * k + i];
+      }
+      double gain = 0;
+      for (size_t i = 0; i < k; i++) {
+        res.h[s * k + i] = h[i];
+        gain += h[i];
+      }
+      res.gain[s] = gain;
+    }
+  }
+}
+
+sys_id_response sys_id_engine::estimate(const int32_t *data, size_t stride,
+                                        size_t n_signals) const
+{
+  if (n_signals == 0 || stride < n_signals)
+    throw std::invalid_argument("invalid signal layout");
+
+  sys_id_response res;
+  res.lags = cfg.lags;
+  res.h.assign(n_signals * cfg.lags, 0);
+  res.gain.assign(n_signals, 0);
+
+  const size_t pairs = (n_signals + 1) / 2;
+  unsigned workers = cfg.threads ? cfg.threads : std::thread::hardware_concurrency();
+  workers = unsigned(std::min<size_t>(std::max(workers, 1u), pairs));
+  // Each worker handles its own signals, the plan and the factored matrix
+  // are only read
+  std::vector<std::thread> threads;
+  for (unsigned w = 1; w < workers; w++)
+    threads.emplace_back(&sys_id_engine::estimate_pairs, this, data, stride, n_signals, w,
+                         workers, std::ref(res));
+  estimate_pairs(data, stride, n_signals, 0, workers, res);
+  for (std::thread &t: threads)
+    t.join();
+  return res;
+}
+
+size_t sys_id_align(const std::vector<double> &reference, const int32_t *data, size_t stride,
+                    size_t n, size_t max_offset)
+{
+  const size_t len = n + max_offset;
+  if (n == 0 || reference.size() < len)
+    throw std::invalid_argument("reference shorter than the capture and offsets");
+
+  double mean_r = 0, mean_c = 0;
+  for (size_t t = 0; t < len; t++)
+    mean_r += reference[t];
+  for (size_t t = 0; t < n; t++)
+    mean_c += data[t * stride];
+  mean_r /= double(len);
+  mean_c /= double(n);
+
+  // Negative offsets wrap around past max_offset
+  const fft_plan plan(fft_size(std::max<size_t>(len, 2)));
+  const size_t sz = plan.size();
+  std::vector<cplx> z(sz, 0);
+  for (size_t t = 0; t < len; t++)
+    z[t].real(reference[t] - mean_r);
+  for (size_t t = 0; t < n; t++)
+    z[t].imag(data[t * stride] - mean_c);
+  plan.forward(z.data());
+  for (size_t k = 0; k <= sz / 2; k++) {
+    const size_t m = (sz - k) & (sz - 1);
+    cplx rk, ck, rm, cm;
+    fft_split_real(z.data(), sz, k, rk, ck);
+    fft_split_real(z.data(), sz, m, rm, cm);
+    z[k] = std::conj(ck) * rk;
+    z[m] = std::conj(cm) * rm;
+  }
+  plan.inverse(z.data());
+
+  size_t best = 0;
+  for (size_t d = 1; d <= max_offset; d++)
+    if (z[d].real() > z[best].real())
+      best = d;
+  return best;
+}
+
+} // namespace fofb
@@ -0,0 +1,82 @@
+// System identification from the PRBS excitation
+//
+// Estimates the impulse responses of captured signals (BPM positions,
+// set-points) to a known excitation (see fofb_prbs.h) by correlation: the
+// excitation autocorrelation and its cross-correlation with each signal are
+// computed with FFTs, two signals per complex transform, and the Wiener-Hopf
+// equations R_xx h = r_xy are solved for 'lags' taps of each signal (the
+// autocorrelation matrix is factored once per excitation). Signals are
+// spread over worker threads, sharing the FFT plan and the factored matrix.
+//
+// As one PRBS drives every channel, the response matrix is identified one
+// corrector per run: each run excites a single channel (sp_distort levels
+// left at zero on the others) and yields one column, the static gains of
+// the BPM positions.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_SYS_ID_H_
+#define FOFB_SYS_ID_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_fft.h"
+
+namespace fofb {
+
+struct sys_id_config {
+  // Impulse response length, in samples
+  size_t lags = 64;
+  // Worker threads, 0 for one per CPU
+  unsigned threads = 0;
+  // Added to the autocorrelation diagonal, relative to the excitation power
+  double regularization = 1e-6;
+};
+
+struct sys_id_response {
+  size_t lags = 0;
+  // h[s * lags + k]: response of signal s, k samples after an excitation
+  // impulse
+  std::vector<double> h;
+  // Static gain of each signal, the sum of its impulse response
+  std::vector<double> gain;
+};
+
+class sys_id_engine {
+ public:
+  // 'excitation' is the distortion applied over the capture, sample by
+  // sample
+  explicit sys_id_engine(const std::vector<double> &excitation, const sys_id_config &cfg = {});
+
+  size_t samples() const { return x.size(); }
+
+  // Sample t of signal s is data[t * stride + s], for t < samples()
+  sys_id_response estimate(const int32_t *data, size_t stride, size_t n_signals) const;
+
+ private:
+  void estimate_pairs(const int32_t *data, size_t stride, size_t n_signals,
+                      unsigned worker, unsigned workers, sys_id_response &r) const;
+
+  sys_id_config cfg;
+  // Excitation without its mean and its transform
+  std::vector<double> x;
+  std::vector<cplx> xf;
+  fft_plan plan;
+  // Cholesky factor of the regularized autocorrelation matrix, row major
+  std::vector<double> chol;
+};
+
+// Offset of a capture in a reference: the d in [0, max_offset] maximizing
+// the correlation of the captured samples with reference[d, d + n). Sample t
+// of the capture is data[t * stride], 'reference' holds at least
+// n + max_offset samples. Used to find the excitation phase from the
+// captured set-points of the excited channel.
+size_t sys_id_align(const std::vector<double> &reference, const int32_t *data, size_t stride,
+                    size_t n, size_t max_offset);
+
+} // namespace fofb
+
+#endif // FOFB_SYS_ID_H_
@@ -0,0 +1,193 @@
+// Streaming FOFB CC time of arrival statistics
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "fofb_toa_stats.h"
+
+namespace fofb {
+
+namespace {
+
+bool valid_header(const toa_stats_file_header &hdr)
+{
+  return !std::memcmp(hdr.magic, c_TOA_STATS_FILE_MAGIC, sizeof(hdr.magic)) &&
+         hdr.version == c_TOA_STATS_FILE_VERSION &&
+         hdr.record_size == sizeof(toa_sketch_data);
+}
+
+} // namespace
+
+uint32_t toa_sketch::bucket_upper(unsigned b)
+{
+  if (b < (2u << c_TOA_SUB_BITS))
+    return b;
+  const unsigned shift = (b >> c_TOA_SUB_BITS) - 1;
+  const uint32_t lower = (b - (shift << c_TOA_SUB_BITS)) << shift;
+  return lower + (uint32_t(1) << shift) - 1;
+}
+
+void toa_sketch::merge(const toa_sketch &o)
+{
+  for (unsigned b = 0; b < c_TOA_BUCKETS; b++)
+    d.buckets[b] += o.d.buckets[b];
+  d.count += o.d.count;
+  d.missing += o.d.missing;
+  if (o.d.min < d.min)
+    d.min = o.d.min;
+  if (o.d.max > d.max)
+    d.max = o.d.max;
+}
+
+void toa_sketch::clear()
+{
+  std::memset(&d, 0, sizeof(d));
+  d.min = UINT32_MAX;
+}
+
+uint32_t toa_sketch::quantile(double q) const
+{
+  if (d.count == 0)
+    return 0;
+  // Rank of the value, 1-based
+  uint64_t rank = uint64_t(std::ceil(q * d.count));
+  if (rank < 1)
+    rank = 1;
+  uint64_t seen = 0;
+  for (unsigned b = 0; b < c_TOA_BUCKETS; b++) {
+    seen += d.buckets[b];
+    if (seen >= rank)
+      return std::min(bucket_upper(b), d.max);
+  }
+  return d.max;
+}
+
+toa_monitor::toa_monitor(const toa_monitor_config &c):
+  cfg(c),
+  win(c.nodes),
+  total(c.nodes)
+{
+  if (cfg.nodes == 0 || cfg.nodes > c_CC_NODES)
+    throw std::invalid_argument("unsupported number of nodes");
+  if (cfg.deadline == 0)
+    throw std::invalid_argument("timeframe deadline not set");
+  if (!(cfg.warn_quantile > 0 && cfg.warn_quantile <= 1) ||
+      !(cfg.warn_fraction > 0 && cfg.warn_fraction <= 1))
+    throw std::invalid_argument("invalid warning quantile or fraction");
+  if (cfg.window == 0)
+    throw std::invalid_argument("empty window");
+  near_threshold = uint32_t(std::ceil(cfg.deadline * cfg.warn_fraction));
+}
+
+size_t toa_monitor::add(const uint32_t *toa)
+{
+  for (unsigned node = 0; node < cfg.nodes; node++) {
+    const uint32_t v = toa[node] & cfg.value_mask;
+    if (v == 0 && cfg.zero_is_missing)
+      win[node].add_missing();
+    else
+      win[node].add(v);
+  }
+  n_snapshots++;
+  if (++win_snapshots < cfg.window)
+    return 0;
+  return end_window();
+}
+
+size_t toa_monitor::end_window()
+{
+  if (win_snapshots == 0)
+    return 0;
+  size_t raised = 0;
+  for (unsigned node = 0; node < cfg.nodes; node++) {
+    toa_sketch &s = win[node];
+    if (s.count() >= cfg.min_count) {
+      const uint32_t v = s.quantile(cfg.warn_quantile);
+      if (v >= near_threshold) {
+        warnings.push_back({n_windows, node,
+                            v >= cfg.deadline ? TOA_PAST_DEADLINE : TOA_NEAR_DEADLINE,
+                            v, s.max(), s.count(), s.missing()});
+        raised++;
+      }
+    }
+    total[node].merge(s);
+    s.clear();
+  }
+  n_windows++;
+  win_snapshots = 0;
+  return raised;
+}
+
+std::vector<toa_warning> toa_monitor::take_warnings()
+{
+  std::vector<toa_warning> w;
+  w.swap(warnings);
+  return w;
+}
+
+void toa_monitor::merge(const toa_monitor &o)
+{
+  if (o.cfg.nodes != cfg.nodes)
+    throw std::invalid_argument("merging monitors of different node counts");
+  for (unsigned node = 0; node < cfg.nodes; node++)
+    total[node].merge(o.total[node]);
+  n_snapshots += o.n_snapshots;
+  n_windows += o.n_windows;
+}
+
+void write_toa_stats_file(const std::string &fname, const std::vector<toa_sketch> &sketches,
+                          uint32_t deadline, uint64_t snapshots)
+{
+  FILE *f = std::fopen(fname.c_str(), "wb");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+  toa_stats_file_header hdr;
+  std::memcpy(hdr.magic, c_TOA_STATS_FILE_MAGIC, sizeof(hdr.magic));
+  hdr.version = c_TOA_STATS_FILE_VERSION;
+  hdr.record_size = sizeof(toa_sketch_data);
+  hdr.nodes = uint32_t(sketches.size());
+  hdr.deadline = deadline;
+  hdr.snapshots = snapshots;
+  bool ok = std::fwrite(&hdr, sizeof(hdr), 1, f) == 1;
+  for (const toa_sketch &s: sketches)
+    ok = ok && std::fwrite(&s.data(), sizeof(toa_sketch_data), 1, f) == 1;
+  if (std::fclose(f) || !ok)
+    throw std::runtime_error(fname + ": write error");
+}
+
+std::vector<toa_sketch> read_toa_stats_file(const std::string &fname,
+                                            toa_stats_file_header *hdr)
+{
+  FILE *f = std::fopen(fname.c_str(), "rb");
+  if (!f)
+    throw std::runtime_error("can't open " + fname);
+
+  toa_stats_file_header h;
+  if (std::fread(&h, sizeof(h), 1, f) != 1 || !valid_header(h) || h.nodes > c_CC_NODES) {
+    std::fclose(f);
+    throw std::runtime_error(fname + ": not a TOA statistics file");
+  }
+  std::vector<toa_sketch> sketches(h.nodes);
+  toa_sketch_data d;
+  bool ok = true;
+  for (toa_sketch &s: sketches) {
+    ok = ok && std::fread(&d, sizeof(d), 1, f) == 1;
+    if (ok)
+      s.set_data(d);
+  }
+  ok = ok && std::fgetc(f) == EOF;
+  std::fclose(f);
+  if (!ok)
+    throw std::runtime_error(fname + ": node count mismatch");
+  if (hdr)
+    *hdr = h;
+  return sketches;
+}
+
+} // namespace fofb
@@ -0,0 +1,210 @@
+// Streaming FOFB CC time of arrival statistics
+//
+// The TOA buffer of the FOFB CC (read by fofb_cc_snapshotter) holds, per
+// node, the arrival time of its packet in the current timeframe. Late
+// packets show there long before they add up to a loop_intlk PACKET_LOSS
+// (fewer than loop_intlk.min_num_pkts packets in a timeframe), so
+// toa_monitor keeps per-node arrival time distributions of every snapshot
+// fed to it and warns when their tail gets close to the timeframe deadline.
+//
+// As the ram_reg word indexes (fofb_cc_status.h), the TOA word layout is
+// defined by the CC core, which isn't part of this repository: following the
+// DLS core, the arrival time is taken as the low bits of the word (in CC
+// clock cycles since the timeframe start, the unit of the time_frame_len
+// configuration word) and a zero word as a node whose packet didn't arrive.
+//
+// Each distribution is a toa_sketch, a fixed log-linear histogram: values
+// below 64 have their own bucket and above, each power of two is split in 32
+// buckets, so a quantile is known within 1/32 of its value (reported as the
+// bucket upper bound, never below the true value), min and max exactly. A
+// sketch takes 3 kB whatever the number of values added, an addition is a
+// few instructions, and two sketches merge by adding their counts, exactly
+// as if all the values had been added to one: windows, boards or whole runs
+// can be combined afterwards.
+//
+// toa_monitor accumulates 'window' snapshots per node, then checks each
+// node's window quantile against the deadline, merges the window into the
+// run totals and starts the next one.
+//
+// Statistics file format (native endianness): a toa_stats_file_header
+// followed by 'nodes' toa_sketch_data records.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_TOA_STATS_H_
+#define FOFB_TOA_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "fofb_cc_status.h"
+
+namespace fofb {
+
+// Sketch resolution: 2^c_TOA_SUB_BITS buckets per power of two, for values
+// of up to c_TOA_VALUE_BITS bits (larger ones count in the last bucket)
+constexpr unsigned c_TOA_SUB_BITS = 5;
+constexpr unsigned c_TOA_VALUE_BITS = 16;
+constexpr unsigned c_TOA_BUCKETS = (c_TOA_VALUE_BITS - c_TOA_SUB_BITS + 1) << c_TOA_SUB_BITS;
+
+struct toa_sketch_data {
+  uint64_t count;
+  uint64_t missing;
+  uint32_t min;
+  uint32_t max;
+  uint64_t buckets[c_TOA_BUCKETS];
+};
+
+class toa_sketch {
+ public:
+  toa_sketch() { clear(); }
+
+  static unsigned bucket(uint32_t v)
+  {
+    constexpr uint32_t top = (uint32_t(1) << c_TOA_VALUE_BITS) - 1;
+    if (v > top)
+      v = top;
+    if (v < (2u << c_TOA_SUB_BITS))
+      return v;
+    const unsigned shift = 31 - __builtin_clz(v) - c_TOA_SUB_BITS;
+    return (shift << c_TOA_SUB_BITS) + (v >> shift);
+  }
+
+  // Largest value counted in bucket 'b'
+  static uint32_t bucket_upper(unsigned b);
+
+  void add(uint32_t v)
+  {
+    d.buckets[bucket(v)]++;
+    d.count++;
+    if (v < d.min)
+      d.min = v;
+    if (v > d.max)
+      d.max = v;
+  }
+
+  void add_missing() { d.missing++; }
+  void merge(const toa_sketch &o);
+  void clear();
+
+  // Smallest value at least a fraction 'q' of the values are less or equal
+  // to, rounded up to its bucket upper bound (and down to max()). 0 when
+  // empty.
+  uint32_t quantile(double q) const;
+
+  uint64_t count() const { return d.count; }
+  uint64_t missing() const { return d.missing; }
+  // UINT32_MAX and 0 when empty
+  uint32_t min() const { return d.min; }
+  uint32_t max() const { return d.max; }
+
+  const toa_sketch_data &data() const { return d; }
+  void set_data(const toa_sketch_data &data) { d = data; }
+
+ private:
+  toa_sketch_data d;
+};
+
+struct toa_monitor_config {
+  unsigned nodes = c_CC_NODES;
+  // Arrival time bits of a TOA word
+  uint32_t value_mask = 0xffff;
+  // A zero word is a node whose packet didn't arrive
+  bool zero_is_missing = true;
+  // Timeframe deadline, in CC clock cycles (time_frame_len)
+  uint32_t deadline = 0;
+  // Warn when the 'warn_quantile' of a node over a window reaches
+  // 'warn_fraction' of the deadline
+  double warn_quantile = 0.999;
+  double warn_fraction = 0.8;
+  // Snapshots per window
+  uint64_t window = 10000;
+  // Arrivals a node needs in a window to be judged
+  uint64_t min_count = 100;
+};
+
+enum toa_warning_level {
+  // Tail past warn_fraction of the deadline
+  TOA_NEAR_DEADLINE,
+  // Tail past the deadline
+  TOA_PAST_DEADLINE,
+};
+
+struct toa_warning {
+  uint64_t window;
+  unsigned node;
+  toa_warning_level level;
+  // The window's warn_quantile and max arrival times, arrivals and missing
+  // packets
+  uint32_t value;
+  uint32_t max;
+  uint64_t count;
+  uint64_t missing;
+};
+
+class toa_monitor {
+ public:
+  explicit toa_monitor(const toa_monitor_config &cfg);
+
+  // Add a TOA buffer snapshot, one word per node. Returns the number of
+  // warnings raised (when it completes a window).
+  size_t add(const uint32_t *toa);
+
+  // Close the current window early (e.g. at the end of a run)
+  size_t end_window();
+
+  // Warnings raised since the last call
+  std::vector<toa_warning> take_warnings();
+
+  // Merge the totals of another monitor (e.g. of another board watching the
+  // same nodes)
+  void merge(const toa_monitor &o);
+
+  const toa_monitor_config &config() const { return cfg; }
+  uint64_t snapshots() const { return n_snapshots; }
+  uint64_t windows() const { return n_windows; }
+  // Per node sketches of the current window and of the closed windows
+  const std::vector<toa_sketch> &window() const { return win; }
+  const std::vector<toa_sketch> &totals() const { return total; }
+  std::vector<toa_sketch> &totals() { return total; }
+
+ private:
+  toa_monitor_config cfg;
+  uint32_t near_threshold;
+  uint64_t n_snapshots = 0;
+  uint64_t n_windows = 0;
+  uint64_t win_snapshots = 0;
+  std::vector<toa_sketch> win;
+  std::vector<toa_sketch> total;
+  std::vector<toa_warning> warnings;
+};
+
+constexpr char c_TOA_STATS_FILE_MAGIC[8] = {'F', 'O', 'F', 'B', 'T', 'O', 'A', 'S'};
+constexpr uint32_t c_TOA_STATS_FILE_VERSION = 1;
+
+struct toa_stats_file_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t nodes;
+  uint32_t deadline;
+  // Snapshots summarized
+  uint64_t snapshots;
+};
+
+static_assert(sizeof(toa_stats_file_header) == 32,
+              "toa_stats_file_header must not have padding");
+
+void write_toa_stats_file(const std::string &fname, const std::vector<toa_sketch> &sketches,
+                          uint32_t deadline, uint64_t snapshots);
+
+// Read a statistics file, fills 'hdr' if not nullptr
+std::vector<toa_sketch> read_toa_stats_file(const std::string &fname,
+                                            toa_stats_file_header *hdr = nullptr);
+
+} // namespace fofb
+
+#endif // FOFB_TOA_STATS_H_
@@ -0,0 +1,119 @@
+// Shared memory stand-in for the FOFB CC X/Y buffer
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fofb_xy_shm.h"
+#include "fofb_host.h"
+
+namespace fofb {
+
+namespace {
+
+static_assert(c_NUM_BPM_POS == 2 * c_CC_NODES, "X and Y positions of every node");
+
+} // namespace
+
+void xy_frame_to_bpm_pos(const xy_shm_frame &f, int32_t *bpm_pos, uint64_t *valid)
+{
+  for (unsigned n = 0; n < c_CC_NODES; n++) {
+    bpm_pos[n] = int32_t(uint32_t(f.xy[n] >> 32));
+    bpm_pos[c_CC_NODES + n] = int32_t(uint32_t(f.xy[n]));
+  }
+  for (unsigned w = 0; w < c_CC_NODES / 64; w++)
+    valid[w] = valid[c_CC_NODES / 64 + w] = f.valid[w];
+}
+
+xy_shm::xy_shm(const std::string &name, bool create):
+  shm_name(name),
+  owner(create)
+{
+  if (create) {
+    ::shm_unlink(name.c_str());
+    fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0)
+      throw sys_error("can't create " + name);
+    if (::ftruncate(fd, sizeof(xy_shm_layout)) < 0) {
+      const auto err = sys_error("can't size " + name);
+      ::close(fd);
+      ::shm_unlink(name.c_str());
+      throw err;
+    }
+  } else {
+    fd = ::shm_open(name.c_str(), O_RDWR, 0);
+    if (fd < 0)
+      throw sys_error("can't open " + name);
+    struct stat sb;
+    if (::fstat(fd, &sb) < 0 || size_t(sb.st_size) < sizeof(xy_shm_layout)) {
+      ::close(fd);
+      throw std::runtime_error(name + ": not a X/Y buffer stand-in");
+    }
+  }
+
+  void *map = ::mmap(nullptr, sizeof(xy_shm_layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (map == MAP_FAILED) {
+    const auto err = sys_error("can't map " + name);
+    ::close(fd);
+    if (owner)
+      ::shm_unlink(name.c_str());
+    throw err;
+  }
+  shm = static_cast<xy_shm_layout *>(map);
+
+  if (create) {
+    shm->hdr.version = c_XY_SHM_VERSION;
+    shm->hdr.slots = c_XY_SHM_SLOTS;
+    shm->head.val.store(0, std::memory_order_relaxed);
+    shm->tail.val.store(0, std::memory_order_relaxed);
+    shm->hdr.magic.store(c_XY_SHM_MAGIC, std::memory_order_release);
+  } else if (shm->hdr.magic.load(std::memory_order_acquire) != c_XY_SHM_MAGIC ||
+             shm->hdr.version != c_XY_SHM_VERSION || shm->hdr.slots != c_XY_SHM_SLOTS) {
+    ::munmap(shm, sizeof(xy_shm_layout));
+    ::close(fd);
+    throw std::runtime_error(name + ": not a X/Y buffer stand-in");
+  }
+}
+
+xy_shm::~xy_shm()
+{
+  ::munmap(shm, sizeof(xy_shm_layout));
+  ::close(fd);
+  if (owner)
+    ::shm_unlink(shm_name.c_str());
+}
+
+bool xy_shm::push(const xy_shm_frame &f)
+{
+  const uint32_t h = shm->head.val.load(std::memory_order_relaxed);
+  if (h - shm->tail.val.load(std::memory_order_acquire) == c_XY_SHM_SLOTS)
+    return false;
+  shm->frames[h % c_XY_SHM_SLOTS] = f;
+  shm->head.val.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+bool xy_shm::pop(xy_shm_frame &f)
+{
+  const uint32_t t = shm->tail.val.load(std::memory_order_relaxed);
+  if (shm->head.val.load(std::memory_order_acquire) == t)
+    return false;
+  f = shm->frames[t % c_XY_SHM_SLOTS];
+  shm->tail.val.store(t + 1, std::memory_order_release);
+  return true;
+}
+
+size_t xy_shm::size() const
+{
+  return shm->head.val.load(std::memory_order_acquire) -
+         shm->tail.val.load(std::memory_order_acquire);
+}
+
+} // namespace fofb
@@ -0,0 +1,106 @@
+// Shared memory stand-in for the FOFB CC X/Y buffer
+//
+// Feeds a host-side consumer (rt_engine, see fofb_rt_engine.h) with the BPM
+// positions of each timeframe as the FOFB CC would hand them to
+// fofb_processing, without the board: a producer process (a replay, a
+// simulation or a bridge to the real CC) publishes one xy_shm_frame per
+// timeframe in /fofb_xy_<key>. As in the X/Y buffer, each node's entry holds
+// its X position in bits 63:32 (xy_buff_data_msb) and its Y position in bits
+// 31:0 (xy_buff_data_lsb); as fofb_processing_dcc_adapter does, node n's X
+// and Y positions are BPM positions n and n + 256.
+//
+// The object holds a header and a single-producer single-consumer ring of
+// frames, laid out and published as the co-simulation rings are (see
+// fofb_cosim_shm.h): each index is only written by its owner side, with
+// release semantics. The producer creates the object and stores the magic
+// number last; consumers attach to an existing one.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_XY_SHM_H_
+#define FOFB_XY_SHM_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "fofb_cc_status.h"
+#include "fofb_regs.h"
+
+namespace fofb {
+
+constexpr uint32_t c_XY_SHM_MAGIC = 0x4d485358; // "XSHM"
+constexpr uint32_t c_XY_SHM_VERSION = 1;
+constexpr unsigned c_XY_SHM_SLOTS = 64;
+
+struct xy_shm_frame {
+  uint64_t tf;
+  // Bit n % 64 of word n / 64: node n's packet arrived
+  uint64_t valid[c_CC_NODES / 64];
+  // X in bits 63:32, Y in bits 31:0
+  uint64_t xy[c_CC_NODES];
+};
+
+struct alignas(64) xy_shm_index {
+  std::atomic<uint32_t> val;
+};
+
+struct alignas(64) xy_shm_header {
+  std::atomic<uint32_t> magic;
+  uint32_t version;
+  uint32_t slots;
+};
+
+struct xy_shm_layout {
+  xy_shm_header hdr;
+  // Written by the producer
+  xy_shm_index head;
+  // Written by the consumer
+  xy_shm_index tail;
+  xy_shm_frame frames[c_XY_SHM_SLOTS];
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free,
+              "the ring is shared between processes");
+static_assert(sizeof(xy_shm_frame) == 2088, "xy_shm_frame must not have padding");
+
+inline std::string xy_shm_name(unsigned key)
+{
+  return "/fofb_xy_" + std::to_string(key);
+}
+
+// Split a frame into c_NUM_BPM_POS positions and the c_NUM_BPM_POS / 64
+// valid words taken by fofb_processing_model::process()
+void xy_frame_to_bpm_pos(const xy_shm_frame &f, int32_t *bpm_pos, uint64_t *valid);
+
+class xy_shm {
+ public:
+  // The producer creates the object (replacing any previous one) and unlinks
+  // it when destroyed, consumers attach to it
+  xy_shm(const std::string &name, bool create);
+  ~xy_shm();
+
+  xy_shm(const xy_shm &) = delete;
+  xy_shm &operator=(const xy_shm &) = delete;
+
+  // Producer side, returns false if the ring is full
+  bool push(const xy_shm_frame &f);
+  // Consumer side, returns false if the ring is empty
+  bool pop(xy_shm_frame &f);
+  // Frames in the ring
+  size_t size() const;
+
+  const std::string &name() const { return shm_name; }
+
+ private:
+  std::string shm_name;
+  bool owner;
+  int fd = -1;
+  xy_shm_layout *shm = nullptr;
+};
+
+} // namespace fofb
+
+#endif // FOFB_XY_SHM_H_
@@ -0,0 +1,100 @@
+// Typed register access for wb_fofb_processing_regs
+//
+// Generated by gen_regs_access.py from wb_fofb_processing_regs.cheby, do not edit.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef WB_FOFB_PROCESSING_REGS_ACCESS_H_
+#define WB_FOFB_PROCESSING_REGS_ACCESS_H_
+
+#include "fofb_reg_access.h"
+
+namespace fofb {
+namespace regs {
+
+struct wb_fofb_processing_regs {
+  static constexpr size_t size = WB_FOFB_PROCESSING_REGS_SIZE;
+  static constexpr unsigned num_consts = 3;
+
+  struct fixed_point_pos {
+    struct coeff : reg_def<WB_FOFB_PROCESSING_REGS_FIXED_POINT_POS_COEFF, access::ro_const, 32, 0> {
+      using val = field<WB_FOFB_PROCESSING_REGS_FIXED_POINT_POS_COEFF_VAL_MASK>;
+    };
+    struct accs_gains : reg_def<WB_FOFB_PROCESSING_REGS_FIXED_POINT_POS_ACCS_GAINS, access::ro_const, 32, 1> {
+      using val = field<WB_FOFB_PROCESSING_REGS_FIXED_POINT_POS_ACCS_GAINS_VAL_MASK>;
+    };
+  };
+  struct loop_intlk {
+    struct ctl : reg_def<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL, access::rw, 32> {
+      using sta_clr = field<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR>;
+      using src_en_orb_distort = field<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_ORB_DISTORT>;
+      using src_en_packet_loss = field<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_PACKET_LOSS>;
+    };
+    struct sta : reg_def<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA, access::ro, 32> {
+      using orb_distort = field<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT>;
+      using packet_loss = field<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_PACKET_LOSS>;
+    };
+    struct orb_distort_limit : reg_def<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_ORB_DISTORT_LIMIT, access::rw, 32> {
+      using val = field<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_ORB_DISTORT_LIMIT_VAL_MASK>;
+    };
+    struct min_num_pkts : reg_def<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_MIN_NUM_PKTS, access::rw, 32> {
+      using val = field<WB_FOFB_PROCESSING_REGS_LOOP_INTLK_MIN_NUM_PKTS_VAL_MASK>;
+    };
+  };
+  struct sp_decim_ratio_max : reg_def<WB_FOFB_PROCESSING_REGS_SP_DECIM_RATIO_MAX, access::ro_const, 32, 2> {
+    using cte = field<WB_FOFB_PROCESSING_REGS_SP_DECIM_RATIO_MAX_CTE_MASK>;
+  };
+  struct sps_ram_bank {
+    static constexpr size_t depth = 512;
+    struct data : mem_reg_def<WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK + WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK_DATA, WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK_SIZE, 512, access::rw, 32> {
+      using val = field<width_mask(32)>;
+    };
+  };
+  // ch[I], templated on the number of instantiated elements
+  template <unsigned I, unsigned N = 12>
+  struct ch {
+    static_assert(N <= 12, "ch supports up to 12 elements");
+    static_assert(I < N, "ch index out of range");
+    static constexpr size_t count = N;
+    static constexpr size_t base = WB_FOFB_PROCESSING_REGS_CH + I * WB_FOFB_PROCESSING_REGS_CH_SIZE;
+    struct coeff_ram_bank {
+      static constexpr size_t depth = 512;
+      struct data : mem_reg_def<base + WB_FOFB_PROCESSING_REGS_CH_COEFF_RAM_BANK + WB_FOFB_PROCESSING_REGS_CH_COEFF_RAM_BANK_DATA, WB_FOFB_PROCESSING_REGS_CH_COEFF_RAM_BANK_SIZE, 512, access::rw, 32> {
+        using val = field<width_mask(32)>;
+      };
+    };
+    struct acc {
+      struct ctl : reg_def<base + WB_FOFB_PROCESSING_REGS_CH_ACC_CTL, access::rw, 32> {
+        using clear = field<WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_CLEAR>;
+        using freeze = field<WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_FREEZE>;
+      };
+      struct gain : reg_def<base + WB_FOFB_PROCESSING_REGS_CH_ACC_GAIN, access::rw, 32> {
+        using val = field<WB_FOFB_PROCESSING_REGS_CH_ACC_GAIN_VAL_MASK>;
+      };
+    };
+    struct sp_limits {
+      struct max : reg_def<base + WB_FOFB_PROCESSING_REGS_CH_SP_LIMITS_MAX, access::rw, 32> {
+        using val = field<WB_FOFB_PROCESSING_REGS_CH_SP_LIMITS_MAX_VAL_MASK>;
+      };
+      struct min : reg_def<base + WB_FOFB_PROCESSING_REGS_CH_SP_LIMITS_MIN, access::rw, 32> {
+        using val = field<WB_FOFB_PROCESSING_REGS_CH_SP_LIMITS_MIN_VAL_MASK>;
+      };
+    };
+    struct sp_decim {
+      struct data : reg_def<base + WB_FOFB_PROCESSING_REGS_CH_SP_DECIM_DATA, access::ro, 32> {
+        using val = field<WB_FOFB_PROCESSING_REGS_CH_SP_DECIM_DATA_VAL_MASK>;
+      };
+      struct ratio : reg_def<base + WB_FOFB_PROCESSING_REGS_CH_SP_DECIM_RATIO, access::rw, 32> {
+        using val = field<WB_FOFB_PROCESSING_REGS_CH_SP_DECIM_RATIO_VAL_MASK>;
+      };
+    };
+  };
+};
+
+static_assert(wb_fofb_processing_regs::size == sizeof(::wb_fofb_processing_regs), "wb_fofb_processing_regs layout mismatch");
+
+} // namespace regs
+} // namespace fofb
+
+#endif // WB_FOFB_PROCESSING_REGS_ACCESS_H_
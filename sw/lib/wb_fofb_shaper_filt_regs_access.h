@@ -0,0 +1,47 @@
+// Typed register access for wb_fofb_shaper_filt_regs
+//
+// Generated by gen_regs_access.py from wb_fofb_shaper_filt_regs.cheby, do not edit.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef WB_FOFB_SHAPER_FILT_REGS_ACCESS_H_
+#define WB_FOFB_SHAPER_FILT_REGS_ACCESS_H_
+
+#include "fofb_reg_access.h"
+
+namespace fofb {
+namespace regs {
+
+struct wb_fofb_shaper_filt_regs {
+  static constexpr size_t size = WB_FOFB_SHAPER_FILT_REGS_SIZE;
+  static constexpr unsigned num_consts = 2;
+
+  // ch[I], templated on the number of instantiated elements
+  template <unsigned I, unsigned N = 12>
+  struct ch {
+    static_assert(N <= 12, "ch supports up to 12 elements");
+    static_assert(I < N, "ch index out of range");
+    static constexpr size_t count = N;
+    static constexpr size_t base = WB_FOFB_SHAPER_FILT_REGS_CH + I * WB_FOFB_SHAPER_FILT_REGS_CH_SIZE;
+    struct coeffs {
+      static constexpr size_t depth = 80;
+      struct val : mem_reg_def<base + WB_FOFB_SHAPER_FILT_REGS_CH_COEFFS + WB_FOFB_SHAPER_FILT_REGS_CH_COEFFS_VAL, WB_FOFB_SHAPER_FILT_REGS_CH_COEFFS_SIZE, 80, access::rw, 32> {
+      };
+    };
+  };
+  struct num_biquads : reg_def<WB_FOFB_SHAPER_FILT_REGS_NUM_BIQUADS, access::ro_const, 32, 0> {
+    using val = field<width_mask(32)>;
+  };
+  struct coeffs_fp_repr : reg_def<WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR, access::ro_const, 32, 1> {
+    using int_width = field<WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_INT_WIDTH_MASK>;
+    using frac_width = field<WB_FOFB_SHAPER_FILT_REGS_COEFFS_FP_REPR_FRAC_WIDTH_MASK>;
+  };
+};
+
+static_assert(wb_fofb_shaper_filt_regs::size == sizeof(::wb_fofb_shaper_filt_regs), "wb_fofb_shaper_filt_regs layout mismatch");
+
+} // namespace regs
+} // namespace fofb
+
+#endif // WB_FOFB_SHAPER_FILT_REGS_ACCESS_H_
@@ -0,0 +1,71 @@
+// Typed register access for wb_fofb_sys_id_regs
+//
+// Generated by gen_regs_access.py from wb_fofb_sys_id_regs.cheby, do not edit.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef WB_FOFB_SYS_ID_REGS_ACCESS_H_
+#define WB_FOFB_SYS_ID_REGS_ACCESS_H_
+
+#include "fofb_reg_access.h"
+
+namespace fofb {
+namespace regs {
+
+struct wb_fofb_sys_id_regs {
+  static constexpr size_t size = WB_FOFB_SYS_ID_REGS_SIZE;
+  static constexpr unsigned num_consts = 2;
+
+  struct bpm_pos_flatenizer {
+    struct ctl : reg_def<WB_FOFB_SYS_ID_REGS_BPM_POS_FLATENIZER_CTL, access::rw, 32> {
+      using base_bpm_id = field<WB_FOFB_SYS_ID_REGS_BPM_POS_FLATENIZER_CTL_BASE_BPM_ID_MASK>;
+    };
+    struct max_num_cte : reg_def<WB_FOFB_SYS_ID_REGS_BPM_POS_FLATENIZER_MAX_NUM_CTE, access::ro_const, 16, 0> {
+      using val = field<width_mask(16)>;
+    };
+  };
+  struct prbs {
+    struct ctl : reg_def<WB_FOFB_SYS_ID_REGS_PRBS_CTL, access::rw, 32> {
+      using rst = field<WB_FOFB_SYS_ID_REGS_PRBS_CTL_RST>;
+      using step_duration = field<WB_FOFB_SYS_ID_REGS_PRBS_CTL_STEP_DURATION_MASK>;
+      using lfsr_length = field<WB_FOFB_SYS_ID_REGS_PRBS_CTL_LFSR_LENGTH_MASK>;
+      using bpm_pos_distort_en = field<WB_FOFB_SYS_ID_REGS_PRBS_CTL_BPM_POS_DISTORT_EN>;
+      using sp_distort_en = field<WB_FOFB_SYS_ID_REGS_PRBS_CTL_SP_DISTORT_EN>;
+      using sp_distort_mov_avg_num_taps_sel = field<WB_FOFB_SYS_ID_REGS_PRBS_CTL_SP_DISTORT_MOV_AVG_NUM_TAPS_SEL_MASK>;
+    };
+    struct sp_distort_mov_avg_max_num_taps_sel_cte : reg_def<WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_MOV_AVG_MAX_NUM_TAPS_SEL_CTE, access::ro_const, 8, 1> {
+      using val = field<width_mask(8)>;
+    };
+    struct sp_distort {
+      // ch[I], templated on the number of instantiated elements
+      template <unsigned I, unsigned N = 12>
+      struct ch {
+        static_assert(N <= 12, "ch supports up to 12 elements");
+        static_assert(I < N, "ch index out of range");
+        static constexpr size_t count = N;
+        static constexpr size_t base = WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH + I * WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_SIZE;
+        struct levels : reg_def<base + WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_LEVELS, access::rw, 32> {
+          using level_0 = field<WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_LEVELS_LEVEL_0_MASK>;
+          using level_1 = field<WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_LEVELS_LEVEL_1_MASK>;
+        };
+      };
+    };
+    struct bpm_pos_distort {
+      struct distort_ram {
+        static constexpr size_t depth = 512;
+        struct levels : mem_reg_def<WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM + WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM_LEVELS, WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM_SIZE, 512, access::rw, 32> {
+          using level_0 = field<WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM_LEVELS_LEVEL_0_MASK>;
+          using level_1 = field<WB_FOFB_SYS_ID_REGS_PRBS_BPM_POS_DISTORT_DISTORT_RAM_LEVELS_LEVEL_1_MASK>;
+        };
+      };
+    };
+  };
+};
+
+static_assert(wb_fofb_sys_id_regs::size == sizeof(::wb_fofb_sys_id_regs), "wb_fofb_sys_id_regs layout mismatch");
+
+} // namespace regs
+} // namespace fofb
+
+#endif // WB_FOFB_SYS_ID_REGS_ACCESS_H_
@@ -0,0 +1,274 @@
+// Archive tests: column codec round trip (vectorized and sequential decoders)
+// on slow, constant and extreme data, writer/reader round trip over several
+// chunks, timeframe range queries and corrupt files
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_archive.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+void check_codec(const std::vector<int32_t> &vals)
+{
+  std::vector<uint8_t> enc = {0xaa};
+  archive_encode_column(vals.data(), vals.size(), enc);
+  const size_t blocks = (vals.size() + c_ARCHIVE_BLOCK - 1) / c_ARCHIVE_BLOCK;
+  for (bool scalar: {false, true}) {
+    std::vector<int32_t> dec(blocks * c_ARCHIVE_BLOCK);
+    archive_decode_column(&enc[1], enc.size() - 1, vals.size(), dec.data(), scalar);
+    TEST_ASSERT(std::equal(vals.begin(), vals.end(), dec.begin()));
+  }
+
+  // Too short, or for another number of values
+  std::vector<int32_t> dec((blocks + 1) * c_ARCHIVE_BLOCK);
+  for (size_t size: {enc.size() - 2, enc.size() - 1}) {
+    bool threw = false;
+    try {
+      const size_t n = size == enc.size() - 1 ? vals.size() + c_ARCHIVE_BLOCK : vals.size();
+      archive_decode_column(&enc[1], size, n, dec.data());
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    TEST_ASSERT(threw);
+  }
+}
+
+void test_codec()
+{
+  test_rng rng;
+  // Slowly moving orbit
+  std::vector<int32_t> orbit(10000);
+  int32_t x = 123456;
+  for (int32_t &v: orbit)
+    v = x += int32_t(rng.range(-50, 50));
+  check_codec(orbit);
+
+  // A constant column takes no blocks data
+  std::vector<int32_t> constant(1000, -7);
+  std::vector<uint8_t> enc;
+  archive_encode_column(constant.data(), constant.size(), enc);
+  TEST_ASSERT(enc.size() == 8 + 4);
+  check_codec(constant);
+
+  // Full range jumps, every width
+  std::vector<int32_t> extreme;
+  for (unsigned w = 0; w <= 32; w++)
+    for (unsigned i = 0; i < c_ARCHIVE_BLOCK; i++)
+      extreme.push_back(w ? int32_t(rng.next() >> (64 - w)) : int32_t(i % 2));
+  extreme.push_back(INT32_MIN);
+  extreme.push_back(INT32_MAX);
+  extreme.push_back(INT32_MIN);
+  check_codec(extreme);
+
+  for (size_t n: {size_t(0), size_t(1), size_t(255), size_t(257)})
+    check_codec(std::vector<int32_t>(orbit.begin(), orbit.begin() + n));
+}
+
+struct archive_data {
+  std::vector<uint64_t> tf;
+  std::vector<std::vector<int32_t>> cols;
+};
+
+archive_data write_archive(const std::string &fname, unsigned chunk_rows)
+{
+  test_rng rng;
+  const std::vector<std::string> names = {"pos_x", "pos_y", "sp", "err_cnt"};
+  archive_data d;
+  d.cols.resize(names.size());
+  archive_writer w(fname, names, chunk_rows);
+
+  // tf_cntr_32 wrapping around, some timeframes missing
+  tf_unwrapper unwrap;
+  uint32_t tf32 = 0xffffff00;
+  int32_t row[4] = {1000, -1000, 0, 0};
+  for (unsigned i = 0; i < 5000; i++) {
+    tf32 += rng.next() % 8 ? 1 : 3;
+    row[0] += int32_t(rng.range(-20, 20));
+    row[1] += int32_t(rng.range(-20, 20));
+    row[2] = int32_t(rng.range(-32768, 32767));
+    row[3] += rng.next() % 1000 == 0;
+    const uint64_t tf = unwrap(tf32);
+    w.append(tf, row);
+    d.tf.push_back(tf);
+    for (unsigned c = 0; c < 4; c++)
+      d.cols[c].push_back(row[c]);
+  }
+  TEST_ASSERT(d.tf.back() > uint64_t(1) << 32 && d.tf.front() == 0xffffff01);
+  TEST_ASSERT(w.rows() == 5000);
+  // Not there before close()
+  TEST_ASSERT(access(fname.c_str(), F_OK) != 0);
+  w.close();
+  return d;
+}
+
+void check_query(const archive_reader &r, const archive_data &d, uint64_t lo, uint64_t hi,
+                 const std::vector<unsigned> &cols)
+{
+  const archive_columns res = r.query(lo, hi, cols);
+  size_t k = 0;
+  for (size_t i = 0; i < d.tf.size(); i++) {
+    if (d.tf[i] < lo || d.tf[i] > hi)
+      continue;
+    TEST_ASSERT(k < res.tf.size() && res.tf[k] == d.tf[i]);
+    for (size_t c = 0; c < cols.size(); c++)
+      TEST_ASSERT(res.vals[c][k] == d.cols[cols[c]][i]);
+    k++;
+  }
+  TEST_ASSERT(k == res.tf.size() && res.vals.size() == cols.size());
+}
+
+void test_round_trip()
+{
+  tmp_file f;
+  unlink(f.path.c_str());
+  const archive_data d = write_archive(f.path, 1000);
+
+  archive_reader r(f.path);
+  TEST_ASSERT(r.rows() == 5000 && r.chunks() == 5);
+  TEST_ASSERT(r.columns().size() == 4 && r.columns()[2] == "sp");
+  TEST_ASSERT(r.column("err_cnt") == 3 && r.column("none") == -1);
+  TEST_ASSERT(r.tf_first() == d.tf.front() && r.tf_last() == d.tf.back());
+  // Smaller than the raw values
+  TEST_ASSERT(r.file_size() < 5000 * 5 * sizeof(int32_t) / 2);
+
+  for (bool scalar: {false, true}) {
+    r.set_force_scalar(scalar);
+    check_query(r, d, 0, UINT64_MAX, {0, 1, 2, 3});
+    // Chunk boundaries, column subsets
+    check_query(r, d, d.tf[999], d.tf[1000], {3, 0});
+    check_query(r, d, d.tf[999] + 1, d.tf[2500], {2});
+    check_query(r, d, d.tf[4321], d.tf[4321], {1});
+    check_query(r, d, d.tf[10], d.tf[4999], {});
+  }
+
+  // Nothing in range
+  TEST_ASSERT(r.query(0, d.tf.front() - 1, {0}).tf.empty());
+  TEST_ASSERT(r.query(d.tf.back() + 1, UINT64_MAX, {0}).tf.empty());
+  TEST_ASSERT(r.query(d.tf[20], d.tf[10], {0}).tf.empty());
+
+  // A scan only sees the chunks in range
+  size_t calls = 0;
+  r.scan(d.tf[1500], d.tf[2999], {0}, [&](size_t n, const uint64_t *, const int32_t *const *) {
+    TEST_ASSERT(n > 0);
+    calls++;
+  });
+  TEST_ASSERT(calls == 2);
+
+  bool threw = false;
+  try {
+    r.query(0, UINT64_MAX, {4});
+  } catch (const std::out_of_range &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+  unlink(f.path.c_str());
+}
+
+void test_errors()
+{
+  tmp_file f;
+  bool threw = false;
+  {
+    archive_writer w(f.path, {"a"}, 16);
+    const int32_t v = 1;
+    w.append(10, &v);
+    try {
+      w.append(9, &v);
+    } catch (const std::invalid_argument &) {
+      threw = true;
+    }
+    // Destroyed without close()
+  }
+  TEST_ASSERT(threw);
+  TEST_ASSERT(access((f.path + ".tmp").c_str(), F_OK) != 0);
+
+  threw = false;
+  try {
+    archive_writer w(f.path, {std::string(c_ARCHIVE_NAME_LEN, 'n')});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+
+  // An empty archive
+  {
+    archive_writer w(f.path, {"a", "b"});
+    w.close();
+    archive_reader r(f.path);
+    TEST_ASSERT(r.rows() == 0 && r.chunks() == 0 && r.query(0, UINT64_MAX, {1}).tf.empty());
+  }
+
+  // Truncated or corrupt
+  unlink(f.path.c_str());
+  write_archive(f.path, 256);
+  std::vector<char> data(archive_reader(f.path).file_size());
+  FILE *fp = std::fopen(f.path.c_str(), "rb");
+  TEST_ASSERT(fp && std::fread(data.data(), 1, data.size(), fp) == data.size());
+  std::fclose(fp);
+  archive_file_header hdr;
+  std::memcpy(&hdr, data.data(), sizeof(hdr));
+  // The index is read in place, aligned for its 64 bits fields
+  TEST_ASSERT(hdr.index_offset % 8 == 0);
+  auto rewrite = [&](const std::vector<char> &bytes) {
+    FILE *out = std::fopen(f.path.c_str(), "wb");
+    TEST_ASSERT(out && std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size());
+    std::fclose(out);
+  };
+  auto fails = [&]() {
+    try {
+      archive_reader r(f.path);
+      r.query(0, UINT64_MAX, {0, 1, 2, 3});
+    } catch (const std::runtime_error &) {
+      return true;
+    }
+    return false;
+  };
+
+  rewrite(std::vector<char>(data.begin(), data.end() - 1));
+  TEST_ASSERT(fails());
+  std::vector<char> bad = data;
+  bad[0] = 'X';
+  rewrite(bad);
+  TEST_ASSERT(fails());
+  // A block width above 32
+  bad = data;
+  bad[sizeof(hdr) + 8] = 40;
+  rewrite(bad);
+  TEST_ASSERT(fails());
+  // A column reference past the index
+  bad = data;
+  archive_column_ref ref;
+  const size_t ref_pos = hdr.index_offset + 4 * c_ARCHIVE_NAME_LEN +
+                         hdr.chunks * sizeof(archive_chunk_desc);
+  std::memcpy(&ref, &bad[ref_pos], sizeof(ref));
+  ref.size = hdr.index_offset;
+  std::memcpy(&bad[ref_pos], &ref, sizeof(ref));
+  rewrite(bad);
+  TEST_ASSERT(fails());
+}
+
+} // namespace
+
+int main()
+{
+  test_codec();
+  test_round_trip();
+  test_errors();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
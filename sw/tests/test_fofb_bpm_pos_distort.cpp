@@ -0,0 +1,189 @@
+// BPM positions distortion model tests: flatenizer windows and received
+// flags, per-index distortion levels following the PRBS with 32 bits
+// saturation, the trigger semantics and chunked processing
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "fofb_bpm_pos_distort.h"
+#include "test_util.h"
+#include "wb_fofb_sys_id_regs_access.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+using prbs_ctl_reg = regs::wb_fofb_sys_id_regs::prbs::ctl;
+
+constexpr unsigned c_VALID_WORDS = c_NUM_BPM_POS / 64;
+
+std::vector<int32_t> random_positions(test_rng &rng, size_t n_tf)
+{
+  std::vector<int32_t> pos(n_tf * c_NUM_BPM_POS);
+  for (int32_t &p: pos)
+    p = int32_t(rng.next() % 2000001) - 1000000;
+  return pos;
+}
+
+void test_flatenizer()
+{
+  test_rng rng;
+  const size_t n_tf = 3;
+  std::vector<int32_t> pos = random_positions(rng, n_tf);
+  // Timeframe 1 misses BPM 251 (x and y), the others receive everything
+  std::vector<uint64_t> valid(n_tf * c_VALID_WORDS, ~uint64_t(0));
+  valid[c_VALID_WORDS + 251 / 64] &= ~(uint64_t(1) << (251 % 64));
+  valid[c_VALID_WORDS + (256 + 251) / 64] &= ~(uint64_t(1) << ((256 + 251) % 64));
+
+  bpm_pos_distort_model model;
+  model.set_base_bpm_id(250);
+  TEST_ASSERT(model.base_bpm_id() == 250 && model.max_num() == c_BPM_POS_FLAT_MAX_NUM);
+  const unsigned m = model.max_num();
+  std::vector<int32_t> flat(n_tf * BPM_POS_FLATS * m);
+  std::vector<uint8_t> rcvd(n_tf * 2 * m);
+  bpm_pos_distort_out out;
+  out.flat = flat.data();
+  out.flat_rcvd = rcvd.data();
+  model.process(pos.data(), valid.data(), n_tf, out);
+
+  for (size_t t = 0; t < n_tf; t++) {
+    const int32_t *p = &pos[t * c_NUM_BPM_POS];
+    const int32_t *f = &flat[t * BPM_POS_FLATS * m];
+    const uint8_t *r = &rcvd[t * 2 * m];
+    for (unsigned i = 0; i < m; i++) {
+      const bool missing = t == 1 && i == 1;
+      // The x window runs into the first y indexes, the y one past the last
+      // index is never received
+      TEST_ASSERT(r[i] == !missing && f[BPM_POS_FLAT_X * m + i] == (missing ? 0 : p[250 + i]));
+      const bool y_rcvd = 256 + 250 + i < c_NUM_BPM_POS && !missing;
+      TEST_ASSERT(r[m + i] == y_rcvd);
+      TEST_ASSERT(f[BPM_POS_FLAT_Y * m + i] == (y_rcvd ? p[256 + 250 + i] : 0));
+      // Distortion disabled
+      TEST_ASSERT(f[DISTORT_BPM_POS_FLAT_X * m + i] == f[BPM_POS_FLAT_X * m + i]);
+      TEST_ASSERT(f[DISTORT_BPM_POS_FLAT_Y * m + i] == f[BPM_POS_FLAT_Y * m + i]);
+    }
+  }
+}
+
+void test_distort()
+{
+  test_rng rng;
+  const size_t n_tf = 300;
+  std::vector<int32_t> pos = random_positions(rng, n_tf);
+  // Saturation both ways whenever the PRBS is 1 (see the levels below)
+  for (size_t t = 0; t < n_tf; t++) {
+    pos[t * c_NUM_BPM_POS + 2] = INT32_MAX - 20000;
+    pos[t * c_NUM_BPM_POS + 3] = INT32_MIN + 20000;
+  }
+
+  auto regs = std::make_unique<wb_fofb_sys_id_regs>();
+  std::memset(regs.get(), 0, sizeof(*regs));
+  prbs_config cfg;
+  cfg.lfsr_length = 7;
+  cfg.step_duration = 2;
+  regs->prbs.ctl = prbs_ctl_reg::rst::put(
+    prbs_ctl_reg::bpm_pos_distort_en::put(cfg.to_ctl(), 1), 1);
+  std::vector<prbs_levels> lv(c_NUM_BPM_POS);
+  for (unsigned idx = 0; idx < c_NUM_BPM_POS; idx++) {
+    lv[idx].level_0 = int16_t(idx * 37 % 2001 - 1000);
+    lv[idx].level_1 = int16_t(idx % 2 ? -32768 : 32767);
+    regs->prbs.bpm_pos_distort.distort_ram[idx].levels = lv[idx].to_reg();
+  }
+
+  bpm_pos_distort_model model;
+  model.load_regs(*regs);
+  // prbs.ctl is only applied on the trigger
+  TEST_ASSERT(!model.distort_en());
+  model.trigger();
+  TEST_ASSERT(model.distort_en() && model.timeframes() == 0);
+
+  std::vector<int32_t> distort(n_tf * c_NUM_BPM_POS);
+  std::vector<uint8_t> prbs(n_tf);
+  bpm_pos_distort_out out;
+  out.distort = distort.data();
+  out.prbs = prbs.data();
+  model.process(pos.data(), nullptr, n_tf, out);
+  TEST_ASSERT(model.timeframes() == n_tf);
+
+  // Timeframe t sees the PRBS after t iterations
+  const std::vector<uint8_t> seq = prbs_sequence(cfg, n_tf);
+  TEST_ASSERT(prbs[0] == 0);
+  for (size_t t = 1; t < n_tf; t++)
+    TEST_ASSERT(prbs[t] == seq[t - 1]);
+
+  unsigned saturated = 0;
+  for (size_t t = 0; t < n_tf; t++) {
+    for (unsigned idx = 0; idx < c_NUM_BPM_POS; idx++) {
+      const int64_t sum = int64_t(pos[t * c_NUM_BPM_POS + idx]) +
+                          (prbs[t] ? lv[idx].level_1 : lv[idx].level_0);
+      const int64_t exp = sum > INT32_MAX ? INT32_MAX : sum < INT32_MIN ? INT32_MIN : sum;
+      saturated += exp != sum;
+      TEST_ASSERT(distort[t * c_NUM_BPM_POS + idx] == exp);
+    }
+  }
+  const size_t ones = std::count(prbs.begin(), prbs.end(), 1);
+  TEST_ASSERT(ones > 0 && saturated == 2 * ones);
+
+  // Chunks of any size give the same stream, the flats agree with it
+  model.trigger();
+  std::vector<int32_t> distort_c(n_tf * c_NUM_BPM_POS);
+  std::vector<int32_t> flat(n_tf * BPM_POS_FLATS * c_BPM_POS_FLAT_MAX_NUM);
+  for (size_t t = 0; t < n_tf;) {
+    const size_t n = std::min<size_t>(rng.next() % 40 + 1, n_tf - t);
+    bpm_pos_distort_out o;
+    o.distort = &distort_c[t * c_NUM_BPM_POS];
+    o.flat = &flat[t * BPM_POS_FLATS * c_BPM_POS_FLAT_MAX_NUM];
+    model.process(&pos[t * c_NUM_BPM_POS], nullptr, n, o);
+    t += n;
+  }
+  TEST_ASSERT(distort_c == distort);
+  const unsigned m = c_BPM_POS_FLAT_MAX_NUM;
+  for (size_t t = 0; t < n_tf; t++) {
+    for (unsigned i = 0; i < m; i++) {
+      const int32_t *f = &flat[t * BPM_POS_FLATS * m];
+      TEST_ASSERT(f[DISTORT_BPM_POS_FLAT_X * m + i] == distort[t * c_NUM_BPM_POS + i]);
+      TEST_ASSERT(f[DISTORT_BPM_POS_FLAT_Y * m + i] == distort[t * c_NUM_BPM_POS + 256 + i]);
+    }
+  }
+
+  // Flats alone, without the full distorted output, and skipping the PRBS
+  // to a later capture start
+  model.trigger();
+  model.skip(100);
+  std::vector<int32_t> flat_s(BPM_POS_FLATS * m);
+  bpm_pos_distort_out o;
+  o.flat = flat_s.data();
+  model.process(&pos[100 * c_NUM_BPM_POS], nullptr, 1, o);
+  TEST_ASSERT(std::equal(flat_s.begin(), flat_s.end(), &flat[100 * BPM_POS_FLATS * m]));
+
+  // A trigger without prbs.ctl.rst keeps the sequence going, and disables
+  // the distortion as the register now says
+  model.set_prbs_ctl(cfg.to_ctl());
+  model.trigger();
+  TEST_ASSERT(!model.distort_en() && model.timeframes() == 101);
+  model.process(pos.data(), nullptr, 1, out);
+  TEST_ASSERT(prbs[0] == seq[100] && std::equal(pos.begin(), pos.begin() + c_NUM_BPM_POS,
+                                                 distort.begin()));
+  // Changing the LFSR length resets the PRBS
+  cfg.lfsr_length = 9;
+  model.set_prbs_ctl(cfg.to_ctl());
+  TEST_ASSERT(model.timeframes() == 0);
+}
+
+} // namespace
+
+int main()
+{
+  test_flatenizer();
+  test_distort();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
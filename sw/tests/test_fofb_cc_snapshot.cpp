@@ -0,0 +1,251 @@
+// FOFB CC snapshot tests, against a simulation of the CC buffers handshake
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdio>
+#include <stdexcept>
+
+#include "fofb_cc_snapshot.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+using cc = regs::fofb_cc_regs;
+
+// Buffer entries hold the timeframe they were written in (bits 31:16) and
+// their index, so the tests can tell when each one was sampled
+uint32_t entry(uint32_t tf, unsigned i, unsigned buf)
+{
+  return tf << 16 | buf << 12 | i;
+}
+
+// CC buffers as seen from the bus. The timeframe counter advances every
+// 'tf_accesses' accesses (never when 0); the live buffers follow it.
+class sim_cc_device {
+ public:
+  explicit sim_cc_device(unsigned tf_accesses): tf_accesses(tf_accesses) {}
+
+  uint32_t read32(size_t addr)
+  {
+    tick();
+    reads++;
+    switch (addr) {
+      case cc::toa_ctl::reg_addr:
+        return toa.rd_en;
+      case cc::toa_data::reg_addr:
+        return toa.data;
+      case cc::rcb_ctl::reg_addr:
+        return rcb.rd_en;
+      case cc::rcb_data::reg_addr:
+        return rcb.data;
+      case cc::xy_buff_ctl::reg_addr:
+        return cc::xy_buff_ctl::addr::put(0, xy_addr);
+      case cc::xy_buff_data_msb::reg_addr:
+        return uint32_t(xy_data >> 32);
+      case cc::xy_buff_data_lsb::reg_addr:
+        return uint32_t(xy_data);
+      case cc::ram_reg::data::reg_addr(cc_status::time_frame_count):
+        return tf;
+    }
+    TEST_ASSERT(false);
+    return 0;
+  }
+
+  uint64_t read64(size_t addr)
+  {
+    tick();
+    reads++;
+    TEST_ASSERT(addr == cc::xy_buff_data_msb::reg_addr);
+    return xy_data >> 32 | xy_data << 32;
+  }
+
+  void write32(size_t addr, uint32_t val)
+  {
+    tick();
+    writes++;
+    switch (addr) {
+      case cc::toa_ctl::reg_addr:
+        toa.write(val, tf, 0);
+        return;
+      case cc::rcb_ctl::reg_addr:
+        rcb.write(val, tf, 1);
+        return;
+      case cc::xy_buff_ctl::reg_addr:
+        xy_addr = cc::xy_buff_ctl::addr::get(val);
+        TEST_ASSERT(xy_addr < c_CC_XY_DEPTH);
+        xy_data = uint64_t(entry(tf, xy_addr, 2)) << 32 | entry(tf, xy_addr, 3);
+        return;
+    }
+    TEST_ASSERT(false);
+  }
+
+  struct buffer {
+    uint32_t rd_en = 0;
+    uint32_t data = 0;
+    unsigned ptr = 0;
+    uint32_t frozen_tf = 0;
+
+    void write(uint32_t val, uint32_t tf, unsigned buf)
+    {
+      const uint32_t en = val & 1;
+      if (en && !rd_en) {
+        frozen_tf = tf;
+        ptr = 0;
+      }
+      rd_en = en;
+      if (val & 2) {
+        // Strobes are only meaningful while frozen
+        TEST_ASSERT(rd_en && ptr < c_CC_NODES);
+        data = entry(frozen_tf, ptr++, buf);
+      }
+    }
+  };
+
+  buffer toa;
+  buffer rcb;
+  unsigned reads = 0;
+  unsigned writes = 0;
+
+ private:
+  void tick()
+  {
+    if (tf_accesses && ++accesses % tf_accesses == 0)
+      tf++;
+  }
+
+  unsigned tf_accesses;
+  unsigned accesses = 0;
+  uint32_t tf = 1;
+  unsigned xy_addr = 0;
+  uint64_t xy_data = 0;
+};
+
+void check_snapshot(const cc_snapshot &snap, const sim_cc_device &dev)
+{
+  TEST_ASSERT(snap.reads == dev.reads && snap.writes == dev.writes);
+  // Released at the end
+  TEST_ASSERT(!dev.toa.rd_en && !dev.rcb.rd_en);
+  TEST_ASSERT(dev.toa.frozen_tf <= snap.tf_start && snap.tf_start <= snap.tf_end);
+  for (unsigned i = 0; i < snap.toa.size(); i++)
+    TEST_ASSERT(snap.toa[i] == entry(dev.toa.frozen_tf, i, 0));
+  for (unsigned i = 0; i < snap.rcb.size(); i++)
+    TEST_ASSERT(snap.rcb[i] == entry(dev.rcb.frozen_tf, i, 1));
+  for (unsigned i = 0; i < snap.xy.size(); i++) {
+    const uint32_t tf = uint32_t(snap.xy[i] >> 48);
+    TEST_ASSERT(tf >= dev.toa.frozen_tf && tf <= snap.tf_end);
+    TEST_ASSERT(snap.xy[i] == (uint64_t(entry(tf, i, 2)) << 32 | entry(tf, i, 3)));
+  }
+}
+
+void test_snapshot()
+{
+  for (bool read64: {false, true}) {
+    sim_cc_device dev(50);
+    cc_snapshot_config cfg;
+    cfg.xy_read64 = read64;
+    fofb_cc_snapshotter<sim_cc_device> snapper(dev, 0, cfg);
+    cc_snapshot snap;
+    snapper.take(snap);
+    TEST_ASSERT(snap.toa.size() == c_CC_NODES && snap.rcb.size() == c_CC_NODES);
+    TEST_ASSERT(snap.xy.size() == c_CC_XY_DEPTH);
+    check_snapshot(snap, dev);
+    // Index by index, the X/Y buffer is sampled across timeframes
+    TEST_ASSERT(snap.tf_end > snap.tf_start);
+
+    // Strobes, X/Y address and the two timeframe counter reads, 4 control
+    // writes to freeze and 2 to release
+    const unsigned xy_reads = read64 ? c_CC_XY_DEPTH : 2 * c_CC_XY_DEPTH;
+    TEST_ASSERT(snap.reads == 2 * c_CC_NODES + xy_reads + 2);
+    TEST_ASSERT(snap.writes == 2 * c_CC_NODES + c_CC_XY_DEPTH + 6);
+
+    // Next snapshot into the same buffers
+    dev.reads = dev.writes = 0;
+    snapper.take(snap);
+    check_snapshot(snap, dev);
+  }
+}
+
+void test_word_by_word()
+{
+  // Without timeframes going by, both readouts return the same data
+  sim_cc_device dev(0);
+  fofb_cc_snapshotter<sim_cc_device> snapper(dev);
+  cc_snapshot fast, ref;
+  snapper.take(fast);
+  dev.reads = dev.writes = 0;
+  snapper.take_word_by_word(ref);
+  check_snapshot(ref, dev);
+  TEST_ASSERT(fast.toa == ref.toa && fast.rcb == ref.rcb && fast.xy == ref.xy);
+  TEST_ASSERT(ref.reads == 4 * c_CC_NODES + 2 * c_CC_XY_DEPTH + 2);
+  TEST_ASSERT(ref.writes == fast.writes);
+  TEST_ASSERT(ref.reads > fast.reads);
+}
+
+void test_depths()
+{
+  sim_cc_device dev(7);
+  cc_snapshot_config cfg;
+  cfg.toa_depth = 0;
+  cfg.rcb_depth = 10;
+  cfg.xy_depth = 40;
+  fofb_cc_snapshotter<sim_cc_device> snapper(dev, 0, cfg);
+  cc_snapshot snap;
+  snapper.take(snap);
+  TEST_ASSERT(snap.toa.empty() && snap.rcb.size() == 10 && snap.xy.size() == 40);
+  check_snapshot(snap, dev);
+
+  cfg.xy_depth = c_CC_XY_DEPTH + 1;
+  bool thrown = false;
+  try {
+    fofb_cc_snapshotter<sim_cc_device> bad(dev, 0, cfg);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+}
+
+void test_read64()
+{
+  tmp_file f;
+  mmap_device dev(f.path, sizeof(::fofb_cc_regs), 0, true);
+  dev.write32(cc::xy_buff_data_msb::reg_addr, 0x89abcdef);
+  dev.write32(cc::xy_buff_data_lsb::reg_addr, 0x01234567);
+  dev.reset_stats();
+  TEST_ASSERT(dev.read64(cc::xy_buff_data_msb::reg_addr) == 0x0123456789abcdefull);
+  TEST_ASSERT(dev.stats().reads == 2 && dev.stats().read_bursts == 1);
+
+  bool thrown = false;
+  try {
+    dev.read64(cc::xy_buff_ctl::reg_addr);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+
+  // Through the snapshotter on a stand-in device: X/Y pairs read either way
+  // match
+  fofb_cc_snapshotter<> snapper(dev);
+  cc_snapshot_config cfg;
+  cfg.xy_read64 = true;
+  fofb_cc_snapshotter<> snapper64(dev, 0, cfg);
+  cc_snapshot a, b;
+  snapper.take(a);
+  snapper64.take(b);
+  TEST_ASSERT(a.xy == b.xy && a.xy[0] == 0x89abcdef01234567ull);
+}
+
+} // namespace
+
+int main()
+{
+  test_snapshot();
+  test_word_by_word();
+  test_depths();
+  test_read64();
+  std::puts("SUCCESS!");
+  return 0;
+}
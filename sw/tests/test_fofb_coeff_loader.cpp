@@ -0,0 +1,117 @@
+// fofb_coeff_loader tests, on a file-backed stand-in device
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+#include "fofb_coeff_loader.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+std::unique_ptr<wb_fofb_processing_regs> random_image(test_rng &rng)
+{
+  auto img = std::make_unique<wb_fofb_processing_regs>();
+  std::memset(img.get(), 0, sizeof(*img));
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+    img->sps_ram_bank[i].data = uint32_t(rng.next());
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+      img->ch[ch].coeff_ram_bank[i].data = uint32_t(rng.next());
+  return img;
+}
+
+bool device_matches(const mmap_device &dev, const wb_fofb_processing_regs &img)
+{
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++) {
+    if (dev.read32(WB_FOFB_PROCESSING_REGS_SPS_RAM_BANK + 4 * i) != img.sps_ram_bank[i].data)
+      return false;
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+      if (dev.read32(WB_FOFB_PROCESSING_REGS_CH + ch * WB_FOFB_PROCESSING_REGS_CH_SIZE +
+                     4 * i) != img.ch[ch].coeff_ram_bank[i].data)
+        return false;
+  }
+  return true;
+}
+
+void test_delta_load()
+{
+  constexpr size_t c_NUM_WORDS = (1 + c_MAX_CHANNELS) * c_NUM_BPM_POS;
+  tmp_file f;
+  mmap_device dev(f.path, sizeof(wb_fofb_processing_regs), 0, true);
+  fofb_coeff_loader loader(dev);
+  test_rng rng;
+
+  // First load: the stand-in device is zeroed, nearly everything changes
+  auto img = random_image(rng);
+  auto st = loader.load(*img, verify_mode::full);
+  TEST_ASSERT(st.words_written == c_NUM_WORDS);
+  TEST_ASSERT(st.words_read == c_NUM_WORDS);
+  TEST_ASSERT(device_matches(dev, *img));
+
+  // Reloading the same image costs no bus access besides verification
+  dev.reset_stats();
+  st = loader.load(*img, verify_mode::none);
+  TEST_ASSERT(st.words_written == 0 && st.bursts == 0);
+  TEST_ASSERT(dev.stats().writes == 0 && dev.stats().reads == 0);
+
+  // A few changed words: close ones are merged into a single burst, far
+  // apart ones get bursts of their own
+  img->ch[3].coeff_ram_bank[100].data ^= 1;
+  img->ch[3].coeff_ram_bank[103].data ^= 1;
+  img->ch[3].coeff_ram_bank[300].data ^= 1;
+  img->sps_ram_bank[511].data ^= 1;
+  dev.reset_stats();
+  st = loader.load(*img, verify_mode::written);
+  TEST_ASSERT(st.words_changed == 4);
+  TEST_ASSERT(st.bursts == 3);
+  TEST_ASSERT(st.words_written == 4 + 2);
+  TEST_ASSERT(st.words_read == st.words_written);
+  TEST_ASSERT(dev.stats().write_bursts == 3);
+  TEST_ASSERT(device_matches(dev, *img));
+
+  // Sparse verification reads one word per burst plus the samples
+  loader.set_sparse_samples(8);
+  img->ch[11].coeff_ram_bank[0].data ^= 1;
+  st = loader.load(*img, verify_mode::sparse);
+  TEST_ASSERT(st.bursts == 1 && st.words_read == 1 + 8);
+  TEST_ASSERT(device_matches(dev, *img));
+
+  // Shadow round trip
+  auto shadow = std::make_unique<wb_fofb_processing_regs>();
+  loader.store_shadow(*shadow);
+  TEST_ASSERT(device_matches(dev, *shadow));
+
+  // Something else wrote the RAM: full verification catches it, and the
+  // next load resyncs the shadow and fixes the device
+  {
+    mmap_device other(f.path, sizeof(wb_fofb_processing_regs));
+    other.write32(WB_FOFB_PROCESSING_REGS_CH + 5 * WB_FOFB_PROCESSING_REGS_CH_SIZE + 4 * 7,
+                  0xdeadbeef);
+  }
+  bool thrown = false;
+  try {
+    loader.load(*img, verify_mode::full);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+  st = loader.load(*img, verify_mode::full);
+  TEST_ASSERT(st.words_changed == 1);
+  TEST_ASSERT(device_matches(dev, *img));
+}
+
+} // namespace
+
+int main()
+{
+  test_delta_load();
+  std::puts("SUCCESS!");
+  return 0;
+}
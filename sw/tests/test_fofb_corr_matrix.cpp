@@ -0,0 +1,222 @@
+// Correction matrix tests: SVD reconstruction and orthogonality, thread count
+// independence, pseudo-inverse properties, rank one exclusions against a new
+// factorization, and coefficient/gain quantization read back through the
+// fofb_processing model formats
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "fofb_corr_matrix.h"
+#include "fofb_fixed_point.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+std::vector<double> random_matrix(test_rng &rng, size_t rows, size_t cols)
+{
+  std::vector<double> a(rows * cols);
+  for (double &v: a)
+    v = double(rng.range(-1000000, 1000000)) * 1e-6;
+  return a;
+}
+
+double max_abs_diff(const std::vector<double> &a, const std::vector<double> &b)
+{
+  TEST_ASSERT(a.size() == b.size());
+  double d = 0;
+  for (size_t i = 0; i < a.size(); i++)
+    d = std::max(d, std::abs(a[i] - b[i]));
+  return d;
+}
+
+void check_svd(const std::vector<double> &a, size_t rows, size_t cols, const svd_factors &f)
+{
+  const size_t k = f.k;
+  TEST_ASSERT(k == std::min(rows, cols));
+  for (size_t l = 1; l < k; l++)
+    TEST_ASSERT(f.s[l] <= f.s[l - 1]);
+  for (size_t i = 0; i < rows; i++) {
+    for (size_t j = 0; j < cols; j++) {
+      double v = 0;
+      for (size_t l = 0; l < k; l++)
+        v += f.u[i * k + l] * f.s[l] * f.v[j * k + l];
+      TEST_ASSERT(std::abs(v - a[i * cols + j]) < 1e-12);
+    }
+  }
+  for (size_t p = 0; p < k; p++) {
+    for (size_t q = 0; q < k; q++) {
+      double uu = 0, vv = 0;
+      for (size_t i = 0; i < rows; i++)
+        uu += f.u[i * k + p] * f.u[i * k + q];
+      for (size_t j = 0; j < cols; j++)
+        vv += f.v[j * k + p] * f.v[j * k + q];
+      TEST_ASSERT(std::abs(uu - (p == q)) < 1e-12 && std::abs(vv - (p == q)) < 1e-12);
+    }
+  }
+}
+
+void test_svd()
+{
+  test_rng rng;
+  for (auto dims: {std::make_pair(40, 12), std::make_pair(9, 31), std::make_pair(33, 33)}) {
+    const size_t rows = dims.first, cols = dims.second;
+    const std::vector<double> a = random_matrix(rng, rows, cols);
+    const svd_factors f1 = svd(a, rows, cols, 1);
+    check_svd(a, rows, cols, f1);
+    const svd_factors f4 = svd(a, rows, cols, 4);
+    TEST_ASSERT(f1.u == f4.u && f1.s == f4.s && f1.v == f4.v);
+  }
+}
+
+void test_inverse()
+{
+  constexpr size_t c_BPMS = 64, c_CORRS = 24;
+  test_rng rng;
+  const std::vector<double> a = random_matrix(rng, c_BPMS, c_CORRS);
+  corr_matrix_config cfg;
+  cfg.threads = 3;
+  const corr_matrix cm(a, c_BPMS, c_CORRS, cfg);
+  TEST_ASSERT(cm.num_sv_used() == c_CORRS);
+
+  // Full column rank: inv a == I
+  const std::vector<double> inv = cm.inverse();
+  for (size_t i = 0; i < c_CORRS; i++) {
+    for (size_t j = 0; j < c_CORRS; j++) {
+      double v = 0;
+      for (size_t b = 0; b < c_BPMS; b++)
+        v += inv[i * c_BPMS + b] * a[b * c_CORRS + j];
+      TEST_ASSERT(std::abs(v - (i == j)) < 1e-10);
+    }
+  }
+
+  // Truncation and damping shrink the inverse
+  cfg.num_sv = 10;
+  const corr_matrix cm10(a, c_BPMS, c_CORRS, cfg);
+  TEST_ASSERT(cm10.num_sv_used() == 10);
+  cfg.num_sv = 0;
+  cfg.tikhonov = 0.1;
+  const corr_matrix cmt(a, c_BPMS, c_CORRS, cfg);
+  double n_full = 0, n_trunc = 0, n_damp = 0;
+  for (size_t i = 0; i < inv.size(); i++) {
+    n_full += inv[i] * inv[i];
+    n_trunc += cm10.inverse()[i] * cm10.inverse()[i];
+    n_damp += cmt.inverse()[i] * cmt.inverse()[i];
+  }
+  TEST_ASSERT(n_trunc < n_full && n_damp < n_full);
+}
+
+void test_exclusions()
+{
+  constexpr size_t c_BPMS = 80, c_CORRS = 30;
+  test_rng rng;
+  std::vector<double> a = random_matrix(rng, c_BPMS, c_CORRS);
+  corr_matrix_config cfg;
+  cfg.threads = 2;
+  cfg.rcond = 1e-9;
+  corr_matrix cm(a, c_BPMS, c_CORRS, cfg);
+
+  const size_t bpms_out[] = {3, 41, 79, 12};
+  const size_t corrs_out[] = {0, 17};
+  for (size_t b: bpms_out) {
+    cm.exclude_bpm(b);
+    std::fill(a.begin() + b * c_CORRS, a.begin() + (b + 1) * c_CORRS, 0);
+  }
+  for (size_t c: corrs_out) {
+    cm.exclude_corrector(c);
+    for (size_t b = 0; b < c_BPMS; b++)
+      a[b * c_CORRS + c] = 0;
+  }
+  TEST_ASSERT(cm.bpm_excluded(41) && !cm.bpm_excluded(40) && cm.corrector_excluded(17));
+  TEST_ASSERT(cm.orm() == a);
+  // Excluding twice is a no-op
+  cm.exclude_bpm(3);
+
+  const corr_matrix ref(a, c_BPMS, c_CORRS, cfg);
+  TEST_ASSERT(cm.num_sv_used() == c_CORRS - 2 && ref.num_sv_used() == c_CORRS - 2);
+  for (size_t l = 0; l < c_CORRS - 2; l++)
+    TEST_ASSERT(std::abs(cm.factors().s[l] - ref.factors().s[l]) < 1e-10);
+  const std::vector<double> inv = cm.inverse();
+  TEST_ASSERT(max_abs_diff(inv, ref.inverse()) < 1e-9);
+  for (size_t c = 0; c < c_CORRS; c++)
+    for (size_t b: bpms_out)
+      TEST_ASSERT(std::abs(inv[c * c_BPMS + b]) < 1e-12);
+  for (size_t b = 0; b < c_BPMS; b++)
+    TEST_ASSERT(std::abs(inv[17 * c_BPMS + b]) < 1e-12);
+
+  cm.recompute();
+  TEST_ASSERT(max_abs_diff(cm.inverse(), ref.inverse()) < 1e-12);
+}
+
+void test_quantize()
+{
+  constexpr size_t c_BPMS = 320, c_CORRS = 16;
+  test_rng rng;
+  std::vector<double> inv = random_matrix(rng, c_CORRS, c_BPMS);
+  // Rows of very different magnitudes, one of them empty
+  for (size_t c = 0; c < c_CORRS; c++)
+    for (size_t b = 0; b < c_BPMS; b++)
+      inv[c * c_BPMS + b] *= c == 5 ? 0 : std::ldexp(1., -int(c));
+  std::vector<double> gains(c_CORRS);
+  for (size_t c = 0; c < c_CORRS; c++)
+    gains[c] = 0.5 + 0.01 * double(c);
+
+  fofb_processing_generics gen;
+  auto img = std::make_unique<wb_fofb_processing_regs>();
+  std::memset(img.get(), 0xff, sizeof(*img));
+  const size_t first = 4;
+  const corr_quant_stats st =
+    quantize_corr_matrix(inv, c_BPMS, first, c_MAX_CHANNELS, gains, gen, *img);
+  TEST_ASSERT(st.saturated == 0);
+
+  const unsigned cw = gen.coeff_int_width + gen.coeff_frac_width + 1;
+  const unsigned gw = gen.gain_int_width + gen.gain_frac_width + 1;
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    const size_t row = first + ch;
+    const double gain = std::ldexp(double(fp_left_aligned(img->ch[ch].acc.gain, gw)),
+                                   -int(gen.gain_frac_width));
+    if (row == 5 || row >= c_CORRS) {
+      TEST_ASSERT(gain == 0);
+    } else {
+      // A power of two, the largest coefficient in the top half of the range
+      int e;
+      TEST_ASSERT(std::frexp(gain, &e) == 0.5);
+      int32_t peak = 0;
+      for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+        peak = std::max(peak, std::abs(fp_left_aligned(img->ch[ch].coeff_ram_bank[i].data, cw)));
+      TEST_ASSERT(peak > fp_max(cw) / 2 || e - 1 == -int(gen.gain_frac_width));
+    }
+    for (unsigned i = 0; i < c_NUM_BPM_POS; i++) {
+      const uint32_t word = img->ch[ch].coeff_ram_bank[i].data;
+      TEST_ASSERT((word & ((uint32_t(1) << (32 - cw)) - 1)) == 0);
+      const double c = std::ldexp(double(fp_left_aligned(word, cw)), -int(gen.coeff_frac_width));
+      const double want = row < c_CORRS && i < c_BPMS ? inv[row * c_BPMS + i] * gains[row] : 0;
+      TEST_ASSERT(std::abs(c * gain - want) <= gain * std::ldexp(0.5, -int(gen.coeff_frac_width)));
+    }
+  }
+  TEST_ASSERT(st.max_err > 0 && st.max_err < 1e-5);
+
+  // Beyond what a gain below 1 and coefficients below 1 can hold
+  std::vector<double> big(c_BPMS, 3.);
+  const corr_quant_stats sat = quantize_corr_matrix(big, c_BPMS, 0, 1, {}, gen, *img);
+  TEST_ASSERT(sat.saturated == c_BPMS);
+}
+
+} // namespace
+
+int main()
+{
+  test_svd();
+  test_inverse();
+  test_exclusions();
+  test_quantize();
+  std::puts("SUCCESS!");
+  return 0;
+}
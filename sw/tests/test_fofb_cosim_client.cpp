@@ -0,0 +1,248 @@
+// Co-simulation shared memory transport tests: a stand-in for the fofb_server
+// side of the rings (same steps as its Rust code) answers the client with a
+// dot product, checking the vectors, pipelined timeframes, reconnection and
+// timeouts
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "fofb_cosim_client.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+constexpr unsigned c_NUM_POS = 512;
+
+// fofb_server with g_SHM = true, the simulation being sp = gain + coeffs .
+// pos. Runs until an exit message.
+class fake_server {
+ public:
+  explicit fake_server(unsigned key, unsigned start_delay_ms = 0):
+    name(cosim_shm_name(key))
+  {
+    th = std::thread([this, start_delay_ms] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(start_delay_ms));
+      run();
+    });
+  }
+
+  ~fake_server()
+  {
+    join();
+    ::shm_unlink(name.c_str());
+  }
+
+  void join()
+  {
+    if (th.joinable())
+      th.join();
+  }
+
+  unsigned connections = 0;
+  unsigned bpm_pos_msgs = 0;
+
+ private:
+  void run()
+  {
+    const int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    TEST_ASSERT(fd >= 0);
+    TEST_ASSERT(::ftruncate(fd, sizeof(cosim_shm_layout)) == 0);
+    void *map = ::mmap(nullptr, sizeof(cosim_shm_layout), PROT_READ | PROT_WRITE, MAP_SHARED,
+                       fd, 0);
+    TEST_ASSERT(map != MAP_FAILED);
+    auto *shm = static_cast<cosim_shm_layout *>(map);
+    shm->hdr.version = c_COSIM_SHM_VERSION;
+    shm->hdr.gain_frac_width = 12;
+    shm->hdr.coeffs_frac_width = 31;
+    shm->hdr.bpm_frac_width = 0;
+    shm->hdr.magic.store(c_COSIM_SHM_MAGIC, std::memory_order_release);
+
+    bool end = false;
+    while (!end) {
+      // fofb_server_wait_con()
+      uint32_t gen;
+      while ((gen = shm->hdr.attach_gen.load(std::memory_order_acquire)) ==
+             shm->hdr.ack_gen.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+      shm->req.tail.val.store(shm->req.head.val.load(std::memory_order_acquire),
+                              std::memory_order_release);
+      shm->resp.tail.val.store(shm->resp.head.val.load(std::memory_order_relaxed),
+                               std::memory_order_relaxed);
+      shm->hdr.ack_gen.store(gen, std::memory_order_release);
+      connections++;
+
+      bool connected = true;
+      while (connected) {
+        // fofb_server_wait_data()
+        cosim_shm_ring &req = shm->req;
+        const uint32_t t = req.tail.val.load(std::memory_order_relaxed);
+        while (req.head.val.load(std::memory_order_acquire) == t)
+          std::this_thread::yield();
+        const cosim_msg msg = req.slots[t % c_COSIM_RING_SLOTS];
+        req.tail.val.store(t + 1, std::memory_order_release);
+
+        switch (msg.type) {
+          case COSIM_MSG_COEFF:
+            std::memcpy(coeffs, msg.data, msg.count * sizeof(int32_t));
+            break;
+          case COSIM_MSG_GAIN:
+            gain = msg.data[0];
+            break;
+          case COSIM_MSG_BPM_POS: {
+            bpm_pos_msgs++;
+            int64_t sp = gain;
+            for (unsigned i = 0; i < msg.count; i++)
+              sp += int64_t(coeffs[i]) * msg.data[i];
+            // fofb_server_write_sp()
+            cosim_shm_ring &resp = shm->resp;
+            const uint32_t h = resp.head.val.load(std::memory_order_relaxed);
+            while (h - resp.tail.val.load(std::memory_order_acquire) == c_COSIM_RING_SLOTS)
+              std::this_thread::yield();
+            resp.slots[h % c_COSIM_RING_SLOTS].type = COSIM_MSG_CORR_SP;
+            resp.slots[h % c_COSIM_RING_SLOTS].count = 1;
+            resp.slots[h % c_COSIM_RING_SLOTS].data[0] = int32_t(sp);
+            resp.head.val.store(h + 1, std::memory_order_release);
+            break;
+          }
+          case COSIM_MSG_DISCONNECT:
+            connected = false;
+            break;
+          case COSIM_MSG_EXIT:
+            connected = false;
+            end = true;
+            break;
+          default:
+            break;
+        }
+      }
+    }
+    ::munmap(map, sizeof(cosim_shm_layout));
+    ::close(fd);
+  }
+
+  std::string name;
+  std::thread th;
+  int32_t coeffs[c_NUM_POS] = {};
+  int32_t gain = 0;
+};
+
+int32_t expected_sp(const std::vector<int32_t> &coeffs, int32_t gain, const int32_t *pos)
+{
+  int64_t sp = gain;
+  for (unsigned i = 0; i < c_NUM_POS; i++)
+    sp += int64_t(coeffs[i]) * pos[i];
+  return int32_t(sp);
+}
+
+void test_transport()
+{
+  const unsigned key = 50000 + unsigned(getpid()) % 10000;
+  fake_server srv(key, 50);
+  test_rng rng;
+
+  std::vector<int32_t> coeffs(c_NUM_POS);
+  for (int32_t &c: coeffs)
+    c = int32_t(rng.range(-1000, 1000));
+  const int32_t gain = 77;
+  const size_t frames = 1000;
+  std::vector<int32_t> pos(frames * c_NUM_POS);
+  for (int32_t &p: pos)
+    p = int32_t(rng.range(-100000, 100000));
+
+  {
+    // Started before the simulation
+    cosim_client c(key, 5);
+    const cosim_frac_widths fw = c.frac_widths();
+    TEST_ASSERT(fw.gain == 12 && fw.coeffs == 31 && fw.bpm == 0);
+
+    c.send_coeffs(coeffs.data(), c_NUM_POS);
+    c.send_gain(gain);
+    c.clear_acc();
+
+    // Many more timeframes than ring slots
+    std::vector<int32_t> sp(frames);
+    c.process(pos.data(), c_NUM_POS, frames, sp.data());
+    for (size_t f = 0; f < frames; f++)
+      TEST_ASSERT(sp[f] == expected_sp(coeffs, gain, &pos[f * c_NUM_POS]));
+
+    c.send_bpm_pos(&pos[0], c_NUM_POS);
+    c.send_bpm_pos(&pos[c_NUM_POS], c_NUM_POS);
+    TEST_ASSERT(c.pending() == 2);
+    TEST_ASSERT(c.recv_sp() == expected_sp(coeffs, gain, &pos[0]));
+    TEST_ASSERT(c.recv_sp() == expected_sp(coeffs, gain, &pos[c_NUM_POS]));
+    TEST_ASSERT(c.pending() == 0);
+
+    bool threw = false;
+    try {
+      c.recv_sp();
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    TEST_ASSERT(threw);
+
+    // Set-points never read, the next client must not see them
+    for (unsigned i = 0; i < 5; i++)
+      c.send_bpm_pos(&pos[i * c_NUM_POS], c_NUM_POS);
+  }
+
+  {
+    cosim_client c(key, 5);
+    std::vector<int32_t> sp(3);
+    c.process(&pos[10 * c_NUM_POS], c_NUM_POS, 3, sp.data());
+    for (size_t f = 0; f < 3; f++)
+      TEST_ASSERT(sp[f] == expected_sp(coeffs, gain, &pos[(10 + f) * c_NUM_POS]));
+    c.exit_simu();
+  }
+
+  srv.join();
+  TEST_ASSERT(srv.connections == 2);
+  TEST_ASSERT(srv.bpm_pos_msgs == frames + 2 + 5 + 3);
+}
+
+void test_timeout()
+{
+  const auto start = std::chrono::steady_clock::now();
+  bool threw = false;
+  try {
+    cosim_client c(60000 + unsigned(getpid()) % 10000, 0.1);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+  TEST_ASSERT(std::chrono::steady_clock::now() - start < std::chrono::seconds(2));
+}
+
+void test_to_fixed()
+{
+  TEST_ASSERT(cosim_client::to_fixed(1.5, 2) == 6);
+  TEST_ASSERT(cosim_client::to_fixed(-1.75, 1) == -3);
+  TEST_ASSERT(cosim_client::to_fixed(0.5, 31) == 1 << 30);
+  TEST_ASSERT(cosim_client::to_fixed(1, 31) == INT32_MAX);
+  TEST_ASSERT(cosim_client::to_fixed(-1e12, 0) == INT32_MIN);
+}
+
+} // namespace
+
+int main()
+{
+  test_transport();
+  test_timeout();
+  test_to_fixed();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
@@ -0,0 +1,287 @@
+// FOFB CC error counters telemetry tests: recording rules, threaded polling
+// against stand-in sources and ram_reg readout
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "fofb_cc_regs_access.h"
+#include "fofb_err_telemetry.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+// Stand-in for a board: counters set by the test, or bumped every 'every'
+// reads, with failures on request
+class fake_source : public err_counter_source {
+ public:
+  explicit fake_source(unsigned every = 0, unsigned seed = 0):
+    every(every), seed(seed) {}
+
+  void read(uint32_t (&out)[c_CC_ERR_COUNTERS]) override
+  {
+    if (fail)
+      throw std::runtime_error("broker timeout");
+    reads++;
+    if (every && reads % every == 0)
+      cnt[(reads / every + seed) % c_CC_ERR_COUNTERS] += seed + 1;
+    std::memcpy(out, cnt, sizeof(cnt));
+  }
+
+  uint32_t cnt[c_CC_ERR_COUNTERS] = {};
+  bool fail = false;
+  unsigned reads = 0;
+
+ private:
+  unsigned every;
+  unsigned seed;
+};
+
+bool all_zero(const err_telemetry_record &rec)
+{
+  for (uint32_t c: rec.cnt)
+    if (c)
+      return false;
+  return true;
+}
+
+void test_sample()
+{
+  fake_source src;
+  src.cnt[0] = 5;
+  src.cnt[11] = 0xfffffffe;
+  err_telemetry_config cfg;
+  cfg.rate_hz = 100;
+  cfg.keepalive_s = 0.1;
+  err_telemetry tel({{3, 1, &src}}, cfg);
+  err_telemetry_record rec;
+
+  // Absolute counters first
+  TEST_ASSERT(tel.sample(0, 0, 0, rec));
+  TEST_ASSERT(rec.flags == ERR_REC_START && rec.board == 3 && rec.halcs == 1);
+  TEST_ASSERT(rec.cnt[0] == 5 && rec.cnt[11] == 0xfffffffe);
+
+  // Nothing written until a counter changes or the keepalive interval
+  for (uint32_t seq = 1; seq < 10; seq++)
+    TEST_ASSERT(!tel.sample(0, seq, 0, rec));
+  TEST_ASSERT(tel.sample(0, 10, 0, rec));
+  TEST_ASSERT(rec.flags == 0 && all_zero(rec));
+
+  // Increments, across the counter wrap around
+  src.cnt[4] += 2;
+  src.cnt[11] += 3;
+  TEST_ASSERT(tel.sample(0, 11, 0, rec));
+  TEST_ASSERT(rec.cnt[4] == 2 && rec.cnt[11] == 3 && rec.cnt[0] == 0);
+
+  // A failure is recorded once per keepalive interval. The recovery gives
+  // the absolute counters again: the board came back reset, counting from
+  // zero.
+  src.fail = true;
+  TEST_ASSERT(tel.sample(0, 12, 0, rec));
+  TEST_ASSERT(rec.flags == ERR_REC_FAIL && all_zero(rec));
+  for (uint32_t seq = 13; seq < 22; seq++)
+    TEST_ASSERT(!tel.sample(0, seq, 0, rec));
+  TEST_ASSERT(tel.sample(0, 22, 0, rec) && rec.flags == ERR_REC_FAIL);
+  src.fail = false;
+  std::memset(src.cnt, 0, sizeof(src.cnt));
+  src.cnt[7] = 1;
+  TEST_ASSERT(tel.sample(0, 23, 0, rec));
+  TEST_ASSERT(rec.flags == ERR_REC_START && rec.cnt[7] == 1 && rec.cnt[11] == 0);
+  TEST_ASSERT(!tel.sample(0, 24, 0, rec));
+
+  // Skipped intervals
+  TEST_ASSERT(tel.sample(0, 27, 0, rec) && rec.flags == ERR_REC_GAP && all_zero(rec));
+
+  const err_telemetry_stats st = tel.stats();
+  TEST_ASSERT(st.polls == 26 && st.failures == 11);
+}
+
+void test_dropped()
+{
+  fake_source src;
+  src.cnt[2] = 7;
+  err_telemetry_config cfg;
+  cfg.rate_hz = 100;
+  cfg.keepalive_s = 1;
+  err_telemetry tel({{1, 2, &src}}, cfg);
+  err_telemetry_record rec;
+
+  // A lost START record is written again, flagged
+  TEST_ASSERT(tel.sample(0, 0, 0, rec) && rec.flags == ERR_REC_START);
+  tel.dropped(0, rec);
+  TEST_ASSERT(tel.sample(0, 1, 0, rec));
+  TEST_ASSERT(rec.flags == (ERR_REC_START | ERR_REC_DROPPED) && rec.cnt[2] == 7);
+  TEST_ASSERT(!tel.sample(0, 2, 0, rec));
+
+  // Lost increments are carried over, even with no change since
+  src.cnt[2] += 3;
+  src.cnt[5] += 1;
+  TEST_ASSERT(tel.sample(0, 3, 0, rec) && rec.cnt[2] == 3);
+  tel.dropped(0, rec);
+  src.cnt[5] += 2;
+  TEST_ASSERT(tel.sample(0, 4, 0, rec) && rec.flags == ERR_REC_DROPPED);
+  TEST_ASSERT(rec.cnt[2] == 3 && rec.cnt[5] == 3);
+  TEST_ASSERT(tel.sample(0, 5, 0, rec) == false);
+
+  src.cnt[0] += 1;
+  TEST_ASSERT(tel.sample(0, 6, 0, rec) && rec.flags == 0);
+  tel.dropped(0, rec);
+  TEST_ASSERT(tel.sample(0, 7, 0, rec) && rec.flags == ERR_REC_DROPPED && rec.cnt[0] == 1);
+  TEST_ASSERT(tel.stats().dropped == 3);
+}
+
+void test_threads()
+{
+  constexpr unsigned c_TARGETS = 18;
+  std::vector<fake_source> srcs;
+  for (unsigned i = 0; i < c_TARGETS; i++)
+    srcs.emplace_back(3 + i % 5, i);
+  std::vector<err_telemetry_target> targets;
+  for (unsigned i = 0; i < c_TARGETS; i++)
+    targets.push_back({2 + i / 2, i % 2 + 1, &srcs[i]});
+
+  tmp_file f;
+  err_telemetry_config cfg;
+  cfg.rate_hz = 1000;
+  cfg.threads = 4;
+  cfg.keepalive_s = 0.01;
+  // Two acquisitions appended to the same file
+  for (unsigned run = 0; run < 2; run++) {
+    err_telemetry_writer w(f.path);
+    err_telemetry tel(targets, cfg);
+    tel.start(w);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    tel.stop();
+    const err_telemetry_stats st = tel.stats();
+    TEST_ASSERT(st.polls > 0 && st.failures == 0 && st.dropped == 0);
+    TEST_ASSERT(w.records() == st.records);
+  }
+
+  // Accumulating the records gives back the last counters read
+  std::map<std::pair<unsigned, unsigned>, std::vector<uint32_t>> acc;
+  unsigned starts = 0;
+  for (const err_telemetry_record &rec: read_err_telemetry_file(f.path)) {
+    std::vector<uint32_t> &a = acc[{rec.board, rec.halcs}];
+    if (rec.flags & ERR_REC_START) {
+      a.assign(rec.cnt, rec.cnt + c_CC_ERR_COUNTERS);
+      starts++;
+    } else {
+      TEST_ASSERT(a.size() == c_CC_ERR_COUNTERS);
+      for (unsigned i = 0; i < c_CC_ERR_COUNTERS; i++)
+        a[i] += rec.cnt[i];
+    }
+  }
+  TEST_ASSERT(starts == 2 * c_TARGETS && acc.size() == c_TARGETS);
+  for (unsigned i = 0; i < c_TARGETS; i++) {
+    const std::vector<uint32_t> &a = acc[{targets[i].board, targets[i].halcs}];
+    TEST_ASSERT(std::memcmp(a.data(), srcs[i].cnt, sizeof(srcs[i].cnt)) == 0);
+    TEST_ASSERT(srcs[i].reads > c_TARGETS);
+  }
+}
+
+void test_torn_record()
+{
+  tmp_file f;
+  err_telemetry_record rec = {};
+  {
+    err_telemetry_writer w(f.path);
+    for (uint32_t seq = 0; seq < 2; seq++) {
+      rec.seq = seq;
+      w.write(&rec, 1);
+    }
+  }
+  // A crash in the middle of a record
+  FILE *fp = std::fopen(f.path.c_str(), "ab");
+  TEST_ASSERT(fp && std::fwrite(&rec, 1, 5, fp) == 5);
+  std::fclose(fp);
+
+  {
+    err_telemetry_writer w(f.path);
+    rec.seq = 2;
+    w.write(&rec, 1);
+  }
+  const std::vector<err_telemetry_record> recs = read_err_telemetry_file(f.path);
+  TEST_ASSERT(recs.size() == 3);
+  for (uint32_t seq = 0; seq < 3; seq++)
+    TEST_ASSERT(recs[seq].seq == seq);
+}
+
+void test_write_error()
+{
+  fake_source src(1);
+  err_telemetry_config cfg;
+  cfg.rate_hz = 1000;
+  cfg.ring_size = 16;
+  tmp_file f;
+  err_telemetry_writer w(f.path);
+  err_telemetry tel({{2, 1, &src}}, cfg);
+  {
+    // Room for the header and a few records
+    file_size_limit lim(sizeof(err_telemetry_file_header) + 4 * sizeof(err_telemetry_record));
+    tel.start(w);
+    while (!tel.write_failed())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // Polling goes on, dropping the records
+  while (tel.stats().dropped == 0)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  bool thrown = false;
+  try {
+    tel.stop();
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown && tel.stats().polls > 4);
+}
+
+void test_cc_source()
+{
+  using cc = regs::fofb_cc_regs;
+  tmp_file f;
+  mmap_device dev(f.path, sizeof(::fofb_cc_regs), 0, true);
+  for (unsigned i = 0; i < c_CC_ERR_COUNTERS; i++)
+    dev.write32(cc::ram_reg::data::reg_addr(cc_status::hard_err_cnt + i), 100 + i);
+  dev.reset_stats();
+
+  cc_err_counter_source src(dev);
+  uint32_t cnt[c_CC_ERR_COUNTERS];
+  src.read(cnt);
+  for (unsigned i = 0; i < c_CC_ERR_COUNTERS; i++)
+    TEST_ASSERT(cnt[i] == 100 + i);
+  TEST_ASSERT(dev.stats().read_bursts == 1 && dev.stats().reads == c_CC_ERR_COUNTERS);
+
+  for (unsigned i = 0; i < c_CC_ERR_COUNTERS; i++)
+    dev.write32(cc::ram_reg::data::reg_addr(cc_status::hard_err_cnt + i), UINT32_MAX);
+  bool thrown = false;
+  try {
+    src.read(cnt);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+}
+
+} // namespace
+
+int main()
+{
+  test_sample();
+  test_dropped();
+  test_threads();
+  test_torn_record();
+  test_write_error();
+  test_cc_source();
+  std::puts("SUCCESS!");
+  return 0;
+}
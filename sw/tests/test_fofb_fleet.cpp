@@ -0,0 +1,245 @@
+// Fleet configuration tests: image hashes and store round trip, concurrent
+// deployment to stand-in boards with manifest skipping, and drift detection
+// by full and sampled readback
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fofb_device.h"
+#include "fofb_fleet.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+// Board address map of the stand-in boards: every part at its own offset
+constexpr off_t c_PROC_OFF = 0x0;
+constexpr off_t c_SHAPER_OFF = 0x10000;
+constexpr off_t c_SYS_ID_OFF = 0x14000;
+constexpr off_t c_CC_OFF = 0x18000;
+constexpr size_t c_BOARD_SIZE = 0x1c000;
+
+struct tmp_dir {
+  std::string path;
+
+  tmp_dir()
+  {
+    char tmpl[] = "/tmp/fofb_testXXXXXX";
+    TEST_ASSERT(mkdtemp(tmpl));
+    path = tmpl;
+  }
+
+  ~tmp_dir() { TEST_ASSERT(std::system(("rm -rf " + path).c_str()) == 0); }
+};
+
+cfg_image make_image(test_rng &rng)
+{
+  cfg_image img;
+  for (unsigned p = 0; p < CFG_NUM_PARTS; p++) {
+    uint32_t *w = img.part(cfg_part(p));
+    for (size_t i = 0; i < cfg_part_size(cfg_part(p)) / 4; i++)
+      w[i] = uint32_t(rng.next());
+  }
+  return img;
+}
+
+const cfg_block &block(const std::string &name)
+{
+  for (const cfg_block &b: cfg_blocks())
+    if (b.name == name)
+      return b;
+  throw std::logic_error("no block " + name);
+}
+
+void test_image_store()
+{
+  test_rng rng;
+  cfg_image img = make_image(rng);
+  const uint64_t h = img.hash();
+
+  // Only the blocks count: status and padding words don't change the hash
+  cfg_image img2 = img;
+  img2.part(CFG_PROC)[WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA / 4] ^= 1;
+  img2.part(CFG_CC)[(offsetof(fofb_cc_regs, ram_reg) / 4) + 300] ^= 1;
+  TEST_ASSERT(img2.hash() == h);
+  // The FOFB CC configuration words above the status ones count too
+  cfg_image img3 = img;
+  img3.part(CFG_CC)[(offsetof(fofb_cc_regs, ram_reg) / 4) + 2047] ^= 1;
+  TEST_ASSERT(img3.hash() != h);
+  img2.part(CFG_SHAPER)[block("shaper.ch5.coeffs").addr / 4 + 3] ^= 1;
+  TEST_ASSERT(img2.hash() != h);
+
+  tmp_dir dir;
+  cfg_store store(dir.path + "/store");
+  TEST_ASSERT(store.put(img, "v1") == h);
+  TEST_ASSERT(store.put(img2, "v2") == img2.hash());
+  // Same contents, new name: one image file, two versions
+  TEST_ASSERT(store.put(img, "v1-again") == h);
+  bool threw = false;
+  try {
+    store.put(img, "v1");
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+
+  const std::vector<cfg_version> vs = cfg_store(dir.path + "/store").versions();
+  TEST_ASSERT(vs.size() == 3 && vs[0].name == "v1" && vs[1].hash == img2.hash());
+  TEST_ASSERT(store.get("v1").hash() == h);
+  TEST_ASSERT(store.get(cfg_hash_str(img2.hash())).hash() == img2.hash());
+  TEST_ASSERT(store.resolve("v1-again") == h);
+
+  // Corrupted image files are caught
+  {
+    std::fstream f(dir.path + "/store/images/" + cfg_hash_str(h) + ".cfg",
+                   std::ios::in | std::ios::out | std::ios::binary);
+    f.seekp(16 + block("proc.ch0.coeffs").addr);
+    f.put('x');
+  }
+  threw = false;
+  try {
+    store.get("v1");
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+void test_deploy_check()
+{
+  constexpr unsigned c_BOARDS = 6;
+  test_rng rng;
+  tmp_dir dir;
+
+  std::vector<tmp_file> devs(c_BOARDS);
+  std::vector<fleet_board> boards;
+  {
+    std::ofstream fleet(dir.path + "/fleet.txt");
+    fleet << "# name device proc shaper sys_id cc\n";
+    for (unsigned b = 0; b < c_BOARDS; b++) {
+      mmap_device(devs[b].path, c_BOARD_SIZE, 0, true);
+      fleet << "board" << b << " " << devs[b].path << " " << c_PROC_OFF << " "
+            << c_SHAPER_OFF << " " << c_SYS_ID_OFF << " "
+            // The last board has no FOFB CC
+            << (b == c_BOARDS - 1 ? std::string("-") : std::to_string(c_CC_OFF)) << "\n";
+    }
+  }
+  boards = read_fleet_file(dir.path + "/fleet.txt");
+  TEST_ASSERT(boards.size() == c_BOARDS && boards[2].offset[CFG_SHAPER] == c_SHAPER_OFF &&
+              boards[c_BOARDS - 1].offset[CFG_CC] == -1);
+
+  const size_t n_blocks = cfg_blocks().size();
+  const size_t n_cc_blocks = std::count_if(cfg_blocks().begin(), cfg_blocks().end(),
+                                           [](const cfg_block &b) { return b.part == CFG_CC; });
+  const cfg_image img = make_image(rng);
+  fleet_config cfg;
+  cfg.threads = 3;
+  fleet_deployer dep(boards, dir.path + "/state", cfg);
+
+  std::vector<fleet_board_result> res = dep.deploy(img);
+  for (unsigned b = 0; b < c_BOARDS; b++) {
+    TEST_ASSERT(res[b].ok && res[b].board == boards[b].name);
+    TEST_ASSERT(res[b].blocks_written == n_blocks - (b == c_BOARDS - 1 ? n_cc_blocks : 0));
+    TEST_ASSERT(res[b].blocks_skipped == 0);
+  }
+  for (check_mode mode: {check_mode::manifest, check_mode::sampled, check_mode::full}) {
+    res = dep.check(img, mode);
+    for (const fleet_board_result &r: res)
+      TEST_ASSERT(r.ok && r.drifted.empty());
+  }
+
+  // Blocks land where they belong, the rest of the board is untouched
+  {
+    mmap_device d(devs[1].path, c_BOARD_SIZE);
+    const cfg_block &blk = block("proc.ch7.coeffs");
+    TEST_ASSERT(d.read32(c_PROC_OFF + blk.addr + 40) == img.part(CFG_PROC)[blk.addr / 4 + 10]);
+    TEST_ASSERT(d.read32(c_PROC_OFF + WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL) == 0);
+    TEST_ASSERT(d.read32(c_CC_OFF + offsetof(fofb_cc_regs, ram_reg) + 4 * 300) == 0);
+  }
+
+  // Nothing changed: no block written
+  res = dep.deploy(img);
+  for (const fleet_board_result &r: res)
+    TEST_ASSERT(r.ok && r.blocks_written == 0 && r.words_written == 0);
+
+  // New version with one coefficient changed: one block per board
+  cfg_image img2 = img;
+  const cfg_block &coeffs3 = block("proc.ch3.coeffs");
+  img2.part(CFG_PROC)[coeffs3.addr / 4 + 100] += 1;
+  res = dep.deploy(img2);
+  for (const fleet_board_result &r: res)
+    TEST_ASSERT(r.ok && r.blocks_written == 1 && r.words_written == coeffs3.words);
+  TEST_ASSERT(fleet_manifest::load(dir.path + "/state/board0.manifest").image == img2.hash());
+
+  // Drift on board 4: somebody wrote a word of the middle of a block
+  const cfg_block &cc = block("cc.cfg");
+  {
+    mmap_device d(devs[4].path, c_BOARD_SIZE);
+    d.write32(c_CC_OFF + cc.addr + 4 * 7, 0xdeadbeef);
+  }
+  res = dep.check(img2, check_mode::full);
+  for (unsigned b = 0; b < c_BOARDS; b++)
+    TEST_ASSERT(res[b].drifted.size() == (b == 4 ? 1u : 0u));
+  TEST_ASSERT(res[4].drifted[0] == "cc.cfg");
+  // One burst per block
+  TEST_ASSERT(res[4].words_read < 2 * n_blocks * 512);
+  // The sampled words miss it, the manifests know nothing about it
+  res = dep.check(img2, check_mode::sampled);
+  TEST_ASSERT(res[4].drifted.empty());
+  res = dep.check(img2, check_mode::manifest);
+  TEST_ASSERT(res[4].drifted.empty());
+  // Later sampled checks read other words, in later runs too
+  unsigned checks = 1;
+  for (fleet_deployer dep3(boards, dir.path + "/state", cfg); res[4].drifted.empty(); checks++) {
+    TEST_ASSERT(checks < cc.words / cfg.samples);
+    res = dep3.check(img2, check_mode::sampled);
+    TEST_ASSERT(res[4].words_read <= n_blocks * cfg.samples);
+  }
+  TEST_ASSERT(res[4].drifted.size() == 1 && res[4].drifted[0] == "cc.cfg");
+
+  // A manifest deployment trusts the manifest, a verifying one repairs
+  res = dep.deploy(img2);
+  TEST_ASSERT(res[4].blocks_written == 0);
+  res = dep.deploy(img2, deploy_mode::verify);
+  for (unsigned b = 0; b < c_BOARDS; b++)
+    TEST_ASSERT(res[b].ok && res[b].blocks_written == (b == 4 ? 1u : 0u));
+  res = dep.check(img2, check_mode::full);
+  TEST_ASSERT(res[4].drifted.empty());
+
+  // A lost manifest shows up without any bus access, and forcing rewrites
+  // everything
+  std::remove((dir.path + "/state/board2.manifest").c_str());
+  res = dep.check(img2, check_mode::manifest);
+  TEST_ASSERT(res[2].drifted.size() == n_blocks && res[2].words_read == 0);
+  res = dep.deploy(img2, deploy_mode::force);
+  TEST_ASSERT(res[2].blocks_written == n_blocks && res[0].blocks_written == n_blocks);
+
+  // A missing board fails alone
+  boards[1].device = dir.path + "/no_such_device";
+  fleet_deployer dep2(boards, dir.path + "/state", cfg);
+  res = dep2.deploy(img2);
+  for (unsigned b = 0; b < c_BOARDS; b++)
+    TEST_ASSERT(res[b].ok == (b != 1));
+  TEST_ASSERT(!res[1].error.empty());
+}
+
+} // namespace
+
+int main()
+{
+  test_image_store();
+  test_deploy_check();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
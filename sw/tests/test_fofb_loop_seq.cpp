@@ -0,0 +1,177 @@
+// Loop sequencer tests: close and open plans (staged gains, ramps, CC
+// enable), channel masks, issuing against the mock board with the batch
+// timings and readback verification, and real gains conversion
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "fofb_cc_regs_access.h"
+#include "fofb_loop_seq.h"
+#include "fofb_reg_bench.h"
+#include "test_util.h"
+#include "wb_fofb_processing_regs_access.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+using proc_regs = regs::wb_fofb_processing_regs;
+using cfg_val = regs::fofb_cc_regs::cfg_val;
+
+constexpr uint32_t c_CLEAR = WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_CLEAR;
+constexpr uint32_t c_FREEZE = WB_FOFB_PROCESSING_REGS_CH_ACC_CTL_FREEZE;
+
+uint32_t ctl(mock_board &board, unsigned ch)
+{
+  return board.proc().read32(WB_FOFB_PROCESSING_REGS_CH + ch * WB_FOFB_PROCESSING_REGS_CH_SIZE +
+                             WB_FOFB_PROCESSING_REGS_CH_ACC_CTL);
+}
+
+uint32_t gain(mock_board &board, unsigned ch)
+{
+  return board.proc().read32(WB_FOFB_PROCESSING_REGS_CH + ch * WB_FOFB_PROCESSING_REGS_CH_SIZE +
+                             WB_FOFB_PROCESSING_REGS_CH_ACC_GAIN);
+}
+
+void check_timings(const loop_seq_plan &plan, const loop_seq_report &rep)
+{
+  TEST_ASSERT(rep.batches.size() == plan.batches.size() && rep.tf_ns == 20833);
+  uint64_t skew = 0;
+  for (size_t i = 0; i < rep.batches.size(); i++) {
+    const loop_seq_batch_timing &t = rep.batches[i];
+    TEST_ASSERT(t.tf == plan.batches[i].tf);
+    TEST_ASSERT(t.start_ns >= t.due_ns && t.first_ns >= t.start_ns &&
+                t.last_ns >= t.first_ns && t.flushed_ns >= t.last_ns);
+    if (i > 0)
+      TEST_ASSERT(t.due_ns - rep.batches[0].due_ns ==
+                  uint64_t(std::llround(t.tf * 1e9 / 48000)));
+    skew = std::max(skew, t.last_ns - t.first_ns);
+  }
+  TEST_ASSERT(rep.max_skew_ns == skew);
+}
+
+void test_close_open()
+{
+  mock_board board;
+  // Unrelated cfg_val fields are kept
+  board.cc().write32(cfg_val::reg_addr, FOFB_CC_REGS_CFG_VAL_TFS_OVERRIDE);
+  loop_sequencer seq(board.proc(), 0, &board.cc(), 0);
+
+  std::vector<uint32_t> gains(c_MAX_CHANNELS);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    gains[ch] = uint32_t((ch % 2 ? -1 : 1) * int32_t(1000 * (ch + 1)));
+
+  // Staged gains, then the channels released in one batch
+  loop_seq_plan plan = seq.plan_close(gains, true, 0, true);
+  TEST_ASSERT(plan.batches.size() == 1);
+  TEST_ASSERT(plan.batches[0].pre.size() == 1 + c_MAX_CHANNELS &&
+              plan.batches[0].writes.size() == c_MAX_CHANNELS);
+  loop_seq_report rep = seq.run(plan);
+  check_timings(plan, rep);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(gain(board, ch) == gains[ch] && ctl(board, ch) == c_CLEAR);
+  TEST_ASSERT(board.cc().read32(cfg_val::reg_addr) ==
+              (FOFB_CC_REGS_CFG_VAL_TFS_OVERRIDE | FOFB_CC_REGS_CFG_VAL_CC_ENABLE));
+
+  // Ramp down over 4 timeframes, then freeze
+  plan = seq.plan_open(4, true);
+  TEST_ASSERT(plan.batches.size() == 5);
+  for (unsigned k = 0; k < 4; k++) {
+    TEST_ASSERT(plan.batches[k].tf == k);
+    const int32_t g = int32_t(plan.batches[k].writes[3].val);
+    TEST_ASSERT(g == -4000 * int32_t(3 - k) / 4);
+  }
+  TEST_ASSERT(plan.batches[4].tf == 4 && plan.batches[4].post.size() == 1);
+  rep = seq.run(plan);
+  check_timings(plan, rep);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(gain(board, ch) == 0 && ctl(board, ch) == c_FREEZE);
+  TEST_ASSERT(board.cc().read32(cfg_val::reg_addr) == FOFB_CC_REGS_CFG_VAL_TFS_OVERRIDE);
+
+  // Released with zero gains, then ramped up
+  plan = seq.plan_close(gains, false, 8);
+  TEST_ASSERT(plan.batches.size() == 9);
+  for (const loop_seq_write &w: plan.batches[0].pre)
+    TEST_ASSERT(w.val == 0);
+  for (unsigned k = 1; k <= 8; k++)
+    TEST_ASSERT(int32_t(plan.batches[k].writes[5].val) == -6000 * int32_t(k) / 8);
+  rep = seq.run(plan);
+  check_timings(plan, rep);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(gain(board, ch) == gains[ch] && ctl(board, ch) == 0);
+}
+
+void test_channels()
+{
+  mock_board board;
+  loop_seq_config cfg;
+  cfg.channels = 0x5;
+  cfg.cpu = 0;
+  loop_sequencer seq(board.proc(), 0, nullptr, 0, cfg);
+  const std::vector<uint32_t> gains(c_MAX_CHANNELS, 77);
+
+  loop_seq_plan plan = seq.plan_open();
+  TEST_ASSERT(plan.batches.size() == 1 && plan.batches[0].writes.size() == 2);
+  seq.run(plan);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(ctl(board, ch) == (ch == 0 || ch == 2 ? c_FREEZE : 0));
+
+  // No CC block: cc_enable is ignored
+  plan = seq.plan_close(gains, false, 0, true);
+  TEST_ASSERT(plan.cc_enable == -1 && plan.batches[0].pre.size() == 2);
+  seq.run(plan);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(gain(board, ch) == (ch == 0 || ch == 2 ? 77u : 0u));
+
+  // Registers not holding what was written
+  plan.gains[2] = 78;
+  bool threw = false;
+  try {
+    seq.run(plan);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+
+  threw = false;
+  try {
+    cfg.channels = 1u << c_MAX_CHANNELS;
+    loop_sequencer bad(board.proc(), 0, nullptr, 0, cfg);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+void test_gain_conversion()
+{
+  TEST_ASSERT(acc_gain_from_real(1.0, 16) == 65536);
+  TEST_ASSERT(int32_t(acc_gain_from_real(-0.5, 16)) == -32768);
+  TEST_ASSERT(acc_gain_from_real(0.1, 0) == 0);
+  bool threw = false;
+  try {
+    acc_gain_from_real(1.0, 31);
+  } catch (const std::out_of_range &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+} // namespace
+
+int main()
+{
+  test_close_open();
+  test_channels();
+  test_gain_conversion();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
@@ -0,0 +1,155 @@
+// Closed-loop simulator tests: disturbance rejection with a correction
+// matrix from fofb_corr_matrix, both loop interlock sources, an unstable
+// gain caught by the orbit distortion interlock, and batch results not
+// depending on the number of threads
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include "fofb_corr_matrix.h"
+#include "fofb_loop_sim.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+loop_sim_machine make_machine(unsigned boards, size_t bpms, double loop_gain)
+{
+  test_rng rng;
+  const size_t n_corr = boards * c_MAX_CHANNELS;
+  loop_sim_machine m;
+  m.bpms = bpms;
+  m.orm.resize(bpms * n_corr);
+  for (double &v: m.orm)
+    v = double(rng.range(-1000, 1000)) * 0.01;
+  m.corr_pole = 0.5;
+  m.delay_tf = 2;
+
+  corr_matrix_config cfg;
+  cfg.threads = 1;
+  const corr_matrix cm(m.orm, bpms, n_corr, cfg);
+  const std::vector<double> inv = cm.inverse();
+  m.proc_regs.resize(boards);
+  for (unsigned b = 0; b < boards; b++) {
+    wb_fofb_processing_regs &img = m.proc_regs[b];
+    std::memset(&img, 0, sizeof(img));
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      img.ch[ch].sp_limits.max = 32767;
+      img.ch[ch].sp_limits.min = uint32_t(-32768);
+    }
+    quantize_corr_matrix(inv, bpms, b * c_MAX_CHANNELS, c_MAX_CHANNELS,
+                         std::vector<double>(n_corr, loop_gain), m.proc_gen, img);
+  }
+  return m;
+}
+
+void test_rejection()
+{
+  // Fewer positions than correctors, so any orbit can be corrected
+  const loop_sim_machine m = make_machine(2, 20, 0.1);
+  loop_sim_scenario sc;
+  sc.timeframes = 4000;
+  sc.step_amp = 2000;
+  sc.step_tf = 100;
+  sc.noise_rms = 20;
+  sc.stop_on_intlk = false;
+
+  const loop_sim_result closed = run_loop_sim(m, sc);
+  TEST_ASSERT(closed.timeframes == 4000 && closed.intlk_tf < 0);
+  TEST_ASSERT(closed.disturbance_rms > 1500);
+  // What's left is mostly the noise
+  TEST_ASSERT(closed.orbit_rms < 60);
+  TEST_ASSERT(closed.sp_peak > 0);
+
+  sc.gain_scale = 0;
+  const loop_sim_result open = run_loop_sim(m, sc);
+  TEST_ASSERT(std::abs(open.orbit_rms - open.disturbance_rms) < 1e-6);
+  TEST_ASSERT(open.sp_peak == 0);
+}
+
+void test_interlocks()
+{
+  constexpr size_t c_BPMS = 40;
+  const loop_sim_machine m = make_machine(1, c_BPMS, 0.1);
+  loop_sim_scenario sc;
+  sc.timeframes = 1000;
+  sc.intlk_ctl = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_ORB_DISTORT |
+                 WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_PACKET_LOSS;
+  sc.orb_distort_limit = 5000;
+  sc.min_num_pkts = c_BPMS / 2 - 2;
+
+  // Nothing trips without a disturbance
+  loop_sim_result r = run_loop_sim(m, sc);
+  TEST_ASSERT(r.intlk_tf < 0 && r.timeframes == 1000);
+
+  // An orbit step beyond the limit trips as soon as it's seen
+  sc.step_amp = 20000;
+  sc.step_tf = 300;
+  r = run_loop_sim(m, sc);
+  TEST_ASSERT(r.intlk_tf == 300 && r.intlk_sta == WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT && r.timeframes == 301);
+
+  // Losing 3 BPMs (6 positions) leaves less than min_num_pkts
+  sc.step_amp = 0;
+  sc.outage_bpms = 6;
+  sc.outage_tf = 500;
+  r = run_loop_sim(m, sc);
+  TEST_ASSERT(r.intlk_tf == 500 && r.intlk_sta == WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_PACKET_LOSS);
+  sc.outage_bpms = 4;
+  r = run_loop_sim(m, sc);
+  TEST_ASSERT(r.intlk_tf < 0);
+
+  // Too much gain for the plant delay and corrector bandwidth: the loop
+  // oscillates until the orbit distortion interlock stops it
+  sc.outage_bpms = 0;
+  sc.noise_rms = 10;
+  sc.gain_scale = 18;
+  r = run_loop_sim(m, sc);
+  TEST_ASSERT(r.intlk_tf > 0 && (r.intlk_sta & WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT));
+}
+
+void test_batch()
+{
+  const loop_sim_machine m = make_machine(1, 40, 0.1);
+  std::vector<loop_sim_scenario> scs;
+  for (unsigned i = 0; i < 9; i++) {
+    loop_sim_scenario sc;
+    sc.timeframes = 500 + 100 * i;
+    sc.seed = i;
+    sc.gain_scale = 0.5 + 0.25 * i;
+    sc.noise_rms = 30;
+    sc.sine_amp = 100;
+    sc.sine_freq = 0.01;
+    sc.pkt_loss = 0.01;
+    sc.intlk_ctl = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_ORB_DISTORT;
+    sc.orb_distort_limit = 400;
+    scs.push_back(sc);
+  }
+  loop_sim_batch_stats st1, st3;
+  const std::vector<loop_sim_result> r1 = run_loop_sims(m, scs, 1, &st1);
+  const std::vector<loop_sim_result> r3 = run_loop_sims(m, scs, 3, &st3);
+  TEST_ASSERT(r1.size() == scs.size() && st1.timeframes == st3.timeframes);
+  uint64_t total = 0;
+  for (size_t i = 0; i < scs.size(); i++) {
+    TEST_ASSERT(r1[i].timeframes == r3[i].timeframes && r1[i].intlk_tf == r3[i].intlk_tf);
+    TEST_ASSERT(r1[i].orbit_rms == r3[i].orbit_rms && r1[i].sp_peak == r3[i].sp_peak);
+    total += r1[i].timeframes;
+  }
+  TEST_ASSERT(st1.timeframes == total && st1.seconds > 0);
+}
+
+} // namespace
+
+int main()
+{
+  test_rejection();
+  test_interlocks();
+  test_batch();
+  std::puts("SUCCESS!");
+  return 0;
+}
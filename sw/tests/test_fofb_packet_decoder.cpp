@@ -0,0 +1,156 @@
+// FOFB packet decoder tests: known packets, vectorized against sequential
+// decoding, filters and capture files
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdio>
+#include <stdexcept>
+#include <vector>
+
+#include "fofb_packet_decoder.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+bool same_row(const packet_columns &a, size_t i, const packet_columns &b, size_t j)
+{
+  bool same = a.idx[i] == b.idx[j] && a.tf_cntr_32[i] == b.tf_cntr_32[j] &&
+              a.tf_cntr_16[i] == b.tf_cntr_16[j] && a.tf_start[i] == b.tf_start[j] &&
+              a.bpm_id[i] == b.bpm_id[j] && a.bpm_x[i] == b.bpm_x[j] &&
+              a.bpm_y[i] == b.bpm_y[j];
+  for (unsigned s = 0; s < c_PACKET_SPS; s++)
+    same = same && a.sp_x[s][i] == b.sp_x[s][j] && a.sp_y[s][i] == b.sp_y[s][j];
+  return same;
+}
+
+void test_known_packet()
+{
+  // reformat_fofb_packet_v2.py field extraction
+  const uint32_t pkt[c_PACKET_WORDS] = {
+    0x89abcdef, uint32_t(-123456), 654321, 0x1234u << 16 | 0x8000 | 0x0105,
+    0x7fff8000, 0xffff0001, 0x00020003, 0x80007fff};
+  // Enough packets to go through the vectorized path
+  std::vector<uint32_t> words;
+  for (unsigned p = 0; p < 16; p++)
+    words.insert(words.end(), pkt, pkt + c_PACKET_WORDS);
+
+  for (bool scalar: {false, true}) {
+    packet_columns cols;
+    TEST_ASSERT(decode_packets(words.data(), 16, 100, nullptr, cols, scalar) == 16);
+    for (size_t k = 0; k < 16; k++) {
+      TEST_ASSERT(cols.idx[k] == 100 + k);
+      TEST_ASSERT(cols.tf_cntr_32[k] == 0x89abcdef);
+      TEST_ASSERT(cols.bpm_y[k] == -123456);
+      TEST_ASSERT(cols.bpm_x[k] == 654321);
+      TEST_ASSERT(cols.tf_cntr_16[k] == 0x1234);
+      TEST_ASSERT(cols.tf_start[k] == 1);
+      TEST_ASSERT(cols.bpm_id[k] == 0x105);
+      TEST_ASSERT(cols.sp_x[0][k] == 32767 && cols.sp_y[0][k] == -32768);
+      TEST_ASSERT(cols.sp_x[1][k] == -1 && cols.sp_y[1][k] == 1);
+      TEST_ASSERT(cols.sp_x[2][k] == 2 && cols.sp_y[2][k] == 3);
+      TEST_ASSERT(cols.sp_x[3][k] == -32768 && cols.sp_y[3][k] == 32767);
+    }
+  }
+}
+
+void test_random_packets()
+{
+  // Not a multiple of 8, so the tail is decoded too
+  constexpr size_t c_N = 10003;
+  test_rng rng;
+  std::vector<uint32_t> words(c_N * c_PACKET_WORDS);
+  for (size_t p = 0; p < c_N; p++) {
+    for (unsigned w = 0; w < c_PACKET_WORDS; w++)
+      words[p * c_PACKET_WORDS + w] = uint32_t(rng.next());
+    // Timeframes in order, as in a capture, with a few BPMs each
+    words[p * c_PACKET_WORDS] = uint32_t(p / 8);
+    words[p * c_PACKET_WORDS + 3] = (words[p * c_PACKET_WORDS + 3] & ~c_MAX_BPM_ID) | (p % 40);
+  }
+
+  packet_columns vec, seq;
+  TEST_ASSERT(decode_packets(words.data(), c_N, 0, nullptr, vec) == c_N);
+  TEST_ASSERT(decode_packets(words.data(), c_N, 0, nullptr, seq, true) == c_N);
+  for (size_t k = 0; k < c_N; k++)
+    TEST_ASSERT(same_row(vec, k, seq, k));
+
+  // Filters: the kept packets are the matching rows of the unfiltered
+  // decoding, in order
+  packet_filter filter;
+  filter.add_bpm_ids("1-3,17,30-31");
+  filter.tf_min = 100;
+  filter.tf_max = 1000;
+  packet_columns all = seq;
+  for (bool scalar: {false, true}) {
+    packet_columns cols;
+    const size_t n = decode_packets(words.data(), c_N, 0, &filter, cols, scalar);
+    size_t j = 0;
+    for (size_t k = 0; k < c_N; k++) {
+      const unsigned id = all.bpm_id[k];
+      const bool keep = ((id >= 1 && id <= 3) || id == 17 || id == 30 || id == 31) &&
+                        all.tf_cntr_32[k] >= 100 && all.tf_cntr_32[k] <= 1000;
+      if (keep) {
+        TEST_ASSERT(j < n);
+        TEST_ASSERT(same_row(all, k, cols, j));
+        j++;
+      }
+    }
+    TEST_ASSERT(j == n && n > 0);
+  }
+
+  // Unsigned timeframe comparisons
+  filter = packet_filter();
+  filter.tf_min = 0x80000000;
+  packet_columns cols;
+  TEST_ASSERT(decode_packets(words.data(), c_N, 0, &filter, cols) == 0);
+
+  bool thrown = false;
+  try {
+    filter.add_bpm_ids("3-1");
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+}
+
+void test_capture_file()
+{
+  tmp_file f;
+  std::vector<uint32_t> words(5 * c_PACKET_WORDS);
+  for (size_t i = 0; i < words.size(); i++)
+    words[i] = uint32_t(i);
+  FILE *fp = std::fopen(f.path.c_str(), "wb");
+  TEST_ASSERT(fp);
+  std::fwrite(words.data(), sizeof(uint32_t), words.size(), fp);
+  std::fclose(fp);
+
+  capture_file cap(f.path);
+  TEST_ASSERT(cap.num_packets() == 5);
+  TEST_ASSERT(cap.words()[4 * c_PACKET_WORDS + 7] == 39);
+
+  // Truncated packets are refused
+  fp = std::fopen(f.path.c_str(), "ab");
+  std::fputc(0, fp);
+  std::fclose(fp);
+  bool thrown = false;
+  try {
+    capture_file bad(f.path);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+}
+
+} // namespace
+
+int main()
+{
+  test_known_packet();
+  test_random_packets();
+  test_capture_file();
+  std::puts("SUCCESS!");
+  return 0;
+}
@@ -0,0 +1,204 @@
+// Post-mortem capture tests: file round trip, polling and interrupt driven
+// detection against the mock board interlock, the history contents, STA_CLR
+// and re-arming, and the interlock mask
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fofb_cc_regs_access.h"
+#include "fofb_postmortem.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+constexpr uint32_t c_ORB_DISTORT = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT;
+constexpr uint32_t c_PACKET_LOSS = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_PACKET_LOSS;
+
+// Wait up to 5 s for 'cond'; timings are kept loose, the machine may be busy
+template <typename F>
+bool wait_for(F cond)
+{
+  const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!cond()) {
+    if (std::chrono::steady_clock::now() > end)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+void test_file()
+{
+  tmp_file f;
+  test_rng rng;
+  std::vector<postmortem_sample> samples(5);
+  for (size_t i = 0; i < samples.size(); i++) {
+    std::memset(&samples[i], 0, sizeof(samples[i]));
+    samples[i].t_ns = 1000 * i;
+    samples[i].seq = uint32_t(i);
+    for (int32_t &v: samples[i].sp_decim)
+      v = int32_t(rng.next());
+    samples[i].cc_err[c_CC_ERR_COUNTERS - 1] = uint32_t(i);
+  }
+  postmortem_file_header hdr = {};
+  hdr.trigger_sta = c_PACKET_LOSS;
+  hdr.count = uint32_t(samples.size());
+  hdr.trigger_t_ns = 123456789;
+  hdr.freeze_latency_ns = 42;
+  write_postmortem_file(f.path, hdr, samples.data());
+
+  postmortem_file_header rd;
+  const std::vector<postmortem_sample> back = read_postmortem_file(f.path, &rd);
+  TEST_ASSERT(back.size() == samples.size());
+  TEST_ASSERT(!std::memcmp(back.data(), samples.data(), samples.size() * sizeof(samples[0])));
+  TEST_ASSERT(rd.version == c_POSTMORTEM_FILE_VERSION && rd.count == 5 &&
+              rd.trigger_sta == c_PACKET_LOSS && rd.trigger_t_ns == 123456789 &&
+              rd.freeze_latency_ns == 42);
+
+  // Truncated
+  {
+    FILE *fp = std::fopen(f.path.c_str(), "r+b");
+    TEST_ASSERT(fp && ftruncate(fileno(fp), sizeof(hdr) + 2 * sizeof(samples[0])) == 0);
+    std::fclose(fp);
+  }
+  bool threw = false;
+  try {
+    read_postmortem_file(f.path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+// Check an event and its file: complete, ordered history up to the
+// interlock: 'trig' only shows again in the last sample, if at all. The CC
+// words are constant: link_up and the last link's frame error count.
+void check_event(const postmortem_event &e, uint32_t sta, uint32_t trig, uint64_t raised_ns,
+                 uint32_t link_up = 0, uint32_t frame_err = 0)
+{
+  TEST_ASSERT(e.error.empty() && e.sta == sta);
+  TEST_ASSERT(e.detect_ns >= raised_ns && e.freeze_ns >= e.detect_ns &&
+              e.clear_ns >= e.freeze_ns);
+
+  postmortem_file_header hdr;
+  const std::vector<postmortem_sample> s = read_postmortem_file(e.file, &hdr);
+  std::remove(e.file.c_str());
+  TEST_ASSERT(hdr.trigger_sta == sta && hdr.count == e.samples && s.size() == e.samples);
+  TEST_ASSERT(hdr.freeze_latency_ns == e.freeze_ns - e.detect_ns);
+  TEST_ASSERT(!s.empty());
+  for (size_t i = 1; i < s.size(); i++)
+    TEST_ASSERT(s[i].seq == s[i - 1].seq + 1 && s[i].t_ns > s[i - 1].t_ns);
+  for (const postmortem_sample &smp: s)
+    TEST_ASSERT(smp.cc_link_up == link_up && smp.cc_err[c_CC_ERR_COUNTERS - 1] == frame_err);
+  // The history since re-arming may start before STA_CLR took effect
+  size_t i = 0;
+  while (i + 1 < s.size() && (s[i].loop_intlk_sta & trig))
+    i++;
+  for (; i + 1 < s.size(); i++)
+    TEST_ASSERT(!(s[i].loop_intlk_sta & trig));
+  TEST_ASSERT(s.back().t_ns <= hdr.trigger_t_ns);
+}
+
+void test_polling()
+{
+  mock_board board;
+  board.cc().write32(regs::fofb_cc_regs::ram_reg::data::reg_addr(cc_status::link_up), 0xf);
+  board.cc().write32(regs::fofb_cc_regs::ram_reg::data::reg_addr(cc_status::frame_err_cnt + 3),
+                     7);
+  intlk_sim sim(board);
+
+  postmortem_config cfg;
+  cfg.rate_hz = 2000;
+  cfg.depth = 64;
+  cfg.mask = c_ORB_DISTORT;
+  cfg.poll_ns = 20000;
+  cfg.out_dir = "/tmp";
+  postmortem_capture cap(board.proc(), 0, &board.cc(), 0, cfg);
+  cap.start();
+
+  // Fill the history past its depth, then trip the interlock
+  TEST_ASSERT(wait_for([&] { return cap.stats().samples > 2 * cfg.depth; }));
+  const uint64_t raised = sim.raise(c_ORB_DISTORT);
+  TEST_ASSERT(wait_for([&] { return cap.stats().events == 1 && sim.clears() == 1; }));
+  std::vector<postmortem_event> evs = cap.events();
+  check_event(evs[0], c_ORB_DISTORT, c_ORB_DISTORT, raised, 0xf, 7);
+  TEST_ASSERT(evs[0].samples == cfg.depth);
+
+  // A masked out source doesn't trigger
+  sim.raise(c_PACKET_LOSS);
+  const uint64_t samples = cap.stats().samples;
+  TEST_ASSERT(wait_for([&] { return cap.stats().samples > samples + 20; }));
+  TEST_ASSERT(cap.stats().events == 1 && sim.clears() == 1);
+
+  // Re-armed: the next one is caught, with the history since re-arming
+  const uint64_t raised2 = sim.raise(c_ORB_DISTORT | c_PACKET_LOSS);
+  TEST_ASSERT(wait_for([&] { return cap.stats().events == 2; }));
+  cap.stop();
+  evs = cap.events();
+  check_event(evs[1], c_ORB_DISTORT | c_PACKET_LOSS, c_ORB_DISTORT, raised2, 0xf, 7);
+  TEST_ASSERT(evs[1].samples <= cfg.depth);
+  TEST_ASSERT(sim.clears() == 2);
+
+  const postmortem_stats st = cap.stats();
+  TEST_ASSERT(st.sta_reads > 0 && st.irqs == 0 && st.cpu_ns > 0 && st.wall_ns > 0);
+  TEST_ASSERT(st.max_freeze_latency_ns >= evs[0].freeze_ns - evs[0].detect_ns);
+}
+
+void test_irq()
+{
+  mock_board board;
+  event_irq irq;
+  intlk_sim sim(board, &irq);
+
+  postmortem_config cfg;
+  cfg.rate_hz = 1000;
+  cfg.depth = 16;
+  cfg.out_dir = "/tmp";
+  postmortem_capture cap(board.proc(), 0, nullptr, 0, cfg, &irq);
+
+  // Present before the start: has to clear first
+  sim.raise(c_PACKET_LOSS);
+  cap.start();
+  TEST_ASSERT(wait_for([&] { return cap.stats().samples > 5 && cap.stats().irqs == 1; }));
+  TEST_ASSERT(cap.stats().events == 0);
+
+  // Cleared by hand (the capture uses board.proc()), then a full history
+  mmap_device proc(board.path(), sizeof(wb_fofb_processing_regs), c_MOCK_PROC_OFF);
+  proc.write32(WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL,
+               WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR);
+  TEST_ASSERT(wait_for([&] { return sim.clears() == 1; }));
+  const uint64_t samples = cap.stats().samples;
+  TEST_ASSERT(wait_for([&] { return cap.stats().samples > samples + 2 * cfg.depth; }));
+
+  const uint64_t raised = sim.raise(c_PACKET_LOSS);
+  TEST_ASSERT(wait_for([&] { return cap.stats().events == 1; }));
+  cap.stop();
+  const std::vector<postmortem_event> evs = cap.events();
+  check_event(evs[0], c_PACKET_LOSS, c_PACKET_LOSS, raised);
+  TEST_ASSERT(evs[0].samples == cfg.depth);
+  // loop_intlk.sta is only read between samples on interrupts
+  const postmortem_stats st = cap.stats();
+  TEST_ASSERT(st.irqs >= 1 && st.irqs <= 2 && st.sta_reads <= st.irqs);
+}
+
+} // namespace
+
+int main()
+{
+  test_file();
+  test_polling();
+  test_irq();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
@@ -0,0 +1,200 @@
+// fofb_processing_model tests
+//
+// Replays the xwb_fofb_processing_tb stimulus with the same tolerances, then
+// checks the vectorized dot product against the sequential one, saturation
+// included.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+
+#include "fofb_processing_model.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+constexpr int c_SP_MAX = 15200;
+constexpr int c_SP_MIN = -15200;
+constexpr uint32_t c_ORB_DISTORT_LIMIT = 1000;
+
+// Coefficient normalized between -1.0 and +1.0 as written by
+// t_coeff_ram_data.load_coeff_from_file
+uint32_t coeff_to_reg(double coeff)
+{
+  if (coeff >= 1.0)
+    return 0x7fffffff;
+  if (coeff <= -1.0)
+    return 0x80000000;
+  return uint32_t(int32_t(std::lround(coeff * std::ldexp(1.0, 31))));
+}
+
+double coeff_reg_to_real(uint32_t reg, unsigned frac_width)
+{
+  return std::ldexp(double(int32_t(reg) >> (31 - frac_width)), -int(frac_width));
+}
+
+void test_xwb_fofb_processing_tb()
+{
+  const auto coeff_dat = read_dat<double>("xwb_fofb_processing/coeff_norm.dat");
+  const auto ref_dat = read_dat<int32_t>("xwb_fofb_processing/fofb_bpm_ref.dat");
+  const auto gains_dat = read_dat<double>("xwb_fofb_processing/fofb_gains.dat");
+  const auto pos_dat = read_dat<int32_t>("xwb_fofb_processing/fofb_bpm_pos.dat");
+
+  fofb_processing_generics gen;
+  auto regs = std::make_unique<wb_fofb_processing_regs>();
+  std::memset(regs.get(), 0, sizeof(*regs));
+  regs->fixed_point_pos.coeff = 31 - gen.coeff_int_width;
+  regs->fixed_point_pos.accs_gains = 31 - gen.gain_int_width;
+  regs->sp_decim_ratio_max = gen.sp_decim_max_ratio;
+  gen.from_regs(*regs);
+
+  uint32_t coeffs[c_NUM_BPM_POS] = {};
+  for (unsigned i = 0; i < c_NUM_BPM_POS && i < coeff_dat.size(); i++)
+    coeffs[i] = coeff_to_reg(coeff_dat[i]);
+  for (unsigned i = 0; i < c_NUM_BPM_POS && i < ref_dat.size(); i++)
+    regs->sps_ram_bank[i].data = uint32_t(ref_dat[i]);
+
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+      regs->ch[ch].coeff_ram_bank[i].data = coeffs[i];
+    regs->ch[ch].acc.gain =
+      uint32_t(int32_t(std::lround(gains_dat[ch] * (1 << gen.gain_frac_width)))) << 16;
+    regs->ch[ch].sp_limits.max = uint32_t(c_SP_MAX);
+    regs->ch[ch].sp_limits.min = uint32_t(c_SP_MIN);
+    regs->ch[ch].sp_decim.ratio = ch;
+  }
+  regs->loop_intlk.orb_distort_limit = c_ORB_DISTORT_LIMIT;
+  regs->loop_intlk.min_num_pkts = 10;
+
+  fofb_processing_model model(gen);
+  model.load_regs(*regs);
+
+  double expec_sp[c_MAX_CHANNELS] = {};
+  double expec_sp_decim[c_MAX_CHANNELS] = {};
+  size_t pos_idx = 0;
+  for (unsigned c = 0; c < 20; c++) {
+    int32_t bpm_pos[c_NUM_BPM_POS] = {};
+    uint64_t valid[c_NUM_BPM_POS / 64] = {};
+    double expec_dot_prod = 0.0;
+    for (unsigned i = 0; i < 160; i++) {
+      bpm_pos[i] = pos_dat[pos_idx++];
+      bpm_pos[i + 256] = pos_dat[pos_idx++];
+      valid[i / 64] |= uint64_t(1) << (i % 64);
+      valid[(i + 256) / 64] |= uint64_t(1) << ((i + 256) % 64);
+      expec_dot_prod += double(ref_dat[i] - bpm_pos[i]) *
+                        coeff_reg_to_real(coeffs[i], gen.coeff_frac_width);
+      expec_dot_prod += double(ref_dat[i + 256] - bpm_pos[i + 256]) *
+                        coeff_reg_to_real(coeffs[i + 256], gen.coeff_frac_width);
+    }
+
+    fofb_processing_result res;
+    model.process(bpm_pos, valid, 1, &res);
+
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      expec_sp[ch] += gains_dat[ch] * expec_dot_prod;
+      expec_sp[ch] = std::min(std::max(expec_sp[ch], double(c_SP_MIN)), double(c_SP_MAX));
+      expec_sp_decim[ch] += expec_sp[ch];
+
+      const double sp_err = std::abs(res.sp[ch] / std::floor(expec_sp[ch]) - 1.0);
+      const double sp_diff = std::abs(res.sp[ch] - expec_sp[ch]);
+      TEST_ASSERT(sp_err <= 0.01 || sp_diff <= 2.0);
+
+      if (res.sp_decim_valid & (1u << ch)) {
+        const double decim_err =
+          std::abs(res.sp_decim[ch] / std::floor(expec_sp_decim[ch]) - 1.0);
+        TEST_ASSERT(decim_err <= 0.01);
+        expec_sp_decim[ch] = 0.0;
+      }
+    }
+    // ch[i].sp_decim.ratio = i, so channel 0 decimates every timeframe
+    TEST_ASSERT(res.sp_decim_valid & 1);
+    TEST_ASSERT(res.loop_intlk_sta == 0);
+  }
+
+  // Enabling loop interlock orbit distortion source, the loop should
+  // interlock on the second extra cycle
+  model.set_loop_intlk_ctl(WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_ORB_DISTORT);
+  for (unsigned c = 0; c < 2; c++) {
+    int32_t bpm_pos[c_NUM_BPM_POS] = {};
+    uint64_t valid[c_NUM_BPM_POS / 64] = {};
+    bpm_pos[0] = int32_t(c_ORB_DISTORT_LIMIT) + ref_dat[0] + int32_t(c);
+    bpm_pos[256] = ref_dat[256];
+    valid[0] = 1;
+    valid[4] = 1;
+    int16_t sp_before[c_MAX_CHANNELS];
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+      sp_before[ch] = model.sp(ch);
+
+    fofb_processing_result res;
+    model.process(bpm_pos, valid, 1, &res);
+    if (c == 0) {
+      TEST_ASSERT(res.loop_intlk_sta == 0);
+    } else {
+      TEST_ASSERT(res.loop_intlk_sta == WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT);
+      // Interlocked: accumulators are frozen
+      for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+        TEST_ASSERT(res.sp[ch] == sp_before[ch]);
+    }
+  }
+
+  model.set_loop_intlk_ctl(WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_STA_CLR);
+  TEST_ASSERT(model.loop_intlk_sta() == 0);
+}
+
+void test_vec_vs_seq()
+{
+  test_rng rng;
+  fofb_processing_generics gen;
+  fofb_processing_model vec(gen), seq(gen);
+  seq.set_force_scalar(true);
+
+  for (unsigned round = 0; round < 2; round++) {
+    // Second round uses full scale coefficients so the dot product
+    // accumulator saturates
+    const int64_t coeff_lim = round ? 0x7fffffff : 0x00ffffff;
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      for (unsigned i = 0; i < c_NUM_BPM_POS; i++) {
+        const uint32_t coeff = uint32_t(rng.range(-coeff_lim, coeff_lim));
+        vec.set_coeff(ch, i, coeff);
+        seq.set_coeff(ch, i, coeff);
+      }
+      const uint32_t gain = uint32_t(rng.range(-0x7fffffff, 0x7fffffff));
+      vec.set_acc_gain(ch, gain);
+      seq.set_acc_gain(ch, gain);
+      vec.set_sp_limits(ch, 30000, uint32_t(-30000));
+      seq.set_sp_limits(ch, 30000, uint32_t(-30000));
+      vec.set_sp_decim_ratio(ch, ch * 3);
+      seq.set_sp_decim_ratio(ch, ch * 3);
+    }
+
+    constexpr size_t n_tf = 200;
+    std::vector<int32_t> bpm_pos(n_tf * c_NUM_BPM_POS);
+    std::vector<uint64_t> valid(n_tf * c_NUM_BPM_POS / 64);
+    for (auto &pos: bpm_pos)
+      pos = int32_t(rng.range(-2000000, 2000000));
+    for (auto &v: valid)
+      v = rng.next() | rng.next();
+
+    std::vector<fofb_processing_result> res_vec(n_tf), res_seq(n_tf);
+    vec.process(bpm_pos.data(), valid.data(), n_tf, res_vec.data());
+    seq.process(bpm_pos.data(), valid.data(), n_tf, res_seq.data());
+    TEST_ASSERT(std::memcmp(res_vec.data(), res_seq.data(),
+                            n_tf * sizeof(fofb_processing_result)) == 0);
+  }
+}
+
+} // namespace
+
+int main()
+{
+  test_xwb_fofb_processing_tb();
+  test_vec_vs_seq();
+  std::puts("SUCCESS!");
+  return 0;
+}
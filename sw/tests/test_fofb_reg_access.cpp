@@ -0,0 +1,141 @@
+// Typed register access tests: generated definitions against the cheby
+// macros, and bus accesses on a file-backed stand-in device
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstddef>
+
+#include "fofb_cc_regs_access.h"
+#include "wb_fofb_processing_regs_access.h"
+#include "wb_fofb_shaper_filt_regs_access.h"
+#include "wb_fofb_sys_id_regs_access.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+using proc = regs::wb_fofb_processing_regs;
+using shaper = regs::wb_fofb_shaper_filt_regs;
+using sys_id = regs::wb_fofb_sys_id_regs;
+using cc = regs::fofb_cc_regs;
+
+// Addresses
+static_assert(proc::ch<3>::acc::gain::reg_addr ==
+              offsetof(::wb_fofb_processing_regs, ch[3].acc.gain), "");
+static_assert(proc::ch<11>::sp_decim::ratio::reg_addr ==
+              offsetof(::wb_fofb_processing_regs, ch[11].sp_decim.ratio), "");
+static_assert(proc::ch<2>::coeff_ram_bank::data::reg_addr(5) ==
+              offsetof(::wb_fofb_processing_regs, ch[2].coeff_ram_bank[5]), "");
+static_assert(proc::sps_ram_bank::data::reg_addr(511) ==
+              offsetof(::wb_fofb_processing_regs, sps_ram_bank[511]), "");
+static_assert(proc::sps_ram_bank::data::reg_depth == c_NUM_BPM_POS, "");
+static_assert(shaper::ch<4>::coeffs::val::reg_addr(10) ==
+              offsetof(::wb_fofb_shaper_filt_regs, ch[4].coeffs[10]), "");
+static_assert(shaper::coeffs_fp_repr::reg_addr ==
+              offsetof(::wb_fofb_shaper_filt_regs, coeffs_fp_repr), "");
+static_assert(sys_id::prbs::sp_distort::ch<7>::levels::reg_addr ==
+              offsetof(::wb_fofb_sys_id_regs, prbs.sp_distort.ch[7].levels), "");
+static_assert(sys_id::prbs::bpm_pos_distort::distort_ram::levels::reg_addr(9) ==
+              offsetof(::wb_fofb_sys_id_regs, prbs.bpm_pos_distort.distort_ram[9]), "");
+static_assert(cc::ram_reg::data::reg_addr(3) == offsetof(::fofb_cc_regs, ram_reg[3]), "");
+static_assert(cc::xy_buff_ctl::reg_addr == FOFB_CC_REGS_XY_BUFF_CTL, "");
+
+// Fields
+using prbs_ctl = sys_id::prbs::ctl;
+static_assert(prbs_ctl::step_duration::shift == WB_FOFB_SYS_ID_REGS_PRBS_CTL_STEP_DURATION_SHIFT,
+              "");
+static_assert(prbs_ctl::step_duration::width == 10, "");
+static_assert(prbs_ctl::lfsr_length::shift == WB_FOFB_SYS_ID_REGS_PRBS_CTL_LFSR_LENGTH_SHIFT, "");
+static_assert(prbs_ctl::sp_distort_en::width == 1, "");
+static_assert(cc::cfg_val::cc_enable::put(0, 1) == FOFB_CC_REGS_CFG_VAL_CC_ENABLE, "");
+static_assert(cc::xy_buff_ctl::addr::put(0, 0x1234) == 0x12340000, "");
+static_assert(shaper::coeffs_fp_repr::frac_width::get(17 << 5 | 2) == 17, "");
+static_assert(shaper::coeffs_fp_repr::int_width::get(17 << 5 | 2) == 2, "");
+static_assert(sys_id::prbs::sp_distort::ch<0>::levels::level_1::get_signed(0xfffe0000) == -2, "");
+static_assert(regs::compose(prbs_ctl::step_duration::val(3), prbs_ctl::lfsr_length::val(5)) ==
+              (3 << WB_FOFB_SYS_ID_REGS_PRBS_CTL_STEP_DURATION_SHIFT |
+               5 << WB_FOFB_SYS_ID_REGS_PRBS_CTL_LFSR_LENGTH_SHIFT), "");
+
+void test_bus_accesses()
+{
+  tmp_file f;
+  mmap_device dev(f.path, sizeof(::wb_fofb_sys_id_regs), 0, true);
+  regs::reg_block<sys_id> blk(dev);
+
+  // Several fields in a single write, without reading first
+  blk.write_fields<prbs_ctl>(prbs_ctl::step_duration::val(3), prbs_ctl::lfsr_length::val(5),
+                             prbs_ctl::sp_distort_en::val(1));
+  TEST_ASSERT(dev.stats().writes == 1 && dev.stats().reads == 0);
+  TEST_ASSERT(dev.read32(WB_FOFB_SYS_ID_REGS_PRBS_CTL) ==
+              (3 << WB_FOFB_SYS_ID_REGS_PRBS_CTL_STEP_DURATION_SHIFT |
+               5 << WB_FOFB_SYS_ID_REGS_PRBS_CTL_LFSR_LENGTH_SHIFT |
+               WB_FOFB_SYS_ID_REGS_PRBS_CTL_SP_DISTORT_EN));
+
+  // Partial update: read-modify-write keeping the other fields
+  dev.reset_stats();
+  blk.modify<prbs_ctl>(prbs_ctl::lfsr_length::val(7));
+  TEST_ASSERT(dev.stats().writes == 1 && dev.stats().reads == 1);
+  TEST_ASSERT((blk.read_field<prbs_ctl::step_duration, prbs_ctl>() == 3));
+  TEST_ASSERT((blk.read_field<prbs_ctl::lfsr_length, prbs_ctl>() == 7));
+  TEST_ASSERT((blk.read_field<prbs_ctl::sp_distort_en, prbs_ctl>() == 1));
+
+  // Fields covering the whole register: no read needed
+  using levels = sys_id::prbs::sp_distort::ch<5>::levels;
+  dev.reset_stats();
+  blk.modify<levels>(levels::level_0::val(0x1234), levels::level_1::val(0xfedc));
+  TEST_ASSERT(dev.stats().writes == 1 && dev.stats().reads == 0);
+  TEST_ASSERT(dev.read32(WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH +
+                         5 * WB_FOFB_SYS_ID_REGS_PRBS_SP_DISTORT_CH_SIZE) == 0xfedc1234);
+
+  // Memories
+  using distort_ram = sys_id::prbs::bpm_pos_distort::distort_ram::levels;
+  blk.write<distort_ram>(9, 0xcafe);
+  TEST_ASSERT(blk.read<distort_ram>(9) == 0xcafe);
+
+  // Constants are read once, until invalidated
+  dev.write32(WB_FOFB_SYS_ID_REGS_BPM_POS_FLATENIZER_MAX_NUM_CTE, 160);
+  dev.reset_stats();
+  for (int i = 0; i < 10; i++)
+    TEST_ASSERT(blk.read<sys_id::bpm_pos_flatenizer::max_num_cte>() == 160);
+  TEST_ASSERT(dev.stats().reads == 1);
+  dev.write32(WB_FOFB_SYS_ID_REGS_BPM_POS_FLATENIZER_MAX_NUM_CTE, 320);
+  TEST_ASSERT(blk.read<sys_id::bpm_pos_flatenizer::max_num_cte>() == 160);
+  blk.invalidate_consts();
+  TEST_ASSERT(blk.read<sys_id::bpm_pos_flatenizer::max_num_cte>() == 320);
+
+  // Ordinary registers are always read from the device
+  dev.reset_stats();
+  blk.read<prbs_ctl>();
+  blk.read<prbs_ctl>();
+  TEST_ASSERT(dev.stats().reads == 2);
+}
+
+void test_block_offset()
+{
+  // Block mapped at an offset of the device window
+  constexpr size_t c_BASE = 0x10000;
+  tmp_file f;
+  mmap_device dev(f.path, c_BASE + sizeof(::wb_fofb_processing_regs), 0, true);
+  regs::reg_block<proc> blk(dev, c_BASE);
+
+  blk.write<proc::ch<4, 8>::acc::gain>(0x5555);
+  TEST_ASSERT(dev.read32(c_BASE + WB_FOFB_PROCESSING_REGS_CH +
+                         4 * WB_FOFB_PROCESSING_REGS_CH_SIZE +
+                         WB_FOFB_PROCESSING_REGS_CH_ACC_GAIN) == 0x5555);
+  blk.write<proc::ch<1>::coeff_ram_bank::data>(100, 0xabcd);
+  TEST_ASSERT(dev.read32(c_BASE + WB_FOFB_PROCESSING_REGS_CH +
+                         WB_FOFB_PROCESSING_REGS_CH_SIZE + 4 * 100) == 0xabcd);
+}
+
+} // namespace
+
+int main()
+{
+  test_bus_accesses();
+  test_block_offset();
+  std::puts("SUCCESS!");
+  return 0;
+}
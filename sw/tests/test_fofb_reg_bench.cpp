@@ -0,0 +1,192 @@
+// Register access benchmark tests: mmap_device latency injection, the mock
+// board address map, the deterministic access counts of each benchmark and
+// the report round trip and regression checks
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "fofb_cc_status.h"
+#include "fofb_reg_bench.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+void test_latency()
+{
+  tmp_file f;
+  mmap_device dev(f.path, 4096, 0, true);
+  uint32_t buf[100];
+
+  auto elapsed_us = [](auto op) {
+    const auto start = std::chrono::steady_clock::now();
+    op();
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() -
+                                                     start).count();
+  };
+
+  dev.set_latency(2000, 500);
+  // Each word of a burst pays the latency, a 64 bits read once
+  TEST_ASSERT(elapsed_us([&] { dev.read_burst(0, buf, 100); }) >= 200);
+  TEST_ASSERT(elapsed_us([&] { dev.write_burst(0, buf, 100); }) >= 50);
+  TEST_ASSERT(elapsed_us([&] { dev.read32(0); }) >= 2);
+  TEST_ASSERT(elapsed_us([&] { dev.write32(0, 1); }) >= 0.5);
+  TEST_ASSERT(elapsed_us([&] { dev.read64(8); }) >= 2);
+
+  dev.set_latency(0, 0);
+  TEST_ASSERT(elapsed_us([&] { dev.read_burst(0, buf, 100); }) < 200);
+  TEST_ASSERT(dev.read32(0) == 1);
+}
+
+void test_mock_board()
+{
+  tmp_file f;
+  mock_board board(f.path);
+  board.proc().write32(WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA, 0x11);
+  board.cc().write32(0, 0x22);
+  board.sys_id().write32(0, 0x33);
+  board.shaper().write32(0, 0x44);
+
+  // Each block at its offset of the file, as other processes would map it
+  mmap_device whole(f.path, c_MOCK_BOARD_SIZE);
+  TEST_ASSERT(whole.read32(c_MOCK_PROC_OFF + WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA) == 0x11);
+  TEST_ASSERT(whole.read32(c_MOCK_CC_OFF) == 0x22);
+  TEST_ASSERT(whole.read32(c_MOCK_SYS_ID_OFF) == 0x33);
+  TEST_ASSERT(whole.read32(c_MOCK_SHAPER_OFF) == 0x44);
+
+  const device_stats st = board.stats();
+  TEST_ASSERT(st.writes == 4 && st.reads == 0);
+  board.reset_stats();
+  TEST_ASSERT(board.stats().writes == 0);
+
+  // The default one is removed with the board
+  std::string path;
+  {
+    mock_board tmp;
+    path = tmp.path();
+    TEST_ASSERT(std::ifstream(path).good());
+  }
+  TEST_ASSERT(!std::ifstream(path).good());
+}
+
+const reg_bench_result &find(const std::vector<reg_bench_result> &res, const std::string &name)
+{
+  for (const reg_bench_result &r: res)
+    if (r.name == name)
+      return r;
+  throw std::logic_error("no result " + name);
+}
+
+void test_benchmarks()
+{
+  mock_board board;
+  reg_bench_config cfg;
+  cfg.read_ns = 0;
+  cfg.write_ns = 0;
+  cfg.iterations = 20;
+  cfg.warmup = 2;
+  std::vector<reg_bench_result> res = fofb_reg_bench(board, cfg).run();
+  TEST_ASSERT(res.size() == reg_bench_names().size());
+  for (size_t i = 0; i < res.size(); i++) {
+    TEST_ASSERT(res[i].name == reg_bench_names()[i] && res[i].iterations == 20);
+    TEST_ASSERT(res[i].median_us <= res[i].p99_us && res[i].bus_us == 0);
+  }
+
+  // Every coefficient and set-point written, in one burst per RAM
+  const reg_bench_result &up = find(res, "matrix_upload");
+  TEST_ASSERT(up.writes == (c_MAX_CHANNELS + 1) * 512 && up.write_bursts == c_MAX_CHANNELS + 1);
+  const reg_bench_result &sh = find(res, "shaper_reload");
+  TEST_ASSERT(sh.writes == c_MAX_CHANNELS * 80 && sh.write_bursts == c_MAX_CHANNELS &&
+              sh.reads == 1);
+  TEST_ASSERT(find(res, "cc_drain").reads == 2 * c_CC_NODES + 2 * c_CC_XY_DEPTH + 2);
+  TEST_ASSERT(find(res, "cc_drain_wbw").reads > find(res, "cc_drain").reads);
+  TEST_ASSERT(find(res, "sp_decim_poll").reads == c_MAX_CHANNELS);
+  TEST_ASSERT(find(res, "intlk_status").reads == 1 && find(res, "intlk_status").writes == 0);
+
+  // The latency shows in the times
+  cfg.read_ns = 20000;
+  cfg.write_ns = 1000;
+  cfg.iterations = 5;
+  cfg.warmup = 0;
+  cfg.only = {"intlk_status", "shaper_reload"};
+  res = fofb_reg_bench(board, cfg).run();
+  TEST_ASSERT(res.size() == 2 && res[0].name == "shaper_reload");
+  TEST_ASSERT(res[1].bus_us == 20 && res[1].median_us >= 20);
+  TEST_ASSERT(res[0].bus_us == 20 + c_MAX_CHANNELS * 80 && res[0].median_us >= res[0].bus_us);
+
+  cfg.only = {"no_such_bench"};
+  bool threw = false;
+  try {
+    fofb_reg_bench(board, cfg);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+void test_report()
+{
+  reg_bench_config cfg;
+  std::vector<reg_bench_result> res(2);
+  res[0] = {"matrix_upload", 100, 800.25, 950.5, 812, 130, 6656, 13, 13, 795.6};
+  res[1] = {"intlk_status", 100, 1.5, 3.25, 1.75, 1, 0, 0, 0, 1};
+
+  tmp_file f;
+  {
+    std::ofstream fout(f.path);
+    write_reg_bench_report(fout, cfg, res);
+  }
+  const std::vector<reg_bench_result> back = read_reg_bench_report(f.path);
+  TEST_ASSERT(back.size() == 2 && back[0].name == "matrix_upload" && back[1].p99_us == 3.25);
+  TEST_ASSERT(back[0].writes == 6656 && back[0].bus_us == 795.6);
+  TEST_ASSERT(compare_reg_bench(back, res, 0.1).empty());
+
+  // Slower within the tolerance, then beyond it, then an extra access
+  std::vector<reg_bench_result> cur = res;
+  cur[0].median_us *= 1.05;
+  TEST_ASSERT(compare_reg_bench(back, cur, 0.1).empty());
+  cur[0].median_us = res[0].median_us * 1.2;
+  TEST_ASSERT(compare_reg_bench(back, cur, 0.1).size() == 1);
+  cur[1].reads = 2;
+  std::vector<std::string> regs = compare_reg_bench(back, cur, 0.1);
+  TEST_ASSERT(regs.size() == 2 && regs[1].find("intlk_status") == 0);
+  // Fewer accesses and benchmarks missing from the baseline are fine
+  cur = res;
+  cur[0].reads = 100;
+  cur.push_back({"cc_drain", 100, 1, 1, 1, 1, 1, 1, 1, 1});
+  TEST_ASSERT(compare_reg_bench(back, cur, 0.1).empty());
+
+  {
+    std::ofstream fout(f.path);
+    fout << "benchmark,median\n";
+  }
+  bool threw = false;
+  try {
+    read_reg_bench_report(f.path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+} // namespace
+
+int main()
+{
+  test_latency();
+  test_mock_board();
+  test_benchmarks();
+  test_report();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
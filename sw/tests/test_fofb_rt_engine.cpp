@@ -0,0 +1,274 @@
+// Real-time engine tests: set-points computed by the engine against the
+// processing and shaper models run offline, the X/Y buffer stand-in (frame
+// layout, ring and underruns), cycle statistics and histogram quantiles
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_rt_engine.h"
+#include "fofb_xy_shm.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+struct images {
+  std::unique_ptr<wb_fofb_processing_regs> proc{new wb_fofb_processing_regs()};
+  std::unique_ptr<wb_fofb_shaper_filt_regs> shaper{new wb_fofb_shaper_filt_regs()};
+};
+
+images make_images(test_rng &rng)
+{
+  images img;
+  std::memset(img.proc.get(), 0, sizeof(*img.proc));
+  std::memset(img.shaper.get(), 0, sizeof(*img.shaper));
+  fofb_shaper_filt_model shaper;
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+      img.proc->ch[ch].coeff_ram_bank[i].data = uint32_t(rng.range(-0xffffff, 0xffffff));
+    img.proc->ch[ch].acc.gain = uint32_t(rng.range(-0x7fffffff, 0x7fffffff));
+    img.proc->ch[ch].sp_limits.max = 30000;
+    img.proc->ch[ch].sp_limits.min = uint32_t(-30000);
+    // One low pass biquad, the others pass through
+    const double lp[5] = {0.2, 0.2, 0, -0.6, 0};
+    for (unsigned k = 0; k < 5; k++)
+      img.shaper->ch[ch].coeffs[k].val = shaper.coeff_to_reg(lp[k]);
+    for (unsigned b = 1; b < c_SHAPER_FILT_MAX_BIQUADS; b++)
+      img.shaper->ch[ch].coeffs[b * c_SHAPER_FILT_COEFFS_PER_BIQUAD].val =
+        shaper.coeff_to_reg(1);
+  }
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+    img.proc->sps_ram_bank[i].data = uint32_t(rng.range(-1000, 1000));
+  return img;
+}
+
+// Offline reference: the filtered set-points of each timeframe
+std::vector<int16_t> reference(const images &img, const std::vector<int32_t> &pos,
+                               const std::vector<uint64_t> *valid)
+{
+  fofb_processing_model proc;
+  proc.load_regs(*img.proc);
+  fofb_shaper_filt_model shaper;
+  shaper.load_regs(*img.shaper);
+  const size_t n_tf = pos.size() / c_NUM_BPM_POS;
+  std::vector<int16_t> sp(n_tf * c_MAX_CHANNELS);
+  for (size_t tf = 0; tf < n_tf; tf++) {
+    fofb_processing_result res;
+    proc.process(&pos[tf * c_NUM_BPM_POS],
+                 valid ? &(*valid)[tf * c_NUM_BPM_POS / 64] : nullptr, 1, &res);
+    shaper.process(res.sp, 1, &sp[tf * c_MAX_CHANNELS]);
+  }
+  return sp;
+}
+
+void check_steps(rt_engine &eng, const std::vector<int16_t> &ref, size_t n_tf)
+{
+  std::vector<rt_engine_step> steps(n_tf + 1);
+  TEST_ASSERT(eng.outputs()->pop(steps.data(), steps.size()) == n_tf);
+  for (size_t tf = 0; tf < n_tf; tf++) {
+    TEST_ASSERT(steps[tf].tf == tf);
+    TEST_ASSERT(!std::memcmp(steps[tf].filt_sp, &ref[tf * c_MAX_CHANNELS],
+                             sizeof(steps[tf].filt_sp)));
+  }
+}
+
+void check_histogram(const rt_histogram &h, uint64_t count)
+{
+  uint64_t sum = 0;
+  for (uint64_t b: h.bins)
+    sum += b;
+  TEST_ASSERT(h.count == count && sum == count);
+  TEST_ASSERT(h.quantile_ns(0.5) <= h.quantile_ns(0.99) &&
+              h.quantile_ns(0.99) <= h.quantile_ns(1) && h.quantile_ns(1) == h.max_ns);
+}
+
+void test_replay()
+{
+  test_rng rng;
+  const images img = make_images(rng);
+  constexpr size_t c_TF = 2000;
+  std::vector<int32_t> pos(c_TF * c_NUM_BPM_POS);
+  for (int32_t &p: pos)
+    p = int32_t(rng.range(-100000, 100000));
+  const std::vector<int16_t> ref = reference(img, pos, nullptr);
+
+  // Back to back, until the end of the recording
+  rt_replay_source src(pos);
+  rt_engine_config cfg;
+  cfg.free_run = true;
+  cfg.output_ring = 4096;
+  rt_engine eng(*img.proc, img.shaper.get(), src, cfg);
+  eng.start();
+  eng.wait();
+  TEST_ASSERT(!eng.running());
+  rt_engine_stats st = eng.stats();
+  TEST_ASSERT(st.cycles == c_TF && st.timeframes == c_TF && st.underruns == 0 &&
+              st.overruns == 0 && st.dropped == 0);
+  check_histogram(st.compute, c_TF);
+  check_histogram(st.latency, c_TF);
+  check_steps(eng, ref, c_TF);
+
+  // The accumulators' state is the board's
+  auto rb = std::make_unique<wb_fofb_processing_regs>();
+  eng.processing().store_regs(*rb);
+  fofb_processing_model proc;
+  proc.load_regs(*img.proc);
+  proc.process(pos.data(), nullptr, c_TF, nullptr);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(eng.processing().sp(ch) == proc.sp(ch));
+
+  // On the loop clock, looping over the recording, with a small ring
+  rt_replay_source loop_src(std::vector<int32_t>(pos.begin(), pos.begin() + 10 * c_NUM_BPM_POS),
+                            true);
+  cfg.free_run = false;
+  cfg.cycles = 960;
+  cfg.output_ring = 256;
+  rt_engine paced(*img.proc, nullptr, loop_src, cfg);
+  const uint64_t t0 = now_ns();
+  paced.start();
+  paced.wait();
+  // 960 cycles of 20.8 us
+  TEST_ASSERT(now_ns() - t0 >= 19000000);
+  st = paced.stats();
+  TEST_ASSERT(st.cycles == 960 && st.timeframes == 960 && st.dropped == 960 - 256);
+  check_histogram(st.wake, 960);
+  std::vector<rt_engine_step> steps(256);
+  TEST_ASSERT(paced.outputs()->pop(steps.data(), steps.size()) == 256);
+  // Without the shaper, the set-points are passed through
+  for (const rt_engine_step &s: steps)
+    TEST_ASSERT(!std::memcmp(s.sp, s.filt_sp, sizeof(s.sp)));
+}
+
+void test_xy_shm()
+{
+  test_rng rng;
+  const images img = make_images(rng);
+  const std::string name = xy_shm_name(40000 + getpid() % 20000);
+  xy_shm producer(name, true);
+  xy_shm consumer(name, false);
+
+  // Frames fill the ring, with some packets missing
+  constexpr size_t c_TF = c_XY_SHM_SLOTS;
+  std::vector<int32_t> pos(c_TF * c_NUM_BPM_POS);
+  std::vector<uint64_t> valid(c_TF * c_NUM_BPM_POS / 64);
+  for (size_t tf = 0; tf < c_TF; tf++) {
+    xy_shm_frame f;
+    f.tf = tf;
+    for (unsigned w = 0; w < c_CC_NODES / 64; w++)
+      f.valid[w] = tf % 4 ? ~uint64_t(0) : rng.next();
+    for (unsigned n = 0; n < c_CC_NODES; n++) {
+      const int32_t x = int32_t(rng.range(-100000, 100000));
+      const int32_t y = int32_t(rng.range(-100000, 100000));
+      f.xy[n] = uint64_t(uint32_t(x)) << 32 | uint32_t(y);
+    }
+    TEST_ASSERT(producer.push(f));
+
+    int32_t *p = &pos[tf * c_NUM_BPM_POS];
+    uint64_t *v = &valid[tf * c_NUM_BPM_POS / 64];
+    xy_frame_to_bpm_pos(f, p, v);
+    TEST_ASSERT(p[3] == int32_t(f.xy[3] >> 32) && p[c_CC_NODES + 3] == int32_t(f.xy[3]));
+    TEST_ASSERT(v[1] == f.valid[1] && v[c_CC_NODES / 64 + 1] == f.valid[1]);
+  }
+  xy_shm_frame extra = {};
+  TEST_ASSERT(!producer.push(extra) && consumer.size() == c_TF);
+  const std::vector<int16_t> ref = reference(img, pos, &valid);
+
+  // The cycles after the last frame find the ring empty
+  rt_xy_shm_source src(consumer);
+  rt_engine_config cfg;
+  cfg.cycles = c_TF + 5;
+  cfg.output_ring = 128;
+  rt_engine eng(*img.proc, img.shaper.get(), src, cfg);
+  eng.start();
+  eng.wait();
+  const rt_engine_stats st = eng.stats();
+  TEST_ASSERT(st.cycles == c_TF + 5 && st.timeframes == c_TF && st.underruns == 5);
+  check_histogram(st.wake, c_TF + 5);
+  check_histogram(st.compute, c_TF);
+  // Underruns wait for the source until the deadline
+  TEST_ASSERT(st.latency.max_ns >= 20833);
+  check_steps(eng, ref, c_TF);
+
+  bool threw = false;
+  try {
+    xy_shm missing(xy_shm_name(39999), false);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+void test_errors()
+{
+  test_rng rng;
+  const images img = make_images(rng);
+  rt_replay_source src(std::vector<int32_t>(c_NUM_BPM_POS), true);
+
+  bool threw = false;
+  try {
+    rt_replay_source bad(std::vector<int32_t>(c_NUM_BPM_POS + 1));
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+
+  // Setup errors of the engine thread come back from wait()
+  rt_engine_config cfg;
+  cfg.cpu = 100000;
+  rt_engine eng(*img.proc, nullptr, src, cfg);
+  eng.start();
+  threw = false;
+  try {
+    eng.wait();
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw && eng.stats().cycles == 0);
+
+  // Stopped while running on its own
+  cfg.cpu = -1;
+  rt_engine free(*img.proc, nullptr, src, cfg);
+  free.start();
+  while (free.stats().cycles < 10)
+    usleep(1000);
+  free.stop();
+  TEST_ASSERT(!free.running());
+}
+
+void test_histogram()
+{
+  rt_histogram h = {};
+  TEST_ASSERT(h.quantile_ns(0.5) == 0);
+  h.bins[0] = 50;
+  h.bins[9] = 49;
+  h.bins[c_RT_HIST_BINS - 1] = 1;
+  h.count = 100;
+  h.max_ns = 1000000;
+  TEST_ASSERT(h.quantile_ns(0.5) == c_RT_HIST_BIN_NS);
+  TEST_ASSERT(h.quantile_ns(0.99) == 10 * c_RT_HIST_BIN_NS);
+  TEST_ASSERT(h.quantile_ns(1) == 1000000);
+}
+
+} // namespace
+
+int main()
+{
+  test_replay();
+  test_xy_shm();
+  test_errors();
+  test_histogram();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
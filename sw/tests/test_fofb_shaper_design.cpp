@@ -0,0 +1,166 @@
+// Shaper realization search tests: factoring a cascade, the exhaustive and
+// local searches on the xwb_fofb_shaper_filt_tb design (independent of the
+// number of threads) and a notch whose Direct Form II state overflows unless
+// the zeros come first
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "fofb_shaper_design.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+// xwb_fofb_shaper_filt_tb generics
+fofb_shaper_filt_generics tb_generics()
+{
+  fofb_shaper_filt_generics gen;
+  gen.num_biquads = 4;
+  gen.coeff_int_width = 2;
+  gen.coeff_frac_width = 16;
+  gen.ifcs_extra_bits = 5;
+  return gen;
+}
+
+std::vector<biquad_coeffs> tb_design()
+{
+  const auto dat = read_dat<double>("xwb_fofb_shaper_filt/fofb_shaper_filt_coeffs.dat");
+  std::vector<biquad_coeffs> bq(c_SHAPER_FILT_MAX_BIQUADS);
+  for (unsigned b = 0; b < c_SHAPER_FILT_MAX_BIQUADS; b++)
+    for (unsigned k = 0; k < 5; k++)
+      bq[b][k] = dat[b * 5 + k];
+  return bq;
+}
+
+std::complex<double> response(const std::vector<biquad_coeffs> &bq, double w)
+{
+  const std::complex<double> z1 = std::polar(1.0, -w), z2 = z1 * z1;
+  std::complex<double> h = 1;
+  for (const biquad_coeffs &c: bq)
+    h *= (c[0] + c[1] * z1 + c[2] * z2) / (1.0 + c[3] * z1 + c[4] * z2);
+  return h;
+}
+
+void test_factor()
+{
+  std::vector<biquad_coeffs> bq = tb_design();
+  bq.resize(4);
+  const shaper_design d = shaper_design_from_biquads(bq);
+  // Butterworth low-pass: double zeros at -1 (ill-conditioned, they may come
+  // out as close complex pairs), complex poles
+  size_t n_zeros = 0;
+  for (const std::complex<double> &z: d.zeros)
+    n_zeros += z.imag() ? 2 : 1;
+  TEST_ASSERT(n_zeros == 8 && d.poles.size() == 4);
+  double gain = 1;
+  for (const biquad_coeffs &c: bq)
+    gain *= c[0];
+  TEST_ASSERT(std::abs(d.gain / gain - 1) < 1e-12);
+  for (const std::complex<double> &z: d.zeros)
+    TEST_ASSERT(std::abs(z + 1.0) < 1e-3);
+  for (const std::complex<double> &p: d.poles)
+    TEST_ASSERT(p.imag() > 0 && std::abs(p) < 1);
+
+  // Identity biquads have no roots, delays are refused
+  const shaper_design id = shaper_design_from_biquads({{2, 0, 0, 0, 0}, {1, -0.5, 0, 0.25, 0}});
+  TEST_ASSERT(id.gain == 2 && id.zeros.size() == 1 && id.poles.size() == 1);
+  TEST_ASSERT(id.zeros[0] == 0.5 && id.poles[0] == -0.25);
+  bool threw = false;
+  try {
+    shaper_design_from_biquads({{0, 1, 0, 0, 0}});
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+void test_tb_design()
+{
+  const std::vector<biquad_coeffs> given = tb_design();
+  shaper_explore_config cfg;
+  cfg.threads = 1;
+  cfg.grid_points = 1024;
+  const shaper_explore_result r1 = shaper_explorer(tb_generics(), cfg).explore(given);
+  cfg.threads = 3;
+  const shaper_explore_result r3 = shaper_explorer(tb_generics(), cfg).explore(given);
+
+  TEST_ASSERT(r1.exhaustive && r1.evaluated == 576);
+  TEST_ASSERT(r1.given.pairing.empty() && r1.given.biquads.size() == 4);
+  TEST_ASSERT(r1.best.metrics.saturations == 0 && r1.best.biquads.size() == 4);
+  TEST_ASSERT(r1.best.metrics.sim_err_rms < r1.given.metrics.sim_err_rms);
+  TEST_ASSERT(r1.best.pairing == r3.best.pairing && r1.best.order == r3.best.order);
+  TEST_ASSERT(r1.best.metrics.sim_err_rms == r3.best.metrics.sim_err_rms);
+
+  // Same ideal filter
+  const std::vector<biquad_coeffs> ref(given.begin(), given.begin() + 4);
+  for (double w: {0.0, 0.3, 1.0, 2.5})
+    TEST_ASSERT(std::abs(response(r1.best.biquads, w) - response(ref, w)) < 1e-9);
+
+  // The biquads' inner levels are scaled, within the coefficients' range
+  for (const biquad_coeffs &c: r1.best.biquads)
+    for (double v: c)
+      TEST_ASSERT(std::abs(v) < 2);
+
+  // Local search within a budget
+  cfg.max_candidates = 50;
+  const shaper_explore_result rl = shaper_explorer(tb_generics(), cfg).explore(given);
+  TEST_ASSERT(!rl.exhaustive && rl.evaluated == 50);
+  TEST_ASSERT(rl.best.metrics.saturations == 0);
+  TEST_ASSERT(rl.best.metrics.sim_err_rms < rl.given.metrics.sim_err_rms);
+}
+
+void test_notch_overflow()
+{
+  // Notch at 0.05 fs, poles just inside the unit circle: the DF2 state of
+  // the pole pair resonates far above the interface range unless the notch
+  // zeros are in an earlier biquad
+  const double th = 2 * M_PI * 0.05, r = 0.999;
+  const std::vector<biquad_coeffs> given = {
+    {1, -0.3, 0, -2 * r * std::cos(th), r * r},
+    {1, -2 * std::cos(th), 1, -0.2, 0},
+  };
+  fofb_shaper_filt_generics gen;
+  gen.num_biquads = 3;
+  shaper_explore_config cfg;
+  cfg.grid_points = 1024;
+  const shaper_explore_result res = shaper_explorer(gen, cfg).explore(given);
+
+  TEST_ASSERT(res.exhaustive && res.evaluated == 4);
+  TEST_ASSERT(res.given.metrics.saturations > 0);
+  TEST_ASSERT(res.best.metrics.saturations == 0);
+  // The resonant pole pair is last, after the notch zeros
+  TEST_ASSERT(res.best.biquads.size() == 2);
+  TEST_ASSERT(std::abs(res.best.biquads[1][4] - r * r) < 1e-12);
+  TEST_ASSERT(std::abs(res.best.biquads[0][2] / res.best.biquads[0][0] - 1) < 1e-9);
+
+  // Unused biquads pass the set-points through
+  fofb_shaper_filt_model model(gen);
+  shaper_explorer::load_cascade(model, 0, res.best.biquads);
+  auto regs = std::make_unique<wb_fofb_shaper_filt_regs>();
+  model.store_regs(*regs);
+  TEST_ASSERT(regs->ch[0].coeffs[2 * c_SHAPER_FILT_COEFFS_PER_BIQUAD].val ==
+              model.coeff_to_reg(1));
+  TEST_ASSERT(regs->ch[0].coeffs[2 * c_SHAPER_FILT_COEFFS_PER_BIQUAD + 1].val == 0);
+}
+
+} // namespace
+
+int main()
+{
+  test_factor();
+  test_tb_design();
+  test_notch_overflow();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
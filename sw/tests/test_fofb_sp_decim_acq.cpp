@@ -0,0 +1,344 @@
+// sp_decim_acq tests, on a file-backed stand-in register bank whose
+// sp_decim.data registers are updated as the gateware would, with a phase and
+// rate of their own
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "fofb_sp_decim_acq.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+constexpr double c_TF_RATE = 48000;
+constexpr uint64_t c_START_NS = 1000000000;
+
+size_t data_addr(unsigned ch)
+{
+  return WB_FOFB_PROCESSING_REGS_CH + ch * WB_FOFB_PROCESSING_REGS_CH_SIZE +
+         WB_FOFB_PROCESSING_REGS_CH_SP_DECIM_DATA;
+}
+
+size_t ratio_addr(unsigned ch)
+{
+  return WB_FOFB_PROCESSING_REGS_CH + ch * WB_FOFB_PROCESSING_REGS_CH_SIZE +
+         WB_FOFB_PROCESSING_REGS_CH_SP_DECIM_RATIO;
+}
+
+// Simulated register bank: each channel's sp_decim.data holds the channel
+// number and the index of the last completed decimation period, counted on a
+// timeframe clock with its own phase and rate, or only the channel number for
+// channels whose set-points don't change
+struct sim_bank {
+  mmap_device &dev;
+  unsigned ratios[c_MAX_CHANNELS];
+  uint64_t start_ns;
+  // Timeframe rate relative to c_TF_RATE
+  double rate;
+  uint32_t constant_mask;
+
+  double period_ns(unsigned ch) const { return (ratios[ch] + 1) * 1e9 / (c_TF_RATE * rate); }
+
+  void update(uint64_t t_ns)
+  {
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      const bool constant = constant_mask >> ch & 1;
+      const uint32_t idx = constant ? 0 : uint32_t((t_ns - start_ns) / period_ns(ch));
+      dev.write32(data_addr(ch), ch << 24 | idx);
+    }
+  }
+};
+
+// Poll at least every microsecond, or when asked, until 'end' or 'done'
+// returns true
+template <typename F>
+uint64_t run(sim_bank &bank, sp_decim_acq &acq, sp_decim_writer *w, uint64_t t, uint64_t end,
+             F done)
+{
+  while (t < end && !done()) {
+    t = std::max(t + 1000, acq.next_poll_ns());
+    bank.update(t);
+    acq.poll(t);
+    if (w)
+      acq.drain(*w);
+  }
+  return t;
+}
+
+// Checks the sequence numbers of 'recs' against the period indexes in their
+// values, returns the periods skipped
+uint64_t check_records(const std::vector<sp_decim_record> &recs, const sim_bank &bank)
+{
+  bool started[c_MAX_CHANNELS] = {};
+  uint64_t next_seq[c_MAX_CHANNELS] = {};
+  uint32_t idx0[c_MAX_CHANNELS] = {};
+  uint64_t gaps = 0;
+  for (const auto &r: recs) {
+    TEST_ASSERT(r.ch < c_MAX_CHANNELS && uint32_t(r.val) >> 24 == r.ch);
+    TEST_ASSERT(r.ratio == bank.ratios[r.ch]);
+    TEST_ASSERT(bool(r.flags & SP_DECIM_REC_START) == !started[r.ch]);
+    if (r.flags & SP_DECIM_REC_START) {
+      TEST_ASSERT(r.seq == 0);
+      idx0[r.ch] = uint32_t(r.val) & 0xffffff;
+    } else if (r.flags & SP_DECIM_REC_GAP) {
+      TEST_ASSERT(r.seq > next_seq[r.ch]);
+      gaps += r.seq - next_seq[r.ch];
+    } else {
+      TEST_ASSERT(r.seq == next_seq[r.ch]);
+    }
+    started[r.ch] = true;
+    next_seq[r.ch] = r.seq + 1;
+
+    if (bank.constant_mask >> r.ch & 1) {
+      // Never seen updating
+      TEST_ASSERT(r.flags & SP_DECIM_REC_AMBIGUOUS);
+    } else {
+      // The period the value belongs to, one off at most when ambiguous
+      const int64_t off = int64_t((uint32_t(r.val) & 0xffffff) - idx0[r.ch]) - int64_t(r.seq);
+      TEST_ASSERT(off == 0 || ((r.flags & SP_DECIM_REC_AMBIGUOUS) && (off == 1 || off == -1)));
+    }
+  }
+  return gaps;
+}
+
+void test_schedule()
+{
+  tmp_file f, out;
+  mmap_device dev(f.path, sizeof(wb_fofb_processing_regs), 0, true);
+  dev.write32(WB_FOFB_PROCESSING_REGS_SP_DECIM_RATIO_MAX, 8191);
+
+  // Ratios above sp_decim_ratio_max keep only their lowest 13 bits. The
+  // timeframe clock started 1.234567 ms before the poller's, 300 ppm fast.
+  sim_bank bank{dev, {}, c_START_NS - 1234567, 1.0003, 1 << 11};
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    const uint32_t ratio = ch == 5 ? 8192 + 20 : ch == 7 ? 8191 + 8192 * 3 : ch * 7;
+    dev.write32(ratio_addr(ch), ratio);
+    bank.ratios[ch] = ratio & 8191;
+  }
+
+  sp_decim_acq_config cfg;
+  cfg.tf_rate_hz = c_TF_RATE;
+  sp_decim_acq acq(dev, 0, cfg);
+  sp_decim_writer w(out.path);
+  acq.configure(c_START_NS);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(acq.ratio(ch) == bank.ratios[ch]);
+
+  // Polling when asked for 500 ms: every update is found, and every period
+  // sampled once, right after its update
+  uint64_t t = run(bank, acq, &w, c_START_NS, c_START_NS + 500000000, [] { return false; });
+  w.flush();
+  sp_decim_acq_stats st = acq.stats();
+  TEST_ASSERT(st.missed == 0 && st.dropped == 0 && st.relocks == 0);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(acq.locked(ch) == (ch != 11));
+  // The period measured on the host clock
+  TEST_ASSERT(std::fabs(acq.tracked_period_ns(10) - bank.period_ns(10)) < 100);
+
+  auto recs = read_sp_decim_file(out.path);
+  TEST_ASSERT(recs.size() == st.samples);
+  TEST_ASSERT(check_records(recs, bank) == 0);
+  unsigned n_recs[c_MAX_CHANNELS] = {};
+  for (const auto &r: recs) {
+    n_recs[r.ch]++;
+    // Read within a poll of the update
+    TEST_ASSERT(r.ch == 11 || (!(r.flags & SP_DECIM_REC_AMBIGUOUS) && r.latency_ns <= 1000));
+  }
+  // Channel 0 (ratio 0) is sampled at the timeframe rate, the constant one
+  // once per period anyway
+  TEST_ASSERT(n_recs[0] >= 499 * 48);
+  TEST_ASSERT(st.ambiguous == n_recs[11] && n_recs[11] + 1 >= 500e6 / acq.period_ns(11));
+
+  // Then a late poll: skipped periods show as a gap, and the channels whose
+  // update was missed search for it again
+  t += uint64_t(3.5 * acq.period_ns(3));
+  bank.update(t);
+  acq.poll(t);
+  run(bank, acq, &w, t, t + 50000000, [] { return false; });
+  w.flush();
+  st = acq.stats();
+  TEST_ASSERT(st.missed > 0 && st.relocks > 0);
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    TEST_ASSERT(acq.locked(ch) == (ch != 11));
+  recs = read_sp_decim_file(out.path);
+  TEST_ASSERT(recs.size() == st.samples);
+  TEST_ASSERT(check_records(recs, bank) == st.missed);
+
+  // A second acquisition appends to the file, after a record torn by a crash
+  const size_t n_first = recs.size();
+  FILE *fp = std::fopen(out.path.c_str(), "ab");
+  TEST_ASSERT(fp && std::fwrite(&recs[0], 1, 5, fp) == 5);
+  std::fclose(fp);
+  {
+    sp_decim_writer w2(out.path);
+    acq.configure(t);
+    run(bank, acq, &w2, t, t + 10000000, [&] { return acq.stats().samples > st.samples; });
+  }
+  recs = read_sp_decim_file(out.path);
+  TEST_ASSERT(recs.size() > n_first);
+  TEST_ASSERT(recs[n_first].flags & SP_DECIM_REC_START);
+
+  // Files of other kinds are refused
+  bool thrown = false;
+  try {
+    sp_decim_writer w3(f.path);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+}
+
+void test_ring_full()
+{
+  tmp_file f;
+  mmap_device dev(f.path, sizeof(wb_fofb_processing_regs), 0, true);
+  dev.write32(WB_FOFB_PROCESSING_REGS_SP_DECIM_RATIO_MAX, 8191);
+
+  sp_decim_acq_config cfg;
+  cfg.ring_size = 8;
+  sp_decim_acq acq(dev, 0, cfg);
+  sim_bank bank{dev, {}, c_START_NS, 1, 0};
+  acq.configure(c_START_NS);
+  run(bank, acq, nullptr, c_START_NS, c_START_NS + 10000000, [&] {
+    const sp_decim_acq_stats st = acq.stats();
+    return st.samples + st.dropped >= 2 * c_MAX_CHANNELS;
+  });
+  const sp_decim_acq_stats st = acq.stats();
+  TEST_ASSERT(st.samples == 8);
+  TEST_ASSERT(st.dropped >= 2 * c_MAX_CHANNELS - 8);
+}
+
+// Updates 'bank' from the steady clock until destroyed, after a first update
+// done before any read. With 'rt_priority', the thread runs SCHED_FIFO at
+// that priority, when allowed ('rt' tells).
+struct bank_updater {
+  sim_bank &bank;
+  std::atomic<bool> running{true};
+  std::thread thread;
+  bool rt = false;
+
+  explicit bank_updater(sim_bank &b, int rt_priority = 0):
+    bank(b)
+  {
+    bank.update(now_ns());
+    thread = std::thread([this] {
+      while (running.load()) {
+        bank.update(now_ns());
+        std::this_thread::sleep_for(std::chrono::microseconds(20));
+      }
+    });
+    if (rt_priority > 0) {
+      sched_param param = {};
+      param.sched_priority = rt_priority;
+      rt = !pthread_setschedparam(thread.native_handle(), SCHED_FIFO, &param);
+    }
+  }
+
+  ~bank_updater()
+  {
+    running.store(false);
+    thread.join();
+  }
+};
+
+// With 'rt_priority', the polling thread runs SCHED_FIFO at that priority,
+// below the register bank updates standing in for the gateware, and no
+// period may be missed. Skipped when not allowed.
+void test_threads(int rt_priority)
+{
+  tmp_file f, out;
+  mmap_device dev(f.path, sizeof(wb_fofb_processing_regs), 0, true);
+  dev.write32(WB_FOFB_PROCESSING_REGS_SP_DECIM_RATIO_MAX, 8191);
+  // 100 Hz on every channel, on a timeframe clock 200 ppm slow
+  sim_bank bank{dev, {}, now_ns() - 3456789, 0.9998, 1 << 4};
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    dev.write32(ratio_addr(ch), 479);
+    bank.ratios[ch] = 479;
+  }
+
+  sp_decim_acq_config cfg;
+  cfg.rt_priority = rt_priority;
+  sp_decim_acq acq(dev, 0, cfg);
+  {
+    bank_updater upd(bank, rt_priority ? rt_priority + 1 : 0);
+    if (rt_priority && !upd.rt) {
+      std::printf("RT-scheduled polling test skipped: SCHED_FIFO not allowed\n");
+      return;
+    }
+    sp_decim_writer w(out.path);
+    acq.start(w);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    acq.stop();
+  }
+
+  const sp_decim_acq_stats st = acq.stats();
+  std::printf("%s polling: %llu samples, %llu missed\n",
+              rt_priority ? "RT-scheduled" : "threaded", (unsigned long long)st.samples,
+              (unsigned long long)st.missed);
+  // Without RT scheduling, a loaded (or single CPU) host can delay a poll by
+  // a whole period now and then: no bound on the periods missed, they only
+  // have to be accounted for
+  TEST_ASSERT(st.dropped == 0 && (!rt_priority || st.missed == 0));
+  TEST_ASSERT(st.samples + st.missed >= 28 * c_MAX_CHANNELS);
+  const auto recs = read_sp_decim_file(out.path);
+  TEST_ASSERT(recs.size() == st.samples);
+  TEST_ASSERT(check_records(recs, bank) == st.missed);
+}
+
+void test_write_error()
+{
+  tmp_file f, out;
+  mmap_device dev(f.path, sizeof(wb_fofb_processing_regs), 0, true);
+  dev.write32(WB_FOFB_PROCESSING_REGS_SP_DECIM_RATIO_MAX, 8191);
+  sim_bank bank{dev, {}, now_ns(), 1, 0};
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+    dev.write32(ratio_addr(ch), 47);
+    bank.ratios[ch] = 47;
+  }
+
+  sp_decim_acq acq(dev);
+  sp_decim_writer w(out.path);
+  bool thrown = false;
+  {
+    bank_updater upd(bank);
+    // Room for the header and a few samples
+    file_size_limit lim(sizeof(sp_decim_file_header) + 4 * sizeof(sp_decim_record));
+    acq.start(w);
+    while (acq.stats().samples < 5 * c_MAX_CHANNELS)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    try {
+      acq.stop();
+    } catch (const std::runtime_error &) {
+      thrown = true;
+    }
+  }
+  TEST_ASSERT(thrown && acq.write_failed());
+}
+
+} // namespace
+
+int main()
+{
+  test_schedule();
+  test_ring_full();
+  test_threads(0);
+  test_threads(10);
+  test_write_error();
+  std::puts("SUCCESS!");
+  return 0;
+}
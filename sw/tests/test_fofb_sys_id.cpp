@@ -0,0 +1,226 @@
+// PRBS model and system identification tests: LFSR period and balance,
+// prbs.ctl decoding, distortion averaging, FFT against a direct DFT, and
+// recovery of known responses from a synthetic capture
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "fofb_fft.h"
+#include "fofb_prbs.h"
+#include "fofb_sys_id.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+void test_prbs_gen()
+{
+  // Maximal length: back to the first state after 2**n - 1 steps only, with
+  // one more '0' than '1's over a period (XNOR feedback never reaches the
+  // all ones state)
+  for (unsigned n = c_PRBS_MIN_LFSR_LENGTH; n <= 20; n++) {
+    prbs_config cfg;
+    cfg.lfsr_length = n;
+    const size_t period = (size_t(1) << n) - 1;
+    const std::vector<uint8_t> seq = prbs_sequence(cfg, 2 * period + n);
+    size_t ones = 0;
+    for (size_t i = 0; i < period; i++)
+      ones += seq[i];
+    TEST_ASSERT(ones == period / 2);
+    for (size_t i = 0; i < period + n; i++)
+      TEST_ASSERT(seq[i] == seq[i + period]);
+    // A shorter period would repeat the first n bits (the LFSR state) early
+    for (size_t p = 1; p < period; p++) {
+      bool same = true;
+      for (unsigned i = 0; i < n && same; i++)
+        same = seq[p + i] == seq[i];
+      TEST_ASSERT(!same);
+    }
+  }
+
+  // Each value held for step_duration iterations
+  prbs_config cfg;
+  cfg.lfsr_length = 9;
+  const std::vector<uint8_t> ref = prbs_sequence(cfg, 100);
+  cfg.step_duration = 3;
+  const std::vector<uint8_t> seq = prbs_sequence(cfg, 300);
+  for (size_t i = 0; i < 300; i++)
+    TEST_ASSERT(seq[i] == ref[i / 3]);
+  TEST_ASSERT(cfg.period() == 511 * 3);
+
+  prbs_gen gen(5);
+  const bool first = gen.next();
+  gen.next();
+  gen.reset();
+  TEST_ASSERT(gen.next() == first);
+
+  bool thrown = false;
+  try {
+    prbs_gen bad(33);
+  } catch (const std::invalid_argument &) {
+    thrown = true;
+  }
+  TEST_ASSERT(thrown);
+}
+
+void test_prbs_regs()
+{
+  prbs_config cfg;
+  cfg.lfsr_length = 17;
+  cfg.step_duration = 1024;
+  cfg.sp_taps_sel = 3;
+  const prbs_config dec = prbs_config::from_ctl(cfg.to_ctl());
+  TEST_ASSERT(dec.lfsr_length == 17 && dec.step_duration == 1024 && dec.sp_taps_sel == 3);
+  const prbs_config rst = prbs_config::from_ctl(0);
+  TEST_ASSERT(rst.lfsr_length == 2 && rst.step_duration == 1 && rst.sp_taps_sel == 0);
+
+  prbs_levels lv;
+  lv.level_0 = -1200;
+  lv.level_1 = 32767;
+  const prbs_levels lv2 = prbs_levels::from_reg(lv.to_reg());
+  TEST_ASSERT(lv2.level_0 == -1200 && lv2.level_1 == 32767);
+}
+
+void test_prbs_sp_distortion()
+{
+  prbs_levels lv;
+  lv.level_0 = -301;
+  lv.level_1 = 517;
+  for (unsigned sel = 0; sel <= c_PRBS_SP_MAX_TAPS_SEL; sel++) {
+    prbs_config cfg;
+    cfg.lfsr_length = 11;
+    cfg.step_duration = 2;
+    cfg.sp_taps_sel = sel;
+    const size_t n = 5000;
+    const std::vector<uint8_t> seq = prbs_sequence(cfg, n);
+    const std::vector<int32_t> d = prbs_sp_distortion(cfg, lv, n);
+    for (size_t i = 0; i < n; i++) {
+      int32_t sum = 0;
+      for (size_t j = 0; j < (size_t(1) << sel); j++)
+        if (j <= i)
+          sum += seq[i - j] ? lv.level_1 : lv.level_0;
+      TEST_ASSERT(d[i] == sum >> sel);
+    }
+  }
+}
+
+void test_fft()
+{
+  test_rng rng;
+  for (size_t n: {2, 8, 64, 1024}) {
+    std::vector<cplx> x(n), ref(n);
+    for (cplx &v: x)
+      v = cplx(rng.range(-1000, 1000), rng.range(-1000, 1000));
+    for (size_t k = 0; k < n; k++)
+      for (size_t t = 0; t < n; t++)
+        ref[k] += x[t] * std::polar(1., -2 * M_PI * double(k * t % n) / double(n));
+
+    fft_plan plan(n);
+    std::vector<cplx> y = x;
+    plan.forward(y.data());
+    for (size_t k = 0; k < n; k++)
+      TEST_ASSERT(std::abs(y[k] - ref[k]) < 1e-9 * double(n) * 1000);
+
+    // Two real transforms packed in one
+    for (size_t k = 0; k < n; k++) {
+      cplx a, b;
+      fft_split_real(y.data(), n, k, a, b);
+      cplx ra, rb;
+      for (size_t t = 0; t < n; t++) {
+        const cplx w = std::polar(1., -2 * M_PI * double(k * t % n) / double(n));
+        ra += x[t].real() * w;
+        rb += x[t].imag() * w;
+      }
+      TEST_ASSERT(std::abs(a - ra) < 1e-6 && std::abs(b - rb) < 1e-6);
+    }
+
+    plan.inverse(y.data());
+    for (size_t t = 0; t < n; t++)
+      TEST_ASSERT(std::abs(y[t] / double(n) - x[t]) < 1e-9);
+  }
+  TEST_ASSERT(fft_size(1) == 1 && fft_size(1000) == 1024 && fft_size(1024) == 1024);
+}
+
+void test_sys_id()
+{
+  constexpr size_t c_T = 8192;
+  constexpr size_t c_LAGS = 32;
+  constexpr size_t c_SIGNALS = 7;
+  constexpr size_t c_PHASE = 777;
+
+  prbs_config cfg;
+  cfg.lfsr_length = 12;
+  cfg.sp_taps_sel = 1;
+  prbs_levels lv;
+  lv.level_0 = -1000;
+  lv.level_1 = 1000;
+  const size_t max_offset = 2000;
+  std::vector<double> dist;
+  for (int32_t d: prbs_sp_distortion(cfg, lv, c_T + max_offset))
+    dist.push_back(d);
+
+  // Signal s responds with a decaying impulse response of gain g[s], and
+  // column c_SIGNALS holds the distortion itself (the excited set-point),
+  // captured from c_PHASE iterations after the PRBS reset
+  test_rng rng;
+  std::vector<std::vector<double>> h(c_SIGNALS, std::vector<double>(c_LAGS));
+  std::vector<double> g(c_SIGNALS);
+  for (size_t s = 0; s < c_SIGNALS; s++) {
+    const double pole = 0.3 + 0.1 * double(s % 5);
+    const size_t delay = s % 4;
+    double sum = 0;
+    for (size_t k = delay; k < c_LAGS; k++)
+      sum += h[s][k] = std::pow(pole, double(k - delay));
+    g[s] = (double(s) - 3.5) * 2.5;
+    for (double &v: h[s])
+      v *= g[s] / sum;
+  }
+  const size_t stride = c_SIGNALS + 1;
+  std::vector<int32_t> data(c_T * stride);
+  for (size_t t = 0; t < c_T; t++) {
+    for (size_t s = 0; s < c_SIGNALS; s++) {
+      double y = 0;
+      for (size_t k = 0; k < c_LAGS; k++)
+        y += h[s][k] * dist[c_PHASE + t - k];
+      data[t * stride + s] = int32_t(std::lround(y + rng.range(-20, 20)));
+    }
+    data[t * stride + c_SIGNALS] = int32_t(dist[c_PHASE + t]) + 100;
+  }
+
+  const size_t off = sys_id_align(dist, &data[c_SIGNALS], stride, c_T, max_offset);
+  TEST_ASSERT(off == c_PHASE);
+
+  const std::vector<double> x(dist.begin() + off, dist.begin() + off + c_T);
+  sys_id_config scfg;
+  scfg.lags = c_LAGS;
+  scfg.threads = 1;
+  const sys_id_response r1 = sys_id_engine(x, scfg).estimate(data.data(), stride, c_SIGNALS);
+  scfg.threads = 4;
+  const sys_id_response r4 = sys_id_engine(x, scfg).estimate(data.data(), stride, c_SIGNALS);
+  TEST_ASSERT(r1.lags == c_LAGS && r1.h.size() == c_SIGNALS * c_LAGS);
+  TEST_ASSERT(r1.h == r4.h && r1.gain == r4.gain);
+  for (size_t s = 0; s < c_SIGNALS; s++) {
+    TEST_ASSERT(std::abs(r1.gain[s] - g[s]) < 0.02 * std::abs(g[s]));
+    for (size_t k = 0; k < c_LAGS; k++)
+      TEST_ASSERT(std::abs(r1.h[s * c_LAGS + k] - h[s][k]) < 0.05);
+  }
+}
+
+} // namespace
+
+int main()
+{
+  test_prbs_gen();
+  test_prbs_regs();
+  test_prbs_sp_distortion();
+  test_fft();
+  test_sys_id();
+  std::puts("SUCCESS!");
+  return 0;
+}
@@ -0,0 +1,179 @@
+// TOA statistics tests: sketch buckets, quantile accuracy against exact
+// order statistics, merging, the monitor windows and warnings, and the
+// statistics file round trip
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_toa_stats.h"
+#include "test_util.h"
+
+using namespace fofb;
+using namespace fofb_test;
+
+namespace {
+
+void test_buckets()
+{
+  // Contiguous, monotonic and covering every value
+  unsigned prev = 0;
+  for (uint32_t v = 0; v < (1u << c_TOA_VALUE_BITS); v++) {
+    const unsigned b = toa_sketch::bucket(v);
+    TEST_ASSERT(b < c_TOA_BUCKETS && (b == prev || b == prev + 1));
+    TEST_ASSERT(v <= toa_sketch::bucket_upper(b));
+    TEST_ASSERT(b == 0 || v > toa_sketch::bucket_upper(b - 1));
+    // Relative width within 1/32
+    TEST_ASSERT(toa_sketch::bucket_upper(b) - v <= v / 32);
+    prev = b;
+  }
+  TEST_ASSERT(prev == c_TOA_BUCKETS - 1);
+  TEST_ASSERT(toa_sketch::bucket(UINT32_MAX) == c_TOA_BUCKETS - 1);
+}
+
+void test_quantiles()
+{
+  test_rng rng;
+  toa_sketch a, b, all;
+  TEST_ASSERT(a.quantile(0.5) == 0 && a.count() == 0);
+  std::vector<uint32_t> vals;
+  for (unsigned i = 0; i < 200000; i++) {
+    // Bulk around 3000 cycles with a long tail
+    uint32_t v = 2500 + uint32_t(rng.next() % 1000);
+    if (rng.next() % 1000 == 0)
+      v += uint32_t(rng.next() % 20000);
+    vals.push_back(v);
+    (i % 3 ? a : b).add(v);
+    all.add(v);
+  }
+  a.add_missing();
+
+  std::vector<uint32_t> sorted = vals;
+  std::sort(sorted.begin(), sorted.end());
+  for (double q: {0.0, 0.5, 0.9, 0.99, 0.999, 0.9999, 1.0}) {
+    const size_t rank = std::max<size_t>(1, size_t(std::ceil(q * sorted.size())));
+    const uint32_t exact = sorted[rank - 1];
+    const uint32_t est = all.quantile(q);
+    TEST_ASSERT(est >= exact && est - exact <= exact / 32);
+  }
+  TEST_ASSERT(all.min() == sorted.front() && all.max() == sorted.back());
+  TEST_ASSERT(all.quantile(1) == sorted.back());
+
+  // Merging is exact
+  a.merge(b);
+  TEST_ASSERT(a.count() == all.count() && a.missing() == 1);
+  TEST_ASSERT(!std::memcmp(a.data().buckets, all.data().buckets, sizeof(all.data().buckets)));
+  TEST_ASSERT(a.min() == all.min() && a.max() == all.max());
+}
+
+void test_monitor()
+{
+  toa_monitor_config cfg;
+  cfg.nodes = 8;
+  cfg.deadline = 10000;
+  cfg.window = 1000;
+  cfg.min_count = 100;
+  toa_monitor mon(cfg);
+  test_rng rng;
+
+  // Node 3's tail reaches 85% of the deadline in the second window, node 5
+  // gets past it in the third; node 7 never receives anything
+  std::vector<uint32_t> toa(cfg.nodes);
+  for (unsigned w = 0; w < 3; w++) {
+    for (unsigned t = 0; t < cfg.window; t++) {
+      for (unsigned node = 0; node < cfg.nodes; node++)
+        toa[node] = 0xabcd0000 | uint32_t(2000 + rng.next() % 2000);
+      if (w == 1 && t % 100 == 0)
+        toa[3] = 8500;
+      if (w == 2 && t % 50 == 0)
+        toa[5] = 12000;
+      toa[7] = 0;
+      const size_t raised = mon.add(toa.data());
+      TEST_ASSERT(raised == (t + 1 == cfg.window && w > 0 ? 1 : 0));
+    }
+  }
+  TEST_ASSERT(mon.snapshots() == 3000 && mon.windows() == 3);
+  std::vector<toa_warning> warns = mon.take_warnings();
+  TEST_ASSERT(warns.size() == 2 && mon.take_warnings().empty());
+  TEST_ASSERT(warns[0].window == 1 && warns[0].node == 3 &&
+              warns[0].level == TOA_NEAR_DEADLINE && warns[0].max == 8500);
+  TEST_ASSERT(warns[1].window == 2 && warns[1].node == 5 &&
+              warns[1].level == TOA_PAST_DEADLINE && warns[1].value >= 12000);
+
+  // Totals hold every window, the masked arrival times
+  const std::vector<toa_sketch> &tot = mon.totals();
+  TEST_ASSERT(tot[0].count() == 3000 && tot[0].max() < 4000 && tot[0].min() >= 2000);
+  TEST_ASSERT(tot[7].count() == 0 && tot[7].missing() == 3000);
+  TEST_ASSERT(tot[3].max() == 8500 && tot[5].max() == 12000);
+
+  // A partial window is closed on request
+  mon.add(toa.data());
+  TEST_ASSERT(mon.window()[0].count() == 1 && mon.end_window() == 0);
+  TEST_ASSERT(mon.windows() == 4 && mon.window()[0].count() == 0);
+
+  // Another board
+  toa_monitor other(cfg);
+  other.add(toa.data());
+  other.end_window();
+  mon.merge(other);
+  TEST_ASSERT(mon.totals()[0].count() == 3002 && mon.snapshots() == 3002);
+
+  bool threw = false;
+  try {
+    cfg.deadline = 0;
+    toa_monitor bad(cfg);
+  } catch (const std::invalid_argument &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+void test_file()
+{
+  tmp_file f;
+  test_rng rng;
+  std::vector<toa_sketch> sk(4);
+  for (toa_sketch &s: sk)
+    for (unsigned i = 0; i < 1000; i++)
+      s.add(uint32_t(rng.next() % 50000));
+  sk[2].add_missing();
+  write_toa_stats_file(f.path, sk, 9000, 1234);
+
+  toa_stats_file_header hdr;
+  const std::vector<toa_sketch> back = read_toa_stats_file(f.path, &hdr);
+  TEST_ASSERT(hdr.nodes == 4 && hdr.deadline == 9000 && hdr.snapshots == 1234);
+  TEST_ASSERT(back.size() == 4);
+  for (size_t i = 0; i < sk.size(); i++)
+    TEST_ASSERT(!std::memcmp(&back[i].data(), &sk[i].data(), sizeof(toa_sketch_data)));
+
+  // Truncated
+  TEST_ASSERT(truncate(f.path.c_str(), sizeof(hdr) + 3 * sizeof(toa_sketch_data)) == 0);
+  bool threw = false;
+  try {
+    read_toa_stats_file(f.path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  TEST_ASSERT(threw);
+}
+
+} // namespace
+
+int main()
+{
+  test_buckets();
+  test_quantiles();
+  test_monitor();
+  test_file();
+
+  std::printf("SUCCESS!\n");
+  return 0;
+}
@@ -0,0 +1,104 @@
+// Minimal helpers shared by the host software tests
+//
+// Tests are run from the sw directory by 'make check', so the testbench data
+// files are reachable through c_TB_DIR.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#ifndef FOFB_TEST_UTIL_H_
+#define FOFB_TEST_UTIL_H_
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define TEST_ASSERT(cond)                                                    \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      std::fprintf(stderr, "%s:%d: assertion failed: %s\n", __FILE__,        \
+                   __LINE__, #cond);                                         \
+      std::exit(1);                                                          \
+    }                                                                        \
+  } while (0)
+
+namespace fofb_test {
+
+constexpr const char *c_TB_DIR = "../hdl/testbench/";
+
+// Read every whitespace separated number of a testbench .dat file
+template <typename T>
+std::vector<T> read_dat(const std::string &fname)
+{
+  std::ifstream fin(c_TB_DIR + fname);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+  std::vector<T> vals;
+  T val;
+  while (fin >> val)
+    vals.push_back(val);
+  return vals;
+}
+
+// Small deterministic PRNG (xorshift64*), so test vectors are reproducible
+struct test_rng {
+  uint64_t state = 0x9e3779b97f4a7c15ull;
+
+  uint64_t next()
+  {
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545f4914f6cdd1dull;
+  }
+
+  // Uniform integer in [lo, hi]
+  int64_t range(int64_t lo, int64_t hi)
+  {
+    return lo + int64_t(next() % uint64_t(hi - lo + 1));
+  }
+};
+
+// Temporary file, e.g. backing a stand-in device, removed on destruction
+struct tmp_file {
+  std::string path;
+
+  tmp_file()
+  {
+    char tmpl[] = "/tmp/fofb_testXXXXXX";
+    const int fd = mkstemp(tmpl);
+    TEST_ASSERT(fd >= 0);
+    close(fd);
+    path = tmpl;
+  }
+
+  ~tmp_file() { unlink(path.c_str()); }
+};
+
+// Limit the size of the files written by the process, so that writes past
+// 'bytes' fail with EFBIG like on a full disk, until destruction
+struct file_size_limit {
+  rlimit old;
+
+  explicit file_size_limit(rlim_t bytes)
+  {
+    std::signal(SIGXFSZ, SIG_IGN);
+    TEST_ASSERT(getrlimit(RLIMIT_FSIZE, &old) == 0);
+    rlimit lim = old;
+    lim.rlim_cur = bytes;
+    TEST_ASSERT(setrlimit(RLIMIT_FSIZE, &lim) == 0);
+  }
+
+  ~file_size_limit() { setrlimit(RLIMIT_FSIZE, &old); }
+};
+
+} // namespace fofb_test
+
+#endif // FOFB_TEST_UTIL_H_
@@ -0,0 +1,347 @@
+// Pack FOFB histories into compressed archives and query them
+//
+// usage: fofb_archive pack [-r chunk_rows] -P capture.bin|-S sp_decim.bin|-E err.bin <out>
+//        fofb_archive info <archive>
+//        fofb_archive query [-t tf_min:tf_max] [-c cols] [-s] <archive>
+//
+// 'pack' converts a recording into an archive (see fofb_archive.h):
+//  -P: a capture of FOFB packets (see fofb_packet_decoder.h), one row per
+//      timeframe, keyed by the unwrapped tf_cntr_32, with columns pos_000 to
+//      pos_511: bpm_id n's X is pos_n and its Y pos_(256 + n), as seen by
+//      fofb_processing. Positions not received in a timeframe keep their
+//      previous value; packets older than the current timeframe are dropped.
+//  -S: a fofb_sp_decim_acq file, one row per decimation period, keyed by
+//      seq * ratio (timeframes since the acquisition start), with columns
+//      sp_decim_00 to sp_decim_11.
+//  -E: a fofb_err_telemetry file, one row per polling interval, keyed by
+//      seq, with the accumulated counters of each board/halcs named
+//      b<board>_h<halcs>_<counter> after the columns of
+//      scripts/err_telemetry_to_csv.py.
+// Values not received yet are 0. Sources holding several acquisitions must
+// be split first, keys can't go backwards.
+//
+// 'info' prints the archive's columns, rows and timeframe range. 'query'
+// prints the rows with tf_min <= tf <= tf_max (all of them by default) of
+// the columns 'cols' (comma separated names, all of them by default) as CSV
+// with a header line, as read by scripts/plot_csv.py; '-s' reports the time
+// spent and the peak memory on stderr.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "fofb_archive.h"
+#include "fofb_cc_status.h"
+#include "fofb_err_telemetry.h"
+#include "fofb_packet_decoder.h"
+#include "fofb_regs.h"
+#include "fofb_sp_decim_acq.h"
+
+using namespace fofb;
+
+namespace {
+
+// Packets decoded at once
+constexpr size_t c_CHUNK = 1 << 16;
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s pack [-r chunk_rows] -P capture.bin|-S sp_decim.bin|-E err.bin <out>\n"
+               "       %s info <archive>\n"
+               "       %s query [-t tf_min:tf_max] [-c cols] [-s] <archive>\n",
+               prog, prog, prog);
+}
+
+std::string numbered(const char *prefix, unsigned n, int digits)
+{
+  char buf[c_ARCHIVE_NAME_LEN];
+  std::snprintf(buf, sizeof(buf), "%s%0*u", prefix, digits, n);
+  return buf;
+}
+
+uint64_t pack_packets(const char *fname, const std::string &out, unsigned chunk_rows,
+                      std::unique_ptr<archive_writer> &w)
+{
+  std::vector<std::string> names;
+  for (unsigned i = 0; i < c_NUM_BPM_POS; i++)
+    names.push_back(numbered("pos_", i, 3));
+  w.reset(new archive_writer(out, names, chunk_rows));
+
+  capture_file cap(fname);
+  const size_t n_pkts = cap.num_packets();
+  packet_columns cols;
+  tf_unwrapper unwrap;
+  std::vector<int32_t> row(c_NUM_BPM_POS);
+  uint64_t cur = 0, dropped = 0;
+  bool have_row = false;
+  for (size_t p = 0; p < n_pkts; p += c_CHUNK) {
+    const size_t n = std::min(c_CHUNK, n_pkts - p);
+    decode_packets(cap.words() + p * c_PACKET_WORDS, n, p, nullptr, cols);
+    for (size_t k = 0; k < cols.count; k++) {
+      const uint64_t tf = unwrap(cols.tf_cntr_32[k]);
+      if (cols.bpm_id[k] >= c_CC_NODES || (have_row && tf < cur)) {
+        dropped++;
+        continue;
+      }
+      if (have_row && tf != cur)
+        w->append(cur, row.data());
+      cur = tf;
+      have_row = true;
+      row[cols.bpm_id[k]] = cols.bpm_x[k];
+      row[c_CC_NODES + cols.bpm_id[k]] = cols.bpm_y[k];
+    }
+  }
+  if (have_row)
+    w->append(cur, row.data());
+  return dropped;
+}
+
+uint64_t pack_sp_decim(const char *fname, const std::string &out, unsigned chunk_rows,
+                       std::unique_ptr<archive_writer> &w)
+{
+  std::vector<std::string> names;
+  for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+    names.push_back(numbered("sp_decim_", ch, 2));
+  w.reset(new archive_writer(out, names, chunk_rows));
+
+  const std::vector<sp_decim_record> recs = read_sp_decim_file(fname);
+  std::vector<int32_t> row(c_MAX_CHANNELS);
+  uint64_t cur = 0, dropped = 0;
+  bool have_row = false;
+  for (const sp_decim_record &r: recs) {
+    if (r.ch >= c_MAX_CHANNELS) {
+      dropped++;
+      continue;
+    }
+    const uint64_t key = uint64_t(r.seq) * r.ratio;
+    if (have_row && key != cur)
+      w->append(cur, row.data());
+    cur = key;
+    have_row = true;
+    row[r.ch] = r.val;
+  }
+  if (have_row)
+    w->append(cur, row.data());
+  return dropped;
+}
+
+uint64_t pack_err_telemetry(const char *fname, const std::string &out, unsigned chunk_rows,
+                            std::unique_ptr<archive_writer> &w)
+{
+  static const char *const counters[3] = {"hard_err_cnt_", "soft_err_cnt_", "frame_err_cnt_"};
+  const std::vector<err_telemetry_record> recs = read_err_telemetry_file(fname);
+
+  // One group of counters per board/halcs, in order
+  std::map<std::pair<unsigned, unsigned>, unsigned> targets;
+  for (const err_telemetry_record &r: recs)
+    targets.emplace(std::make_pair(r.board, r.halcs), 0);
+  std::vector<std::string> names;
+  for (auto &t: targets) {
+    t.second = unsigned(names.size());
+    const std::string prefix =
+      "b" + std::to_string(t.first.first) + "_h" + std::to_string(t.first.second) + "_";
+    for (unsigned c = 0; c < c_CC_ERR_COUNTERS; c++)
+      names.push_back(prefix + counters[c / c_CC_LINKS] + std::to_string(c % c_CC_LINKS + 1));
+  }
+  if (names.empty())
+    throw std::runtime_error(std::string(fname) + ": no records");
+  w.reset(new archive_writer(out, names, chunk_rows));
+
+  std::vector<int32_t> row(names.size());
+  std::vector<bool> started(targets.size());
+  uint64_t cur = 0, dropped = 0;
+  bool have_row = false;
+  for (const err_telemetry_record &r: recs) {
+    const unsigned first = targets[std::make_pair(r.board, r.halcs)];
+    const unsigned t = first / c_CC_ERR_COUNTERS;
+    // Increments before the first complete read can't be accumulated
+    if ((r.flags & ERR_REC_FAIL) || (!(r.flags & ERR_REC_START) && !started[t])) {
+      dropped++;
+      continue;
+    }
+    if (have_row && r.seq != cur)
+      w->append(cur, row.data());
+    cur = r.seq;
+    have_row = true;
+    for (unsigned c = 0; c < c_CC_ERR_COUNTERS; c++)
+      row[first + c] = int32_t(r.flags & ERR_REC_START ? r.cnt[c]
+                                                       : uint32_t(row[first + c]) + r.cnt[c]);
+    started[t] = true;
+  }
+  if (have_row)
+    w->append(cur, row.data());
+  return dropped;
+}
+
+int pack(int argc, char **argv)
+{
+  unsigned chunk_rows = 4096;
+  char kind = 0;
+  const char *input = nullptr;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:P:S:E:")) != -1) {
+    switch (opt) {
+      case 'r': chunk_rows = unsigned(std::strtoul(optarg, nullptr, 0)); break;
+      case 'P': case 'S': case 'E':
+        kind = char(opt);
+        input = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (!input || argc - optind != 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const std::string out = argv[optind];
+  std::unique_ptr<archive_writer> w;
+  uint64_t dropped;
+  if (kind == 'P')
+    dropped = pack_packets(input, out, chunk_rows, w);
+  else if (kind == 'S')
+    dropped = pack_sp_decim(input, out, chunk_rows, w);
+  else
+    dropped = pack_err_telemetry(input, out, chunk_rows, w);
+  w->close();
+  std::fprintf(stderr, "%llu rows, %llu bytes, %llu records dropped\n",
+               (unsigned long long)w->rows(), (unsigned long long)w->size(),
+               (unsigned long long)dropped);
+  return 0;
+}
+
+int info(int argc, char **argv)
+{
+  if (argc != 3) {
+    usage(argv[0]);
+    return 1;
+  }
+  archive_reader r(argv[2]);
+  const double raw = double(r.rows()) * (r.columns().size() * sizeof(int32_t) + sizeof(uint64_t));
+  std::printf("%zu columns, %llu rows in %zu chunks, %zu bytes (%.1f%% of the raw values)\n",
+              r.columns().size(), (unsigned long long)r.rows(), r.chunks(), r.file_size(),
+              raw ? 100 * r.file_size() / raw : 0);
+  if (r.rows())
+    std::printf("timeframes %llu to %llu\n", (unsigned long long)r.tf_first(),
+                (unsigned long long)r.tf_last());
+  for (const std::string &name: r.columns())
+    std::printf("%s\n", name.c_str());
+  return 0;
+}
+
+int query(int argc, char **argv)
+{
+  uint64_t tf_min = 0, tf_max = UINT64_MAX;
+  const char *col_list = nullptr;
+  bool report = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:c:s")) != -1) {
+    switch (opt) {
+      case 't': {
+        char *end;
+        tf_min = std::strtoull(optarg, &end, 0);
+        if (*end != ':')
+          throw std::invalid_argument("invalid timeframe range");
+        tf_max = std::strtoull(end + 1, nullptr, 0);
+        break;
+      }
+      case 'c': col_list = optarg; break;
+      case 's': report = true; break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 1) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  archive_reader r(argv[optind]);
+  std::vector<unsigned> cols;
+  if (col_list) {
+    std::istringstream ss(col_list);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+      const int c = r.column(name);
+      if (c < 0)
+        throw std::invalid_argument("no column " + name + " in " + argv[optind]);
+      cols.push_back(unsigned(c));
+    }
+  } else {
+    for (unsigned c = 0; c < r.columns().size(); c++)
+      cols.push_back(c);
+  }
+
+  std::printf("tf");
+  for (unsigned c: cols)
+    std::printf(",%s", r.columns()[c].c_str());
+  std::printf("\n");
+  uint64_t rows = 0;
+  r.scan(tf_min, tf_max, cols, [&](size_t n, const uint64_t *tf, const int32_t *const *vals) {
+    for (size_t i = 0; i < n; i++) {
+      std::printf("%llu", (unsigned long long)tf[i]);
+      for (size_t k = 0; k < cols.size(); k++)
+        std::printf(",%d", vals[k][i]);
+      std::printf("\n");
+    }
+    rows += n;
+  });
+  std::fflush(stdout);
+
+  if (report) {
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    std::fprintf(stderr, "%llu rows, %.3f s, max RSS %ld kB\n", (unsigned long long)rows,
+                 elapsed.count(), ru.ru_maxrss);
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+  const std::string cmd = argv[1];
+  // The options follow the command
+  optind = 2;
+
+  try {
+    if (cmd == "pack")
+      return pack(argc, argv);
+    if (cmd == "info")
+      return info(argc, argv);
+    if (cmd == "query")
+      return query(argc, argv);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  usage(argv[0]);
+  return 1;
+}
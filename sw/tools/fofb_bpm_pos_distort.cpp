@@ -0,0 +1,160 @@
+// Replay recorded BPM positions through the sys-id distortion and flatenizers
+//
+// usage: fofb_bpm_pos_distort [-s skip] [-c chunk] [-d distort.bin]
+//          [-f flat.bin] [-p prbs.bin] <regs.bin> <bpm_pos.bin>
+//
+// regs.bin is a raw wb_fofb_sys_id_regs image (as read from the device),
+// bpm_pos.bin holds c_NUM_BPM_POS little-endian int32 positions per timeframe
+// (as for fofb_processing_replay), all of them received. The capture is
+// taken to start on the sys-id trigger applying the image's prbs.ctl, 'skip'
+// PRBS iterations after it (0 by default). It is read and processed 'chunk'
+// timeframes at a time (4096 by default), so memory use doesn't depend on
+// its length, and optionally writes, per timeframe:
+//   - distort.bin: the c_NUM_BPM_POS distorted positions fofb_processing
+//     sees, int32;
+//   - flat.bin: the x, y, distorted x and distorted y flatenizers'
+//     bpm_pos_flatenizer.max_num_cte positions each, int32;
+//   - prbs.bin: the PRBS value, one byte.
+// Reports the achieved timeframe rate.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_bpm_pos_distort.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-s skip] [-c chunk] [-d distort.bin] [-f flat.bin]\n"
+               "       [-p prbs.bin] <regs.bin> <bpm_pos.bin>\n", prog);
+}
+
+std::unique_ptr<std::ofstream> open_out(const std::string &fname)
+{
+  if (fname.empty())
+    return nullptr;
+  auto f = std::make_unique<std::ofstream>(fname, std::ios::binary);
+  if (!*f)
+    throw std::runtime_error("can't open " + fname);
+  return f;
+}
+
+template <typename T>
+void write_out(std::ofstream *f, const std::vector<T> &v, size_t n)
+{
+  if (f && !f->write(reinterpret_cast<const char *>(v.data()), n * sizeof(T)))
+    throw std::runtime_error("write error");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint64_t skip = 0;
+  size_t chunk = 4096;
+  std::string distort_fname, flat_fname, prbs_fname;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:d:f:p:")) != -1) {
+    switch (opt) {
+      case 's': skip = std::strtoull(optarg, nullptr, 0); break;
+      case 'c': chunk = std::strtoul(optarg, nullptr, 0); break;
+      case 'd': distort_fname = optarg; break;
+      case 'f': flat_fname = optarg; break;
+      case 'p': prbs_fname = optarg; break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 2 || chunk == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    auto regs = std::make_unique<wb_fofb_sys_id_regs>();
+    std::ifstream fregs(argv[optind], std::ios::binary);
+    if (!fregs)
+      throw std::runtime_error(std::string("can't open ") + argv[optind]);
+    if (!fregs.read(reinterpret_cast<char *>(regs.get()), sizeof(*regs)) ||
+        fregs.peek() != std::char_traits<char>::eof())
+      throw std::runtime_error("register image size mismatch");
+
+    const unsigned max_num = regs->bpm_pos_flatenizer.max_num_cte ?
+                             regs->bpm_pos_flatenizer.max_num_cte : c_BPM_POS_FLAT_MAX_NUM;
+    bpm_pos_distort_model model(max_num);
+    model.load_regs(*regs);
+    model.trigger();
+    model.skip(skip);
+
+    std::ifstream fpos(argv[optind + 1], std::ios::binary);
+    if (!fpos)
+      throw std::runtime_error(std::string("can't open ") + argv[optind + 1]);
+    const auto fdistort = open_out(distort_fname);
+    const auto fflat = open_out(flat_fname);
+    const auto fprbs = open_out(prbs_fname);
+
+    std::vector<int32_t> pos(chunk * c_NUM_BPM_POS);
+    std::vector<int32_t> distort(fdistort ? pos.size() : 0);
+    std::vector<int32_t> flat(fflat ? chunk * BPM_POS_FLATS * max_num : 0);
+    std::vector<uint8_t> prbs(fprbs ? chunk : 0);
+    bpm_pos_distort_out out;
+    out.distort = fdistort ? distort.data() : nullptr;
+    out.flat = fflat ? flat.data() : nullptr;
+    out.prbs = fprbs ? prbs.data() : nullptr;
+
+    const size_t tf_size = c_NUM_BPM_POS * sizeof(int32_t);
+    size_t n_tf = 0;
+    double busy = 0;
+    for (;;) {
+      fpos.read(reinterpret_cast<char *>(pos.data()), chunk * tf_size);
+      const size_t got = fpos.gcount();
+      if (got % tf_size)
+        throw std::runtime_error("BPM positions file size isn't a multiple of a timeframe");
+      const size_t n = got / tf_size;
+      if (n == 0)
+        break;
+
+      const auto start = std::chrono::steady_clock::now();
+      model.process(pos.data(), nullptr, n, out);
+      busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      write_out(fdistort.get(), distort, n * c_NUM_BPM_POS);
+      write_out(fflat.get(), flat, n * BPM_POS_FLATS * max_num);
+      write_out(fprbs.get(), prbs, n);
+      n_tf += n;
+    }
+    if (n_tf == 0)
+      throw std::runtime_error("no timeframes");
+
+    for (std::ofstream *f: {fdistort.get(), fflat.get(), fprbs.get()})
+      if (f && !f->flush())
+        throw std::runtime_error("write error");
+
+    std::printf("%zu timeframes, distortion %s, flatenizers base BPM %u (%u positions)\n",
+                n_tf, model.distort_en() ? "enabled" : "disabled", model.base_bpm_id(),
+                max_num);
+    std::printf("processed in %.3f ms: %.0f timeframes/s\n", busy * 1e3, n_tf / busy);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
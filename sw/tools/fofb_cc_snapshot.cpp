@@ -0,0 +1,124 @@
+// Take snapshots of the FOFB CC TOA, RCB and X/Y buffers
+//
+// usage: fofb_cc_snapshot [-o offset] [-n count] [-x xy_depth] [-6] [-w] [-p]
+//          <device>
+//
+// <device> is the file mapping the register space (e.g. a PCIe BAR resource
+// file) and 'offset' the fofb_cc_regs block offset in it. 'count' snapshots
+// are taken back to back (1 by default) and their mean and maximum duration
+// reported. '-x' limits the X/Y entries read, '-6' reads each X/Y pair with a
+// 64 bits access and '-w' uses the word by word handshake instead (see
+// fofb_cc_snapshot.h). '-p' prints the last snapshot, one line per index:
+// index, TOA, RCB, X/Y msb and X/Y lsb, in hexadecimal.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+#include <unistd.h>
+
+#include "fofb_cc_snapshot.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-o offset] [-n count] [-x xy_depth] [-6] [-w] [-p]\n"
+               "       <device>\n", prog);
+}
+
+void print_snapshot(const cc_snapshot &snap)
+{
+  std::printf("# time_frame_count %u to %u\n", snap.tf_start, snap.tf_end);
+  const size_t n = std::max({snap.toa.size(), snap.rcb.size(), snap.xy.size()});
+  for (size_t i = 0; i < n; i++) {
+    std::printf("%4zu", i);
+    if (i < snap.toa.size())
+      std::printf(" %08x", snap.toa[i]);
+    else
+      std::printf(" %8s", "-");
+    if (i < snap.rcb.size())
+      std::printf(" %08x", snap.rcb[i]);
+    else
+      std::printf(" %8s", "-");
+    if (i < snap.xy.size())
+      std::printf(" %08x %08x", uint32_t(snap.xy[i] >> 32), uint32_t(snap.xy[i]));
+    std::printf("\n");
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  off_t offset = 0;
+  unsigned count = 1;
+  bool word_by_word = false;
+  bool print = false;
+  cc_snapshot_config cfg;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:n:x:6wp")) != -1) {
+    switch (opt) {
+      case 'o':
+        offset = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'n':
+        count = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'x':
+        cfg.xy_depth = std::strtoul(optarg, nullptr, 0);
+        break;
+      case '6':
+        cfg.xy_read64 = true;
+        break;
+      case 'w':
+        word_by_word = true;
+        break;
+      case 'p':
+        print = true;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 1 || count == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    mmap_device dev(argv[optind], sizeof(::fofb_cc_regs), offset);
+    fofb_cc_snapshotter<> snapper(dev, 0, cfg);
+    cc_snapshot snap;
+    double sum = 0, max = 0;
+    uint32_t max_span = 0;
+    for (unsigned i = 0; i < count; i++) {
+      if (word_by_word)
+        snapper.take_word_by_word(snap);
+      else
+        snapper.take(snap);
+      sum += snap.duration_s;
+      max = std::max(max, snap.duration_s);
+      max_span = std::max(max_span, snap.tf_end - snap.tf_start);
+    }
+
+    if (print)
+      print_snapshot(snap);
+    std::printf("%u snapshots, %u reads and %u writes each, duration mean %.1f us "
+                "max %.1f us (%.0f/s), up to %u timeframes spanned\n",
+                count, snap.reads, snap.writes, sum / count * 1e6, max * 1e6,
+                count / sum, max_span);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,125 @@
+// Load a coefficients/set-points image into fofb_processing
+//
+// usage: fofb_coeff_load [-o offset] [-v none|sparse|written|full]
+//          [-s shadow.bin] <device> <image.bin>
+//
+// <device> is the file mapping the register space (e.g. a PCIe BAR resource
+// file) and 'offset' the wb_fofb_processing_regs block offset in it.
+// image.bin is a raw wb_fofb_processing_regs image; only its coeff_ram_bank
+// and sps_ram_bank contents are used. With -s, the shadow copy is kept in
+// shadow.bin between runs, so only changed words are written without reading
+// the RAMs back first; it's created on the first run.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+#include "fofb_coeff_loader.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-o offset] [-v none|sparse|written|full] [-s shadow.bin]\n"
+               "       <device> <image.bin>\n", prog);
+}
+
+bool read_image(const std::string &fname, wb_fofb_processing_regs &img)
+{
+  std::ifstream fin(fname, std::ios::binary);
+  if (!fin)
+    return false;
+  fin.read(reinterpret_cast<char *>(&img), sizeof(img));
+  if (fin.gcount() != sizeof(img))
+    throw std::runtime_error(fname + ": register image size mismatch");
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  off_t offset = 0;
+  verify_mode verify = verify_mode::sparse;
+  const char *shadow_fname = nullptr;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:v:s:")) != -1) {
+    switch (opt) {
+      case 'o':
+        offset = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'v':
+        if (!std::strcmp(optarg, "none"))
+          verify = verify_mode::none;
+        else if (!std::strcmp(optarg, "sparse"))
+          verify = verify_mode::sparse;
+        else if (!std::strcmp(optarg, "written"))
+          verify = verify_mode::written;
+        else if (!std::strcmp(optarg, "full"))
+          verify = verify_mode::full;
+        else {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 's':
+        shadow_fname = optarg;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    auto img = std::make_unique<wb_fofb_processing_regs>();
+    if (!read_image(argv[optind + 1], *img))
+      throw std::runtime_error(std::string("can't open ") + argv[optind + 1]);
+
+    mmap_device dev(argv[optind], sizeof(wb_fofb_processing_regs), offset);
+    fofb_coeff_loader loader(dev);
+
+    auto shadow = std::make_unique<wb_fofb_processing_regs>();
+    if (shadow_fname && read_image(shadow_fname, *shadow))
+      loader.set_shadow(*shadow);
+
+    const auto start = std::chrono::steady_clock::now();
+    const coeff_load_stats st = loader.load(*img, verify);
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    std::printf("%zu words changed, %zu words written in %zu bursts, %zu words "
+                "read back, %.3f ms\n", st.words_changed, st.words_written,
+                st.bursts, st.words_read, elapsed.count() * 1e3);
+
+    if (shadow_fname) {
+      loader.store_shadow(*shadow);
+      std::ofstream fout(shadow_fname, std::ios::binary);
+      if (!fout)
+        throw std::runtime_error(std::string("can't open ") + shadow_fname);
+      fout.write(reinterpret_cast<const char *>(shadow.get()), sizeof(*shadow));
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
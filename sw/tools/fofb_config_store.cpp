@@ -0,0 +1,120 @@
+// Store a configuration image under a new version, or list the versions
+//
+// usage: fofb_config_store [-b base_version] [-p proc.bin] [-s shaper.bin]
+//          [-i sys_id.bin] [-c cc.bin] <store_dir> <version>
+//        fofb_config_store -l <store_dir>
+//
+// The image is made of the given raw register images (wb_fofb_processing_regs,
+// e.g. written by fofb_corr_matrix, wb_fofb_shaper_filt_regs,
+// wb_fofb_sys_id_regs and fofb_cc_regs), on top of those of 'base_version'
+// with -b. Only the configuration blocks listed in fofb_fleet.h count. The
+// image hash is printed; storing the same contents again only adds a version
+// name. With -l, the versions are listed, oldest first.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_fleet.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-b base_version] [-p proc.bin] [-s shaper.bin]\n"
+               "       [-i sys_id.bin] [-c cc.bin] <store_dir> <version>\n"
+               "       %s -l <store_dir>\n", prog, prog);
+}
+
+void read_part(cfg_image &img, cfg_part part, const std::string &fname)
+{
+  std::ifstream fin(fname, std::ios::binary);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+  std::vector<char> buf(cfg_part_size(part));
+  fin.read(buf.data(), buf.size());
+  if (size_t(fin.gcount()) != buf.size() || fin.peek() != std::ifstream::traits_type::eof())
+    throw std::runtime_error(fname + ": register image size mismatch");
+  img.set_part(part, buf.data(), buf.size());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  const char *part_fname[CFG_NUM_PARTS] = {};
+  const char *base = nullptr;
+  bool list = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:p:s:i:c:l")) != -1) {
+    switch (opt) {
+      case 'b':
+        base = optarg;
+        break;
+      case 'p':
+        part_fname[CFG_PROC] = optarg;
+        break;
+      case 's':
+        part_fname[CFG_SHAPER] = optarg;
+        break;
+      case 'i':
+        part_fname[CFG_SYS_ID] = optarg;
+        break;
+      case 'c':
+        part_fname[CFG_CC] = optarg;
+        break;
+      case 'l':
+        list = true;
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != (list ? 1 : 2)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    cfg_store store(argv[optind]);
+    if (list) {
+      for (const cfg_version &v: store.versions()) {
+        const std::time_t t = std::time_t(v.time);
+        char date[32];
+        std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&t));
+        std::printf("%s %s %s\n", cfg_hash_str(v.hash).c_str(), date, v.name.c_str());
+      }
+      return 0;
+    }
+
+    cfg_image img = base ? store.get(base) : cfg_image();
+    bool any = base != nullptr;
+    for (unsigned p = 0; p < CFG_NUM_PARTS; p++) {
+      if (part_fname[p]) {
+        read_part(img, cfg_part(p), part_fname[p]);
+        any = true;
+      }
+    }
+    if (!any)
+      throw std::invalid_argument("no register image given");
+
+    std::printf("%s\n", cfg_hash_str(store.put(img, argv[optind + 1])).c_str());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,202 @@
+// Compute the correction matrix and its fofb_processing coefficient images
+//
+// usage: fofb_corr_matrix [-n num_sv] [-r rcond] [-t tikhonov] [-j threads]
+//          [-g loop_gain] [-p regs.bin] [-F coeff_frac,gain_frac]
+//          [-x bpm_pos] [-X corrector] <orm.txt> <out_prefix>
+//
+// orm.txt holds the response matrix, one line per BPM position (in the
+// fofb_processing index order, 0 to 255 horizontal and 256 to 511 vertical)
+// and one column per corrector, lines starting with '#' are ignored (the
+// fofb_sys_id output format). The regularized pseudo-inverse (see
+// fofb_corr_matrix.h) is scaled by 'loop_gain' (1 by default) and quantized
+// into out_prefix_<n>.bin, one wb_fofb_processing_regs image per board, board
+// n taking correctors 12n to 12n + 11 on channels 0 to 11: coeff_ram_bank and
+// acc.gain are set, the rest comes from regs.bin (a register image read from
+// the board, whose fixed_point_pos also gives the integer widths) or is zero.
+// The fractionary widths are generics the gateware doesn't expose, '-F'
+// overrides their defaults. Each '-x' or '-X' excludes a BPM position or a
+// corrector with a rank one update, timed separately. fofb_coeff_load loads
+// the coefficients RAMs of the images.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_corr_matrix.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-n num_sv] [-r rcond] [-t tikhonov] [-j threads]\n"
+               "       [-g loop_gain] [-p regs.bin] [-F coeff_frac,gain_frac]\n"
+               "       [-x bpm_pos] [-X corrector] <orm.txt> <out_prefix>\n", prog);
+}
+
+std::vector<double> read_orm(const std::string &fname, size_t &bpms, size_t &correctors)
+{
+  std::ifstream fin(fname);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+  std::vector<double> orm;
+  bpms = correctors = 0;
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream ss(line);
+    size_t cols = 0;
+    double v;
+    while (ss >> v) {
+      orm.push_back(v);
+      cols++;
+    }
+    if (!ss.eof() || (bpms && cols != correctors))
+      throw std::runtime_error(fname + ": malformed line " + std::to_string(bpms + 1));
+    correctors = cols;
+    bpms++;
+  }
+  if (bpms == 0 || bpms > c_NUM_BPM_POS)
+    throw std::runtime_error(fname + ": unsupported number of BPM positions");
+  return orm;
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  corr_matrix_config cfg;
+  double loop_gain = 1;
+  const char *regs_fname = nullptr;
+  const char *frac = nullptr;
+  std::vector<size_t> bpms_out, corrs_out;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:r:t:j:g:p:F:x:X:")) != -1) {
+    switch (opt) {
+      case 'n':
+        cfg.num_sv = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'r':
+        cfg.rcond = std::strtod(optarg, nullptr);
+        break;
+      case 't':
+        cfg.tikhonov = std::strtod(optarg, nullptr);
+        break;
+      case 'j':
+        cfg.threads = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'g':
+        loop_gain = std::strtod(optarg, nullptr);
+        break;
+      case 'p':
+        regs_fname = optarg;
+        break;
+      case 'F':
+        frac = optarg;
+        break;
+      case 'x':
+        bpms_out.push_back(std::strtoul(optarg, nullptr, 0));
+        break;
+      case 'X':
+        corrs_out.push_back(std::strtoul(optarg, nullptr, 0));
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    auto base = std::make_unique<wb_fofb_processing_regs>();
+    std::memset(base.get(), 0, sizeof(*base));
+    fofb_processing_generics gen;
+    if (regs_fname) {
+      std::ifstream fin(regs_fname, std::ios::binary);
+      if (!fin)
+        throw std::runtime_error(std::string("can't open ") + regs_fname);
+      fin.read(reinterpret_cast<char *>(base.get()), sizeof(*base));
+      if (fin.gcount() != sizeof(*base))
+        throw std::runtime_error(std::string(regs_fname) + ": register image size mismatch");
+      gen.from_regs(*base);
+    }
+    if (frac) {
+      char *end;
+      gen.coeff_frac_width = std::strtoul(frac, &end, 0);
+      if (*end != ',')
+        throw std::invalid_argument("invalid fractionary widths");
+      gen.gain_frac_width = std::strtoul(end + 1, nullptr, 0);
+    }
+
+    size_t bpms, correctors;
+    const std::vector<double> orm = read_orm(argv[optind], bpms, correctors);
+
+    auto start = std::chrono::steady_clock::now();
+    corr_matrix cm(orm, bpms, correctors, cfg);
+    std::printf("%zu BPM positions, %zu correctors: SVD in %.1f ms, s %.6g to %.6g\n",
+                bpms, correctors, elapsed_ms(start), cm.factors().s.front(),
+                cm.factors().s.back());
+    for (size_t b: bpms_out) {
+      start = std::chrono::steady_clock::now();
+      cm.exclude_bpm(b);
+      std::printf("BPM position %zu excluded in %.1f ms\n", b, elapsed_ms(start));
+    }
+    for (size_t c: corrs_out) {
+      start = std::chrono::steady_clock::now();
+      cm.exclude_corrector(c);
+      std::printf("corrector %zu excluded in %.1f ms\n", c, elapsed_ms(start));
+    }
+
+    start = std::chrono::steady_clock::now();
+    const std::vector<double> inv = cm.inverse();
+    std::printf("pseudo-inverse with %zu singular values in %.1f ms\n", cm.num_sv_used(),
+                elapsed_ms(start));
+
+    const std::vector<double> gains(correctors, loop_gain);
+    auto img = std::make_unique<wb_fofb_processing_regs>();
+    for (size_t board = 0; board * c_MAX_CHANNELS < correctors; board++) {
+      std::memcpy(img.get(), base.get(), sizeof(*img));
+      const corr_quant_stats st = quantize_corr_matrix(inv, bpms, board * c_MAX_CHANNELS,
+                                                       c_MAX_CHANNELS, gains, gen, *img);
+      const std::string fname = std::string(argv[optind + 1]) + "_" + std::to_string(board) +
+                                ".bin";
+      std::ofstream fout(fname, std::ios::binary);
+      if (!fout)
+        throw std::runtime_error("can't open " + fname);
+      fout.write(reinterpret_cast<const char *>(img.get()), sizeof(*img));
+      if (!fout)
+        throw std::runtime_error(fname + ": write error");
+      std::printf("%s: max quantization error %.3g (%.3g of the largest value), "
+                  "%zu coefficients saturated\n", fname.c_str(), st.max_err,
+                  st.max_val > 0 ? st.max_err / st.max_val : 0., st.saturated);
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,153 @@
+// Log the FOFB CC error counters of the whole crate
+//
+// usage: fofb_err_telemetry [-r rate] [-j threads] [-k keepalive] [-t seconds]
+//          -d board,halcs,device[,offset] [-d ...] <out.bin>
+//
+// Replaces scripts/get_fofb_errors.sh: instead of one fofb_ctrl process per
+// counter, HALCS instance and board every second, a single process polls the
+// hard, soft and frame error counters of every '-d' target at 'rate' Hz (1 by
+// default) from 'threads' threads (4 by default). 'device' is the file
+// mapping the board register space (e.g. its PCIe BAR resource file) and
+// 'offset' the fofb_cc_regs block offset in it. Records are appended to
+// out.bin (see fofb_err_telemetry.h for the format) until 'seconds' elapse
+// or SIGINT/SIGTERM; a record is written at least every 'keepalive' seconds
+// (10 by default) for each target. scripts/err_telemetry_to_csv.py converts
+// out.bin to CSV files.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_err_telemetry.h"
+#include "fofb_regs.h"
+
+using namespace fofb;
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_signal(int)
+{
+  stop_requested = 1;
+}
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-r rate] [-j threads] [-k keepalive] [-t seconds]\n"
+               "       -d board,halcs,device[,offset] [-d ...] <out.bin>\n", prog);
+}
+
+struct target_spec {
+  unsigned board;
+  unsigned halcs;
+  std::string path;
+  off_t offset;
+};
+
+// "board,halcs,device[,offset]", the device path may hold ':' (PCI addresses)
+target_spec parse_target(const std::string &s)
+{
+  target_spec t;
+  char *end;
+  t.board = std::strtoul(s.c_str(), &end, 0);
+  if (*end != ',')
+    throw std::invalid_argument("invalid target: " + s);
+  t.halcs = std::strtoul(end + 1, &end, 0);
+  if (*end != ',')
+    throw std::invalid_argument("invalid target: " + s);
+  const std::string rest(end + 1);
+  const size_t comma = rest.rfind(',');
+  t.path = rest.substr(0, comma);
+  t.offset = comma == std::string::npos ? 0 : std::strtoull(rest.c_str() + comma + 1, nullptr, 0);
+  if (t.path.empty())
+    throw std::invalid_argument("invalid target: " + s);
+  return t;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  double duration = 0;
+  err_telemetry_config cfg;
+  std::vector<target_spec> specs;
+  int opt;
+  try {
+    while ((opt = getopt(argc, argv, "r:j:k:t:d:")) != -1) {
+      switch (opt) {
+        case 'r':
+          cfg.rate_hz = std::strtod(optarg, nullptr);
+          break;
+        case 'j':
+          cfg.threads = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'k':
+          cfg.keepalive_s = std::strtod(optarg, nullptr);
+          break;
+        case 't':
+          duration = std::strtod(optarg, nullptr);
+          break;
+        case 'd':
+          specs.push_back(parse_target(optarg));
+          break;
+        default:
+          usage(argv[0]);
+          return 1;
+      }
+    }
+    if (argc - optind != 1 || specs.empty()) {
+      usage(argv[0]);
+      return 1;
+    }
+
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    std::vector<std::unique_ptr<mmap_device>> devs;
+    std::vector<std::unique_ptr<cc_err_counter_source>> srcs;
+    std::vector<err_telemetry_target> targets;
+    for (const target_spec &s: specs) {
+      devs.emplace_back(new mmap_device(s.path, sizeof(::fofb_cc_regs), s.offset));
+      srcs.emplace_back(new cc_err_counter_source(*devs.back()));
+      targets.push_back({s.board, s.halcs, srcs.back().get()});
+    }
+
+    err_telemetry_writer w(argv[optind]);
+    err_telemetry tel(targets, cfg);
+    const auto start = std::chrono::steady_clock::now();
+    tel.start(w);
+    while (!stop_requested && !tel.write_failed()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+      if (duration > 0 && elapsed.count() >= duration)
+        break;
+    }
+    tel.stop();
+
+    const err_telemetry_stats st = tel.stats();
+    std::printf("%llu polls, %llu failed, %llu records, %llu intervals missed, "
+                "%llu records dropped\n",
+                (unsigned long long)st.polls, (unsigned long long)st.failures,
+                (unsigned long long)st.records, (unsigned long long)st.missed,
+                (unsigned long long)st.dropped);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
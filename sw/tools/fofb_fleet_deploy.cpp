@@ -0,0 +1,142 @@
+// Deploy a configuration version to many boards at once, or check them
+//
+// usage: fofb_fleet_deploy [-j threads] [-m manifest|verify|force]
+//          [-c manifest|sampled|full] [-n samples]
+//          <store_dir> <version> <fleet.txt> <state_dir>
+//
+// fleet.txt lists the boards, one per line: 'name device proc shaper sys_id
+// cc', 'device' being the file mapping the board register space (e.g. its
+// PCIe BAR resource file) and the others the offsets of each register block
+// in it ('-' when absent). Every board is handled by its own worker thread
+// (at most 'threads' of them), and the per-block hashes last deployed to each
+// board are kept in state_dir/<name>.manifest.
+//
+// Deploying (the default) writes the blocks of 'version' whose hash differs
+// from the board manifest (-m manifest, the default), from the board
+// contents (-m verify, repairs drift) or every block (-m force); each
+// written block is read back and checked. With -c the boards are only
+// checked against 'version': their manifests (no bus access), 'samples'
+// words of each block (-c sampled, 4 by default, other words on each run)
+// or each whole block in one burst (-c full). One line is printed per
+// board; the exit status is 2 when a board drifted or failed.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_fleet.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-j threads] [-m manifest|verify|force]\n"
+               "       [-c manifest|sampled|full] [-n samples]\n"
+               "       <store_dir> <version> <fleet.txt> <state_dir>\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  fleet_config cfg;
+  deploy_mode dmode = deploy_mode::manifest;
+  check_mode cmode = check_mode::full;
+  bool check = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:m:c:n:")) != -1) {
+    switch (opt) {
+      case 'j':
+        cfg.threads = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'm':
+        if (!std::strcmp(optarg, "manifest"))
+          dmode = deploy_mode::manifest;
+        else if (!std::strcmp(optarg, "verify"))
+          dmode = deploy_mode::verify;
+        else if (!std::strcmp(optarg, "force"))
+          dmode = deploy_mode::force;
+        else {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'c':
+        check = true;
+        if (!std::strcmp(optarg, "manifest"))
+          cmode = check_mode::manifest;
+        else if (!std::strcmp(optarg, "sampled"))
+          cmode = check_mode::sampled;
+        else if (!std::strcmp(optarg, "full"))
+          cmode = check_mode::full;
+        else {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      case 'n':
+        cfg.samples = std::strtoul(optarg, nullptr, 0);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 4 || cfg.samples == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  bool bad = false;
+  try {
+    const cfg_store store(argv[optind]);
+    const cfg_image img = store.get(argv[optind + 1]);
+    const std::vector<fleet_board> boards = read_fleet_file(argv[optind + 2]);
+    fleet_deployer dep(boards, argv[optind + 3], cfg);
+
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<fleet_board_result> res = check ? dep.check(img, cmode) :
+                                                dep.deploy(img, dmode);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double slowest = 0;
+    for (const fleet_board_result &r: res) {
+      slowest = std::max(slowest, r.seconds);
+      if (!r.ok) {
+        bad = true;
+        std::printf("%s: FAILED: %s\n", r.board.c_str(), r.error.c_str());
+      } else if (check) {
+        bad |= !r.drifted.empty();
+        std::printf("%s: %s (%zu words read, %.3f ms)", r.board.c_str(),
+                    r.drifted.empty() ? "ok" : "DRIFT", r.words_read, r.seconds * 1e3);
+        for (const std::string &b: r.drifted)
+          std::printf(" %s", b.c_str());
+        std::printf("\n");
+      } else {
+        std::printf("%s: %zu blocks written (%zu words), %zu unchanged, %.3f ms\n",
+                    r.board.c_str(), r.blocks_written, r.words_written, r.blocks_skipped,
+                    r.seconds * 1e3);
+      }
+    }
+    std::fprintf(stderr, "%s %s on %zu boards in %.3f ms (slowest board %.3f ms)\n",
+                 check ? "checked" : "deployed", cfg_hash_str(img.hash()).c_str(),
+                 res.size(), elapsed.count() * 1e3, slowest * 1e3);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return bad ? 2 : 0;
+}
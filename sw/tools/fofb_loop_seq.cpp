@@ -0,0 +1,168 @@
+// Close or open the loop on every channel at once
+//
+// usage: fofb_loop_seq [-g gain[,gain...]] [-m channels] [-r ramp_tfs] [-k]
+//          [-e] [-f tf_rate] [-c cpu] [-P priority] [-l read_ns,write_ns]
+//          close|open <device> [proc_offset [cc_offset]]
+//
+// 'close' releases the accumulators of the 'channels' mask (0xfff by
+// default) with the given real gains (one for all channels or one per
+// channel, converted with the fixed_point_pos.accs_gains of the device), the
+// accumulators being cleared first unless -k; 'open' freezes them. With -r,
+// the gains are ramped up from zero (close) or down to zero (open) over
+// 'ramp_tfs' timeframes of 'tf_rate' Hz (48000 by default). With -e and a CC
+// block, cfg_val.CC_ENABLE is set before closing or cleared after opening.
+// 'device' is the file mapping the board register space, with the
+// wb_fofb_processing_regs block at 'proc_offset' (0 by default) and the
+// fofb_cc_regs block at 'cc_offset' (none by default); 'mock' runs against a
+// mock board instead, whose reads and writes cost 'read_ns' and 'write_ns'
+// (1000 and 100 by default, see fofb_reg_bench.h). The sequence runs on
+// 'cpu' (any by default) with SCHED_FIFO 'priority' if given.
+//
+// Reports, per batch, the channel writes skew and start delay, and whether
+// all channels switched within one timeframe (exit status 2 if not).
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_loop_seq.h"
+#include "fofb_reg_bench.h"
+#include "wb_fofb_processing_regs_access.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-g gain[,gain...]] [-m channels] [-r ramp_tfs] [-k] [-e]\n"
+               "       [-f tf_rate] [-c cpu] [-P priority] [-l read_ns,write_ns]\n"
+               "       close|open <device> [proc_offset [cc_offset]]\n", prog);
+}
+
+std::vector<double> parse_list(const char *s)
+{
+  std::vector<double> v;
+  for (;;) {
+    char *end;
+    v.push_back(std::strtod(s, &end));
+    if (end == s || (*end && *end != ','))
+      throw std::invalid_argument(std::string("invalid list: ") + s);
+    if (!*end)
+      return v;
+    s = end + 1;
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  loop_seq_config cfg;
+  std::vector<double> real_gains;
+  unsigned ramp_tfs = 0;
+  bool clear = true, cc_switch = false;
+  uint32_t read_ns = 1000, write_ns = 100;
+  int opt;
+  try {
+    while ((opt = getopt(argc, argv, "g:m:r:kef:c:P:l:")) != -1) {
+      switch (opt) {
+        case 'g': real_gains = parse_list(optarg); break;
+        case 'm': cfg.channels = std::strtoul(optarg, nullptr, 0); break;
+        case 'r': ramp_tfs = std::strtoul(optarg, nullptr, 0); break;
+        case 'k': clear = false; break;
+        case 'e': cc_switch = true; break;
+        case 'f': cfg.tf_rate_hz = std::strtod(optarg, nullptr); break;
+        case 'c': cfg.cpu = std::atoi(optarg); break;
+        case 'P': cfg.rt_priority = std::atoi(optarg); break;
+        case 'l': {
+          const std::vector<double> l = parse_list(optarg);
+          if (l.size() != 2)
+            throw std::invalid_argument("-l takes read_ns,write_ns");
+          read_ns = uint32_t(l[0]);
+          write_ns = uint32_t(l[1]);
+          break;
+        }
+        default:
+          usage(argv[0]);
+          return 1;
+      }
+    }
+    const int nargs = argc - optind;
+    if (nargs < 2 || nargs > 4) {
+      usage(argv[0]);
+      return 1;
+    }
+    const std::string action = argv[optind];
+    const std::string device = argv[optind + 1];
+    if (action != "close" && action != "open") {
+      usage(argv[0]);
+      return 1;
+    }
+    if (action == "close" && real_gains.size() != 1 && real_gains.size() != c_MAX_CHANNELS)
+      throw std::invalid_argument("close needs one gain, or one per channel");
+
+    std::unique_ptr<mock_board> board;
+    std::unique_ptr<mmap_device> proc, cc;
+    mmap_device *proc_dev, *cc_dev = nullptr;
+    if (device == "mock") {
+      board.reset(new mock_board());
+      board->set_latency(read_ns, write_ns);
+      proc_dev = &board->proc();
+      cc_dev = &board->cc();
+    } else {
+      const off_t proc_off = nargs > 2 ? std::strtoull(argv[optind + 2], nullptr, 0) : 0;
+      proc.reset(new mmap_device(device, sizeof(wb_fofb_processing_regs), proc_off));
+      if (nargs > 3)
+        cc.reset(new mmap_device(device, sizeof(::fofb_cc_regs),
+                                 std::strtoull(argv[optind + 3], nullptr, 0)));
+      proc_dev = proc.get();
+      cc_dev = cc.get();
+    }
+
+    loop_sequencer seq(*proc_dev, 0, cc_dev, 0, cfg);
+    loop_seq_plan plan;
+    if (action == "close") {
+      using proc_regs = regs::wb_fofb_processing_regs;
+      regs::reg_block<proc_regs> blk(*proc_dev);
+      const unsigned frac_bits = blk.read<proc_regs::fixed_point_pos::accs_gains>();
+      std::vector<uint32_t> gains(c_MAX_CHANNELS);
+      for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+        gains[ch] = acc_gain_from_real(real_gains[real_gains.size() == 1 ? 0 : ch], frac_bits);
+      plan = seq.plan_close(gains, clear, ramp_tfs, cc_switch);
+    } else {
+      plan = seq.plan_open(ramp_tfs, cc_switch);
+    }
+
+    const loop_seq_report rep = seq.run(plan);
+    std::printf("batch,tf,writes,skew_us,late_us,flush_us\n");
+    for (size_t i = 0; i < rep.batches.size(); i++) {
+      const loop_seq_batch_timing &t = rep.batches[i];
+      const loop_seq_batch &b = plan.batches[i];
+      std::printf("%zu,%llu,%zu,%.3f,%.3f,%.3f\n", i, (unsigned long long)t.tf,
+                  b.pre.size() + b.writes.size() + b.post.size(),
+                  (t.last_ns - t.first_ns) / 1e3, (t.start_ns - t.due_ns) / 1e3,
+                  (t.flushed_ns - t.last_ns) / 1e3);
+    }
+    std::printf("max skew %.3f us, max start delay %.3f us: %s one timeframe (%.3f us)\n",
+                rep.max_skew_ns / 1e3, rep.max_late_ns / 1e3,
+                rep.within_tf() ? "within" : "NOT within", rep.tf_ns / 1e3);
+    if (!rep.within_tf())
+      return 2;
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
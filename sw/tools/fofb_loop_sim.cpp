@@ -0,0 +1,292 @@
+// Sweep closed-loop FOFB simulations over gains and interlock thresholds
+//
+// usage: fofb_loop_sim [-j threads] [-t timeframes] [-d delay_tf] [-p corr_pole]
+//          [-f shaper_coeffs.dat] [-q sp_limit] [-n noise_rms]
+//          [-s sine_amp,sine_freq_hz] [-k step_amp,step_tf] [-l pkt_loss]
+//          [-u outage_bpm_positions,outage_tf] [-e intlk_ctl] [-c]
+//          [-G gain_scales] [-L orb_distort_limits] [-P min_num_pkts] [-R seeds]
+//          <orm.txt> <image_prefix>
+//
+// orm.txt is the plant response matrix in the fofb_corr_matrix input format
+// (one line per BPM position, one column per corrector, in BPM position
+// units per set-point unit) and image_prefix_<n>.bin the
+// wb_fofb_processing_regs image of board n (e.g. written by
+// fofb_corr_matrix), board n driving correctors 12n to 12n + 11. Images
+// whose sp_limits are both zero, and every image with '-q', get
+// -sp_limit..sp_limit (32767 by default). '-f' filters the set-points of
+// every board through shaper biquads with the fofb_shaper_filt_coeffs.dat
+// format coefficients.
+//
+// One scenario (see fofb_loop_sim.h) is run for every combination of the
+// '-G', '-L' and '-P' values and of seeds 1 to 'seeds' (1 by default), each
+// list being either 'value' or 'first,last,count'. '-e' sets loop_intlk.ctl
+// (both sources enabled by default) and '-c' keeps simulating after an
+// interlock. One CSV line is printed per scenario, and the simulation rate
+// to stderr.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_loop_sim.h"
+
+using namespace fofb;
+
+namespace {
+
+constexpr double c_FOFB_RATE = 48e3;
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-j threads] [-t timeframes] [-d delay_tf] [-p corr_pole]\n"
+               "       [-f shaper_coeffs.dat] [-q sp_limit] [-n noise_rms]\n"
+               "       [-s sine_amp,sine_freq_hz] [-k step_amp,step_tf] [-l pkt_loss]\n"
+               "       [-u outage_bpm_positions,outage_tf] [-e intlk_ctl] [-c]\n"
+               "       [-G gain_scales] [-L orb_distort_limits] [-P min_num_pkts] [-R seeds]\n"
+               "       <orm.txt> <image_prefix>\n", prog);
+}
+
+// "value" or "first,last,count"
+std::vector<double> parse_list(const char *s)
+{
+  char *end;
+  const double first = std::strtod(s, &end);
+  if (*end == '\0')
+    return {first};
+  if (*end != ',')
+    throw std::invalid_argument(std::string("invalid list: ") + s);
+  const double last = std::strtod(end + 1, &end);
+  if (*end != ',')
+    throw std::invalid_argument(std::string("invalid list: ") + s);
+  const unsigned long count = std::strtoul(end + 1, nullptr, 0);
+  if (count == 0)
+    throw std::invalid_argument(std::string("invalid list: ") + s);
+  std::vector<double> vals;
+  for (unsigned long i = 0; i < count; i++)
+    vals.push_back(count == 1 ? first : first + (last - first) * double(i) / double(count - 1));
+  return vals;
+}
+
+// "a,b"
+void parse_pair(const char *s, double &a, double &b)
+{
+  char *end;
+  a = std::strtod(s, &end);
+  if (*end != ',')
+    throw std::invalid_argument(std::string("invalid pair: ") + s);
+  b = std::strtod(end + 1, nullptr);
+}
+
+std::vector<double> read_orm(const std::string &fname, size_t &bpms, size_t &correctors)
+{
+  std::ifstream fin(fname);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+  std::vector<double> orm;
+  bpms = correctors = 0;
+  std::string line;
+  while (std::getline(fin, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    std::istringstream ss(line);
+    size_t cols = 0;
+    double v;
+    while (ss >> v) {
+      orm.push_back(v);
+      cols++;
+    }
+    if (!ss.eof() || (bpms && cols != correctors))
+      throw std::runtime_error(fname + ": malformed line " + std::to_string(bpms + 1));
+    correctors = cols;
+    bpms++;
+  }
+  if (bpms == 0 || bpms > c_NUM_BPM_POS)
+    throw std::runtime_error(fname + ": unsupported number of BPM positions");
+  return orm;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned threads = 0;
+  loop_sim_scenario base;
+  base.intlk_ctl = WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_ORB_DISTORT |
+                   WB_FOFB_PROCESSING_REGS_LOOP_INTLK_CTL_SRC_EN_PACKET_LOSS;
+  loop_sim_machine m;
+  const char *shaper_fname = nullptr;
+  long sp_limit = -1;
+  std::vector<double> gains = {1}, limits = {0}, pkts = {0};
+  unsigned seeds = 1;
+  int opt;
+  try {
+    while ((opt = getopt(argc, argv, "j:t:d:p:f:q:n:s:k:l:u:e:cG:L:P:R:")) != -1) {
+      double a, b;
+      switch (opt) {
+        case 'j':
+          threads = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 't':
+          base.timeframes = std::strtoull(optarg, nullptr, 0);
+          break;
+        case 'd':
+          m.delay_tf = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'p':
+          m.corr_pole = std::strtod(optarg, nullptr);
+          break;
+        case 'f':
+          shaper_fname = optarg;
+          break;
+        case 'q':
+          sp_limit = std::strtol(optarg, nullptr, 0);
+          break;
+        case 'n':
+          base.noise_rms = std::strtod(optarg, nullptr);
+          break;
+        case 's':
+          parse_pair(optarg, a, b);
+          base.sine_amp = a;
+          base.sine_freq = b / c_FOFB_RATE;
+          break;
+        case 'k':
+          parse_pair(optarg, a, b);
+          base.step_amp = a;
+          base.step_tf = uint64_t(b);
+          break;
+        case 'l':
+          base.pkt_loss = std::strtod(optarg, nullptr);
+          break;
+        case 'u':
+          parse_pair(optarg, a, b);
+          base.outage_bpms = size_t(a);
+          base.outage_tf = uint64_t(b);
+          break;
+        case 'e':
+          base.intlk_ctl = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'c':
+          base.stop_on_intlk = false;
+          break;
+        case 'G':
+          gains = parse_list(optarg);
+          break;
+        case 'L':
+          limits = parse_list(optarg);
+          break;
+        case 'P':
+          pkts = parse_list(optarg);
+          break;
+        case 'R':
+          seeds = std::strtoul(optarg, nullptr, 0);
+          break;
+        default:
+          usage(argv[0]);
+          return 1;
+      }
+    }
+    if (argc - optind != 2 || seeds == 0) {
+      usage(argv[0]);
+      return 1;
+    }
+
+    size_t correctors;
+    const std::vector<double> orm = read_orm(argv[optind], m.bpms, correctors);
+    const size_t boards = (correctors + c_MAX_CHANNELS - 1) / c_MAX_CHANNELS;
+    const size_t n_corr = boards * c_MAX_CHANNELS;
+    m.orm.assign(m.bpms * n_corr, 0);
+    for (size_t i = 0; i < m.bpms; i++)
+      std::copy(&orm[i * correctors], &orm[(i + 1) * correctors], &m.orm[i * n_corr]);
+
+    m.proc_regs.resize(boards);
+    for (size_t b = 0; b < boards; b++) {
+      const std::string fname = std::string(argv[optind + 1]) + "_" + std::to_string(b) + ".bin";
+      std::ifstream fin(fname, std::ios::binary);
+      if (!fin)
+        throw std::runtime_error("can't open " + fname);
+      wb_fofb_processing_regs &img = m.proc_regs[b];
+      fin.read(reinterpret_cast<char *>(&img), sizeof(img));
+      if (fin.gcount() != sizeof(img))
+        throw std::runtime_error(fname + ": register image size mismatch");
+      for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+        auto &lim = img.ch[ch].sp_limits;
+        if (sp_limit >= 0 || (lim.max == 0 && lim.min == 0)) {
+          const long l = sp_limit >= 0 ? sp_limit : 32767;
+          lim.max = uint32_t(l);
+          lim.min = uint32_t(-l);
+        }
+      }
+    }
+
+    if (shaper_fname) {
+      fofb_shaper_filt_model shaper(m.shaper_gen);
+      std::ifstream fcoeffs(shaper_fname);
+      if (!fcoeffs)
+        throw std::runtime_error(std::string("can't open ") + shaper_fname);
+      for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+        for (unsigned biquad = 0; biquad < c_SHAPER_FILT_MAX_BIQUADS; biquad++) {
+          for (unsigned k = 0; k < 5; k++) {
+            double coeff;
+            if (!(fcoeffs >> coeff))
+              throw std::runtime_error("not enough coefficients");
+            shaper.set_coeff(ch, biquad * c_SHAPER_FILT_COEFFS_PER_BIQUAD + k,
+                             shaper.coeff_to_reg(coeff));
+          }
+        }
+      }
+      auto img = std::make_unique<wb_fofb_shaper_filt_regs>();
+      std::memset(img.get(), 0, sizeof(*img));
+      shaper.store_regs(*img);
+      m.shaper_regs.assign(boards, *img);
+    }
+
+    std::vector<loop_sim_scenario> scs;
+    for (double g: gains)
+      for (double l: limits)
+        for (double p: pkts)
+          for (unsigned seed = 1; seed <= seeds; seed++) {
+            loop_sim_scenario sc = base;
+            sc.gain_scale = g;
+            sc.orb_distort_limit = uint32_t(l);
+            sc.min_num_pkts = uint32_t(p);
+            sc.seed = seed;
+            scs.push_back(sc);
+          }
+
+    loop_sim_batch_stats st;
+    const std::vector<loop_sim_result> res = run_loop_sims(m, scs, threads, &st);
+
+    std::printf("gain_scale,orb_distort_limit,min_num_pkts,seed,timeframes,intlk_tf,"
+                "intlk_sta,orbit_rms,disturbance_rms,sp_peak\n");
+    for (size_t i = 0; i < scs.size(); i++)
+      std::printf("%g,%u,%u,%llu,%llu,%lld,%u,%.6g,%.6g,%d\n", scs[i].gain_scale,
+                  scs[i].orb_distort_limit, scs[i].min_num_pkts,
+                  (unsigned long long)scs[i].seed, (unsigned long long)res[i].timeframes,
+                  (long long)res[i].intlk_tf, res[i].intlk_sta, res[i].orbit_rms,
+                  res[i].disturbance_rms, res[i].sp_peak);
+
+    const double rate = double(st.timeframes) / st.seconds;
+    std::fprintf(stderr, "%zu scenarios, %llu timeframes in %.3f s: %.0f timeframes/s "
+                 "(%.1fx real time at %.0f kHz)\n", scs.size(),
+                 (unsigned long long)st.timeframes, st.seconds, rate, rate / c_FOFB_RATE,
+                 c_FOFB_RATE / 1e3);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
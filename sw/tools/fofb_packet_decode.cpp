@@ -0,0 +1,307 @@
+// Decode a capture of FOFB packets with set-points
+//
+// usage: fofb_packet_decode [-b bpm_ids] [-t tf_min:tf_max] [-f cols|table]
+//          [-o outdir] [-s] <capture.bin>
+//
+// capture.bin holds 8 words per packet (see fofb_packet_decoder.h). Only
+// packets whose bpm_id is in 'bpm_ids' (e.g. "0-7,16") and whose tf_cntr_32
+// is in [tf_min, tf_max] are kept. With '-f cols' (the default), every field
+// is written to outdir/<field>.bin as a raw array: idx (uint64), tf_cntr_32
+// (uint32), tf_cntr_16 (uint16), tf_start (uint8), bpm_id (uint16), bpm_x and
+// bpm_y (int32), sp_x_<i> and sp_y_<i> (int16). '-f table' prints the same
+// table as 'scripts/reformat_fofb_packet_v2.py int32'. '-s' reports the
+// decoding throughput on stderr.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fofb_packet_decoder.h"
+
+using namespace fofb;
+
+namespace {
+
+// Packets decoded at once
+constexpr size_t c_CHUNK = 1 << 18;
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-b bpm_ids] [-t tf_min:tf_max] [-f cols|table]\n"
+               "       [-o outdir] [-s] <capture.bin>\n", prog);
+}
+
+class column_writer {
+ public:
+  explicit column_writer(const std::string &dir)
+  {
+    if (::mkdir(dir.c_str(), 0755) < 0 && errno != EEXIST)
+      throw std::runtime_error("can't create " + dir);
+    open(dir, "idx");
+    open(dir, "tf_cntr_32");
+    open(dir, "tf_cntr_16");
+    open(dir, "tf_start");
+    open(dir, "bpm_id");
+    open(dir, "bpm_x");
+    open(dir, "bpm_y");
+    for (unsigned i = 0; i < c_PACKET_SPS; i++)
+      open(dir, "sp_x_" + std::to_string(i));
+    for (unsigned i = 0; i < c_PACKET_SPS; i++)
+      open(dir, "sp_y_" + std::to_string(i));
+  }
+
+  ~column_writer()
+  {
+    for (FILE *f: files)
+      std::fclose(f);
+  }
+
+  void write(const packet_columns &cols)
+  {
+    unsigned i = 0;
+    put(i++, cols.idx, cols.count);
+    put(i++, cols.tf_cntr_32, cols.count);
+    put(i++, cols.tf_cntr_16, cols.count);
+    put(i++, cols.tf_start, cols.count);
+    put(i++, cols.bpm_id, cols.count);
+    put(i++, cols.bpm_x, cols.count);
+    put(i++, cols.bpm_y, cols.count);
+    for (unsigned j = 0; j < c_PACKET_SPS; j++)
+      put(i++, cols.sp_x[j], cols.count);
+    for (unsigned j = 0; j < c_PACKET_SPS; j++)
+      put(i++, cols.sp_y[j], cols.count);
+  }
+
+ private:
+  void open(const std::string &dir, const std::string &name)
+  {
+    const std::string fname = dir + "/" + name + ".bin";
+    FILE *f = std::fopen(fname.c_str(), "wb");
+    if (!f)
+      throw std::runtime_error("can't open " + fname);
+    files.push_back(f);
+    names.push_back(fname);
+  }
+
+  template <typename T>
+  void put(unsigned i, const std::vector<T> &v, size_t n)
+  {
+    if (std::fwrite(v.data(), sizeof(T), n, files[i]) != n)
+      throw std::runtime_error(names[i] + ": write error");
+  }
+
+  std::vector<FILE *> files;
+  std::vector<std::string> names;
+};
+
+// Text output matching reformat_fofb_packet_v2.py, formatted by hand since
+// printf() would dominate the decoding time
+class table_writer {
+ public:
+  table_writer(): buf(new char[c_BUF_SIZE]) {}
+
+  ~table_writer()
+  {
+    flush();
+  }
+
+  void header()
+  {
+    static const char *const c_NAMES[] = {
+      "tf_cntr_16", "tf_start", "bpm_id", "bpm_x", "bpm_y", "tf_cntr_32",
+      "sp_x_0", "sp_y_0", "sp_x_1", "sp_y_1", "sp_x_2", "sp_y_2", "sp_x_3", "sp_y_3"};
+    put_str("| packet # |");
+    for (unsigned i = 0; i < 14; i++) {
+      put_char(' ');
+      put_centered(c_NAMES[i], std::strlen(c_NAMES[i]), c_WIDTHS[i]);
+      put_str(" |");
+    }
+    put_char('\n');
+  }
+
+  void write(const packet_columns &cols)
+  {
+    for (size_t k = 0; k < cols.count; k++) {
+      if (pos > c_BUF_SIZE - c_MAX_LINE)
+        flush();
+      const int64_t vals[14] = {
+        cols.tf_cntr_16[k], cols.tf_start[k], cols.bpm_id[k], cols.bpm_x[k],
+        cols.bpm_y[k], cols.tf_cntr_32[k],
+        cols.sp_x[0][k], cols.sp_y[0][k], cols.sp_x[1][k], cols.sp_y[1][k],
+        cols.sp_x[2][k], cols.sp_y[2][k], cols.sp_x[3][k], cols.sp_y[3][k]};
+
+      char num[24];
+      size_t len = fmt_int(num, int64_t(cols.idx[k]));
+      put_str("| ");
+      for (size_t i = len; i < 8; i++)
+        put_char(' ');
+      put_mem(num, len);
+      put_str(" |");
+      for (unsigned i = 0; i < 14; i++) {
+        put_char(' ');
+        len = fmt_int(num, vals[i]);
+        put_centered(num, len, c_WIDTHS[i]);
+        put_str(" |");
+      }
+      put_char('\n');
+    }
+  }
+
+  void flush()
+  {
+    if (pos && std::fwrite(buf.get(), 1, pos, stdout) != pos)
+      throw std::runtime_error("write error");
+    pos = 0;
+  }
+
+ private:
+  static constexpr size_t c_BUF_SIZE = 1 << 20;
+  static constexpr size_t c_MAX_LINE = 256;
+  static constexpr unsigned c_WIDTHS[14] = {10, 8, 6, 10, 10, 10, 10, 10, 10, 10, 10, 10,
+                                            10, 10};
+
+  static size_t fmt_int(char *dst, int64_t v)
+  {
+    char tmp[24];
+    size_t n = 0;
+    const bool neg = v < 0;
+    uint64_t u = neg ? -uint64_t(v) : uint64_t(v);
+    do {
+      tmp[n++] = char('0' + u % 10);
+      u /= 10;
+    } while (u);
+    size_t len = 0;
+    if (neg)
+      dst[len++] = '-';
+    while (n)
+      dst[len++] = tmp[--n];
+    return len;
+  }
+
+  void put_char(char c) { buf[pos++] = c; }
+  void put_mem(const char *s, size_t n)
+  {
+    std::memcpy(&buf[pos], s, n);
+    pos += n;
+  }
+  void put_str(const char *s) { put_mem(s, std::strlen(s)); }
+
+  // Python's '^' alignment: the extra space goes to the right
+  void put_centered(const char *s, size_t n, size_t width)
+  {
+    const size_t pad = n < width ? width - n : 0;
+    for (size_t i = 0; i < pad / 2; i++)
+      put_char(' ');
+    put_mem(s, n);
+    for (size_t i = 0; i < pad - pad / 2; i++)
+      put_char(' ');
+  }
+
+  std::unique_ptr<char[]> buf;
+  size_t pos = 0;
+};
+
+constexpr unsigned table_writer::c_WIDTHS[14];
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  packet_filter filter;
+  bool use_filter = false;
+  bool table = false;
+  bool report = false;
+  std::string outdir = ".";
+  int opt;
+  try {
+    while ((opt = getopt(argc, argv, "b:t:f:o:s")) != -1) {
+      switch (opt) {
+        case 'b':
+          filter.add_bpm_ids(optarg);
+          use_filter = true;
+          break;
+        case 't': {
+          char *end;
+          filter.tf_min = std::strtoul(optarg, &end, 0);
+          if (*end != ':')
+            throw std::invalid_argument("invalid timeframe range");
+          filter.tf_max = std::strtoul(end + 1, nullptr, 0);
+          use_filter = true;
+          break;
+        }
+        case 'f':
+          if (!std::strcmp(optarg, "table"))
+            table = true;
+          else if (std::strcmp(optarg, "cols")) {
+            usage(argv[0]);
+            return 1;
+          }
+          break;
+        case 'o':
+          outdir = optarg;
+          break;
+        case 's':
+          report = true;
+          break;
+        default:
+          usage(argv[0]);
+          return 1;
+      }
+    }
+    if (argc - optind != 1) {
+      usage(argv[0]);
+      return 1;
+    }
+
+    capture_file cap(argv[optind]);
+    const size_t n_pkts = cap.num_packets();
+    packet_columns cols;
+    std::unique_ptr<column_writer> cw;
+    std::unique_ptr<table_writer> tw;
+    if (table) {
+      tw.reset(new table_writer);
+      tw->header();
+    } else {
+      cw.reset(new column_writer(outdir));
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    size_t kept = 0;
+    for (size_t p = 0; p < n_pkts; p += c_CHUNK) {
+      const size_t n = std::min(c_CHUNK, n_pkts - p);
+      kept += decode_packets(cap.words() + p * c_PACKET_WORDS, n, p,
+                             use_filter ? &filter : nullptr, cols);
+      if (tw)
+        tw->write(cols);
+      else
+        cw->write(cols);
+    }
+    if (tw)
+      tw->flush();
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    if (report) {
+      const double bytes = double(n_pkts) * c_PACKET_WORDS * sizeof(uint32_t);
+      std::fprintf(stderr, "%zu packets, %zu kept, %.3f s, %.2f GB/s\n", n_pkts, kept,
+                   elapsed.count(), bytes / elapsed.count() * 1e-9);
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,209 @@
+// Capture post-mortem data on loop interlocks
+//
+// usage: fofb_postmortem [-r rate] [-n depth] [-m mask] [-p poll_ns]
+//          [-u uio_dev] [-o out_dir] [-P priority] [-t seconds]
+//          <device> [proc_offset [cc_offset]]
+//        fofb_postmortem -S events [-r rate] [-n depth] [-p poll_ns] [-i]
+//          [-l read_ns] [-o out_dir]
+//
+// Keeps the last 'depth' samples (16384 by default), taken at 'rate' Hz
+// (10000 by default), of the channels' sp_decim.data, loop_intlk.sta and the
+// FOFB CC link and error counters, and writes them to
+// out_dir/fofb_postmortem_<t_ns>.bin (see fofb_postmortem.h) whenever a
+// 'mask' bit (ORB_DISTORT | PACKET_LOSS by default) of loop_intlk.sta sets,
+// then clears the interlock status. 'device' is the file mapping the board
+// register space, with the wb_fofb_processing_regs block at 'proc_offset' (0
+// by default) and the fofb_cc_regs block at 'cc_offset' (none by default).
+// The interlock is detected on the 'uio_dev' interrupt (e.g. /dev/uio0) or,
+// without -u, by polling loop_intlk.sta every 'poll_ns' (back to back by
+// default). Runs until 'seconds' elapse or SIGINT/SIGTERM.
+//
+// With -S, runs against a mock board instead: 'events' interlocks are raised
+// one at a time, every read costing 'read_ns' (1000 by default), and
+// detected by polling or, with -i, on a software interrupt. Reports the
+// interlock to detection and detection to freeze latencies and the CPU use of
+// the capture thread.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_postmortem.h"
+
+using namespace fofb;
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_signal(int)
+{
+  stop_requested = 1;
+}
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-r rate] [-n depth] [-m mask] [-p poll_ns] [-u uio_dev]\n"
+               "       [-o out_dir] [-P priority] [-t seconds]\n"
+               "       <device> [proc_offset [cc_offset]]\n"
+               "       %s -S events [-r rate] [-n depth] [-p poll_ns] [-i] [-l read_ns]\n"
+               "       [-o out_dir]\n", prog, prog);
+}
+
+void print_stats(const postmortem_stats &st)
+{
+  std::printf("%llu samples, %llu missed, %llu loop_intlk.sta reads, %llu interrupts, "
+              "%llu post-mortems\n",
+              (unsigned long long)st.samples, (unsigned long long)st.missed,
+              (unsigned long long)st.sta_reads, (unsigned long long)st.irqs,
+              (unsigned long long)st.events);
+  std::printf("capture thread CPU: %.1f%%\n",
+              st.wall_ns ? 100.0 * st.cpu_ns / st.wall_ns : 0.0);
+}
+
+double percentile(std::vector<double> v, double p)
+{
+  std::sort(v.begin(), v.end());
+  return v[std::min(v.size() - 1, size_t(p * v.size()))];
+}
+
+void simulate(unsigned n_events, const postmortem_config &cfg, bool use_irq,
+              uint32_t read_ns)
+{
+  mock_board board;
+  board.set_latency(read_ns, 0);
+  event_irq irq;
+  intlk_sim sim(board, use_irq ? &irq : nullptr);
+  postmortem_capture cap(board.proc(), 0, &board.cc(), 0, cfg, use_irq ? &irq : nullptr);
+
+  // Interlocks at a few history lengths apart, alternating the sources
+  const auto gap = std::chrono::duration<double>(std::min(cfg.depth / cfg.rate_hz, 0.5) / 4);
+  std::vector<double> detect_us, freeze_us;
+  cap.start();
+  for (unsigned i = 0; i < n_events && !stop_requested; i++) {
+    std::this_thread::sleep_for(gap);
+    const uint32_t sta = i % 2 ? WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_PACKET_LOSS :
+                                 WB_FOFB_PROCESSING_REGS_LOOP_INTLK_STA_ORB_DISTORT;
+    const uint64_t raised = sim.raise(sta & cfg.mask ? sta : cfg.mask);
+    while (cap.stats().events <= i || sim.clears() <= i) {
+      if (stop_requested)
+        break;
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    if (stop_requested)
+      break;
+    const postmortem_event e = cap.events().back();
+    if (!e.error.empty())
+      throw std::runtime_error(e.error);
+    std::remove(e.file.c_str());
+    detect_us.push_back((e.detect_ns - raised) / 1e3);
+    freeze_us.push_back((e.freeze_ns - e.detect_ns) / 1e3);
+  }
+  cap.stop();
+
+  print_stats(cap.stats());
+  if (detect_us.empty())
+    return;
+  std::printf("interlock to detection: median %.1f us, p99 %.1f us, max %.1f us\n",
+              percentile(detect_us, 0.5), percentile(detect_us, 0.99),
+              percentile(detect_us, 1));
+  std::printf("detection to freeze: median %.2f us, max %.2f us\n",
+              percentile(freeze_us, 0.5), percentile(freeze_us, 1));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  postmortem_config cfg;
+  double duration = 0;
+  std::string uio;
+  unsigned sim_events = 0;
+  bool sim_irq = false;
+  uint32_t read_ns = 1000;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:n:m:p:u:o:P:t:S:il:")) != -1) {
+    switch (opt) {
+      case 'r': cfg.rate_hz = std::strtod(optarg, nullptr); break;
+      case 'n': cfg.depth = std::strtoul(optarg, nullptr, 0); break;
+      case 'm': cfg.mask = std::strtoul(optarg, nullptr, 0); break;
+      case 'p': cfg.poll_ns = std::strtoull(optarg, nullptr, 0); break;
+      case 'u': uio = optarg; break;
+      case 'o': cfg.out_dir = optarg; break;
+      case 'P': cfg.rt_priority = std::atoi(optarg); break;
+      case 't': duration = std::strtod(optarg, nullptr); break;
+      case 'S': sim_events = std::strtoul(optarg, nullptr, 0); break;
+      case 'i': sim_irq = true; break;
+      case 'l': read_ns = std::strtoul(optarg, nullptr, 0); break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  const int nargs = argc - optind;
+  if (sim_events ? nargs != 0 : nargs < 1 || nargs > 3) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    std::signal(SIGINT, on_signal);
+    std::signal(SIGTERM, on_signal);
+
+    if (sim_events) {
+      simulate(sim_events, cfg, sim_irq, read_ns);
+      return 0;
+    }
+
+    const off_t proc_off = nargs > 1 ? std::strtoull(argv[optind + 1], nullptr, 0) : 0;
+    mmap_device proc(argv[optind], sizeof(wb_fofb_processing_regs), proc_off);
+    std::unique_ptr<mmap_device> cc;
+    if (nargs > 2)
+      cc.reset(new mmap_device(argv[optind], sizeof(::fofb_cc_regs),
+                               std::strtoull(argv[optind + 2], nullptr, 0)));
+    std::unique_ptr<uio_irq> irq;
+    if (!uio.empty())
+      irq.reset(new uio_irq(uio));
+
+    postmortem_capture cap(proc, 0, cc.get(), 0, cfg, irq.get());
+    const auto start = std::chrono::steady_clock::now();
+    size_t reported = 0;
+    cap.start();
+    while (!stop_requested) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      const std::vector<postmortem_event> evs = cap.events();
+      for (; reported < evs.size(); reported++) {
+        const postmortem_event &e = evs[reported];
+        if (e.error.empty())
+          std::printf("interlock 0x%x: %zu samples written to %s\n", e.sta, e.samples,
+                      e.file.c_str());
+        else
+          std::fprintf(stderr, "interlock 0x%x: %s\n", e.sta, e.error.c_str());
+        std::fflush(stdout);
+      }
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      if (duration > 0 && elapsed.count() >= duration)
+        break;
+    }
+    cap.stop();
+    print_stats(cap.stats());
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
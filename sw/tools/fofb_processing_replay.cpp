@@ -0,0 +1,95 @@
+// Replay recorded BPM positions through the fofb_processing model
+//
+// usage: fofb_processing_replay <regs.bin> <bpm_pos.bin> [sp.csv]
+//
+// regs.bin is a raw wb_fofb_processing_regs image (as read from the device),
+// bpm_pos.bin holds c_NUM_BPM_POS little-endian int32 positions per timeframe.
+// Optionally writes one line per timeframe with the set-point of each channel.
+// Reports the achieved timeframe rate against the 48 kHz FOFB rate.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "fofb_processing_model.h"
+
+using namespace fofb;
+
+namespace {
+
+constexpr double c_FOFB_RATE = 48e3;
+
+std::vector<char> read_file(const char *fname)
+{
+  std::ifstream fin(fname, std::ios::binary);
+  if (!fin)
+    throw std::runtime_error(std::string("can't open ") + fname);
+  return std::vector<char>(std::istreambuf_iterator<char>(fin), {});
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc < 3) {
+    std::fprintf(stderr, "usage: %s <regs.bin> <bpm_pos.bin> [sp.csv]\n", argv[0]);
+    return 1;
+  }
+
+  try {
+    const auto regs_raw = read_file(argv[1]);
+    if (regs_raw.size() != sizeof(wb_fofb_processing_regs))
+      throw std::runtime_error("register image size mismatch");
+    auto regs = std::make_unique<wb_fofb_processing_regs>();
+    std::memcpy(regs.get(), regs_raw.data(), sizeof(*regs));
+
+    const auto pos_raw = read_file(argv[2]);
+    const size_t tf_size = c_NUM_BPM_POS * sizeof(int32_t);
+    const size_t n_tf = pos_raw.size() / tf_size;
+    if (n_tf == 0 || pos_raw.size() % tf_size)
+      throw std::runtime_error("BPM positions file size isn't a multiple of a timeframe");
+    std::vector<int32_t> bpm_pos(n_tf * c_NUM_BPM_POS);
+    std::memcpy(bpm_pos.data(), pos_raw.data(), n_tf * tf_size);
+
+    fofb_processing_generics gen;
+    gen.from_regs(*regs);
+    fofb_processing_model model(gen);
+    model.load_regs(*regs);
+
+    std::vector<fofb_processing_result> res(n_tf);
+    const auto start = std::chrono::steady_clock::now();
+    model.process(bpm_pos.data(), nullptr, n_tf, res.data());
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    const double rate = n_tf / elapsed.count();
+    std::printf("%zu timeframes in %.3f ms: %.0f timeframes/s (%.1fx the %.0f kHz FOFB rate)\n",
+                n_tf, elapsed.count() * 1e3, rate, rate / c_FOFB_RATE,
+                c_FOFB_RATE / 1e3);
+
+    if (argc > 3) {
+      std::FILE *fout = std::fopen(argv[3], "w");
+      if (!fout)
+        throw std::runtime_error(std::string("can't open ") + argv[3]);
+      for (const auto &r: res) {
+        for (unsigned ch = 0; ch < gen.channels; ch++)
+          std::fprintf(fout, ch ? ",%d" : "%d", r.sp[ch]);
+        std::fprintf(fout, "\n");
+      }
+      std::fclose(fout);
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
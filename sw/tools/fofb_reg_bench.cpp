@@ -0,0 +1,131 @@
+// Benchmark the host register access operations against a mock board
+//
+// usage: fofb_reg_bench [-r read_ns] [-w write_ns] [-n iterations]
+//          [-l bench[,bench...]] [-m mock_file] [-o report.csv]
+//          [-b baseline.csv] [-t tolerance]
+//
+// Runs the benchmarks of fofb_reg_bench.h (all of them, or those listed with
+// -l) against a mock board whose every word read costs 'read_ns' and every
+// word written 'write_ns' (1000 and 100 by default), 'iterations' times each
+// (200 by default). The mock board is a new /dev/shm file unless -m names
+// one, which is kept.
+//
+// The CSV report goes to stdout, or to 'report.csv' with -o: per benchmark,
+// the median, 99th percentile and mean time of an iteration, the bus
+// accesses it issued and the time those cost at the configured latency. With
+// -b, the results are compared with a previous report: more accesses than
+// the baseline, or a median time more than 'tolerance' above it (0.2, i.e.
+// 20%, by default) is reported on stderr and the exit status is 2.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_reg_bench.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-r read_ns] [-w write_ns] [-n iterations]\n"
+               "       [-l bench[,bench...]] [-m mock_file] [-o report.csv]\n"
+               "       [-b baseline.csv] [-t tolerance]\n", prog);
+  std::fprintf(stderr, "benchmarks:");
+  for (const std::string &name: reg_bench_names())
+    std::fprintf(stderr, " %s", name.c_str());
+  std::fprintf(stderr, "\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  reg_bench_config cfg;
+  std::string mock_file, report, baseline;
+  double tolerance = 0.2;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:w:n:l:m:o:b:t:")) != -1) {
+    switch (opt) {
+      case 'r':
+        cfg.read_ns = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'w':
+        cfg.write_ns = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'n':
+        cfg.iterations = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'l': {
+        std::istringstream ss(optarg);
+        std::string name;
+        while (std::getline(ss, name, ','))
+          cfg.only.push_back(name);
+        break;
+      }
+      case 'm':
+        mock_file = optarg;
+        break;
+      case 'o':
+        report = optarg;
+        break;
+      case 'b':
+        baseline = optarg;
+        break;
+      case 't':
+        tolerance = std::strtod(optarg, nullptr);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc != optind || cfg.iterations == 0) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    // Read first, so that a bad baseline doesn't cost a whole run
+    std::vector<reg_bench_result> base;
+    if (!baseline.empty())
+      base = read_reg_bench_report(baseline);
+
+    mock_board board(mock_file);
+    fofb_reg_bench bench(board, cfg);
+    const std::vector<reg_bench_result> res = bench.run();
+
+    if (report.empty()) {
+      write_reg_bench_report(std::cout, cfg, res);
+    } else {
+      std::ofstream fout(report);
+      write_reg_bench_report(fout, cfg, res);
+      if (!fout.flush())
+        throw std::runtime_error("can't write " + report);
+    }
+
+    if (!baseline.empty()) {
+      const std::vector<std::string> regs = compare_reg_bench(base, res, tolerance);
+      for (const std::string &r: regs)
+        std::fprintf(stderr, "regression: %s\n", r.c_str());
+      if (!regs.empty())
+        return 2;
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
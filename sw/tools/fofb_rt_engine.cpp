@@ -0,0 +1,264 @@
+// Run the correction chain on the host, on the loop clock
+//
+// usage: fofb_rt_engine [-s shaper_regs.bin] [-f tf_rate] [-c cpu] [-P priority] [-L]
+//          [-F] [-n cycles] [-r] [-o sp.csv] [-x expected.csv] <regs.bin> <source>
+//        fofb_rt_engine -X key [-f tf_rate] [-r] <bpm_pos.bin>
+//
+// The first form runs an rt_engine (see fofb_rt_engine.h) configured from
+// regs.bin, a raw wb_fofb_processing_regs image, and shaper_regs.bin, a raw
+// wb_fofb_shaper_filt_regs image (the shaper filters are bypassed without
+// it). 'source' is either a BPM positions file (c_NUM_BPM_POS int32 per
+// timeframe, replayed once or, with -r, in a loop) or 'shm:<key>', the X/Y
+// buffer stand-in /fofb_xy_<key>. The cycles run at 'tf_rate' Hz (48000 by
+// default) or, with -F, back to back, on 'cpu' with SCHED_FIFO 'priority'
+// if given and the process memory locked with -L, for 'cycles' cycles or
+// until the source ends (or SIGINT). The cycle statistics are printed every
+// second and at the end; -o writes the (filtered) set-points, one line per
+// timeframe, and -x compares them word for word with the ones in
+// expected.csv, in the same format (exit status 2 on a mismatch).
+//
+// The second form feeds the stand-in /fofb_xy_<key> with a BPM positions
+// file at 'tf_rate', all packets received, for an engine in another process.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_rt_engine.h"
+#include "fofb_xy_shm.h"
+
+using namespace fofb;
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_sigint(int)
+{
+  stop_requested = 1;
+}
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-s shaper_regs.bin] [-f tf_rate] [-c cpu] [-P priority] [-L]\n"
+               "       [-F] [-n cycles] [-r] [-o sp.csv] [-x expected.csv] <regs.bin> <source>\n"
+               "       %s -X key [-f tf_rate] [-r] <bpm_pos.bin>\n", prog, prog);
+}
+
+template <typename T>
+std::unique_ptr<T> read_image(const char *fname)
+{
+  std::ifstream fin(fname, std::ios::binary);
+  if (!fin)
+    throw std::runtime_error(std::string("can't open ") + fname);
+  auto img = std::make_unique<T>();
+  if (!fin.read(reinterpret_cast<char *>(img.get()), sizeof(T)) || fin.peek() != EOF)
+    throw std::runtime_error(std::string(fname) + ": register image size mismatch");
+  return img;
+}
+
+std::vector<int16_t> read_sp_csv(const char *fname)
+{
+  std::ifstream fin(fname);
+  if (!fin)
+    throw std::runtime_error(std::string("can't open ") + fname);
+  std::vector<int16_t> sp;
+  std::string line;
+  while (std::getline(fin, line)) {
+    std::istringstream ss(line);
+    std::string field;
+    unsigned n = 0;
+    while (std::getline(ss, field, ',')) {
+      sp.push_back(int16_t(std::stoi(field)));
+      n++;
+    }
+    if (n != c_MAX_CHANNELS)
+      throw std::runtime_error(std::string(fname) + ": expected one set-point per channel");
+  }
+  return sp;
+}
+
+void print_stats(const rt_engine_stats &st, const char *prefix)
+{
+  std::fprintf(stderr, "%s%llu cycles, %llu timeframes, %llu underruns, %llu overruns, "
+               "%llu dropped\n", prefix, (unsigned long long)st.cycles,
+               (unsigned long long)st.timeframes, (unsigned long long)st.underruns,
+               (unsigned long long)st.overruns, (unsigned long long)st.dropped);
+  const std::pair<const char *, const rt_histogram *> hists[] = {
+    {"wake-up", &st.wake}, {"compute", &st.compute}, {"latency", &st.latency}};
+  for (const auto &h: hists)
+    std::fprintf(stderr, "%s  %-8s p50 %6.1f us  p99 %6.1f us  p99.9 %6.1f us  max %6.1f us\n",
+                 prefix, h.first, h.second->quantile_ns(0.5) / 1e3,
+                 h.second->quantile_ns(0.99) / 1e3, h.second->quantile_ns(0.999) / 1e3,
+                 h.second->max_ns / 1e3);
+}
+
+void feed(unsigned key, double tf_rate, bool loop, const char *fname)
+{
+  const std::vector<int32_t> pos = read_bpm_pos_file(fname);
+  const size_t n_tf = pos.size() / c_NUM_BPM_POS;
+  xy_shm shm(xy_shm_name(key), true);
+  std::fprintf(stderr, "feeding %s with %zu timeframes\n", shm.name().c_str(), n_tf);
+
+  auto frame = std::make_unique<xy_shm_frame>();
+  for (unsigned w = 0; w < c_CC_NODES / 64; w++)
+    frame->valid[w] = ~uint64_t(0);
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(1 / tf_rate));
+  auto next = std::chrono::steady_clock::now();
+  for (uint64_t tf = 0; !stop_requested && (loop || tf < n_tf); tf++) {
+    const int32_t *p = &pos[(tf % n_tf) * c_NUM_BPM_POS];
+    frame->tf = tf;
+    for (unsigned n = 0; n < c_CC_NODES; n++)
+      frame->xy[n] = uint64_t(uint32_t(p[n])) << 32 | uint32_t(p[c_CC_NODES + n]);
+    next += period;
+    std::this_thread::sleep_until(next);
+    while (!shm.push(*frame) && !stop_requested)
+      std::this_thread::sleep_for(period);
+  }
+  // Let the consumer drain the ring before the object goes away
+  while (shm.size() && !stop_requested)
+    std::this_thread::sleep_for(period);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  rt_engine_config cfg;
+  const char *shaper_file = nullptr, *out_file = nullptr, *expected_file = nullptr;
+  bool loop = false;
+  int feed_key = -1;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:f:c:P:LFn:ro:x:X:")) != -1) {
+    switch (opt) {
+      case 's': shaper_file = optarg; break;
+      case 'f': cfg.tf_rate_hz = std::strtod(optarg, nullptr); break;
+      case 'c': cfg.cpu = std::atoi(optarg); break;
+      case 'P': cfg.rt_priority = std::atoi(optarg); break;
+      case 'L': cfg.lock_memory = true; break;
+      case 'F': cfg.free_run = true; break;
+      case 'n': cfg.cycles = std::strtoull(optarg, nullptr, 0); break;
+      case 'r': loop = true; break;
+      case 'o': out_file = optarg; break;
+      case 'x': expected_file = optarg; break;
+      case 'X': feed_key = std::atoi(optarg); break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  const int nargs = argc - optind;
+  if (nargs != (feed_key >= 0 ? 1 : 2)) {
+    usage(argv[0]);
+    return 1;
+  }
+  std::signal(SIGINT, on_sigint);
+
+  try {
+    if (feed_key >= 0) {
+      feed(unsigned(feed_key), cfg.tf_rate_hz, loop, argv[optind]);
+      return 0;
+    }
+
+    const auto proc_regs = read_image<wb_fofb_processing_regs>(argv[optind]);
+    fofb_processing_generics proc_gen;
+    proc_gen.from_regs(*proc_regs);
+    std::unique_ptr<wb_fofb_shaper_filt_regs> shaper_regs;
+    fofb_shaper_filt_generics shaper_gen;
+    if (shaper_file) {
+      shaper_regs = read_image<wb_fofb_shaper_filt_regs>(shaper_file);
+      shaper_gen.from_regs(*shaper_regs);
+    }
+    const std::vector<int16_t> expected =
+      expected_file ? read_sp_csv(expected_file) : std::vector<int16_t>();
+
+    const std::string source = argv[optind + 1];
+    std::unique_ptr<xy_shm> shm;
+    std::unique_ptr<rt_pos_source> src;
+    if (source.compare(0, 4, "shm:") == 0) {
+      shm.reset(new xy_shm(xy_shm_name(std::stoul(source.substr(4))), false));
+      src.reset(new rt_xy_shm_source(*shm));
+    } else {
+      src.reset(new rt_replay_source(read_bpm_pos_file(source), loop));
+    }
+
+    if (out_file || expected_file)
+      cfg.output_ring = 1 << 16;
+    rt_engine eng(*proc_regs, shaper_regs.get(), *src, cfg, proc_gen, shaper_gen);
+    std::vector<rt_engine_step> steps, chunk(1024);
+    auto drain = [&]() {
+      if (eng.outputs())
+        while (size_t n = eng.outputs()->pop(chunk.data(), chunk.size()))
+          steps.insert(steps.end(), chunk.begin(), chunk.begin() + n);
+    };
+
+    eng.start();
+    auto last_print = std::chrono::steady_clock::now();
+    while (eng.running()) {
+      if (stop_requested)
+        eng.stop();
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      drain();
+      if (std::chrono::steady_clock::now() - last_print > std::chrono::seconds(1)) {
+        print_stats(eng.stats(), "# ");
+        last_print = std::chrono::steady_clock::now();
+      }
+    }
+    eng.wait();
+    drain();
+    print_stats(eng.stats(), "");
+
+    if (out_file) {
+      std::FILE *fout = std::fopen(out_file, "w");
+      if (!fout)
+        throw std::runtime_error(std::string("can't open ") + out_file);
+      for (const rt_engine_step &s: steps) {
+        for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++)
+          std::fprintf(fout, ch ? ",%d" : "%d", s.filt_sp[ch]);
+        std::fprintf(fout, "\n");
+      }
+      std::fclose(fout);
+    }
+
+    if (expected_file) {
+      const size_t n_tf = std::min(steps.size(), expected.size() / c_MAX_CHANNELS);
+      size_t mismatches = 0;
+      for (size_t tf = 0; tf < n_tf; tf++) {
+        for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+          const int16_t exp = expected[tf * c_MAX_CHANNELS + ch];
+          if (steps[tf].filt_sp[ch] == exp)
+            continue;
+          if (mismatches++ == 0)
+            std::printf("first mismatch: timeframe %zu channel %u: %d, expected %d\n", tf, ch,
+                        steps[tf].filt_sp[ch], exp);
+        }
+      }
+      std::printf("%zu timeframes compared, %zu set-points differ\n", n_tf, mismatches);
+      if (mismatches || n_tf == 0)
+        return 2;
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
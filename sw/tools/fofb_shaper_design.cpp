@@ -0,0 +1,181 @@
+// Search the fixed-point realization of shaper filter designs
+//
+// usage: fofb_shaper_design [-n num_biquads] [-i coeff_int_width]
+//          [-f coeff_frac_width] [-a arith_extra_bits] [-e ifcs_extra_bits]
+//          [-j threads] [-g grid_points] [-N max_candidates]
+//          [-m sim|resp|noise] <coeffs.dat> <out_prefix>
+//
+// coeffs.dat has the fofb_shaper_filt_coeffs.dat format: one line per
+// channel with b0, b1, b2, a1 and a2 of each of the c_SHAPER_FILT_MAX_BIQUADS
+// biquads, of which the first 'num_biquads' are the design. For each channel
+// (once per distinct design), the pairings of zeros and poles into biquads
+// and the biquads' orderings are searched as described in
+// fofb_shaper_design.h, 'threads' at a time (one per CPU by default),
+// exhaustively up to 'max_candidates' (20000) of them. The best realizations
+// are written to out_prefix.dat, in the same format, and to out_prefix.bin,
+// a raw wb_fofb_shaper_filt_regs image whose ch[].coeffs hold the register
+// values.
+//
+// One line is printed per channel, for the design as given and for the best
+// realization: internal saturations on a full-scale step and chirp, RMS
+// error of the fixed-point model output against the ideal filter and output
+// roundoff noise (set-point LSBs), and the worst frequency response error
+// (dB). '-m' selects which of the last three ranks the realizations without
+// saturations (sim, the fixed-point model error, by default). Generics
+// default to the afc_ref_fofb_ctrl_gen ones.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_shaper_design.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-n num_biquads] [-i coeff_int_width] [-f coeff_frac_width]\n"
+               "       [-a arith_extra_bits] [-e ifcs_extra_bits] [-j threads]\n"
+               "       [-g grid_points] [-N max_candidates] [-m sim|resp|noise]\n"
+               "       <coeffs.dat> <out_prefix>\n", prog);
+}
+
+void print_metrics(const char *what, const shaper_quant_metrics &m)
+{
+  std::printf("  %-6s saturations %8llu  sim err %9.3f  noise %7.4f  resp err %7.1f dB\n",
+              what, static_cast<unsigned long long>(m.saturations), m.sim_err_rms,
+              m.noise_rms, 20 * std::log10(std::max(m.resp_err, 1e-30)));
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  fofb_shaper_filt_generics gen;
+  shaper_explore_config cfg;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:i:f:a:e:j:g:N:m:")) != -1) {
+    switch (opt) {
+      case 'n': gen.num_biquads = std::strtoul(optarg, nullptr, 0); break;
+      case 'i': gen.coeff_int_width = std::strtoul(optarg, nullptr, 0); break;
+      case 'f': gen.coeff_frac_width = std::strtoul(optarg, nullptr, 0); break;
+      case 'a': gen.arith_extra_bits = std::strtoul(optarg, nullptr, 0); break;
+      case 'e': gen.ifcs_extra_bits = std::strtoul(optarg, nullptr, 0); break;
+      case 'j': cfg.threads = std::strtoul(optarg, nullptr, 0); break;
+      case 'g': cfg.grid_points = std::strtoul(optarg, nullptr, 0); break;
+      case 'N': cfg.max_candidates = std::strtoull(optarg, nullptr, 0); break;
+      case 'm':
+        if (!std::strcmp(optarg, "sim")) {
+          cfg.metric = shaper_metric::sim;
+        } else if (!std::strcmp(optarg, "resp")) {
+          cfg.metric = shaper_metric::resp;
+        } else if (!std::strcmp(optarg, "noise")) {
+          cfg.metric = shaper_metric::noise;
+        } else {
+          usage(argv[0]);
+          return 1;
+        }
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 2) {
+    usage(argv[0]);
+    return 1;
+  }
+  const std::string prefix = argv[optind + 1];
+
+  try {
+    shaper_explorer explorer(gen, cfg);
+    fofb_shaper_filt_model model(gen);
+
+    std::ifstream fcoeffs(argv[optind]);
+    if (!fcoeffs)
+      throw std::runtime_error(std::string("can't open ") + argv[optind]);
+    std::vector<std::vector<biquad_coeffs>> designs(c_MAX_CHANNELS);
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      for (unsigned biquad = 0; biquad < c_SHAPER_FILT_MAX_BIQUADS; biquad++) {
+        biquad_coeffs c;
+        for (unsigned k = 0; k < 5; k++)
+          if (!(fcoeffs >> c[k]))
+            throw std::runtime_error("not enough coefficients");
+        if (biquad < gen.num_biquads)
+          designs[ch].push_back(c);
+      }
+    }
+
+    std::map<std::vector<biquad_coeffs>, shaper_explore_result> done;
+    std::vector<std::vector<biquad_coeffs>> best(c_MAX_CHANNELS);
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      auto it = done.find(designs[ch]);
+      if (it == done.end()) {
+        const auto start = std::chrono::steady_clock::now();
+        const shaper_explore_result res = explorer.explore(designs[ch]);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        it = done.emplace(designs[ch], res).first;
+
+        std::printf("ch %u: %zu candidates (%s) in %.2f s\n", ch, res.evaluated,
+                    res.exhaustive ? "exhaustive" : "local search", elapsed.count());
+        print_metrics("given", res.given.metrics);
+        print_metrics("best", res.best.metrics);
+        std::printf("  order");
+        for (unsigned p: res.best.order)
+          std::printf(" p%u/z%u", p, res.best.pairing[p]);
+        std::printf("\n");
+      } else {
+        std::printf("ch %u: same design as a previous channel\n", ch);
+      }
+      best[ch] = it->second.best.biquads;
+      shaper_explorer::load_cascade(model, ch, best[ch]);
+    }
+
+    std::ofstream fdat(prefix + ".dat");
+    if (!fdat)
+      throw std::runtime_error("can't open " + prefix + ".dat");
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      for (unsigned biquad = 0; biquad < c_SHAPER_FILT_MAX_BIQUADS; biquad++) {
+        const biquad_coeffs c = biquad < best[ch].size() ? best[ch][biquad] :
+                                biquad_coeffs{1, 0, 0, 0, 0};
+        for (unsigned k = 0; k < 5; k++) {
+          char buf[32];
+          std::snprintf(buf, sizeof(buf), "%.8e", c[k]);
+          fdat << (biquad || k ? " " : "") << buf;
+        }
+      }
+      fdat << "\n";
+    }
+    if (!fdat.flush())
+      throw std::runtime_error("can't write " + prefix + ".dat");
+
+    auto regs = std::make_unique<wb_fofb_shaper_filt_regs>();
+    std::memset(regs.get(), 0, sizeof(*regs));
+    model.store_regs(*regs);
+    std::ofstream fbin(prefix + ".bin", std::ios::binary);
+    fbin.write(reinterpret_cast<const char *>(regs.get()), sizeof(*regs));
+    if (!fbin.flush())
+      throw std::runtime_error("can't write " + prefix + ".bin");
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,114 @@
+// Filter recorded set-points through the fofb_shaper_filt model
+//
+// usage: fofb_shaper_filt_replay [-n num_biquads] [-i coeff_int_width]
+//          [-f coeff_frac_width] [-a arith_extra_bits] [-e ifcs_extra_bits]
+//          <coeffs.dat> <sp.bin> [filt_sp.bin]
+//
+// coeffs.dat has the fofb_shaper_filt_coeffs.dat format: one line per
+// channel with b0, b1, b2, a1 and a2 of each of the c_SHAPER_FILT_MAX_BIQUADS
+// biquads. sp.bin holds c_MAX_CHANNELS little-endian int16 set-points per
+// timeframe; the filtered set-points are written to filt_sp.bin in the same
+// format. Generics default to the afc_ref_fofb_ctrl_gen ones.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_shaper_filt_model.h"
+
+using namespace fofb;
+
+namespace {
+
+constexpr double c_FOFB_RATE = 48e3;
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-n num_biquads] [-i coeff_int_width] [-f coeff_frac_width]\n"
+               "       [-a arith_extra_bits] [-e ifcs_extra_bits]\n"
+               "       <coeffs.dat> <sp.bin> [filt_sp.bin]\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  fofb_shaper_filt_generics gen;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:i:f:a:e:")) != -1) {
+    switch (opt) {
+      case 'n': gen.num_biquads = std::strtoul(optarg, nullptr, 0); break;
+      case 'i': gen.coeff_int_width = std::strtoul(optarg, nullptr, 0); break;
+      case 'f': gen.coeff_frac_width = std::strtoul(optarg, nullptr, 0); break;
+      case 'a': gen.arith_extra_bits = std::strtoul(optarg, nullptr, 0); break;
+      case 'e': gen.ifcs_extra_bits = std::strtoul(optarg, nullptr, 0); break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind < 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    fofb_shaper_filt_model model(gen);
+
+    std::ifstream fcoeffs(argv[optind]);
+    if (!fcoeffs)
+      throw std::runtime_error(std::string("can't open ") + argv[optind]);
+    for (unsigned ch = 0; ch < c_MAX_CHANNELS; ch++) {
+      for (unsigned biquad = 0; biquad < c_SHAPER_FILT_MAX_BIQUADS; biquad++) {
+        for (unsigned k = 0; k < 5; k++) {
+          double coeff;
+          if (!(fcoeffs >> coeff))
+            throw std::runtime_error("not enough coefficients");
+          model.set_coeff(ch, biquad * c_SHAPER_FILT_COEFFS_PER_BIQUAD + k,
+                          model.coeff_to_reg(coeff));
+        }
+      }
+    }
+
+    std::ifstream fsp(argv[optind + 1], std::ios::binary | std::ios::ate);
+    if (!fsp)
+      throw std::runtime_error(std::string("can't open ") + argv[optind + 1]);
+    const size_t tf_size = c_MAX_CHANNELS * sizeof(int16_t);
+    const size_t n_tf = size_t(fsp.tellg()) / tf_size;
+    std::vector<int16_t> sp(n_tf * c_MAX_CHANNELS);
+    fsp.seekg(0);
+    fsp.read(reinterpret_cast<char *>(sp.data()), n_tf * tf_size);
+
+    const auto start = std::chrono::steady_clock::now();
+    model.process(sp.data(), n_tf, sp.data());
+    const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+    const double rate = n_tf / elapsed.count();
+    std::printf("%zu timeframes in %.3f ms: %.0f timeframes/s (%.1f s of %.0f kHz "
+                "data per second)\n", n_tf, elapsed.count() * 1e3, rate,
+                rate / c_FOFB_RATE, c_FOFB_RATE / 1e3);
+
+    if (argc - optind > 2) {
+      std::ofstream fout(argv[optind + 2], std::ios::binary);
+      if (!fout)
+        throw std::runtime_error(std::string("can't open ") + argv[optind + 2]);
+      fout.write(reinterpret_cast<const char *>(sp.data()), n_tf * tf_size);
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
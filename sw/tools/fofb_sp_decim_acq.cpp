@@ -0,0 +1,115 @@
+// Acquire the decimated set-points of fofb_processing to a file
+//
+// usage: fofb_sp_decim_acq [-o offset] [-r tf_rate] [-c channels]
+//          [-p rt_priority] [-t seconds] <device> <out.bin>
+//
+// <device> is the file mapping the register space (e.g. a PCIe BAR resource
+// file) and 'offset' the wb_fofb_processing_regs block offset in it.
+// 'tf_rate' is the timeframe rate in Hz (48000 by default). With -p, the
+// polling thread runs with SCHED_FIFO 'rt_priority'. Samples are
+// appended to out.bin (see fofb_sp_decim_acq.h for the format) until
+// 'seconds' elapse or SIGINT/SIGTERM.
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include <unistd.h>
+
+#include "fofb_sp_decim_acq.h"
+
+using namespace fofb;
+
+namespace {
+
+volatile std::sig_atomic_t stop_requested = 0;
+
+void on_signal(int)
+{
+  stop_requested = 1;
+}
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-o offset] [-r tf_rate] [-c channels] [-p rt_priority]\n"
+               "       [-t seconds] <device> <out.bin>\n", prog);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  off_t offset = 0;
+  double duration = 0;
+  sp_decim_acq_config cfg;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:r:c:p:t:")) != -1) {
+    switch (opt) {
+      case 'o':
+        offset = std::strtoull(optarg, nullptr, 0);
+        break;
+      case 'r':
+        cfg.tf_rate_hz = std::strtod(optarg, nullptr);
+        break;
+      case 'c':
+        cfg.channels = std::strtoul(optarg, nullptr, 0);
+        break;
+      case 'p':
+        cfg.rt_priority = std::atoi(optarg);
+        break;
+      case 't':
+        duration = std::strtod(optarg, nullptr);
+        break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  if (argc - optind != 2) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::signal(SIGINT, on_signal);
+  std::signal(SIGTERM, on_signal);
+
+  try {
+    mmap_device dev(argv[optind], sizeof(wb_fofb_processing_regs), offset);
+    sp_decim_writer w(argv[optind + 1]);
+    sp_decim_acq acq(dev, 0, cfg);
+
+    const auto start = std::chrono::steady_clock::now();
+    acq.start(w);
+    for (unsigned ch = 0; ch < cfg.channels; ch++)
+      std::printf("ch %u: ratio %u, %.3f ms period\n", ch, acq.ratio(ch),
+                  acq.period_ns(ch) * 1e-6);
+    while (!stop_requested && !acq.write_failed()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+      if (duration > 0 && elapsed.count() >= duration)
+        break;
+    }
+    acq.stop();
+
+    const sp_decim_acq_stats st = acq.stats();
+    std::printf("%llu samples, %llu periods missed, %llu ambiguous, %llu relocks, "
+                "%llu dropped, latency mean %.1f us max %.1f us\n",
+                (unsigned long long)st.samples, (unsigned long long)st.missed,
+                (unsigned long long)st.ambiguous, (unsigned long long)st.relocks,
+                (unsigned long long)st.dropped,
+                st.samples ? st.sum_latency_ns * 1e-3 / st.samples : 0.,
+                st.max_latency_ns * 1e-3);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,196 @@
+// Identify the corrector to BPM response matrix from PRBS excitation runs
+//
+// usage: fofb_sys_id [-c prbs_ctl | -L lfsr_length -s step_duration -a taps_sel]
+//          [-k lags] [-j threads] [-m max_offset] [-n bpms] [-o out.txt]
+//          <ch,level_0,level_1,bpm.bin,sp.bin> [...]
+//
+// Each run excites channel 'ch' alone, with the PRBS set by prbs.ctl ('-c',
+// or its decoded fields) and the channel's sp_distort levels. bpm.bin holds
+// 'bpms' int32 BPM positions per FOFB cycle (c_NUM_BPM_POS by default) and
+// sp.bin the c_MAX_CHANNELS int32 set-points of the same cycles. The
+// excitation is regenerated from the PRBS model and aligned with the
+// captured set-points of 'ch', searching up to 'max_offset' cycles past the
+// PRBS reset (one period by default, at most 2**20). The responses are
+// estimated over 'lags' cycles (64 by default) with 'threads' threads (one
+// per CPU by default), and the matrix of static gains, one row per BPM
+// position and one column per run, is written to out.txt (stdout by
+// default).
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_prbs.h"
+#include "fofb_processing_model.h"
+#include "fofb_sys_id.h"
+
+using namespace fofb;
+
+namespace {
+
+constexpr size_t c_MAX_DEFAULT_OFFSET = size_t(1) << 20;
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-c prbs_ctl | -L lfsr_length -s step_duration -a taps_sel]\n"
+               "       [-k lags] [-j threads] [-m max_offset] [-n bpms] [-o out.txt]\n"
+               "       <ch,level_0,level_1,bpm.bin,sp.bin> [...]\n", prog);
+}
+
+struct run_spec {
+  unsigned ch;
+  prbs_levels lv;
+  std::string bpm_fname;
+  std::string sp_fname;
+};
+
+run_spec parse_run(const std::string &s)
+{
+  run_spec r;
+  char *end;
+  r.ch = std::strtoul(s.c_str(), &end, 0);
+  if (*end != ',' || r.ch >= c_MAX_CHANNELS)
+    throw std::invalid_argument("invalid run: " + s);
+  r.lv.level_0 = int16_t(std::strtol(end + 1, &end, 0));
+  if (*end != ',')
+    throw std::invalid_argument("invalid run: " + s);
+  r.lv.level_1 = int16_t(std::strtol(end + 1, &end, 0));
+  if (*end != ',')
+    throw std::invalid_argument("invalid run: " + s);
+  const std::string rest(end + 1);
+  const size_t comma = rest.find(',');
+  if (comma == std::string::npos || comma == 0 || comma + 1 == rest.size())
+    throw std::invalid_argument("invalid run: " + s);
+  r.bpm_fname = rest.substr(0, comma);
+  r.sp_fname = rest.substr(comma + 1);
+  return r;
+}
+
+std::vector<int32_t> read_int32_file(const std::string &fname, size_t width)
+{
+  std::ifstream fin(fname, std::ios::binary);
+  if (!fin)
+    throw std::runtime_error("can't open " + fname);
+  const std::vector<char> raw(std::istreambuf_iterator<char>(fin), {});
+  if (raw.empty() || raw.size() % (width * sizeof(int32_t)))
+    throw std::runtime_error(fname + ": not a whole number of cycles");
+  std::vector<int32_t> vals(raw.size() / sizeof(int32_t));
+  std::copy(raw.begin(), raw.end(), reinterpret_cast<char *>(vals.data()));
+  return vals;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  prbs_config pcfg;
+  sys_id_config cfg;
+  size_t max_offset = 0;
+  size_t bpms = c_NUM_BPM_POS;
+  const char *out_fname = nullptr;
+  int opt;
+  try {
+    while ((opt = getopt(argc, argv, "c:L:s:a:k:j:m:n:o:")) != -1) {
+      switch (opt) {
+        case 'c':
+          pcfg = prbs_config::from_ctl(std::strtoul(optarg, nullptr, 0));
+          break;
+        case 'L':
+          pcfg.lfsr_length = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 's':
+          pcfg.step_duration = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'a':
+          pcfg.sp_taps_sel = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'k':
+          cfg.lags = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'j':
+          cfg.threads = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'm':
+          max_offset = std::strtoull(optarg, nullptr, 0);
+          break;
+        case 'n':
+          bpms = std::strtoul(optarg, nullptr, 0);
+          break;
+        case 'o':
+          out_fname = optarg;
+          break;
+        default:
+          usage(argv[0]);
+          return 1;
+      }
+    }
+    if (argc - optind < 1 || bpms == 0) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (max_offset == 0)
+      max_offset = size_t(std::min<uint64_t>(pcfg.period() - 1, c_MAX_DEFAULT_OFFSET));
+
+    std::vector<run_spec> runs;
+    for (int i = optind; i < argc; i++)
+      runs.push_back(parse_run(argv[i]));
+
+    // gain[bpm][run]
+    std::vector<std::vector<double>> gains(bpms, std::vector<double>(runs.size()));
+    for (size_t r = 0; r < runs.size(); r++) {
+      const run_spec &run = runs[r];
+      const auto start = std::chrono::steady_clock::now();
+      const std::vector<int32_t> bpm = read_int32_file(run.bpm_fname, bpms);
+      const std::vector<int32_t> sp = read_int32_file(run.sp_fname, c_MAX_CHANNELS);
+      const size_t cycles = sp.size() / c_MAX_CHANNELS;
+      if (bpm.size() / bpms != cycles)
+        throw std::runtime_error(run.bpm_fname + " and " + run.sp_fname +
+                                 " hold different numbers of cycles");
+
+      std::vector<double> dist;
+      for (int32_t d: prbs_sp_distortion(pcfg, run.lv, cycles + max_offset))
+        dist.push_back(d);
+      const size_t off = sys_id_align(dist, &sp[run.ch], c_MAX_CHANNELS, cycles, max_offset);
+      const std::vector<double> x(dist.begin() + off, dist.begin() + off + cycles);
+      const sys_id_response res = sys_id_engine(x, cfg).estimate(bpm.data(), bpms, bpms);
+      for (size_t b = 0; b < bpms; b++)
+        gains[b][r] = res.gain[b];
+
+      const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+      std::fprintf(stderr, "channel %u: %zu cycles, PRBS offset %zu, %.2f s\n",
+                   run.ch, cycles, off, elapsed.count());
+    }
+
+    std::FILE *fout = out_fname ? std::fopen(out_fname, "w") : stdout;
+    if (!fout)
+      throw std::runtime_error(std::string("can't open ") + out_fname);
+    std::fprintf(fout, "# channels:");
+    for (const run_spec &run: runs)
+      std::fprintf(fout, " %u", run.ch);
+    std::fprintf(fout, "\n");
+    for (size_t b = 0; b < bpms; b++) {
+      for (size_t r = 0; r < runs.size(); r++)
+        std::fprintf(fout, "%s%.9g", r ? " " : "", gains[b][r]);
+      std::fprintf(fout, "\n");
+    }
+    if (fout != stdout)
+      std::fclose(fout);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}
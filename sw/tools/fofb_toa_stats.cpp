@@ -0,0 +1,198 @@
+// Per-node FOFB CC time of arrival statistics
+//
+// usage: fofb_toa_stats [-o offset] [-D deadline] [-w window] [-q quantile]
+//          [-f fraction] [-t seconds] [-s out.bin] <device>
+//        fofb_toa_stats -m in.bin [in.bin...]
+//        fofb_toa_stats [-w window] -S timeframes
+//
+// The first form snapshots the TOA buffer of the fofb_cc_regs block at
+// 'offset' of <device> back to back for 'seconds' (10 by default), feeding a
+// toa_monitor (see fofb_toa_stats.h): a warning is printed whenever the
+// 'quantile' (0.999 by default) of a node over 'window' snapshots (10000 by
+// default) reaches 'fraction' (0.8 by default) of the timeframe deadline,
+// time_frame_len read from the CC unless given with -D. The run totals are
+// saved to 'out.bin' if given. The second form merges statistics files (of
+// several runs or boards) and the third runs the monitor on 'timeframes'
+// synthetic snapshots, to measure its cost.
+//
+// The first two forms end printing the per-node totals as CSV:
+// node,count,missing,p50,p99,p999,max (in CC clock cycles).
+
+// Copyright (c) 2026 CNPEM
+// Licensed under GNU Lesser General Public License (LGPL) v3.0
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "fofb_cc_snapshot.h"
+#include "fofb_toa_stats.h"
+
+using namespace fofb;
+
+namespace {
+
+void usage(const char *prog)
+{
+  std::fprintf(stderr,
+               "usage: %s [-o offset] [-D deadline] [-w window] [-q quantile]\n"
+               "       [-f fraction] [-t seconds] [-s out.bin] <device>\n"
+               "       %s -m in.bin [in.bin...]\n"
+               "       %s [-w window] -S timeframes\n", prog, prog, prog);
+}
+
+void print_warnings(toa_monitor &mon)
+{
+  for (const toa_warning &w: mon.take_warnings())
+    std::fprintf(stderr, "window %llu: node %u %s deadline: p%g %u, max %u "
+                 "(%llu arrivals, %llu missing)\n",
+                 (unsigned long long)w.window, w.node,
+                 w.level == TOA_PAST_DEADLINE ? "past" : "near",
+                 mon.config().warn_quantile * 100, w.value, w.max,
+                 (unsigned long long)w.count, (unsigned long long)w.missing);
+}
+
+void print_totals(const std::vector<toa_sketch> &sketches)
+{
+  std::printf("node,count,missing,p50,p99,p999,max\n");
+  for (size_t node = 0; node < sketches.size(); node++) {
+    const toa_sketch &s = sketches[node];
+    if (s.count() == 0 && s.missing() == 0)
+      continue;
+    std::printf("%zu,%llu,%llu,%u,%u,%u,%u\n", node, (unsigned long long)s.count(),
+                (unsigned long long)s.missing(), s.quantile(0.5), s.quantile(0.99),
+                s.quantile(0.999), s.max());
+  }
+}
+
+void run_device(const char *device, off_t offset, toa_monitor_config cfg, double seconds,
+                const std::string &out)
+{
+  using cc = regs::fofb_cc_regs;
+  mmap_device dev(device, sizeof(::fofb_cc_regs), offset);
+  if (cfg.deadline == 0) {
+    regs::reg_block<cc> blk(dev);
+    cfg.deadline = blk.read<cc::ram_reg::data>(cc_cfg::time_frame_len);
+  }
+  toa_monitor mon(cfg);
+  cc_snapshot_config scfg;
+  scfg.toa_depth = cfg.nodes;
+  scfg.rcb_depth = 0;
+  scfg.xy_depth = 0;
+  fofb_cc_snapshotter<> snapper(dev, 0, scfg);
+  cc_snapshot snap;
+
+  const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+  while (std::chrono::steady_clock::now() < end) {
+    snapper.take(snap);
+    if (mon.add(snap.toa.data()))
+      print_warnings(mon);
+  }
+  mon.end_window();
+  print_warnings(mon);
+
+  std::fprintf(stderr, "%llu snapshots in %llu windows, deadline %u\n",
+               (unsigned long long)mon.snapshots(), (unsigned long long)mon.windows(),
+               cfg.deadline);
+  if (!out.empty())
+    write_toa_stats_file(out, mon.totals(), cfg.deadline, mon.snapshots());
+  print_totals(mon.totals());
+}
+
+void run_merge(char **files, int n)
+{
+  std::vector<toa_sketch> total;
+  uint64_t snapshots = 0;
+  for (int i = 0; i < n; i++) {
+    toa_stats_file_header hdr;
+    const std::vector<toa_sketch> s = read_toa_stats_file(files[i], &hdr);
+    if (total.size() < s.size())
+      total.resize(s.size());
+    for (size_t node = 0; node < s.size(); node++)
+      total[node].merge(s[node]);
+    snapshots += hdr.snapshots;
+  }
+  std::fprintf(stderr, "%llu snapshots from %d files\n", (unsigned long long)snapshots, n);
+  print_totals(total);
+}
+
+void run_synthetic(toa_monitor_config cfg, uint64_t timeframes)
+{
+  // Arrival times spread over the first half of the timeframe, with a node
+  // occasionally late
+  cfg.deadline = 5000;
+  toa_monitor mon(cfg);
+  std::vector<uint32_t> toa(cfg.nodes);
+  uint64_t rng = 1;
+  double busy = 0;
+  for (uint64_t tf = 0; tf < timeframes; tf++) {
+    for (unsigned node = 0; node < cfg.nodes; node++) {
+      rng ^= rng << 13;
+      rng ^= rng >> 7;
+      rng ^= rng << 17;
+      toa[node] = 500 + uint32_t(rng % 2000) + (rng >> 40 == 0 ? 3000 : 0);
+    }
+    const auto start = std::chrono::steady_clock::now();
+    mon.add(toa.data());
+    busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+  mon.end_window();
+  std::printf("%llu snapshots of %u nodes: %.1f ns per snapshot, %zu bytes of sketches, "
+              "%zu warnings\n", (unsigned long long)timeframes, cfg.nodes,
+              busy / timeframes * 1e9, 2 * cfg.nodes * sizeof(toa_sketch),
+              mon.take_warnings().size());
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  off_t offset = 0;
+  toa_monitor_config cfg;
+  double seconds = 10;
+  std::string out;
+  bool merge = false;
+  uint64_t synthetic = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:D:w:q:f:t:s:mS:")) != -1) {
+    switch (opt) {
+      case 'o': offset = std::strtoull(optarg, nullptr, 0); break;
+      case 'D': cfg.deadline = std::strtoul(optarg, nullptr, 0); break;
+      case 'w': cfg.window = std::strtoull(optarg, nullptr, 0); break;
+      case 'q': cfg.warn_quantile = std::strtod(optarg, nullptr); break;
+      case 'f': cfg.warn_fraction = std::strtod(optarg, nullptr); break;
+      case 't': seconds = std::strtod(optarg, nullptr); break;
+      case 's': out = optarg; break;
+      case 'm': merge = true; break;
+      case 'S': synthetic = std::strtoull(optarg, nullptr, 0); break;
+      default:
+        usage(argv[0]);
+        return 1;
+    }
+  }
+  const int nargs = argc - optind;
+  if ((synthetic && nargs != 0) || (!synthetic && merge && nargs < 1) ||
+      (!synthetic && !merge && nargs != 1)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  try {
+    if (synthetic)
+      run_synthetic(cfg, synthetic);
+    else if (merge)
+      run_merge(argv + optind, nargs);
+    else
+      run_device(argv[optind], offset, cfg, seconds, out);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "error: %s\n", e.what());
+    return 1;
+  }
+
+  return 0;
+}